@@ -60,7 +60,7 @@ static void run_client(unsigned short cltport, unsigned short srvport, unsigned
         msgid = mc_endpt_udp_post(&endpt, &addr, 0, uri, 0, mk_payload(ndoubles, itimes));
         msg = mc_endpt_udp_recv(&endpt);
         process_resp(msg);
-        if (msg) ms_free(mc_message_deinit(msg));
+        if (msg) mc_message_free(msg);
     }
     stop = mn_gettime();
     delta = stop - start;
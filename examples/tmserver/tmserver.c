@@ -23,7 +23,7 @@
 
  int request_handler(mc_endpt_udp_t* const endpt, mc_message_t* const msg) {
     // Currently just echoing the message.
-    if (msg->from) mc_endpt_udp_send(endpt, msg->from, msg, 0);
+    if (msg->from.ss_family) mc_endpt_udp_send(endpt, &msg->from, msg, 0);
     return 1;
  }
  
@@ -0,0 +1,329 @@
+/**
+ * A command line application which decodes the segments of a binary event log
+ * (see mcoap/mc_event_log.h) into text, or into a pcap file that wireshark can open.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_event_log.h"
+
+#define LINKTYPE_RAW    101     /**< pcap link type for bare IPv4 and IPv6 packets. */
+#define IPV4_HEADER     20
+#define IPV6_HEADER     40
+#define UDP_HEADER      8
+
+typedef struct segment segment_t;
+struct segment {
+    const char* path;
+    uint8_t* bytes;
+    size_t size;
+    const mc_event_log_header_t* header;
+};
+
+/** The last address recorded for each peer id, indexed like the log's known ids. */
+typedef struct peer peer_t;
+struct peer {
+    mn_peer_id_t id;
+    mc_event_addr_t addr;
+};
+
+static peer_t peers[MC_EVENT_LOG_PEERS];
+
+static void usage() {
+    printf(
+        "mcevlog [-x] [-w file.pcap] segment [segment..]\n"
+        "\n"
+        "mcevlog followed by 1 or more event log segments, e.g. events.0 events.1,\n"
+        "prints the events in the order they were written.\n"
+        "-x to also print the bytes of each datagram in hex\n"
+        "-w file.pcap to write the datagrams to a pcap file instead\n"
+        "Files that are not segments are skipped.\n");
+}
+
+/** Read a whole segment file. @return 1 on success. */
+static int read_segment(segment_t* segment, const char* path) {
+    FILE* file = fopen(path, "rb");
+    long size;
+
+    memset(segment, 0, sizeof(segment_t));
+    segment->path = path;
+    if (file == 0) {
+        fprintf(stderr, "Unable to open %s.\n", path);
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    /* Heap blocks are aligned for any type, so the events can be read in place. */
+    segment->bytes = size > 0 ? ms_malloc((size_t)size, uint8_t) : 0;
+    if (segment->bytes) segment->size = fread(segment->bytes, 1, (size_t)size, file);
+    fclose(file);
+
+    segment->header = mc_event_log_header(segment->bytes, segment->size);
+    if (segment->header == 0) {
+        fprintf(stderr, "%s is not an event log segment written on a machine of this byte order.\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+static int by_sequence(const void* left, const void* right) {
+    uint64_t lseq = ((const segment_t*)left)->header->sequence;
+    uint64_t rseq = ((const segment_t*)right)->header->sequence;
+
+    return lseq < rseq ? -1 : lseq > rseq;
+}
+
+static const mc_event_addr_t* find_peer(mn_peer_id_t id) {
+    peer_t* peer = &peers[MN_PEER_INDEX(id) % MC_EVENT_LOG_PEERS];
+    return peer->id == id ? &peer->addr : 0;
+}
+
+static void remember_peer(const mc_event_t* event) {
+    peer_t* peer = &peers[MN_PEER_INDEX(event->peer) % MC_EVENT_LOG_PEERS];
+
+    peer->id = event->peer;
+    memcpy(&peer->addr, event + 1, sizeof(mc_event_addr_t));
+}
+
+static char* format_addr(char* text, size_t size, const mc_event_addr_t* addr) {
+    const uint8_t* bytes = addr ? addr->addr : 0;
+    unsigned port = addr ? ((const uint8_t*)&addr->port)[0] << 8 | ((const uint8_t*)&addr->port)[1] : 0;
+
+    if (addr && addr->family == 4) {
+        snprintf(text, size, "%u.%u.%u.%u:%u", bytes[0], bytes[1], bytes[2], bytes[3], port);
+    }
+    else if (addr && addr->family == 6) {
+        snprintf(text, size, "[%x:%x:%x:%x:%x:%x:%x:%x]:%u",
+                 bytes[0] << 8 | bytes[1], bytes[2] << 8 | bytes[3], bytes[4] << 8 | bytes[5], bytes[6] << 8 | bytes[7],
+                 bytes[8] << 8 | bytes[9], bytes[10] << 8 | bytes[11], bytes[12] << 8 | bytes[13], bytes[14] << 8 | bytes[15],
+                 port);
+    }
+    else {
+        snprintf(text, size, "?");
+    }
+    return text;
+}
+
+static void print_hex(const uint8_t* bytes, uint32_t nbytes) {
+    uint32_t ibyte;
+
+    for (ibyte = 0; ibyte < nbytes; ibyte++) {
+        printf("%s%02x", ibyte % 16 == 0 ? "    " : " ", bytes[ibyte]);
+        if (ibyte % 16 == 15 || ibyte + 1 == nbytes) printf("\n");
+    }
+}
+
+static void print_event(const mc_event_t* event, int hex) {
+    time_t seconds = (time_t)(event->time / 1000000);
+    struct tm* utc = gmtime(&seconds);
+    char when[32];
+    char addr[64];
+
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", utc);
+    format_addr(addr, sizeof(addr), find_peer(event->peer));
+
+    if (event->type == MC_EVENT_PEER) {
+        printf("%s.%06u %-10s 0x%08x %s\n", when, (unsigned)(event->time % 1000000), mc_event_type_name(event->type),
+               event->peer, addr);
+        return;
+    }
+
+    printf("%s.%06u %-10s 0x%08x %s msgid %u code %u.%02u length %u\n", when, (unsigned)(event->time % 1000000),
+           mc_event_type_name(event->type), event->peer, addr, event->msgid, event->code >> 5, event->code & 0x1f,
+           event->length);
+    if (hex) print_hex((const uint8_t*)(event + 1), event->nbytes);
+}
+
+static uint8_t* put16(uint8_t* dest, uint32_t value) {
+    dest[0] = (uint8_t)(value >> 8);
+    dest[1] = (uint8_t)value;
+    return dest + 2;
+}
+
+/** Add bytes to a ones complement sum, 16 bits at a time. */
+static uint32_t sum16(uint32_t sum, const uint8_t* bytes, uint32_t nbytes) {
+    uint32_t ibyte;
+
+    for (ibyte = 0; ibyte + 1 < nbytes; ibyte += 2) sum += (uint32_t)(bytes[ibyte] << 8 | bytes[ibyte + 1]);
+    if (nbytes & 1) sum += (uint32_t)(bytes[nbytes - 1] << 8);
+    return sum;
+}
+
+static uint16_t fold(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+/**
+ * Build the IP and UDP headers for a datagram from src to dst.
+ * The UDP checksum is only filled in if the whole datagram was captured.
+ * @return the header bytes.
+ */
+static uint32_t mk_headers(uint8_t* packet, const mc_event_addr_t* src, const mc_event_addr_t* dst,
+                           const mc_event_t* event) {
+    uint32_t addrlen = src->family == 4 ? 4 : 16;
+    uint32_t udplen = UDP_HEADER + event->length;
+    uint32_t iplen = src->family == 4 ? IPV4_HEADER : IPV6_HEADER;
+    uint8_t* udp = packet + iplen;
+    uint32_t sum;
+
+    memset(packet, 0, iplen + UDP_HEADER);
+    if (src->family == 4) {
+        packet[0] = 0x45;
+        put16(packet + 2, iplen + udplen);
+        put16(packet + 6, 0x4000);
+        packet[8] = 64;
+        packet[9] = 17;
+        memcpy(packet + 12, src->addr, 4);
+        memcpy(packet + 16, dst->addr, 4);
+        put16(packet + 10, fold(sum16(0, packet, IPV4_HEADER)));
+    }
+    else {
+        packet[0] = 0x60;
+        put16(packet + 4, udplen);
+        packet[6] = 17;
+        packet[7] = 64;
+        memcpy(packet + 8, src->addr, 16);
+        memcpy(packet + 24, dst->addr, 16);
+    }
+
+    memcpy(udp, &src->port, 2);
+    memcpy(udp + 2, &dst->port, 2);
+    put16(udp + 4, udplen);
+
+    if (event->nbytes == event->length) {
+        /* Pseudo header, then the UDP header and data. */
+        sum = sum16(0, src->addr, addrlen);
+        sum = sum16(sum, dst->addr, addrlen);
+        sum += 17 + udplen;
+        sum = sum16(sum, udp, UDP_HEADER);
+        sum = sum16(sum, (const uint8_t*)(event + 1), event->nbytes);
+        sum = fold(sum);
+        put16(udp + 6, sum == 0 ? 0xffff : sum);
+    }
+    return iplen + UDP_HEADER;
+}
+
+static void write_pcap_header(FILE* pcap) {
+    struct {
+        uint32_t magic;
+        uint16_t major;
+        uint16_t minor;
+        int32_t zone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+    } header;
+
+    /* Written in this machine's byte order, which the magic number tells readers. */
+    header.magic = 0xa1b2c3d4;
+    header.major = 2;
+    header.minor = 4;
+    header.zone = 0;
+    header.sigfigs = 0;
+    header.snaplen = UINT16_MAX + IPV6_HEADER + UDP_HEADER;
+    header.linktype = LINKTYPE_RAW;
+    fwrite(&header, sizeof(header), 1, pcap);
+}
+
+/** Write a sent or received datagram as a packet between the endpoint and the peer. */
+static void write_packet(FILE* pcap, const mc_event_log_header_t* header, const mc_event_t* event) {
+    const mc_event_addr_t* peer = find_peer(event->peer);
+    mc_event_addr_t local = header->local;
+    uint8_t packet[IPV6_HEADER + UDP_HEADER];
+    uint32_t record[4];
+    uint32_t nheader;
+
+    if (peer == 0 || peer->family == 0) return;
+    if (local.family != peer->family) {
+        /* The endpoint's address was not given, or is of the other family. */
+        memset(local.addr, 0, sizeof(local.addr));
+        local.family = peer->family;
+    }
+
+    nheader = event->type == MC_EVENT_RECV ? mk_headers(packet, peer, &local, event) : mk_headers(packet, &local, peer, event);
+
+    record[0] = (uint32_t)(event->time / 1000000);
+    record[1] = (uint32_t)(event->time % 1000000);
+    record[2] = nheader + event->nbytes;
+    record[3] = nheader + event->length;
+    fwrite(record, sizeof(record), 1, pcap);
+    fwrite(packet, nheader, 1, pcap);
+    fwrite(event + 1, event->nbytes, 1, pcap);
+}
+
+static void decode(segment_t* segment, FILE* pcap, int hex) {
+    const mc_event_t* event;
+    char local[64];
+    size_t pos = 0;
+
+    memset(peers, 0, sizeof(peers));
+    if (pcap == 0) {
+        printf("# %s segment %u snaplen %u local %s\n", segment->path, (unsigned)segment->header->sequence,
+               segment->header->snaplen, format_addr(local, sizeof(local), &segment->header->local));
+    }
+
+    while ((event = mc_event_log_next(segment->bytes, segment->size, &pos)) != 0) {
+        if (event->type == MC_EVENT_PEER && event->nbytes == sizeof(mc_event_addr_t)) remember_peer(event);
+
+        if (pcap == 0) {
+            print_event(event, hex);
+        }
+        else if (event->type == MC_EVENT_SEND || event->type == MC_EVENT_RECV || event->type == MC_EVENT_RETRANSMIT) {
+            write_packet(pcap, segment->header, event);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* pcappath = 0;
+    segment_t* segments;
+    FILE* pcap = 0;
+    int nsegments = 0;
+    int hex = 0;
+    int err = 0;
+    int iarg;
+
+    segments = ms_calloc(argc, segment_t);
+    for (iarg = 1; iarg < argc && !err; iarg++) {
+        if (strcmp("-x", argv[iarg]) == 0) {
+            hex = 1;
+        }
+        else if (strcmp("-w", argv[iarg]) == 0) {
+            if (iarg + 1 < argc) pcappath = argv[++iarg];
+            else err = 1;
+        }
+        else if (read_segment(&segments[nsegments], argv[iarg])) {
+            nsegments++;
+        }
+        else {
+            /* Skip it, the other segments can still be decoded. */
+            ms_free(segments[nsegments].bytes);
+        }
+    }
+
+    if (err || nsegments == 0) {
+        usage();
+    }
+    else if (pcappath && (pcap = fopen(pcappath, "wb")) == 0) {
+        fprintf(stderr, "Unable to create %s.\n", pcappath);
+        err = 1;
+    }
+    else {
+        qsort(segments, nsegments, sizeof(segment_t), by_sequence);
+        if (pcap) write_pcap_header(pcap);
+        for (iarg = 0; iarg < nsegments; iarg++) decode(&segments[iarg], pcap, hex);
+        if (pcap) fclose(pcap);
+    }
+
+    for (iarg = 0; iarg < nsegments; iarg++) ms_free(segments[iarg].bytes);
+    ms_free(segments);
+    return err || nsegments == 0;
+}
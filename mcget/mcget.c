@@ -78,7 +78,7 @@ static void get_uri(unsigned short port, char* const uri) {
 
     print_msg(msg);
 
-    if (msg) ms_free(mc_message_deinit(msg));
+    if (msg) mc_message_free(msg);
     mc_endpt_udp_deinit(&endpt);
 }
 
@@ -7,12 +7,16 @@
 #include <string.h>
 #include "msys/ms_memory.h"
 #include "mcoap/mc_buffer.h"
+#include "mcoap/mc_pool.h"
 
 /**
- * Allocate a mc_buffer_t struct.
+ * Allocate a mc_buffer_t struct from the buffer pool, free it with mc_buffer_free.
  */
 mc_buffer_t* mc_buffer_alloc() {
-    return ms_calloc(1, mc_buffer_t);
+    mc_buffer_t* buffer = ms_pool_get(mc_pool_buffers());
+
+    if (buffer) memset(buffer, 0, sizeof(mc_buffer_t));
+    return buffer;
 }
 
 /**
@@ -36,6 +40,13 @@ mc_buffer_t* mc_buffer_deinit(mc_buffer_t* buffer) {
     return buffer;
 }
 
+/**
+ * Deinitialize a buffer from mc_buffer_alloc and return it to the pool, 0 is ignored.
+ */
+void mc_buffer_free(mc_buffer_t* buffer) {
+    if (buffer) ms_pool_put(mc_pool_buffers(), mc_buffer_deinit(buffer));
+}
+
 uint8_t mc_buffer_next_uint8(const mc_buffer_t* buffer, uint32_t* bpos) {
 	uint8_t byte = buffer->bytes[*bpos];
 	(*bpos)++;
@@ -47,7 +58,7 @@ uint8_t mc_buffer_next_uint8(const mc_buffer_t* buffer, uint32_t* bpos) {
 uint16_t mc_buffer_next_uint16(const mc_buffer_t* buffer, uint32_t* bpos) {
 	uint16_t result;
 
-	memcpy(&(buffer->bytes[*bpos]), &result, 2);
+	memcpy(&result, &(buffer->bytes[*bpos]), 2);
 	(*bpos) += 2;
 
 	return result;
@@ -101,7 +112,7 @@ mc_buffer_t* mc_buffer_copy(const mc_buffer_t* src, uint32_t spos, uint32_t nbyt
 	if (src == 0) return 0;
 	if ((src->nbytes - spos) < nbytes) return 0;
 
-	result = mc_buffer_init(mc_buffer_alloc(), nbytes, ms_calloc(nbytes, uint8_t));
+	result = mc_buffer_init(mc_buffer_alloc(), nbytes, ms_calloc_tag(MS_MEM_BUFFER, nbytes, uint8_t));
 	return copy_to(result, 0, src, spos, nbytes);
 }
 
@@ -17,6 +17,7 @@ struct mc_buffer {
 
 mc_buffer_t* mc_buffer_alloc();
 mc_buffer_t* mc_buffer_deinit(mc_buffer_t* buffer);
+void mc_buffer_free(mc_buffer_t* buffer);
 mc_buffer_t* mc_buffer_init(mc_buffer_t* buffer, uint32_t nbytes, uint8_t* bytes);
 uint8_t mc_buffer_next_uint8(const mc_buffer_t* buffer, uint32_t* bpos);
 uint16_t mc_buffer_next_uint16(const mc_buffer_t* buffer, uint32_t* bpos);
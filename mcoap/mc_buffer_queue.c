@@ -1,15 +1,16 @@
+#define MS_LOG_CATEGORY MS_LOG_ENDPT
+
+#include <math.h>
+#include <string.h>
+
 #include "msys/ms_log.h"
 #include "msys/ms_memory.h"
+#include "msys/ms_random.h"
+#include "mnet/mn_timeout.h"
 #include "mcoap/mc_endpt_udp.h"
 #include "mcoap/mc_buffer_queue.h"
 
-/**
- * Allocate an entry for the queue.
- * @return the entry.
- */
-static mc_buffer_queue_entry_t* queue_entry_alloc() {
-    return (mc_buffer_queue_entry_t*)calloc(1, sizeof(mc_buffer_queue_entry_t));
-}
+#define MIN_CAPACITY 16
 
 /**
  * Generate a timeout value between ACK_TIMEOUT and ACK_TIMEOUT * ACK_RANDOM_FACTOR.
@@ -24,243 +25,216 @@ static double mk_timeout() {
 	double delta = (ack * factor) - ack;
 
 	/* Generate a random number from 0..1 to multiply delta by. */
-	double randfraction = (double)rand();
-	randfraction = randfraction / RAND_MAX;
+	double randfraction = ms_random_fraction(ms_random_thread());
 
 	return ack + (randfraction * delta);
 }
 
-/**
- * Initialize the entry fields.
- * @return the initialized entry.
- */
-static mc_buffer_queue_entry_t* queue_entry_init(
-		mc_buffer_queue_entry_t* entry,
-		uint32_t msgid,
-		sockaddr_t* dest,
-		mc_buffer_t* msg,
-		mc_endpt_result_fn_t resultfn,
-		mc_buffer_queue_entry_t* prev,
-		mc_buffer_queue_entry_t* next) {
-    entry->msgid = msgid;
-    entry->dest = dest;
-    entry->msg = msg;
-    entry->resultfn = resultfn;
-    entry->prev = prev;
-    entry->next = next;
-
-    entry->xmitcounter = 0;
-
-    mn_timeout_init(&entry->timeout, -1.0, mk_timeout());
-    mn_timeout_markstart(&entry->timeout);
-
-    return entry;
-}
-
-static mc_buffer_queue_entry_t* queue_entry_deinit(mc_buffer_queue_entry_t* entry) {
-    entry->msgid = 0;
-    ms_free(entry->dest);
-    entry->dest = 0;
-    ms_free(mc_buffer_deinit(entry->msg));
-    entry->msg = 0;
-    entry->resultfn = 0;
-    entry->prev = 0;
-    entry->next = 0;
-    entry->xmitcounter = 0;
-
-    mn_timeout_init(&entry->timeout, 0.0, 0.0);
-
-    return entry;
-}
-
 /**
  * Allocate a buffer queue.
  * @return the allocated queue.
  */
 mc_buffer_queue_t* mc_buffer_queue_alloc() {
-    return (mc_buffer_queue_t*)calloc(1, sizeof(mc_buffer_queue_t));
+    return ms_calloc(1, mc_buffer_queue_t);
 }
 
-/** 
- * Init a queue.
+/**
+ * Init a queue, the slots are allocated on the first add.
  * @return the queue.
  */
 mc_buffer_queue_t* mc_buffer_queue_init(mc_buffer_queue_t* queue) {
-    queue->first = 0;
-    queue->last = 0;
-
+    memset(queue, 0, sizeof(mc_buffer_queue_t));
     return queue;
 }
 
-/** 
- * Add to the end of the queue.
+/**
+ * Release the queued messages and free the slots, the result fns are not called.
  * @return the queue.
  */
-mc_buffer_queue_entry_t* mc_buffer_queue_add(mc_buffer_queue_t* queue, uint16_t msgid, sockaddr_t* dest, mc_buffer_t* msg, mc_endpt_result_fn_t resultfn) {
+mc_buffer_queue_t* mc_buffer_queue_deinit(mc_buffer_queue_t* queue) {
+    uint32_t slot;
 
-    mc_buffer_queue_entry_t* entry;
+    for (slot = 0; slot < queue->nslots; slot++) mc_shared_buffer_release(queue->msgs[slot]);
 
-    if (queue->first == 0) {
-        entry = queue_entry_init(queue_entry_alloc(), msgid, dest, msg, resultfn, 0, 0);
-        queue->first = entry;
-        queue->last = queue->first;
-    }
-    else {
-        entry = queue_entry_init(queue_entry_alloc(), msgid, dest, msg, resultfn, queue->last, 0);
-        queue->last->next = entry;
-        queue->last = entry;
-    }
-    ms_log_debug("add msgid: %d", msgid);
+    ms_free(queue->deadlines);
+    ms_free(queue->timeouts);
+    ms_free(queue->msgids);
+    ms_free(queue->xmits);
+    ms_free(queue->peers);
+    ms_free(queue->resultfns);
+    ms_free(queue->msgs);
+    ms_free(queue->nextfree);
 
-    return entry;
+    return mc_buffer_queue_init(queue);
 }
 
 /**
- * Count the number of entries in the queue.
- * @return the count.
+ * Grow the slot arrays to hold at least capacity messages, e.g. to preallocate for the
+ * number of confirmable messages a server keeps outstanding.
+ * @return 1 on success, 0 if allocation fails.
  */
-uint32_t mc_buffer_queue_count(const mc_buffer_queue_t* queue) {
-    mc_buffer_queue_entry_t* current = queue->first;
-    uint32_t count = 0;
-
-    while (current) {
-        count++;
-        current = current->next;
+int mc_buffer_queue_reserve(mc_buffer_queue_t* queue, uint32_t capacity) {
+    double* deadlines;
+    float* timeouts;
+    uint16_t* msgids;
+    uint8_t* xmits;
+    mn_peer_id_t* peers;
+    mc_endpt_result_fn_t* resultfns;
+    mc_shared_buffer_t** msgs;
+    uint32_t* nextfree;
+
+    if (capacity <= queue->capacity) return 1;
+
+    /* Each array is stored as soon as it grows, the capacity only once they all have. */
+    if ((deadlines = ms_realloc_tag(MS_MEM_QUEUE, queue->deadlines, capacity, double)) == 0) return 0;
+    queue->deadlines = deadlines;
+    if ((timeouts = ms_realloc_tag(MS_MEM_QUEUE, queue->timeouts, capacity, float)) == 0) return 0;
+    queue->timeouts = timeouts;
+    if ((msgids = ms_realloc_tag(MS_MEM_QUEUE, queue->msgids, capacity, uint16_t)) == 0) return 0;
+    queue->msgids = msgids;
+    if ((xmits = ms_realloc_tag(MS_MEM_QUEUE, queue->xmits, capacity, uint8_t)) == 0) return 0;
+    queue->xmits = xmits;
+    if ((peers = ms_realloc_tag(MS_MEM_QUEUE, queue->peers, capacity, mn_peer_id_t)) == 0) return 0;
+    queue->peers = peers;
+    if ((resultfns = ms_realloc_tag(MS_MEM_QUEUE, queue->resultfns, capacity, mc_endpt_result_fn_t)) == 0) return 0;
+    queue->resultfns = resultfns;
+    if ((msgs = ms_realloc_tag(MS_MEM_QUEUE, queue->msgs, capacity, mc_shared_buffer_t*)) == 0) return 0;
+    queue->msgs = msgs;
+    if ((nextfree = ms_realloc_tag(MS_MEM_QUEUE, queue->nextfree, capacity, uint32_t)) == 0) return 0;
+    queue->nextfree = nextfree;
+
+    queue->capacity = capacity;
+    return 1;
+}
+
+/** @return a free slot or MC_BUFFER_QUEUE_NONE if allocation fails. */
+static uint32_t take_slot(mc_buffer_queue_t* queue) {
+    uint32_t slot;
+
+    if (queue->freelist) {
+        slot = queue->freelist - 1;
+        queue->freelist = queue->nextfree[slot];
+        return slot;
     }
 
-    return count;
+    if (queue->nslots == queue->capacity) {
+        uint32_t capacity = queue->capacity ? queue->capacity * 2 : MIN_CAPACITY;
+        if (!mc_buffer_queue_reserve(queue, capacity)) return MC_BUFFER_QUEUE_NONE;
+    }
+    return queue->nslots++;
 }
 
 /**
- * Remove an entry from the queue.
- * @return the entry with the prevous and next pointers 0'd.
+ * Add a message and start its retransmit timer, the slot takes over the caller's reference to msg.
+ * @return the slot, or MC_BUFFER_QUEUE_NONE if allocation fails, msg is then released.
  */
-static mc_buffer_queue_entry_t* remove_entry(mc_buffer_queue_t* queue, mc_buffer_queue_entry_t* current) {
-    /* Detatch the prev node and make it point to the next node. */
-    /* If this current is at the top then we just have to reset queue->first. */
-    if (current->prev) {
-        current->prev->next = current->next;
-    } 
-    else {
-        queue->first = current->next;
-    }
+uint32_t mc_buffer_queue_add(mc_buffer_queue_t* queue, uint16_t msgid, mn_peer_id_t peer, mc_shared_buffer_t* msg, mc_endpt_result_fn_t resultfn) {
+    uint32_t slot = take_slot(queue);
 
-    /* Detach the next node and make it point to the prev node. */
-    /* If current is on the bottom we just have to reset queue->last. */
-    if (current->next) {
-        current->next->prev = current->prev;
-    }
-    else {
-        queue->last = current->prev;
+    if (slot == MC_BUFFER_QUEUE_NONE) {
+        ms_log_debug("Unable to queue msgid: %d", msgid);
+        mc_shared_buffer_release(msg);
+        return slot;
     }
 
-    /* Clear prev, next pointers so the caller can't use them. */
-    current->prev = 0;
-    current->next = 0;
+    queue->timeouts[slot] = (float)mk_timeout();
+    queue->deadlines[slot] = mn_gettime() + queue->timeouts[slot];
+    queue->msgids[slot] = msgid;
+    queue->xmits[slot] = 0;
+    queue->peers[slot] = peer;
+    queue->resultfns[slot] = resultfn;
+    queue->msgs[slot] = msg;
+    queue->nextfree[slot] = 0;
+    queue->count++;
+    ms_log_debug("add msgid: %d", msgid);
+
+    return slot;
+}
 
-    return current;
+/**
+ * Count the number of messages in the queue.
+ * @return the count.
+ */
+uint32_t mc_buffer_queue_count(const mc_buffer_queue_t* queue) {
+    return queue->count;
 }
 
 /**
- * Remove the given entry and delete it.
- * Unlike many functions, it actually frees the entry pointer
- * and not just deinit'ing its contents.
- * @return the *next* entry in the list.
+ * Return the slot with the matching message id.
+ * @return the slot or MC_BUFFER_QUEUE_NONE if queue is 0 or the id is not queued.
  */
-mc_buffer_queue_entry_t* mc_buffer_queue_remove_entry(mc_buffer_queue_t* queue, mc_buffer_queue_entry_t* entry) {
-    mc_buffer_queue_entry_t* result;
-    if (entry == 0) return 0;
+uint32_t mc_buffer_queue_get(const mc_buffer_queue_t* queue, uint16_t msgid) {
+    uint32_t slot;
 
-    result = entry->next;
-    entry = remove_entry(queue, entry);
-    ms_free(queue_entry_deinit(entry));
+    if (queue == 0) return MC_BUFFER_QUEUE_NONE;
 
-    return result;
+    for (slot = 0; slot < queue->nslots; slot++) {
+        if (queue->msgids[slot] == msgid && queue->msgs[slot]) return slot;
+    }
+    return MC_BUFFER_QUEUE_NONE;
 }
 
 /**
- * Return the entry with the matching message id.
- * @return the matching entry or 0 if queue is 0 or entry not found.
+ * Release a slot's message and put the slot on the free list.
  */
-mc_buffer_queue_entry_t* mc_buffer_queue_get(mc_buffer_queue_t* queue, uint16_t msgid) {
-    mc_buffer_queue_entry_t* current;
-
-    if (queue == 0) return 0;
-
-    current = queue->first;
-    while (current) {
-        if (current->msgid == msgid) {
-            return current;
-        }
-        else {
-            current = current->next;
-        }
+void mc_buffer_queue_remove_slot(mc_buffer_queue_t* queue, uint32_t slot) {
+    if (slot >= queue->nslots || queue->msgs[slot] == 0) return;
+
+    mc_shared_buffer_release(queue->msgs[slot]);
+    queue->msgs[slot] = 0;
+    queue->deadlines[slot] = HUGE_VAL;
+    queue->peers[slot] = MN_PEER_NONE;
+    queue->resultfns[slot] = 0;
+    queue->count--;
+
+    /* Once the queue drains start over so scans stay short after a burst. */
+    if (queue->count == 0) {
+        queue->nslots = 0;
+        queue->freelist = 0;
+    }
+    else {
+        queue->nextfree[slot] = queue->freelist;
+        queue->freelist = slot + 1;
     }
-    return 0;
 }
 
 /**
- * Remove the next entry with the given flow_id.
+ * Remove the message with the given id.
  * @return the queued msg_id or UINT32_MAX if not found.
  */
 uint32_t mc_buffer_queue_remove(mc_buffer_queue_t* queue, uint16_t msgid) {
-    mc_buffer_queue_entry_t* entry = mc_buffer_queue_get(queue, msgid);
-    if (entry == 0) return UINT32_MAX;
+    uint32_t slot = mc_buffer_queue_get(queue, msgid);
+    if (slot == MC_BUFFER_QUEUE_NONE) return UINT32_MAX;
 
-    mc_buffer_queue_remove_entry(queue, entry);
+    mc_buffer_queue_remove_slot(queue, slot);
     return msgid;
 }
 
 /**
- * Free the contents of a queue.
- * @return the queue pointer
+ * Double the time to wait for the ACK and restart the slot's timer from now.
+ * Implements the exponential back off algorithm.
  */
-mc_buffer_queue_t* mc_buffer_queue_free(mc_buffer_queue_t* queue) {
-    while (queue->first) {
-        mc_buffer_queue_remove_entry(queue, queue->first);
-    }
-    return queue;
+void mc_buffer_queue_backoff(mc_buffer_queue_t* queue, uint32_t slot, double now) {
+    queue->timeouts[slot] *= 2.0f;
+    queue->deadlines[slot] = now + queue->timeouts[slot];
 }
 
 /**
- * Return the next entry (including this one) that has a timeout.
- * If this routine returns a timed out entry, to find the next onec
- * call the function again with entry->next;
- * @return pointer to a timed out entry, 0 if none.
+ * Return the next slot (including this one) that has timed out at now.
+ * To find the following one call the function again with the result + 1.
+ * @return the timed out slot or MC_BUFFER_QUEUE_NONE if none.
  */
-mc_buffer_queue_entry_t* mc_buffer_queue_next_timeout(mc_buffer_queue_entry_t* entry) {
-    while (entry && (mn_timeout_get(&entry->timeout) != 0.0)) {
-    	entry = entry->next;
+uint32_t mc_buffer_queue_next_timeout(const mc_buffer_queue_t* queue, uint32_t slot, double now) {
+    for (; slot < queue->nslots; slot++) {
+        if (queue->deadlines[slot] <= now) return slot;
     }
-
-    return entry;
+    return MC_BUFFER_QUEUE_NONE;
 }
 
 /**
- * Scan the pending queue for timeouts, but do not modify the queue.
+ * Scan the queue for timeouts, but do not modify the queue.
  * @return the true if one found, false otherwise.
  */
 int mc_buffer_queue_has_timeout(const mc_buffer_queue_t* queue) {
-    return (mc_buffer_queue_next_timeout(queue->first) != 0);
-}
-
-/**
- * Scan the pending queue for timeouts and remove the first one found.
- * @return the first timed out entry or 0 if none found.
- */
-mc_buffer_queue_entry_t* mc_buffer_queue_timeout(mc_buffer_queue_t* queue) {
-    mc_buffer_queue_entry_t* current = queue->first;
-    mc_buffer_queue_entry_t* result = 0;
-
-    while (current) {
-        if (mn_timeout_get(&current->timeout) == 0.0) {
-            result = remove_entry(queue, current);
-            current = 0;
-        }
-        else {
-            current = current->next;
-        }
-    }
-
-    return result;
+    return mc_buffer_queue_next_timeout(queue, 0, mn_gettime()) != MC_BUFFER_QUEUE_NONE;
 }
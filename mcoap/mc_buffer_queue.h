@@ -2,48 +2,57 @@
 #define MC_BUFFER_QUEUE
 
 #include "msys/ms_config.h"
-#include "mnet/mn_timeout.h"
+#include "mnet/mn_peer_table.h"
 #include "mcoap/mc_buffer.h"
+#include "mcoap/mc_shared_buffer.h"
 
 #define MC_XMIT_TIMEOUT        -1
 #define MC_XMIT_ACK_RECEIVED    0
 
+#define MC_BUFFER_QUEUE_NONE    UINT32_MAX  /**< Not a slot, e.g. the message id is not queued. */
+
 /* And endpt id is the pointer to the endpt that sent the message. */
 /* Its encoded this way so the buffer queue can be defined independently of the endpt. */
 typedef void* mc_endpt_id_t;
 
 typedef int (*mc_endpt_result_fn_t)(mc_endpt_id_t endpt, uint16_t msgid, int status);
 
-/** Define a queue for confirmable messages for managing retransmits. */
-typedef struct mc_buffer_queue_entry mc_buffer_queue_entry_t;
-struct mc_buffer_queue_entry {
-    uint16_t msgid;
-    uint16_t xmitcounter;
-    sockaddr_t* dest;
-    mn_timeout_t timeout;
-    mc_endpt_result_fn_t resultfn;
-    mc_buffer_t* msg;
-    mc_buffer_queue_entry_t* prev;
-    mc_buffer_queue_entry_t* next;
-};
-
-
+/**
+ * Define a queue for confirmable messages for managing retransmits.
+ *
+ * Each outstanding message has a slot, and the slots' fields are kept in parallel arrays
+ * so the timeout scan only reads the deadlines and a message id lookup only reads the
+ * msgids. Free slots are chained through nextfree and reused, and a slot never moves,
+ * so its index stays valid until it is removed even if the arrays grow.
+ * The destination is a peer id in the endpoint's peer table rather than an address.
+ */
 typedef struct mc_buffer_queue mc_buffer_queue_t;
 struct mc_buffer_queue {
-	mc_buffer_queue_entry_t* first;
-	mc_buffer_queue_entry_t* last;
+    uint32_t count;                     /**< Slots in use. */
+    uint32_t nslots;                    /**< Slots in use or free, scans stop here. */
+    uint32_t capacity;
+    uint32_t freelist;                  /**< First free slot + 1, 0 if none. */
+    double* deadlines;                  /**< When to retransmit, HUGE_VAL for free slots. */
+    float* timeouts;                    /**< Seconds to wait for the ACK, doubled on each retransmit. */
+    uint16_t* msgids;
+    uint8_t* xmits;                     /**< Times sent. */
+    mn_peer_id_t* peers;                /**< Destinations, MN_PEER_NONE for free slots. */
+    mc_endpt_result_fn_t* resultfns;
+    mc_shared_buffer_t** msgs;          /**< The serialized messages, a slot holds one reference. */
+    uint32_t* nextfree;                 /**< Next free slot + 1 while a slot is free. */
 };
 
 mc_buffer_queue_t* mc_buffer_queue_alloc();
 mc_buffer_queue_t* mc_buffer_queue_init(mc_buffer_queue_t* queue);
-mc_buffer_queue_entry_t* mc_buffer_queue_add(mc_buffer_queue_t* queue, uint16_t msgid, sockaddr_t* dest, mc_buffer_t* msg, mc_endpt_result_fn_t resultfn);
+mc_buffer_queue_t* mc_buffer_queue_deinit(mc_buffer_queue_t* queue);
+int mc_buffer_queue_reserve(mc_buffer_queue_t* queue, uint32_t capacity);
+uint32_t mc_buffer_queue_add(mc_buffer_queue_t* queue, uint16_t msgid, mn_peer_id_t peer, mc_shared_buffer_t* msg, mc_endpt_result_fn_t resultfn);
 uint32_t mc_buffer_queue_count(const mc_buffer_queue_t* queue);
-mc_buffer_queue_entry_t* mc_buffer_queue_get(mc_buffer_queue_t* queue, uint16_t msgid);
-mc_buffer_queue_entry_t* mc_buffer_queue_remove_entry(mc_buffer_queue_t* queue, mc_buffer_queue_entry_t* entry);
+uint32_t mc_buffer_queue_get(const mc_buffer_queue_t* queue, uint16_t msgid);
+void mc_buffer_queue_remove_slot(mc_buffer_queue_t* queue, uint32_t slot);
 uint32_t mc_buffer_queue_remove(mc_buffer_queue_t* queue, uint16_t msgid);
-mc_buffer_queue_t* mc_buffer_queue_deinit(mc_buffer_queue_t* queue);
-mc_buffer_queue_entry_t* mc_buffer_queue_next_timeout(mc_buffer_queue_entry_t* entry);
+void mc_buffer_queue_backoff(mc_buffer_queue_t* queue, uint32_t slot, double now);
+uint32_t mc_buffer_queue_next_timeout(const mc_buffer_queue_t* queue, uint32_t slot, double now);
 int mc_buffer_queue_has_timeout(const mc_buffer_queue_t* queue);
-mc_buffer_queue_entry_t* mc_buffer_queue_timeout(mc_buffer_queue_t* queue);
 
 #endif
@@ -0,0 +1,542 @@
+/**
+ * @file
+ * @ingroup discovery
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_discovery.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+mc_discovery_t* mc_discovery_alloc() {
+    return ms_calloc(1, mc_discovery_t);
+}
+
+mc_discovery_t* mc_discovery_init(mc_discovery_t* disc) {
+    memset(disc, 0, sizeof(mc_discovery_t));
+    disc->szx = MC_DISCOVERY_BLOCK_SZX;
+    return disc;
+}
+
+static void index_deinit(mc_link_index_t* index) {
+    uint32_t ientry;
+
+    for (ientry = 0; ientry < index->count; ientry++) {
+        ms_free(index->entries[ientry].value);
+        ms_free(index->entries[ientry].slots);
+    }
+    ms_free(index->entries);
+    ms_free(index->buckets);
+    memset(index, 0, sizeof(mc_link_index_t));
+}
+
+mc_discovery_t* mc_discovery_deinit(mc_discovery_t* disc) {
+    uint32_t slot;
+
+    for (slot = 0; slot < disc->nlinks; slot++) {
+        ms_free(disc->links[slot].path);
+        ms_free(disc->links[slot].rt);
+        ms_free(disc->links[slot].ifdesc);
+    }
+    ms_free(disc->links);
+    ms_free(disc->payload);
+    ms_free(disc->result);
+    index_deinit(&disc->hrefs);
+    index_deinit(&disc->rts);
+    index_deinit(&disc->ifs);
+    index_deinit(&disc->cts);
+    memset(disc, 0, sizeof(mc_discovery_t));
+
+    return disc;
+}
+
+/* FNV-1a over the value bytes. */
+static uint32_t value_hash(const char* value, uint32_t nvalue) {
+    uint32_t hash = FNV_OFFSET;
+    uint32_t ibyte;
+
+    for (ibyte = 0; ibyte < nvalue; ibyte++) {
+        hash ^= (uint8_t)value[ibyte];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static mc_link_postings_t* index_find(const mc_link_index_t* index, const char* value, uint32_t nvalue) {
+    uint32_t hash = value_hash(value, nvalue);
+    uint32_t next;
+
+    if (index->nbuckets == 0) return 0;
+
+    next = index->buckets[hash & (index->nbuckets - 1)];
+    while (next) {
+        mc_link_postings_t* entry = &index->entries[next - 1];
+        if (entry->hash == hash && entry->nvalue == nvalue && memcmp(entry->value, value, nvalue) == 0) return entry;
+        next = entry->chain;
+    }
+    return 0;
+}
+
+/** @return 1 on success, 0 if allocation fails. */
+static int index_grow(mc_link_index_t* index) {
+    uint32_t capacity = index->capacity ? index->capacity * 2 : 16;
+    uint32_t nbuckets = 1;
+    mc_link_postings_t* entries;
+    uint32_t* buckets;
+    uint32_t ientry;
+
+    entries = ms_realloc(index->entries, capacity, mc_link_postings_t);
+    if (entries == 0) return 0;
+    index->entries = entries;
+
+    while (nbuckets < capacity) nbuckets <<= 1;
+    buckets = ms_realloc(index->buckets, nbuckets, uint32_t);
+    if (buckets == 0) return 0;
+    index->buckets = buckets;
+    index->nbuckets = nbuckets;
+    index->capacity = capacity;
+
+    memset(buckets, 0, nbuckets * sizeof(uint32_t));
+    for (ientry = 0; ientry < index->count; ientry++) {
+        uint32_t* bucket = &buckets[entries[ientry].hash & (nbuckets - 1)];
+        entries[ientry].chain = *bucket;
+        *bucket = ientry + 1;
+    }
+    return 1;
+}
+
+/** @return 1 on success, 0 if allocation fails. */
+static int index_add(mc_link_index_t* index, const char* value, uint32_t nvalue, uint32_t slot) {
+    mc_link_postings_t* entry = index_find(index, value, nvalue);
+
+    if (entry == 0) {
+        uint32_t* bucket;
+
+        if (index->count == index->capacity && !index_grow(index)) return 0;
+        entry = &index->entries[index->count];
+        memset(entry, 0, sizeof(mc_link_postings_t));
+        entry->value = ms_copy_char(nvalue, value);
+        if (entry->value == 0) return 0;
+        entry->nvalue = nvalue;
+        entry->hash = value_hash(value, nvalue);
+
+        bucket = &index->buckets[entry->hash & (index->nbuckets - 1)];
+        entry->chain = *bucket;
+        *bucket = ++index->count;
+    }
+
+    /* A value repeated in one attribute, e.g. rt="a a", is indexed once. */
+    if (entry->count > 0 && entry->slots[entry->count - 1] == slot) return 1;
+
+    if (entry->count == entry->capacity) {
+        uint32_t capacity = entry->capacity ? entry->capacity * 2 : 4;
+        uint32_t* slots = ms_realloc(entry->slots, capacity, uint32_t);
+
+        if (slots == 0) return 0;
+        entry->slots = slots;
+        entry->capacity = capacity;
+    }
+    entry->slots[entry->count++] = slot;
+
+    return 1;
+}
+
+/* The chain link that points at an entry, in its bucket or in the entry before it. */
+static uint32_t* chain_to(mc_link_index_t* index, uint32_t ientry) {
+    uint32_t* link = &index->buckets[index->entries[ientry].hash & (index->nbuckets - 1)];
+
+    while (*link != ientry + 1) link = &index->entries[*link - 1].chain;
+    return link;
+}
+
+/* Free an entry and move the last entry into its place. */
+static void index_delete(mc_link_index_t* index, mc_link_postings_t* entry) {
+    uint32_t ientry = (uint32_t)(entry - index->entries);
+    uint32_t last = index->count - 1;
+
+    *chain_to(index, ientry) = entry->chain;
+    ms_free(entry->value);
+    ms_free(entry->slots);
+
+    if (ientry != last) {
+        *chain_to(index, last) = ientry + 1;
+        *entry = index->entries[last];
+    }
+    index->count--;
+}
+
+static void index_remove(mc_link_index_t* index, const char* value, uint32_t nvalue, uint32_t slot) {
+    mc_link_postings_t* entry = index_find(index, value, nvalue);
+    uint32_t islot;
+
+    if (entry == 0) return;
+    for (islot = 0; islot < entry->count; islot++) {
+        if (entry->slots[islot] == slot) {
+            memmove(&entry->slots[islot], &entry->slots[islot + 1], (entry->count - islot - 1) * sizeof(uint32_t));
+            if (--entry->count == 0) index_delete(index, entry);
+            return;
+        }
+    }
+}
+
+/* Length of the space separated token at value, skipping leading spaces. */
+static const char* next_token(const char* value, uint32_t* ntoken) {
+    const char* end;
+
+    while (*value == ' ') value++;
+    end = value;
+    while (*end && *end != ' ') end++;
+    *ntoken = (uint32_t)(end - value);
+
+    return value;
+}
+
+/** Add or remove each space separated value of an attribute. */
+static int index_tokens(mc_link_index_t* index, const char* values, uint32_t slot, int add) {
+    uint32_t ntoken;
+    const char* token;
+
+    if (values == 0) return 1;
+    for (token = next_token(values, &ntoken); ntoken > 0; token = next_token(token + ntoken, &ntoken)) {
+        if (!add) index_remove(index, token, ntoken, slot);
+        else if (!index_add(index, token, ntoken, slot)) return 0;
+    }
+    return 1;
+}
+
+static int index_link(mc_discovery_t* disc, const mc_link_t* link, uint32_t slot, int add) {
+    char ct[12];
+    int nct = snprintf(ct, sizeof(ct), "%d", (int)link->ct);
+
+    if (!add) {
+        index_remove(&disc->hrefs, link->path, (uint32_t)strlen(link->path), slot);
+        if (link->ct >= 0) index_remove(&disc->cts, ct, (uint32_t)nct, slot);
+    }
+    else if (!index_add(&disc->hrefs, link->path, (uint32_t)strlen(link->path), slot)
+             || (link->ct >= 0 && !index_add(&disc->cts, ct, (uint32_t)nct, slot))) {
+        return 0;
+    }
+    return index_tokens(&disc->rts, link->rt, slot, add) && index_tokens(&disc->ifs, link->ifdesc, slot, add);
+}
+
+/** Render a link like snprintf. @return the length of the link. */
+static int render_link(const mc_link_t* link, char* dest, uint32_t size) {
+    char ct[16] = "";
+
+    if (link->ct >= 0) snprintf(ct, sizeof(ct), ";ct=%d", (int)link->ct);
+    return snprintf(dest, size, "<%s>%s%s%s%s%s%s%s", link->path,
+                    link->rt ? ";rt=\"" : "", link->rt ? link->rt : "", link->rt ? "\"" : "",
+                    link->ifdesc ? ";if=\"" : "", link->ifdesc ? link->ifdesc : "", link->ifdesc ? "\"" : "",
+                    ct);
+}
+
+/** Make room for nbytes more characters and a null. @return 1 on success, 0 if allocation fails. */
+static int reserve(char** bytes, uint32_t* capacity, uint32_t used, uint32_t nbytes) {
+    uint32_t needed = used + nbytes + 1;
+    uint32_t grown = *capacity ? *capacity : 256;
+    char* resized;
+
+    if (needed <= *capacity) return 1;
+    while (grown < needed) grown *= 2;
+
+    resized = ms_realloc(*bytes, grown, char);
+    if (resized == 0) return 0;
+    *bytes = resized;
+    *capacity = grown;
+
+    return 1;
+}
+
+/** Squeeze the bytes of removed links out of the payload, keeping the links in order. */
+static void compact(mc_discovery_t* disc) {
+    uint32_t npayload = 0;
+    uint32_t next;
+
+    for (next = disc->first; next; next = disc->links[next - 1].next) {
+        mc_link_t* link = &disc->links[next - 1];
+
+        /* The comma lands on this link's own comma or before it, never on the link. */
+        if (npayload) disc->payload[npayload++] = ',';
+        memmove(&disc->payload[npayload], &disc->payload[link->offset], link->length);
+        link->offset = npayload;
+        npayload += link->length;
+    }
+    if (disc->payload) disc->payload[npayload] = 0;
+    disc->npayload = npayload;
+    disc->ngarbage = 0;
+}
+
+static int valid_value(const char* value) {
+    return value == 0 || strchr(value, '"') == 0;
+}
+
+/**
+ * Advertise a resource, replacing an earlier link with the same path.
+ * Only this link is rendered, it is appended to the stored payload.
+ * @param rt space separated resource types or 0.
+ * @param ifdesc space separated interface descriptions or 0.
+ * @param ct content format or -1.
+ * @return 1 on success, 0 if the path does not start with / or a value has a '"', or allocation fails.
+ */
+int mc_discovery_add(mc_discovery_t* disc, const char* path, const char* rt, const char* ifdesc, int32_t ct) {
+    mc_link_t* link;
+    uint32_t slot;
+    int length;
+
+    if (path == 0 || path[0] != '/' || !valid_value(path) || !valid_value(rt) || !valid_value(ifdesc)) return 0;
+    mc_discovery_remove(disc, path);
+
+    if (disc->freelist) {
+        slot = disc->freelist - 1;
+        disc->freelist = disc->links[slot].nextfree;
+    }
+    else {
+        if (disc->nlinks == disc->capacity) {
+            uint32_t capacity = disc->capacity ? disc->capacity * 2 : 16;
+            mc_link_t* links = ms_realloc(disc->links, capacity, mc_link_t);
+
+            if (links == 0) return 0;
+            disc->links = links;
+            disc->capacity = capacity;
+        }
+        slot = disc->nlinks++;
+    }
+
+    link = &disc->links[slot];
+    memset(link, 0, sizeof(mc_link_t));
+    link->path = ms_copy_str(path);
+    link->rt = rt ? ms_copy_str(rt) : 0;
+    link->ifdesc = ifdesc ? ms_copy_str(ifdesc) : 0;
+    link->ct = ct < 0 ? -1 : ct;
+
+    if (disc->ngarbage > disc->npayload / 2) compact(disc);
+    length = render_link(link, 0, 0);
+    if (!reserve(&disc->payload, &disc->payloadcap, disc->npayload, (uint32_t)length + 1)) return 0;
+    if (disc->npayload) disc->payload[disc->npayload++] = ',';
+    link->offset = disc->npayload;
+    link->length = (uint32_t)length;
+    render_link(link, &disc->payload[disc->npayload], (uint32_t)length + 1);
+    disc->npayload += (uint32_t)length;
+
+    link->prev = disc->last;
+    if (disc->last) disc->links[disc->last - 1].next = slot + 1;
+    else disc->first = slot + 1;
+    disc->last = slot + 1;
+
+    return index_link(disc, link, slot, 1);
+}
+
+/**
+ * Stop advertising a resource. Its link stays in the stored payload until it is compacted.
+ * @return 1 if the path was advertised, 0 otherwise.
+ */
+int mc_discovery_remove(mc_discovery_t* disc, const char* path) {
+    mc_link_postings_t* entry = index_find(&disc->hrefs, path, (uint32_t)strlen(path));
+    mc_link_t* link;
+    uint32_t slot;
+
+    if (entry == 0) return 0;
+    slot = entry->slots[0];
+    link = &disc->links[slot];
+    index_link(disc, link, slot, 0);
+
+    /* The link and its comma. */
+    disc->ngarbage += link->length + 1;
+    if (link->prev) disc->links[link->prev - 1].next = link->next;
+    else disc->first = link->next;
+    if (link->next) disc->links[link->next - 1].prev = link->prev;
+    else disc->last = link->prev;
+
+    ms_free(link->path);
+    ms_free(link->rt);
+    ms_free(link->ifdesc);
+    memset(link, 0, sizeof(mc_link_t));
+    link->nextfree = disc->freelist;
+    disc->freelist = (uint32_t)(link - disc->links) + 1;
+
+    return 1;
+}
+
+/** Match a filter value, a trailing * in the filter matches any suffix. */
+static int value_matches(const char* value, uint32_t nvalue, const char* filter, uint32_t nfilter, int prefix) {
+    if (prefix) return nvalue >= nfilter && memcmp(value, filter, nfilter) == 0;
+    return nvalue == nfilter && memcmp(value, filter, nfilter) == 0;
+}
+
+static int tokens_match(const char* values, const char* filter, uint32_t nfilter, int prefix) {
+    uint32_t ntoken;
+    const char* token;
+
+    if (values == 0) return 0;
+    for (token = next_token(values, &ntoken); ntoken > 0; token = next_token(token + ntoken, &ntoken)) {
+        if (value_matches(token, ntoken, filter, nfilter, prefix)) return 1;
+    }
+    return 0;
+}
+
+static int link_matches(const mc_link_t* link, const char* name, uint32_t nname, const char* filter, uint32_t nfilter, int prefix) {
+    char ct[12];
+
+    if (value_matches(name, nname, "href", 4, 0)) {
+        return value_matches(link->path, (uint32_t)strlen(link->path), filter, nfilter, prefix);
+    }
+    if (value_matches(name, nname, "rt", 2, 0)) return tokens_match(link->rt, filter, nfilter, prefix);
+    if (value_matches(name, nname, "if", 2, 0)) return tokens_match(link->ifdesc, filter, nfilter, prefix);
+    if (value_matches(name, nname, "ct", 2, 0) && link->ct >= 0) {
+        return value_matches(ct, (uint32_t)snprintf(ct, sizeof(ct), "%d", (int)link->ct), filter, nfilter, prefix);
+    }
+    return 0;
+}
+
+/* Append an already rendered link to the result. */
+static int append_link(mc_discovery_t* disc, uint32_t* nresult, const mc_link_t* link) {
+    if (!reserve(&disc->result, &disc->resultcap, *nresult, link->length + 1)) return 0;
+    if (*nresult) disc->result[(*nresult)++] = ',';
+    memcpy(&disc->result[*nresult], &disc->payload[link->offset], link->length);
+    *nresult += link->length;
+
+    return 1;
+}
+
+/**
+ * Get the link-format payload for a Uri-Query filter (name=value or name=prefix*).
+ * Without a filter this is the stored payload. Exact rt, if and ct filters are answered from
+ * the indexes, others scan the links. The result is valid until the discovery is changed or
+ * queried again.
+ * @param query the Uri-Query value or 0.
+ * @return the payload, with its length in nbytes.
+ */
+const char* mc_discovery_query(mc_discovery_t* disc, const mc_buffer_t* query, uint32_t* nbytes) {
+    const char* name;
+    const char* filter;
+    const char* equals;
+    const mc_link_index_t* index = 0;
+    uint32_t nname;
+    uint32_t nfilter;
+    uint32_t nresult = 0;
+    uint32_t next;
+    int prefix;
+
+    equals = query ? memchr(query->bytes, '=', query->nbytes) : 0;
+    if (equals == 0) {
+        if (disc->ngarbage) compact(disc);
+        *nbytes = disc->npayload;
+        return disc->payload ? disc->payload : "";
+    }
+
+    name = (const char*)query->bytes;
+    nname = (uint32_t)(equals - name);
+    filter = equals + 1;
+    nfilter = query->nbytes - nname - 1;
+    prefix = nfilter > 0 && filter[nfilter - 1] == '*';
+    if (prefix) nfilter--;
+
+    if (value_matches(name, nname, "rt", 2, 0)) index = &disc->rts;
+    else if (value_matches(name, nname, "if", 2, 0)) index = &disc->ifs;
+    else if (value_matches(name, nname, "ct", 2, 0)) index = &disc->cts;
+
+    if (index && !prefix) {
+        const mc_link_postings_t* entry = index_find(index, filter, nfilter);
+        uint32_t islot;
+
+        for (islot = 0; entry && islot < entry->count; islot++) {
+            if (!append_link(disc, &nresult, &disc->links[entry->slots[islot]])) break;
+        }
+    }
+    else {
+        for (next = disc->first; next; next = disc->links[next - 1].next) {
+            const mc_link_t* link = &disc->links[next - 1];
+            if (link_matches(link, name, nname, filter, nfilter, prefix) && !append_link(disc, &nresult, link)) break;
+        }
+    }
+
+    *nbytes = nresult;
+    return nresult ? disc->result : "";
+}
+
+/** Serve /.well-known/core from a router. @return 1 on success, 0 if it is already registered. */
+int mc_discovery_register(mc_discovery_t* disc, mc_router_t* router) {
+    return mc_router_add(router, MC_GET, MC_WELL_KNOWN_CORE, mc_discovery_handler, disc);
+}
+
+/* A template with a * segment matches many paths, it has no single link to advertise. */
+static int has_wildcard(const char* path) {
+    const char* star;
+
+    for (star = strchr(path, '*'); star; star = strchr(star + 1, '*')) {
+        if (star[-1] == '/' && (star[1] == '/' || star[1] == 0)) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Register a handler on a router and advertise the resource, see mc_router_add and
+ * mc_discovery_add. A template with a * segment is routed but not advertised.
+ * @return 1 on success, 0 if the link attributes are invalid or the router or the discovery
+ * rejects the resource.
+ */
+int mc_discovery_router_add(mc_discovery_t* disc, mc_router_t* router, uint8_t method, const char* path,
+                            mc_router_handler_fn_t handler, void* arg, const char* rt, const char* ifdesc, int32_t ct) {
+    if (path == 0 || path[0] != '/' || !valid_value(path) || !valid_value(rt) || !valid_value(ifdesc)) return 0;
+    if (!mc_router_add(router, method, path, handler, arg)) return 0;
+
+    return has_wildcard(path) || mc_discovery_add(disc, path, rt, ifdesc, ct);
+}
+
+/**
+ * Router handler for GET /.well-known/core, arg is the discovery.
+ * The first Uri-Query is used as the filter. Payloads longer than a block are sent in
+ * Block2 blocks of the smaller of the requested and the discovery's block size.
+ */
+int mc_discovery_handler(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg) {
+    mc_discovery_t* disc = arg;
+    const mc_buffer_t* query = request->options ? mc_options_list_get_value(request->options, OPTION_URI_QUERY) : 0;
+    mc_option_t* options;
+    mc_buffer_t* payload = 0;
+    const char* body;
+    uint32_t total;
+    uint32_t block2;
+    uint32_t num = 0;
+    uint32_t szx = disc->szx;
+    uint32_t start;
+    uint32_t nbytes;
+    uint32_t noptions = 1;
+    int blockwise = 0;
+    int more;
+
+    body = mc_discovery_query(disc, query, &total);
+
+    if (request->options && mc_options_list_get_uint32(request->options, OPTION_BLOCK2, &block2)) {
+        blockwise = 1;
+        num = block2 >> 4;
+        if ((block2 & 0x07) < szx) szx = block2 & 0x07;
+    }
+
+    start = num << (szx + 4);
+    if (num > 0 && start >= total) {
+        mc_endpt_udp_respond(endpt, request, MC_BAD_OPTION, 0, 0);
+        return 1;
+    }
+    nbytes = total - start > (1u << (szx + 4)) ? (1u << (szx + 4)) : total - start;
+    more = start + nbytes < total;
+
+    options = mc_option_nalloc(3);
+    mc_option_init_uint32(&options[0], OPTION_CONTENT_FORMAT, CONTENT_APP_LINK);
+    if (blockwise || more) {
+        mc_option_init_uint32(&options[noptions++], OPTION_BLOCK2, (num << 4) | (more << 3) | szx);
+        if (num == 0) mc_option_init_uint32(&options[noptions++], OPTION_SIZE_2, total);
+    }
+    if (nbytes) payload = mc_buffer_init(mc_buffer_alloc(), nbytes, ms_mem_retag(ms_copy_uint8(nbytes, (const uint8_t*)&body[start]), MS_MEM_BUFFER));
+
+    mc_endpt_udp_respond(endpt, request, MC_CONTENT, mc_options_list_init(mc_options_list_alloc(), noptions, options), payload);
+    return 1;
+}
+
+/** @} */
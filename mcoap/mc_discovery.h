@@ -0,0 +1,100 @@
+#ifndef MC_DISCOVERY_H
+#define MC_DISCOVERY_H
+
+/**
+ * @file
+ * @defgroup discovery CoAP Resource Discovery
+ * @{
+ * Serve /.well-known/core in CoRE Link Format (RFC 6690).
+ *
+ * The link-format payload is kept rendered. Adding a resource renders only its link and
+ * appends it, removing one only unlinks it, so neither walks the other links. The bytes of
+ * removed links are squeezed out at the next unfiltered GET, which copies the whole payload
+ * anyway, or once they are half the payload, so an unfiltered GET sends the stored bytes
+ * without rendering the resources. The rt, if and ct values are indexed,
+ * so a query filter like ?rt=temperature concatenates the already rendered links of the
+ * matching resources instead of scanning them all. Filters on href, prefix filters
+ * (value*), and other attributes fall back to a scan.
+ *
+ * Payloads larger than the block size are served with Block2 (RFC 7959).
+ *
+ * mc_discovery_router_add registers a handler on the router and advertises it with its link
+ * attributes in one call. Handlers added with mc_router_add alone are not advertised, which
+ * keeps /.well-known/core itself and internal resources out of the listing.
+ */
+
+#include "msys/ms_config.h"
+#include "mcoap/mc_router.h"
+
+#define MC_WELL_KNOWN_CORE      "/.well-known/core"
+#define MC_DISCOVERY_BLOCK_SZX  6       /**< Default Block2 size exponent, 1024 byte blocks. */
+
+/** The links of each value of one attribute. */
+typedef struct mc_link_postings mc_link_postings_t;
+struct mc_link_postings {
+    char* value;
+    uint32_t nvalue;
+    uint32_t hash;
+    uint32_t chain;         /**< Next entry + 1 in the bucket, 0 ends the chain. */
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* slots;        /**< Link slots in the order they were added. */
+};
+
+typedef struct mc_link_index mc_link_index_t;
+struct mc_link_index {
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t nbuckets;      /**< A power of 2, at least capacity. */
+    uint32_t* buckets;      /**< First entry + 1 in each bucket, 0 if empty. */
+    mc_link_postings_t* entries;
+};
+
+typedef struct mc_link mc_link_t;
+struct mc_link {
+    char* path;
+    char* rt;               /**< Space separated resource types or 0. */
+    char* ifdesc;           /**< Space separated interface descriptions or 0. */
+    int32_t ct;             /**< Content format or -1. */
+    uint32_t offset;        /**< The rendered link in the payload. */
+    uint32_t length;
+    uint32_t prev;          /**< Previous link + 1 in payload order, 0 for the first. */
+    uint32_t next;          /**< Next link + 1 in payload order, 0 for the last. */
+    uint32_t nextfree;      /**< Next free slot + 1 while unused. */
+};
+
+typedef struct mc_discovery mc_discovery_t;
+struct mc_discovery {
+    uint32_t nlinks;        /**< Slots in use or on the free list. */
+    uint32_t capacity;
+    uint32_t freelist;      /**< First free slot + 1. */
+    uint32_t first;         /**< First link + 1 in payload order. */
+    uint32_t last;          /**< Last link + 1 in payload order. */
+    mc_link_t* links;
+    char* payload;          /**< Rendered links separated by commas, and removed links. */
+    uint32_t npayload;
+    uint32_t ngarbage;      /**< Bytes of removed links still in the payload. */
+    uint32_t payloadcap;
+    char* result;           /**< Scratch space for filtered results. */
+    uint32_t resultcap;
+    mc_link_index_t hrefs;
+    mc_link_index_t rts;
+    mc_link_index_t ifs;
+    mc_link_index_t cts;
+    uint8_t szx;            /**< Largest Block2 size exponent to send. */
+};
+
+mc_discovery_t* mc_discovery_alloc();
+mc_discovery_t* mc_discovery_init(mc_discovery_t* disc);
+mc_discovery_t* mc_discovery_deinit(mc_discovery_t* disc);
+int mc_discovery_add(mc_discovery_t* disc, const char* path, const char* rt, const char* ifdesc, int32_t ct);
+int mc_discovery_remove(mc_discovery_t* disc, const char* path);
+const char* mc_discovery_query(mc_discovery_t* disc, const mc_buffer_t* query, uint32_t* nbytes);
+int mc_discovery_register(mc_discovery_t* disc, mc_router_t* router);
+int mc_discovery_router_add(mc_discovery_t* disc, mc_router_t* router, uint8_t method, const char* path,
+                            mc_router_handler_fn_t handler, void* arg, const char* rt, const char* ifdesc, int32_t ct);
+int mc_discovery_handler(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg);
+
+/** @} */
+
+#endif
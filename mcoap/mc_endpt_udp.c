@@ -4,17 +4,24 @@
  * @{
  */
 
+#define MS_LOG_CATEGORY MS_LOG_ENDPT
+
 #include "msys/ms_config.h"
+#include "msys/ms_copy.h"
+#include "msys/ms_endian.h"
 #include "msys/ms_memory.h"
 #include "msys/ms_log.h"
 #include "mnet/mn_timeout.h"
 #include "mnet/mn_sockaddr.h"
 #include "mcoap/mc_endpt_udp.h"
 #include "mcoap/mc_code.h"
+#include "mcoap/mc_header.h"
+#include "mcoap/mc_options_builder.h"
 #include "mcoap/mc_token.h"
 #include "mcoap/mc_uri.h"
+#include "mcoap/mc_pool.h"
 
-#include <math.h>
+#include <string.h>
 
 #define DEFAULT_ENDPT_TIMEOUT 0.05
 
@@ -22,31 +29,32 @@ mc_endpt_udp_t* mc_endpt_udp_alloc() {
     return ms_calloc(1, mc_endpt_udp_t);
 }
 
-/**
- * RFC7252 4.4 recommends choosing a random initial value.
- */
-static uint16_t random_id() {
-    unsigned int seed = (unsigned int)round(mn_gettime()*1000.0);
-    srand(seed);
-    return (uint16_t)rand();
-}
-
 mc_endpt_udp_t* mc_endpt_udp_init(mc_endpt_udp_t* const endpt, uint32_t rdsize, uint32_t wrsize, const char* hostname, unsigned short port) {
     sockaddr_t addr;
     int err;
     endpt->readfn = 0;
     endpt->thread = 0;
     endpt->running = 0;
-    endpt->nextid = random_id();
+    endpt->sock = MN_SOCKET_INVALID;
+    endpt->family = AF_UNSPEC;
+
+    /* RFC7252 4.4 recommends choosing a random initial value. */
+    endpt->nextid = (uint16_t)ms_random_next(ms_random_thread());
     if (endpt->nextid == 0) {
         endpt->nextid = 1;
     }
 
     /* @todo consider restricting the maxmimum buffer sizes (e.g. less then 64k). */
-    mc_buffer_init(&endpt->rdbuffer, rdsize, ms_calloc(rdsize, uint8_t));
-    mc_buffer_init(&endpt->wrbuffer, wrsize, ms_calloc(wrsize, uint8_t));
+    mc_recv_ring_init(&endpt->ring, MC_RECV_SLOTS, rdsize, 0);
+    mc_buffer_init(&endpt->wrbuffer, wrsize, ms_calloc_tag(MS_MEM_BUFFER, wrsize, uint8_t));
 
     mc_buffer_queue_init(&endpt->confirmq);
+    mc_uri_cache_init(&endpt->uricache, MC_URI_CACHE_SIZE);
+    mn_peer_table_init(&endpt->peers, MC_PEER_TABLE_SIZE);
+    mc_request_table_init(&endpt->requests, MC_REQUEST_TABLE_SIZE);
+    endpt->resolver = 0;
+    endpt->pending = 0;
+    endpt->events = 0;
 
     mn_timeout_init(&endpt->tmout, DEFAULT_ENDPT_TIMEOUT, -1.0);
     if (hostname == 0) {
@@ -59,13 +67,14 @@ mc_endpt_udp_t* mc_endpt_udp_init(mc_endpt_udp_t* const endpt, uint32_t rdsize,
         return 0;
     }
 
-    err = mn_socket_create(&endpt->sock, AF_INET, SOCK_DGRAM, 0);
+    endpt->family = addr.ss_family;
+    err = mn_socket_create(&endpt->sock, addr.ss_family, SOCK_DGRAM, 0);
     if ( err != MN_DONE) {
         ms_log_debug("Failed to create socket, error: %d, %s.", err, mn_strerror(err));
         return 0;
     }
 
-    err = mn_socket_bind(&endpt->sock, &addr, sizeof(sockaddr_t));
+    err = mn_socket_bind(&endpt->sock, &addr, mn_sockaddr_len(&addr));
     if (err != MN_DONE) {
         ms_log_debug("Error %s (%d) binding socket on %s:%d", mn_strerror(err), err, hostname, port);
         return 0;
@@ -79,9 +88,56 @@ mc_endpt_udp_t* mc_endpt_set_timeout(mc_endpt_udp_t* const endpt, double seconds
     return endpt;
 }
 
+/**
+ * Replace the receive slots, e.g. with a large huge page backed ring for batch receive.
+ * Slots keep their size. No received message may still reference a slot.
+ * @return 1 on success, 0 if the slots could not be mapped and the old ones are kept.
+ */
+int mc_endpt_udp_set_recv_slots(mc_endpt_udp_t* const endpt, uint32_t nslots, int huge) {
+    mc_recv_ring_t ring;
+
+    if (mc_recv_ring_init(&ring, nslots, endpt->ring.slotsize, huge) == 0) return 0;
+    mc_recv_ring_deinit(&endpt->ring);
+    mc_recv_ring_move(&endpt->ring, &ring);
+
+    return 1;
+}
+
+/**
+ * Record every datagram sent and received in an event log, or stop recording if events is 0.
+ * The log must outlive the endpoint or be unset first.
+ * @return the endpoint.
+ */
+mc_endpt_udp_t* mc_endpt_udp_set_event_log(mc_endpt_udp_t* const endpt, mc_event_log_t* events) {
+    endpt->events = events;
+    return endpt;
+}
+
+static mc_endpt_pending_t* pending_free(mc_endpt_pending_t* pending) {
+    mc_endpt_pending_t* next = pending->next;
+
+    ms_free(pending->host);
+    mc_shared_buffer_release(pending->msg);
+    ms_free(pending);
+
+    return next;
+}
+
 mc_endpt_udp_t* mc_endpt_udp_deinit(mc_endpt_udp_t* const endpt) {
-    mc_buffer_deinit(&endpt->rdbuffer);
+    while (endpt->pending) endpt->pending = pending_free(endpt->pending);
+    if (endpt->resolver) {
+        ms_free(mn_resolver_deinit(endpt->resolver));
+        endpt->resolver = 0;
+    }
+
+    /* Close the socket so the port's datagrams are not split with a later endpoint bound to it. */
+    mn_socket_destroy(&endpt->sock);
+    mc_recv_ring_deinit(&endpt->ring);
     mc_buffer_deinit(&endpt->wrbuffer);
+    mc_buffer_queue_deinit(&endpt->confirmq);
+    mc_uri_cache_deinit(&endpt->uricache);
+    mn_peer_table_deinit(&endpt->peers);
+    mc_request_table_deinit(&endpt->requests);
 
     return endpt;
 }
@@ -103,7 +159,7 @@ static void endpt_udp_loop(mc_endpt_udp_t* endpt) {
             /* There's no locking around setting the running flag. */
             /* This should be fine as longer as the using program does not set running outside this thread. */
             endpt->running = endpt->readfn(endpt, msg);
-            ms_free(mc_message_deinit(msg));
+            mc_message_free(msg);
         }
 
         mc_endpt_udp_check_queues(endpt);
@@ -113,6 +169,9 @@ static void endpt_udp_loop(mc_endpt_udp_t* endpt) {
 static void endpt_udp_reader(void* data) {
     mc_endpt_udp_t* rendpt = (mc_endpt_udp_t*)data;
     endpt_udp_loop(rendpt);
+
+    /* The objects cached for this thread would be lost when it exits. */
+    mc_pool_flush();
 }
 
 /**
@@ -141,7 +200,7 @@ uint16_t mc_endpt_udp_nextid(mc_endpt_udp_t* endpt) {
 mc_endpt_udp_t* mc_endpt_udp_start(mc_endpt_udp_t* const endpt, mc_endpt_read_fn_t readfn) {
     endpt->running = 1;
     endpt->readfn = readfn;
-    endpt->thread = ms_thread_init(ms_thread_alloc(), (ms_thread_fn_t*)&endpt_udp_reader, endpt);
+    endpt->thread = ms_thread_init(ms_thread_alloc(), endpt_udp_reader, endpt);
 
     return endpt;
 }
@@ -160,60 +219,217 @@ static void call_result_fn(mc_endpt_udp_t* endpt, mc_endpt_result_fn_t resultfn,
     }
 }
 
-mc_message_t* mc_endpt_udp_recv(mc_endpt_udp_t* const endpt) {
-    sockaddr_t fromaddr;
-    socklen_t addrlen;
-    uint32_t bpos;
-    uint32_t rdsize;
-    mc_message_t* msg;
-    int err;
+/**
+ * Reject a message with an unrecognized critical option (RFC7252 5.4.1).
+ * A confirmable request gets a piggybacked 4.02 Bad Option response, anything else is ignored.
+ * @return 1 if the message was rejected.
+ */
+static int reject_bad_options(mc_endpt_udp_t* const endpt, mc_message_t* msg, sockaddr_t* fromaddr) {
+    mc_message_t response;
+    uint8_t code = mc_message_get_code(msg);
+    int index = mc_options_list_validate(msg->options);
 
-    addrlen = sizeof fromaddr;
-    rdsize = endpt->rdbuffer.nbytes;
-    mn_timeout_markstart(&endpt->tmout);
-    err = mn_socket_recvfrom(&endpt->sock, (char*)endpt->rdbuffer.bytes, endpt->rdbuffer.nbytes, (size_t*)&endpt->rdbuffer.nbytes, &fromaddr, &addrlen, &endpt->tmout);
+    if (index < 0) return 0;
 
-    if (err != MN_DONE) {
-        msg = 0;
-        ms_log_debug("Receive error: %d, %s", err, mn_strerror(err));
+    ms_log_debug("Rejecting message %d, bad critical option %d",
+                 mc_message_get_message_id(msg), msg->options->options[index].option_num);
+
+    if (mc_message_is_confirmable(msg) && code != 0 && mc_code_get_category(code) == MC_CODE_REQUEST) {
+        mc_message_ack_init(&response, MC_BAD_OPTION, mc_message_get_message_id(msg), mc_message_echo_token(&response, msg), 0, 0);
+        mc_endpt_udp_send(endpt, fromaddr, &response, 0);
+        mc_message_deinit(&response);
+    }
+    return 1;
+}
+
+/**
+ * Queue a confirmable message for retransmission and pin its peer, so the peer keeps its
+ * address while the message waits. The message buffer is consumed.
+ * @return the slot or MC_BUFFER_QUEUE_NONE if the queue is full or every peer is pinned.
+ */
+static uint32_t queue_con(mc_endpt_udp_t* const endpt, uint16_t msgid, const sockaddr_t* toaddr,
+                          mc_shared_buffer_t* msg, mc_endpt_result_fn_t resultfn) {
+    mn_peer_id_t peer = mn_peer_table_intern(&endpt->peers, toaddr);
+    uint32_t slot;
+
+    if (peer == MN_PEER_NONE) {
+        mc_shared_buffer_release(msg);
+        return MC_BUFFER_QUEUE_NONE;
+    }
+    slot = mc_buffer_queue_add(&endpt->confirmq, msgid, peer, msg, resultfn);
+    if (slot != MC_BUFFER_QUEUE_NONE) mn_peer_table_pin(&endpt->peers, peer);
+    return slot;
+}
+
+/** Drop a confirmable message from the queue and release its pin on the peer. */
+static void unqueue_con(mc_endpt_udp_t* const endpt, uint32_t slot) {
+    if (slot == MC_BUFFER_QUEUE_NONE) return;
+    mn_peer_table_unpin(&endpt->peers, endpt->confirmq.peers[slot]);
+    mc_buffer_queue_remove_slot(&endpt->confirmq, slot);
+}
+
+/** Stop tracking a request and release its pin on the peer. */
+static void untrack_request(mc_endpt_udp_t* const endpt, mc_request_t* request) {
+    mn_peer_table_unpin(&endpt->peers, request->peer);
+    mc_request_table_remove(&endpt->requests, request);
+}
+
+/**
+ * Deliver a response to the request it answers, matched on (peer, token).
+ * A confirmable (separate) response is acked. Observe notifications keep the request
+ * open for Max-Age plus EXCHANGE_LIFETIME unless the response fn returns 0.
+ * @return 1 if the response was delivered, 0 if it does not match a request.
+ */
+static int complete_request(mc_endpt_udp_t* const endpt, mc_message_t* msg) {
+    uint8_t category = mc_code_get_category(mc_message_get_code(msg));
+    mc_request_t* request;
+    mc_endpt_response_fn_t responsefn;
+    uint16_t msgid;
+    uint32_t maxage = DEFAULT_MAX_AGE;
+    int keep;
+
+    if (category != MC_CODE_RESPONSE && category != MC_CLT_ERROR && category != MC_SRV_ERROR) return 0;
+
+    request = mc_request_table_find(&endpt->requests, msg->peer, msg->token);
+    if (request == 0) return 0;
+
+    if (mc_message_is_confirmable(msg)) {
+        mc_endpt_udp_ack(endpt, &msg->from, mc_buffer_init(mc_buffer_alloc(), 0, 0), mc_message_get_message_id(msg));
+    }
+
+    responsefn = request->responsefn;
+    msgid = request->msgid;
+
+    if (msg->options && mc_options_list_has(msg->options, OPTION_OBSERVE)) {
+        keep = (*responsefn)((mc_endpt_id_t)endpt, msgid, msg);
+
+        /* The response fn may have added requests, so find it again. */
+        request = mc_request_table_find(&endpt->requests, msg->peer, msg->token);
+        if (request && keep) {
+            mc_options_list_get_uint32(msg->options, OPTION_MAX_AGE, &maxage);
+            mc_request_table_set_deadline(&endpt->requests, request, mn_gettime() + maxage + EXCHANGE_LIFETIME);
+        }
+        else if (request) {
+            untrack_request(endpt, request);
+        }
     }
     else {
-        bpos = 0;
-        ms_log_debug("Received response with %d bytes", endpt->rdbuffer.nbytes);
-        /* ms_log_bytes(ms_debug, endpt->rdbuffer.nbytes, endpt->rdbuffer.bytes); */
+        untrack_request(endpt, request);
+        (*responsefn)((mc_endpt_id_t)endpt, msgid, msg);
+    }
+
+    return 1;
+}
+
+/** Record a datagram sent to or received from addr, if there is an event log. */
+static void log_datagram(mc_endpt_udp_t* const endpt, uint8_t type, mn_peer_id_t peer, const sockaddr_t* addr,
+                         const uint8_t* bytes, uint32_t nbytes) {
+    if (endpt->events == 0) return;
+    if (peer == MN_PEER_NONE) peer = mn_peer_table_intern(&endpt->peers, addr);
+    mc_event_log_datagram(endpt->events, type, peer, addr, bytes, nbytes);
+}
+
+/**
+ * Receive into a free slot, or a heap buffer of the slot size if the application
+ * holds every slot.
+ * @return the buffer with its view set to the datagram, or 0 on error.
+ */
+static mc_shared_buffer_t* recv_slot(mc_endpt_udp_t* const endpt, sockaddr_t* fromaddr) {
+    mc_shared_buffer_t* slot = mc_recv_ring_acquire(&endpt->ring);
+    socklen_t addrlen = sizeof(sockaddr_t);
+    size_t got = 0;
+    int err;
+
+    if (slot == 0) {
+        ms_log_debug_limited("All %d receive slots are in use", endpt->ring.nslots);
+        slot = mc_shared_buffer_create(endpt->ring.slotsize, 0);
+        if (slot == 0) return 0;
+    }
 
-        msg = mc_message_from_buffer(mc_message_alloc(), &endpt->rdbuffer, &bpos);
-        msg->from = mn_sockaddr_copy(&fromaddr);
+    mn_timeout_markstart(&endpt->tmout);
+    err = mn_socket_recvfrom(&endpt->sock, (char*)slot->view.bytes, slot->view.nbytes, &got, fromaddr, &addrlen, &endpt->tmout);
+    if (err != MN_DONE) {
+        /* Timing out is how an idle loop wakes up, not an error. */
+        if (err != MN_TIMEOUT) ms_log_debug_limited("Receive error: %d, %s", err, mn_strerror(err));
+        mc_shared_buffer_release(slot);
+        return 0;
     }
 
-    /** Reset the read buffer size to it original value. */
-    endpt->rdbuffer.nbytes = rdsize;
+    slot->view.nbytes = (uint32_t)got;
+    log_datagram(endpt, MC_EVENT_RECV, MN_PEER_NONE, fromaddr, slot->view.bytes, slot->view.nbytes);
+    return slot;
+}
+
+mc_message_t* mc_endpt_udp_recv(mc_endpt_udp_t* const endpt) {
+    sockaddr_t fromaddr;
+    mc_shared_buffer_t* slot = recv_slot(endpt, &fromaddr);
+    mc_message_t* msg = 0;
+
+    if (slot) {
+        ms_log_debug("Received response with %d bytes", slot->view.nbytes);
+
+        /* The message references the slot for its payload, the slot is reused once it is freed. */
+        msg = mc_message_alloc();
+        if (mc_message_from_shared(msg, slot) == 0) {
+            ms_log_debug_limited("Dropping malformed message with %d bytes", slot->view.nbytes);
+            mc_message_free(msg);
+            msg = 0;
+        }
+        else {
+            memcpy(&msg->from, &fromaddr, sizeof(sockaddr_t));
+            msg->peer = mn_peer_table_intern(&endpt->peers, &fromaddr);
+        }
+        mc_shared_buffer_release(slot);
+    }
 
     if (mc_message_is_ack(msg)) {
         uint16_t msgid = mc_message_get_message_id(msg);
-        mc_buffer_queue_entry_t* entry = mc_buffer_queue_get(&endpt->confirmq, msgid);
+        uint32_t slot = mc_buffer_queue_get(&endpt->confirmq, msgid);
 
-        /* Note that err should be MN_DONE at this point. */
-        call_result_fn(endpt, entry->resultfn, entry->msgid, err);
-        mc_buffer_queue_remove_entry(&endpt->confirmq, entry);
+        if (slot != MC_BUFFER_QUEUE_NONE) {
+            call_result_fn(endpt, endpt->confirmq.resultfns[slot], msgid, MN_DONE);
+            unqueue_con(endpt, slot);
+        }
+    }
+
+    if (msg && reject_bad_options(endpt, msg, &fromaddr)) {
+        mc_message_free(msg);
+        msg = 0;
+    }
+
+    if (msg && complete_request(endpt, msg)) {
+        mc_message_free(msg);
+        msg = 0;
     }
 
     return msg;
 }
 
-static int send_entry_buffer(mc_endpt_udp_t* const endpt, mc_buffer_queue_entry_t* entry) {
+/**
+ * (Re)send a queued confirmable message to its peer.
+ * The peer is pinned while the message is queued, so its address is still in the peer table.
+ */
+static int send_queued(mc_endpt_udp_t* const endpt, uint32_t slot) {
+    mc_buffer_queue_t* queue = &endpt->confirmq;
+    sockaddr_t dest;
     size_t sent;
     int err;
-    socklen_t tolen = (socklen_t)sizeof(struct sockaddr_in);
-
-    if (entry->xmitcounter >= MAX_RETRANSMIT) {
+    if (queue->xmits[slot] >= MAX_RETRANSMIT) {
         err = MN_TIMEOUT;
     }
+    else if (mn_peer_table_address(&endpt->peers, queue->peers[slot], &dest) == 0) {
+        err = MN_UNKNOWN;
+    }
     else {
+        const mc_buffer_t* view = &queue->msgs[slot]->view;
+
         mn_timeout_markstart(&endpt->tmout);
-        err = mn_socket_sendto(&endpt->sock, (char*)entry->msg->bytes, entry->msg->nbytes, &sent, entry->dest, tolen, &endpt->tmout);
+        err = mn_socket_sendto(&endpt->sock, (char*)view->bytes, view->nbytes, &sent, &dest, mn_sockaddr_len(&dest), &endpt->tmout);
+        if (err == MN_DONE) {
+            log_datagram(endpt, queue->xmits[slot] ? MC_EVENT_RETRANSMIT : MC_EVENT_SEND, queue->peers[slot], &dest, view->bytes, view->nbytes);
+        }
 
-        entry->xmitcounter++;
+        queue->xmits[slot]++;
     }
     return err;
 }
@@ -223,44 +439,43 @@ static int send_entry_buffer(mc_endpt_udp_t* const endpt, mc_buffer_queue_entry_
  */
 static int send_endpt_buffer(mc_endpt_udp_t* const endpt, uint32_t nbytes, sockaddr_t* toaddr) {
     size_t sent;
-    socklen_t tolen = (socklen_t)sizeof(struct sockaddr_in);
+    int err;
 
     mn_timeout_markstart(&endpt->tmout);
-    return mn_socket_sendto(&endpt->sock, (const char*)endpt->wrbuffer.bytes, nbytes, &sent, toaddr, tolen, &endpt->tmout);
+    err = mn_socket_sendto(&endpt->sock, (const char*)endpt->wrbuffer.bytes, nbytes, &sent, toaddr, mn_sockaddr_len(toaddr), &endpt->tmout);
+    if (err == MN_DONE) log_datagram(endpt, MC_EVENT_SEND, MN_PEER_NONE, toaddr, endpt->wrbuffer.bytes, nbytes);
+    return err;
 }
 
 /**
  * Only used the first time we send a confirmable msg as this loads it into the confirm queue.
- * Retransmits are sent by send_entry_buffer() when we check the the buffer queues.
+ * Retransmits are sent by send_queued() when we check the the buffer queues.
  * 
  */
 static int send_con_msg(mc_endpt_udp_t* const endpt, uint32_t nbytes, sockaddr_t* toaddr, mc_message_t* msg, mc_endpt_result_fn_t resultfn) {
-    mc_buffer_queue_entry_t* entry = mc_buffer_queue_add(
-        &endpt->confirmq,
-        mc_message_get_message_id(msg),
-        mn_sockaddr_copy(toaddr),
-        mc_buffer_copy(&endpt->wrbuffer, 0, nbytes),
-        resultfn);
-
-    int err = send_endpt_buffer(endpt, nbytes, toaddr);
+    uint32_t slot = queue_con(endpt, mc_message_get_message_id(msg), toaddr,
+                              mc_shared_buffer_create(nbytes, endpt->wrbuffer.bytes), resultfn);
+
+    int err = slot == MC_BUFFER_QUEUE_NONE ? MN_UNKNOWN : send_endpt_buffer(endpt, nbytes, toaddr);
     if (err == MN_DONE) {
-        entry->xmitcounter++;
+        endpt->confirmq.xmits[slot]++;
     }
     else {
         call_result_fn(endpt, resultfn, mc_message_get_message_id(msg), err);
-        mc_buffer_queue_remove_entry(&endpt->confirmq, entry);
+        unqueue_con(endpt, slot);
     }
     return err;
 }
 
-int mc_endpt_udp_send(mc_endpt_udp_t* const endpt, sockaddr_t* toaddr, mc_message_t* msg, mc_endpt_result_fn_t resultfn) {
-    uint32_t nbytes;
+/** Send a message already serialized into the write buffer, queueing it if confirmable. */
+static int send_serialized(mc_endpt_udp_t* const endpt, uint32_t nbytes, sockaddr_t* toaddr, mc_message_t* msg, mc_endpt_result_fn_t resultfn) {
     int err;
 
-    /* Serialize the mesage into the endpt's write buffer. */
-    nbytes = mc_message_to_buffer(msg, &endpt->wrbuffer);
-
-    if (mc_message_is_confirmable(msg)) {
+    if (nbytes == 0) {
+        err = MN_UNKNOWN;
+        call_result_fn(endpt, resultfn, mc_message_get_message_id(msg), err);
+    }
+    else if (mc_message_is_confirmable(msg)) {
         err = send_con_msg(endpt, nbytes, toaddr, msg, resultfn);
     }
     else {
@@ -270,40 +485,164 @@ int mc_endpt_udp_send(mc_endpt_udp_t* const endpt, sockaddr_t* toaddr, mc_messag
     return err;
 }
 
+int mc_endpt_udp_send(mc_endpt_udp_t* const endpt, sockaddr_t* toaddr, mc_message_t* msg, mc_endpt_result_fn_t resultfn) {
+    /* Serialize the mesage into the endpt's write buffer. */
+    uint32_t nbytes = mc_message_to_buffer(msg, &endpt->wrbuffer);
+
+    return send_serialized(endpt, nbytes, toaddr, msg, resultfn);
+}
+
+/**
+ * Register a serialized request that is being sent to toaddr so its response can be matched.
+ * The msgid, type and token are read back from the serialized header. The peer is pinned
+ * until the request is done, so the response is interned under the same id however many
+ * other peers are seen meanwhile.
+ * @return the request, or 0 if there is no response fn or it could not be added.
+ */
+static mc_request_t* track_request(mc_endpt_udp_t* const endpt, sockaddr_t* toaddr, const mc_buffer_t* serialized, mc_endpt_response_fn_t responsefn) {
+    mc_buffer_t token;
+    mc_request_t* request = 0;
+    mn_peer_id_t peer;
+    uint32_t header;
+    uint32_t bpos = 0;
+    double lifetime;
+
+    if (responsefn == 0 || serialized->nbytes < 4) return 0;
+
+    header = ms_swap_u32(mc_buffer_next_uint32(serialized, &bpos));
+    mc_buffer_init(&token, mc_header_get_token_length(header), serialized->bytes + bpos);
+    lifetime = mc_header_get_message_type(header) == MC_CONFIRM ? EXCHANGE_LIFETIME : NON_LIFETIME;
+
+    peer = mn_peer_table_intern(&endpt->peers, toaddr);
+    if (peer != MN_PEER_NONE) {
+        request = mc_request_table_add(&endpt->requests, peer, &token, mc_header_get_message_id(header), mn_gettime() + lifetime);
+    }
+    if (request == 0) {
+        ms_log_debug("Unable to track request: %d", mc_header_get_message_id(header));
+        return 0;
+    }
+    request->responsefn = responsefn;
+    mn_peer_table_pin(&endpt->peers, peer);
+
+    return request;
+}
+
+/**
+ * Fail the requests whose deadline passed without a (final) response,
+ * the response fn is called with a null response.
+ */
+static void check_requests(mc_endpt_udp_t* const endpt) {
+    double now = mn_gettime();
+    mc_request_t* request;
+
+    while ((request = mc_request_table_expired(&endpt->requests, now)) != 0) {
+        mc_endpt_response_fn_t responsefn = request->responsefn;
+        uint16_t msgid = request->msgid;
+
+        untrack_request(endpt, request);
+        (*responsefn)((mc_endpt_id_t)endpt, msgid, 0);
+    }
+}
+
+/**
+ * Send a request whose host has resolved, a confirmable one moves into the confirm queue.
+ * The pending request's message buffer is consumed.
+ */
+static int send_pending(mc_endpt_udp_t* const endpt, mc_endpt_pending_t* pending, sockaddr_t* toaddr) {
+    uint32_t slot;
+    size_t sent;
+    int err;
+
+    if (!pending->confirmable) {
+        const mc_buffer_t* view = &pending->msg->view;
+
+        mn_timeout_markstart(&endpt->tmout);
+        err = mn_socket_sendto(&endpt->sock, (const char*)view->bytes, view->nbytes, &sent, toaddr, mn_sockaddr_len(toaddr), &endpt->tmout);
+        if (err == MN_DONE) log_datagram(endpt, MC_EVENT_SEND, MN_PEER_NONE, toaddr, view->bytes, view->nbytes);
+        return err;
+    }
+
+    slot = queue_con(endpt, pending->msgid, toaddr, pending->msg, pending->resultfn);
+    pending->msg = 0;
+
+    err = slot == MC_BUFFER_QUEUE_NONE ? MN_UNKNOWN : send_queued(endpt, slot);
+    if (err != MN_DONE) {
+        call_result_fn(endpt, pending->resultfn, pending->msgid, err);
+        unqueue_con(endpt, slot);
+    }
+    return err;
+}
+
+/**
+ * Send the pending requests whose host names have resolved, fail the ones that
+ * did not resolve or waited too long.
+ */
+static void check_pending(mc_endpt_udp_t* const endpt) {
+    mc_endpt_pending_t** link = &endpt->pending;
+    double now = mn_gettime();
+
+    while (*link) {
+        mc_endpt_pending_t* pending = *link;
+        sockaddr_t addr;
+        int err = mn_resolver_lookup(endpt->resolver, pending->host, pending->port, endpt->family, &addr);
+
+        if (err == MN_PENDING && now < pending->deadline) {
+            link = &pending->next;
+            continue;
+        }
+
+        if (err == MN_DONE) {
+            mc_request_t* request = track_request(endpt, &addr, &pending->msg->view, pending->responsefn);
+
+            err = send_pending(endpt, pending, &addr);
+            if (err != MN_DONE) {
+                ms_log_debug("Error: %d, sending resolved request: %d", err, pending->msgid);
+                if (request) untrack_request(endpt, request);
+            }
+        }
+        else {
+            if (err == MN_PENDING) err = MN_TIMEOUT;
+            ms_log_debug("Unable to resolve %s: %s", pending->host, mn_strerror(err));
+            call_result_fn(endpt, pending->resultfn, pending->msgid, err);
+        }
+        *link = pending_free(pending);
+    }
+}
+
 /**
- * Iterate over the confirmation queue entries, if timeout retransmit
+ * Scan the confirmation queue's deadlines, if timeout retransmit
  * or notify client of error if too many tries.
  *
- * NOTE! The entry is *NOT* removed until after the result function is called
+ * NOTE! The slot is *NOT* removed until after the result function is called
  * Consider adding an accessor that the callee can use to inspect the failed message
  * while executing the result function.
  */
 mc_endpt_udp_t* mc_endpt_udp_check_queues(mc_endpt_udp_t* const endpt) {
+    mc_buffer_queue_t* queue = &endpt->confirmq;
+    double now;
+    uint32_t slot;
     int err;
-    mc_buffer_queue_entry_t* current;
-
-    current = endpt->confirmq.first;
-    while (current) {
-        if (mn_timeout_get(&current->timeout) == 0.0) {
-
-            /* Double the timeout we'll wait for the confirm. */
-            /* Implements the exponential back off algorithm. */
-            mn_timeout_init(&current->timeout, -1.0, current->timeout.total * 2.0);
-            mn_timeout_markstart(&current->timeout);
 
-            err = send_entry_buffer(endpt, current);
-            if (err != MN_DONE) {
-                ms_log_debug("Error: %d, resending confirmable: %d, xmit: %d", err, current->msgid, current->xmitcounter);
-                call_result_fn(endpt, current->resultfn, current->msgid, err);
-                current = mc_buffer_queue_remove_entry(&endpt->confirmq, current);
-            }
-            else {
-                current = current->next;
+    if (endpt->pending) check_pending(endpt);
+    if (endpt->requests.count) check_requests(endpt);
+
+    /* The slot arrays may grow if a result fn sends, so index them afresh each time. */
+    now = mn_gettime();
+    slot = mc_buffer_queue_next_timeout(queue, 0, now);
+    while (slot != MC_BUFFER_QUEUE_NONE) {
+        mc_buffer_queue_backoff(queue, slot, now);
+
+        err = send_queued(endpt, slot);
+        if (err != MN_DONE) {
+            ms_log_debug("Error: %d, resending confirmable: %d, xmit: %d", err, queue->msgids[slot], queue->xmits[slot]);
+            if (endpt->events) {
+                mc_event_log_write(endpt->events, MC_EVENT_TIMEOUT, queue->peers[slot], 0, queue->msgids[slot],
+                                   queue->msgs[slot]->view.bytes[1], 0, 0);
             }
+            call_result_fn(endpt, queue->resultfns[slot], queue->msgids[slot], err);
+            unqueue_con(endpt, slot);
         }
-        else {
-            current = current->next;
-        }
+        slot = mc_buffer_queue_next_timeout(queue, slot + 1, now);
     }
 
     return endpt;
@@ -330,22 +669,64 @@ int mc_endpt_udp_ack(mc_endpt_udp_t*const endpt, sockaddr_t*const addr, mc_buffe
 }
 
 /**
- * Create options from URI and to address.
- * If there are extra options merge them into the list.
+ * Send a response to a received request, piggybacked on the ack if the request is confirmable,
+ * otherwise as a non-confirmable message. The options and payload belong to the response.
+ * @return send error code.
+ */
+int mc_endpt_udp_respond(mc_endpt_udp_t* const endpt, mc_message_t* const request, uint8_t code,
+                         mc_options_list_t* options, mc_buffer_t* payload) {
+    mc_message_t msg;
+    int err;
+
+    if (mc_message_is_confirmable(request)) {
+        mc_message_ack_init(&msg, code, mc_message_get_message_id(request), mc_message_echo_token(&msg, request), options, payload);
+    }
+    else {
+        mc_message_non_init(&msg, code, mc_endpt_udp_nextid(endpt), mc_message_echo_token(&msg, request), options, payload);
+    }
+
+    err = mc_endpt_udp_send(endpt, &request->from, &msg, 0);
+    if (err != MN_DONE) {
+        ms_log_debug("Error sending response: %d, %s", err, mn_strerror(err));
+    }
+
+    mc_message_deinit(&msg);
+    return err;
+}
+
+/**
+ * Create options from the cached URI options and extra options.
+ * Extra options are copied into the list, extra is left as it was.
  */
-static  mc_options_list_t* mk_options(char* const uri, sockaddr_t* const addr, mc_options_list_t* extra) {
-    mc_options_list_t* list = mc_uri_to_options(mc_options_list_alloc(), addr, uri);
-    if (extra != 0) {
-        mc_options_list_t* merged = mc_options_list_merge(list, extra);
-        ms_free(mc_options_list_deinit(list));
-        list = merged;
+static mc_options_list_t* mk_options(const mc_uri_cache_entry_t* cached, mc_options_list_t* extra) {
+    mc_options_builder_t builder;
+    mc_options_list_t* list = mc_options_list_alloc();
+    mc_options_list_t* copy;
+    uint32_t bpos = 0;
+
+    if (mc_options_list_from_buffer(list, (mc_buffer_t*)&cached->options, &bpos) == 0) {
+        mc_options_list_init(list, 0, 0);
     }
-    return list;
+    if (extra == 0 || extra->noptions == 0) return list;
+
+    copy = mc_options_list_copy(extra);
+    mc_options_builder_init(&builder, list->noptions + copy->noptions);
+    mc_options_builder_merge(&builder, list);
+    mc_options_builder_merge(&builder, copy);
+    ms_free(copy);
+
+    return mc_options_builder_to_list(&builder, list);
+}
+
+/** @return 1 if the (sorted) extra options can be encoded after option number lastnum. */
+static int follows(const mc_options_list_t* extra, uint16_t lastnum) {
+    if (extra == 0 || extra->noptions == 0) return 1;
+    return extra->options[0].option_num >= lastnum;
 }
 
 static uint16_t mk_message(mc_message_t* msg, mc_endpt_udp_t* const endpt, uint8_t code, mc_endpt_result_fn_t resultfn, mc_options_list_t* list, mc_buffer_t* payload) {
     uint16_t msgid = mc_endpt_udp_nextid(endpt);
-    mc_buffer_t* token = mc_token_create2(msgid);
+    mc_buffer_t* token = mc_message_random_token(msg, MC_TOKEN_LEN, ms_random_thread());
 
     if (resultfn != 0) {
         mc_message_con_init(msg, code, msgid, token, list, payload);
@@ -357,21 +738,101 @@ static uint16_t mk_message(mc_message_t* msg, mc_endpt_udp_t* const endpt, uint8
     return msgid;
 }
 
+/**
+ * Queue a serialized request until its host name resolves, see check_pending().
+ * @return MN_PENDING.
+ */
+static int queue_pending(mc_endpt_udp_t* const endpt, const mc_uri_cache_entry_t* cached, uint32_t nbytes, mc_message_t* msg,
+                         mc_endpt_result_fn_t resultfn, mc_endpt_response_fn_t responsefn) {
+    mc_endpt_pending_t* pending = ms_calloc_tag(MS_MEM_QUEUE, 1, mc_endpt_pending_t);
+
+    pending->host = ms_mem_retag(ms_copy_str(cached->host), MS_MEM_URI);
+    pending->port = cached->port;
+    pending->msgid = mc_message_get_message_id(msg);
+    pending->confirmable = mc_message_is_confirmable(msg);
+    pending->msg = mc_shared_buffer_create(nbytes, endpt->wrbuffer.bytes);
+    pending->resultfn = resultfn;
+    pending->responsefn = responsefn;
+    pending->deadline = mn_gettime() + MAX_TRANSMIT_SPAN;
+    pending->next = endpt->pending;
+    endpt->pending = pending;
+
+    return MN_PENDING;
+}
+
+/**
+ * Find where to send a request when the caller did not give an address.
+ * IP literals come from the URI cache, host names from the resolver, which never blocks.
+ * The address is one the socket's family can reach, IPv4 is mapped for an IPv6 socket.
+ * @return MN_DONE with addr set, MN_PENDING if the name is still being resolved, or an error.
+ */
+static int lookup_addr(mc_endpt_udp_t* const endpt, const mc_uri_cache_entry_t* cached, sockaddr_t* addr) {
+    if (cached->resolved) {
+        *addr = cached->addr;
+        return mn_sockaddr_to_family(addr, endpt->family) ? MN_DONE : MN_NOHOST;
+    }
+    if (endpt->resolver == 0) {
+        endpt->resolver = mn_resolver_init(mn_resolver_alloc(), MN_RESOLVER_SIZE, MN_RESOLVER_TTL);
+    }
+    return mn_resolver_lookup(endpt->resolver, cached->host, cached->port, endpt->family, addr);
+}
+
 /**
  * Generic message sending function to suppport implementation of
  * mc_endpt_udp_get, put, post, and delete.
+ * The URI options come from the endpoint's URI cache, already encoded. Extra options that sort
+ * after them are encoded behind them, otherwise the cached options are decoded and merged.
+ * If addr is 0 the message is sent to the URI's host; a host name that is not resolved yet
+ * queues the request until it is (or fails) rather than blocking.
+ * Extra options are left as they were, the caller may reuse them for further requests.
+ * With a response fn the request is tracked in the endpoint's request table until it is answered.
  */
-static uint16_t send_msg(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, uint8_t code, char* const uri, mc_options_list_t* extra, mc_buffer_t* payload) {
+static uint16_t send_msg(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, mc_endpt_response_fn_t responsefn,
+                         uint8_t code, char* const uri, mc_options_list_t* extra, mc_buffer_t* payload) {
+    const mc_uri_cache_entry_t* cached = mc_uri_cache_get(&endpt->uricache, addr, uri);
+    sockaddr_t toaddr;
     mc_message_t msg;
-    mc_options_list_t* list;
+    mc_buffer_t serialized;
+    mc_request_t* request;
+    uint32_t nbytes;
     uint16_t msgid;
     int err;
 
-    list = mk_options(uri, addr, extra);
-    msgid = mk_message(&msg, endpt, code, resultfn, list, payload);
+    if (cached == 0) {
+        ms_log_debug("Unable to convert uri to options: %s", uri);
+        mc_buffer_free(payload);
+        return 0;
+    }
 
-    err = mc_endpt_udp_send(endpt, addr, &msg, resultfn);
-    if (err != MN_DONE) {
+    if (follows(extra, cached->lastnum)) {
+        /* Extra is only lent to the message to be encoded, it is not the message's to free. */
+        msgid = mk_message(&msg, endpt, code, resultfn, extra && extra->noptions ? extra : 0, payload);
+        nbytes = mc_message_to_buffer_encoded(&msg, &cached->options, cached->lastnum, &endpt->wrbuffer);
+        msg.options = 0;
+    }
+    else {
+        msgid = mk_message(&msg, endpt, code, resultfn, mk_options(cached, extra), payload);
+        nbytes = mc_message_to_buffer(&msg, &endpt->wrbuffer);
+    }
+
+    if (addr) {
+        toaddr = *addr;
+        err = MN_DONE;
+    }
+    else {
+        err = lookup_addr(endpt, cached, &toaddr);
+    }
+
+    if (err == MN_DONE) {
+        request = track_request(endpt, &toaddr, mc_buffer_init(&serialized, nbytes, endpt->wrbuffer.bytes), responsefn);
+        err = send_serialized(endpt, nbytes, &toaddr, &msg, resultfn);
+        if (err != MN_DONE && request) untrack_request(endpt, request);
+    }
+    else if (err == MN_PENDING && nbytes > 0) {
+        err = queue_pending(endpt, cached, nbytes, &msg, resultfn, responsefn);
+    }
+
+    if (err != MN_DONE && err != MN_PENDING) {
         ms_log_debug("Error sending message: %d, %s", err, mn_strerror(err));
         msgid = 0;
     }
@@ -385,7 +846,7 @@ static uint16_t send_msg(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc
  * @return the message id.
  */
 uint16_t mc_endpt_udp_delete(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, char* const uri, mc_options_list_t* extra) {
-    return send_msg(endpt, addr, resultfn, MC_DELETE, uri, extra, 0);
+    return send_msg(endpt, addr, resultfn, 0, MC_DELETE, uri, extra, 0);
 }
 
 /**
@@ -393,7 +854,7 @@ uint16_t mc_endpt_udp_delete(mc_endpt_udp_t* const endpt, sockaddr_t* const addr
  * @return the message id.
  */
 uint16_t mc_endpt_udp_get(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, char* const uri, mc_options_list_t* extra) {
-    return send_msg(endpt, addr, resultfn, MC_GET, uri, extra, 0);
+    return send_msg(endpt, addr, resultfn, 0, MC_GET, uri, extra, 0);
 }
 
 /**
@@ -402,7 +863,7 @@ uint16_t mc_endpt_udp_get(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, m
  * @return the message id.
  */
 uint16_t mc_endpt_udp_post(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, char* const uri, mc_options_list_t* extra, mc_buffer_t* payload) {
-    return send_msg(endpt, addr, resultfn, MC_POST, uri, extra, payload);
+    return send_msg(endpt, addr, resultfn, 0, MC_POST, uri, extra, payload);
 }
 
 /**
@@ -410,7 +871,22 @@ uint16_t mc_endpt_udp_post(mc_endpt_udp_t* const endpt, sockaddr_t* const addr,
  * @return the message id.
  */
 uint16_t mc_endpt_udp_put(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn, char* const uri, mc_options_list_t* extra, mc_buffer_t* payload) {
-    return send_msg(endpt, addr, resultfn, MC_PUT, uri, extra, payload);
+    return send_msg(endpt, addr, resultfn, 0, MC_PUT, uri, extra, payload);
+}
+
+/**
+ * Send a request and deliver its response to responsefn.
+ * The request is confirmable if there is a result fn, like the other request functions.
+ * Responses are matched on (peer, token), including separate responses and observe
+ * notifications, and are not returned by mc_endpt_udp_recv(). If no final response arrives
+ * within EXCHANGE_LIFETIME (NON_LIFETIME for non-confirmable requests) responsefn is
+ * called with a null response.
+ * @return the message id or 0 on error.
+ */
+uint16_t mc_endpt_udp_request(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, uint8_t code, char* const uri,
+                              mc_options_list_t* extra, mc_buffer_t* payload,
+                              mc_endpt_result_fn_t resultfn, mc_endpt_response_fn_t responsefn) {
+    return send_msg(endpt, addr, resultfn, responsefn, code, uri, extra, payload);
 }
 
 /** @} */
@@ -10,9 +10,15 @@
 #include "msys/ms_config.h"
 #include "msys/ms_thread.h"
 #include "mnet/mn_socket.h"
+#include "mnet/mn_peer_table.h"
+#include "mnet/mn_resolver.h"
 #include "mcoap/mc_buffer.h"
 #include "mcoap/mc_message.h"
 #include "mcoap/mc_buffer_queue.h"
+#include "mcoap/mc_event_log.h"
+#include "mcoap/mc_recv_ring.h"
+#include "mcoap/mc_request_table.h"
+#include "mcoap/mc_uri_cache.h"
 
 /* @todo consider creating a struct and init-with-defaults function for this information. */
 /* Default transmission parameters. */
@@ -27,19 +33,45 @@
 #define MAX_LATENCY         100
 #define PROCESSING_DELAY    ACK_TIMEOUT
 #define EXCHANGE_LIFETIME   247   /* MAX_TRANSMIT_SPAN + (2 * MAX_LATENCY) + PROCESSING_DELAY */
+#define NON_LIFETIME        145   /* MAX_TRANSMIT_SPAN + MAX_LATENCY */
+#define DEFAULT_MAX_AGE     60    /**< seconds, RFC7252 5.10.5. */
+
+#define MC_PEER_TABLE_SIZE  1024  /**< Default number of interned peer addresses. */
+#define MC_RECV_SLOTS       64    /**< Default number of receive slots. */
 
 typedef struct mc_endpt_udp mc_endpt_udp_t;
 
+/** A serialized request waiting for its host name to resolve. */
+typedef struct mc_endpt_pending mc_endpt_pending_t;
+struct mc_endpt_pending {
+    char* host;
+    uint16_t port;
+    uint16_t msgid;
+    int confirmable;
+    mc_shared_buffer_t* msg;
+    mc_endpt_result_fn_t resultfn;
+    mc_endpt_response_fn_t responsefn;
+    double deadline;
+    mc_endpt_pending_t* next;
+};
+
 typedef int (*mc_endpt_read_fn_t)(mc_endpt_udp_t* const endpt, mc_message_t* const msg);
 
 struct mc_endpt_udp {
     ms_thread_t* thread;
     mn_socket_t sock;
+    int family;                     /**< Of the socket, AF_INET or AF_INET6. */
     mn_timeout_t tmout;
     mc_endpt_read_fn_t readfn;
-    mc_buffer_t rdbuffer;
+    mc_recv_ring_t ring;            /**< Receive slots, payloads reference their slot until released. */
     mc_buffer_t wrbuffer;
     mc_buffer_queue_t confirmq;
+    mc_uri_cache_t uricache;
+    mn_peer_table_t peers;          /**< Interned source addresses, see mc_message_t.peer. */
+    mc_request_table_t requests;    /**< Requests waiting for a response, see mc_endpt_udp_request(). */
+    mn_resolver_t* resolver;        /**< Started on the first request to a host name. */
+    mc_endpt_pending_t* pending;    /**< Requests waiting for the resolver. */
+    mc_event_log_t* events;         /**< Records the datagrams sent and received if set, not owned. */
     int running;
     uint16_t nextid;
 };
@@ -47,6 +79,8 @@ struct mc_endpt_udp {
 mc_endpt_udp_t* mc_endpt_udp_alloc();
 mc_endpt_udp_t* mc_endpt_udp_init(mc_endpt_udp_t* const endpt, uint32_t rdsize, uint32_t wrsize, const char* hostname, unsigned short port);
 mc_endpt_udp_t* mc_endpt_set_timeout(mc_endpt_udp_t* const endpt, double seconds);
+int mc_endpt_udp_set_recv_slots(mc_endpt_udp_t* const endpt, uint32_t nslots, int huge);
+mc_endpt_udp_t* mc_endpt_udp_set_event_log(mc_endpt_udp_t* const endpt, mc_event_log_t* events);
 mc_endpt_udp_t* mc_endpt_udp_deinit(mc_endpt_udp_t* const endpt);
 mc_endpt_udp_t* mc_endpt_udp_start(mc_endpt_udp_t* const endpt, mc_endpt_read_fn_t readfn);
 mc_endpt_udp_t* mc_endpt_udp_stop(mc_endpt_udp_t* const endpt);
@@ -55,6 +89,8 @@ void mc_endpt_udp_loop(mc_endpt_udp_t* endpt, mc_endpt_read_fn_t readfn);
 int mc_endpt_udp_send(mc_endpt_udp_t* const endpt, sockaddr_t* toaddr, mc_message_t* msg, mc_endpt_result_fn_t resultfn);
 mc_endpt_udp_t* mc_endpt_udp_check_queues(mc_endpt_udp_t* const endpt);
 int mc_endpt_udp_ack(mc_endpt_udp_t *const endpt, sockaddr_t *const addr, mc_buffer_t *token, uint16_t msgid);
+int mc_endpt_udp_respond(mc_endpt_udp_t* const endpt, mc_message_t* const request, uint8_t code,
+                         mc_options_list_t* options, mc_buffer_t* payload);
 uint16_t mc_endpt_udp_delete(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn,
                              char* const uri, mc_options_list_t* extra);
 uint16_t mc_endpt_udp_get(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn,
@@ -63,6 +99,9 @@ uint16_t mc_endpt_udp_post(mc_endpt_udp_t* const endpt, sockaddr_t* const addr,
                            char* const uri, mc_options_list_t* extra, mc_buffer_t* payload);
 uint16_t mc_endpt_udp_put(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, mc_endpt_result_fn_t resultfn,
                           char* const uri, mc_options_list_t* extra, mc_buffer_t* payload);
+uint16_t mc_endpt_udp_request(mc_endpt_udp_t* const endpt, sockaddr_t* const addr, uint8_t code, char* const uri,
+                              mc_options_list_t* extra, mc_buffer_t* payload,
+                              mc_endpt_result_fn_t resultfn, mc_endpt_response_fn_t responsefn);
 mc_message_t* mc_endpt_udp_get_queued_msg(mc_endpt_udp_t* endpt, uint16_t msgid);
 
 /** @} */
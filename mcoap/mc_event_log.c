@@ -0,0 +1,271 @@
+/**
+ * @file
+ * @ingroup event_log
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "msys/ms_atomic.h"
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_event_log.h"
+
+#define PAD(nbytes)         (((nbytes) + MC_EVENT_ALIGN - 1) / MC_EVENT_ALIGN * MC_EVENT_ALIGN)
+#define EVENT_SIZE(nbytes)  (sizeof(mc_event_t) + PAD(nbytes))
+#define PEER_EVENT_SIZE     EVENT_SIZE(sizeof(mc_event_addr_t))
+
+mc_event_log_t* mc_event_log_alloc() {
+    return ms_calloc(1, mc_event_log_t);
+}
+
+/**
+ * Convert a socket address to its portable form, the family is 0 if it is not IPv4 or IPv6.
+ * @return event_addr.
+ */
+mc_event_addr_t* mc_event_addr_init(mc_event_addr_t* event_addr, const sockaddr_t* addr) {
+    memset(event_addr, 0, sizeof(mc_event_addr_t));
+    if (addr == 0) return event_addr;
+
+    if (addr->ss_family == AF_INET) {
+        const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+        memcpy(event_addr->addr, &in->sin_addr, sizeof(in->sin_addr));
+        event_addr->port = in->sin_port;
+        event_addr->family = 4;
+    }
+    else if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)addr;
+        memcpy(event_addr->addr, &in6->sin6_addr, sizeof(in6->sin6_addr));
+        event_addr->port = in6->sin6_port;
+        event_addr->family = 6;
+    }
+    return event_addr;
+}
+
+/**
+ * Name the file of a segment, path.segment.
+ * @return buffer.
+ */
+char* mc_event_log_segment_path(char* buffer, size_t size, const char* path, uint32_t segment) {
+    snprintf(buffer, size, "%s.%u", path, segment);
+    return buffer;
+}
+
+/** Map the file for the log's sequence number and write its header, call locked. */
+static int open_segment(mc_event_log_t* log) {
+    mc_event_log_header_t* header;
+    char path[1024];
+
+    mc_event_log_segment_path(path, sizeof(path), log->path, (uint32_t)(log->sequence % log->nsegments));
+    if (ms_pages_map_file(&log->segment, path, log->segsize) == 0) return 0;
+
+    header = (mc_event_log_header_t*)log->segment.base;
+    memcpy(header->magic, MC_EVENT_LOG_MAGIC, sizeof(header->magic));
+    header->version = MC_EVENT_LOG_VERSION;
+    header->order = MC_EVENT_LOG_ORDER;
+    header->sequence = log->sequence;
+    header->size = (uint32_t)log->segment.size;
+    header->snaplen = log->snaplen;
+    header->local = log->local;
+
+    log->pos = sizeof(mc_event_log_header_t);
+    memset(log->known, 0, sizeof(log->known));
+    return 1;
+}
+
+/** @return the sequence number after the newest segment left under the log's path, 0 if none. */
+static uint64_t resume_sequence(const mc_event_log_t* log) {
+    mc_event_log_header_t header;
+    char path[1024];
+    uint64_t sequence = 0;
+    uint32_t isegment;
+
+    for (isegment = 0; isegment < log->nsegments; isegment++) {
+        FILE* file = fopen(mc_event_log_segment_path(path, sizeof(path), log->path, isegment), "rb");
+        int found;
+
+        if (file == 0) continue;
+        found = fread(&header, sizeof(header), 1, file) == 1
+                && mc_event_log_header((const uint8_t*)&header, sizeof(header)) != 0;
+        fclose(file);
+        if (found && header.sequence >= sequence) sequence = header.sequence + 1;
+    }
+    return sequence;
+}
+
+/**
+ * Open a log, continuing after the newest segment already under the path. Datagrams are
+ * cut to snaplen bytes, at most 65535, and the segment size must leave room for at least
+ * one event of that size.
+ * Local is the endpoint's own address for the pcap output, it may be 0.
+ * @return the log or 0 if the segment can not be mapped.
+ */
+mc_event_log_t* mc_event_log_init(mc_event_log_t* log, const char* path, uint32_t segsize, uint32_t nsegments,
+                                  uint32_t snaplen, const sockaddr_t* local) {
+    memset(log, 0, sizeof(mc_event_log_t));
+    if (snaplen > UINT16_MAX) snaplen = UINT16_MAX;
+    if (nsegments == 0 || segsize < sizeof(mc_event_log_header_t) + PEER_EVENT_SIZE + EVENT_SIZE(snaplen)) return 0;
+
+    log->path = ms_copy_str(path);
+    log->segsize = segsize;
+    log->nsegments = nsegments;
+    log->snaplen = snaplen;
+    mc_event_addr_init(&log->local, local);
+
+    if (log->path) log->sequence = resume_sequence(log);
+    if (log->path == 0 || !open_segment(log)) {
+        mc_event_log_deinit(log);
+        return 0;
+    }
+    return log;
+}
+
+/**
+ * Unmap the segment, the events already written stay in the files.
+ */
+mc_event_log_t* mc_event_log_deinit(mc_event_log_t* log) {
+    ms_pages_deinit(&log->segment);
+    ms_free(log->path);
+    memset(log, 0, sizeof(mc_event_log_t));
+
+    return log;
+}
+
+/** Append an event, the caller has checked it fits. */
+static void append(mc_event_log_t* log, const mc_event_t* event, const void* bytes) {
+    uint8_t* dest = (uint8_t*)log->segment.base + log->pos;
+
+    memcpy(dest, event, sizeof(mc_event_t));
+    if (event->nbytes) memcpy(dest + sizeof(mc_event_t), bytes, event->nbytes);
+    log->pos += EVENT_SIZE(event->nbytes);
+}
+
+/**
+ * Record the address of a peer the segment has not seen yet. The address is compared too,
+ * a peer table id is reused for another address once its slot's generation wraps.
+ */
+static void append_peer(mc_event_log_t* log, const mc_event_t* event, const sockaddr_t* addr) {
+    mc_event_log_peer_t* known = &log->known[MN_PEER_INDEX(event->peer) % MC_EVENT_LOG_PEERS];
+    mc_event_addr_t event_addr;
+    mc_event_t peer;
+
+    if (mc_event_addr_init(&event_addr, addr)->family == 0) return;
+    if (known->peer == event->peer && memcmp(&known->addr, &event_addr, sizeof(event_addr)) == 0) return;
+    known->peer = event->peer;
+    known->addr = event_addr;
+
+    memset(&peer, 0, sizeof(mc_event_t));
+    peer.time = event->time;
+    peer.peer = event->peer;
+    peer.length = sizeof(mc_event_addr_t);
+    peer.nbytes = sizeof(mc_event_addr_t);
+    peer.type = MC_EVENT_PEER;
+    append(log, &peer, &event_addr);
+}
+
+/**
+ * Append an event with up to snaplen of the length raw bytes.
+ * Addr is the peer's address, recorded the first time a segment sees the peer, it may be 0.
+ * @return 1 on success, 0 if the event was dropped because a segment could not be mapped.
+ */
+int mc_event_log_write(mc_event_log_t* log, uint8_t type, mn_peer_id_t peer, const sockaddr_t* addr,
+                       uint16_t msgid, uint8_t code, const uint8_t* bytes, uint32_t length) {
+    mc_event_t event;
+    int written;
+
+    memset(&event, 0, sizeof(mc_event_t));
+    event.time = (uint64_t)(mn_gettime() * 1.0e6);
+    event.peer = peer;
+    event.length = length;
+    event.msgid = msgid;
+    event.nbytes = (uint16_t)(bytes == 0 ? 0 : length < log->snaplen ? length : log->snaplen);
+    event.type = type;
+    event.code = code;
+
+    ms_spin_lock(&log->lock);
+    if (log->segment.base == 0) {
+        /* Retry a segment that could not be mapped. */
+        open_segment(log);
+    }
+    else if (log->pos + PEER_EVENT_SIZE + EVENT_SIZE(event.nbytes) > log->segment.size) {
+        /* The tail is left zero, which ends the segment. */
+        ms_pages_deinit(&log->segment);
+        log->sequence++;
+        open_segment(log);
+    }
+
+    written = log->segment.base != 0;
+    if (written) {
+        if (peer != MN_PEER_NONE && addr) append_peer(log, &event, addr);
+        append(log, &event, bytes);
+    }
+    else {
+        log->dropped++;
+    }
+    ms_spin_unlock(&log->lock);
+
+    return written;
+}
+
+/**
+ * Append a CoAP datagram, its message id and code are read from its header.
+ * @return 1 on success, 0 if the event was dropped.
+ */
+int mc_event_log_datagram(mc_event_log_t* log, uint8_t type, mn_peer_id_t peer, const sockaddr_t* addr,
+                          const uint8_t* bytes, uint32_t length) {
+    uint16_t msgid = 0;
+    uint8_t code = 0;
+
+    if (length >= 4) {
+        code = bytes[1];
+        msgid = (uint16_t)((bytes[2] << 8) | bytes[3]);
+    }
+    return mc_event_log_write(log, type, peer, addr, msgid, code, bytes, length);
+}
+
+/**
+ * Check that a segment read into memory was written by this version in this byte order.
+ * @return its header or 0 if it is not a segment that can be decoded here.
+ */
+const mc_event_log_header_t* mc_event_log_header(const uint8_t* segment, size_t size) {
+    const mc_event_log_header_t* header = (const mc_event_log_header_t*)segment;
+
+    if (size < sizeof(mc_event_log_header_t)) return 0;
+    if (memcmp(header->magic, MC_EVENT_LOG_MAGIC, sizeof(header->magic)) != 0) return 0;
+    if (header->version != MC_EVENT_LOG_VERSION || header->order != MC_EVENT_LOG_ORDER) return 0;
+    return header;
+}
+
+/**
+ * Step through the events of a segment read into memory aligned to MC_EVENT_ALIGN.
+ * Start with pos 0, the event's raw bytes follow it.
+ * @return the next event or 0 at the end of the segment.
+ */
+const mc_event_t* mc_event_log_next(const uint8_t* segment, size_t size, size_t* pos) {
+    const mc_event_t* event;
+
+    if (*pos < sizeof(mc_event_log_header_t)) *pos = sizeof(mc_event_log_header_t);
+    if (*pos + sizeof(mc_event_t) > size) return 0;
+
+    event = (const mc_event_t*)(segment + *pos);
+    if (event->type == MC_EVENT_END || *pos + EVENT_SIZE(event->nbytes) > size) return 0;
+
+    *pos += EVENT_SIZE(event->nbytes);
+    return event;
+}
+
+/** @return the name of an event type. */
+const char* mc_event_type_name(uint8_t type) {
+    switch (type) {
+        case MC_EVENT_SEND: return "SEND";
+        case MC_EVENT_RECV: return "RECV";
+        case MC_EVENT_RETRANSMIT: return "RETRANSMIT";
+        case MC_EVENT_TIMEOUT: return "TIMEOUT";
+        case MC_EVENT_PEER: return "PEER";
+        default: return "UNKNOWN";
+    }
+}
+
+/** @} */
@@ -0,0 +1,116 @@
+#ifndef MC_EVENT_LOG_H
+#define MC_EVENT_LOG_H
+
+/**
+ * @file
+ * @defgroup event_log CoAP Binary Event Log
+ * @{
+ * A compact record of the datagrams an endpoint sends and receives, for post-mortems.
+ *
+ * Events are appended to a segment file mapped shared, so each one is a couple of stores
+ * and the file keeps what was written even if the process dies. When a segment is full
+ * the log moves on to the next of nsegments files named path.0, path.1, ... reusing the
+ * oldest, so disk use is bounded by nsegments * segsize. A log opened on a path that
+ * already has segments continues after the newest of them, so a process restarted after
+ * a crash keeps the segments that recorded it.
+ *
+ * A segment starts with a mc_event_log_header_t followed by events. Each event is a fixed
+ * mc_event_t followed by nbytes raw bytes, padded to MC_EVENT_ALIGN, and a zero type ends
+ * the segment. The first time a segment refers to a peer id a MC_EVENT_PEER event records
+ * its address, so every segment can be decoded on its own. Fields are in the byte order
+ * of the machine that wrote the log, see mc_event_log_header_t.order.
+ *
+ * The mcevlog tool turns segments into text or a pcap file.
+ */
+
+#include "msys/ms_config.h"
+#include "msys/ms_pages.h"
+#include "mnet/mn_socket.h"
+#include "mnet/mn_peer_table.h"
+
+#define MC_EVENT_LOG_MAGIC      "MCEVLOG"   /**< With its terminator, the first 8 bytes of a segment. */
+#define MC_EVENT_LOG_VERSION    1
+#define MC_EVENT_LOG_ORDER      0x01020304  /**< Reads back differently in the other byte order. */
+#define MC_EVENT_LOG_PEERS      1024        /**< Peer ids remembered per segment, others are recorded again. */
+#define MC_EVENT_ALIGN          8
+
+/** Event types. */
+#define MC_EVENT_END            0           /**< No more events in the segment. */
+#define MC_EVENT_SEND           1           /**< First transmission of a datagram. */
+#define MC_EVENT_RECV           2
+#define MC_EVENT_RETRANSMIT     3           /**< A confirmable message sent again. */
+#define MC_EVENT_TIMEOUT        4           /**< A confirmable message given up on, no bytes. */
+#define MC_EVENT_PEER           5           /**< The address of a peer id, bytes are a mc_event_addr_t. */
+
+/** A portable socket address. */
+typedef struct mc_event_addr mc_event_addr_t;
+struct mc_event_addr {
+    uint8_t addr[16];       /**< IPv4 addresses use the first 4 bytes. */
+    uint16_t port;          /**< Network byte order. */
+    uint8_t family;         /**< 4 or 6, 0 if unknown. */
+    uint8_t pad;
+};
+
+typedef struct mc_event_log_header mc_event_log_header_t;
+struct mc_event_log_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;         /**< MC_EVENT_LOG_ORDER as written. */
+    uint64_t sequence;      /**< Segments written before this one, by earlier runs too. */
+    uint32_t size;          /**< Segment bytes, header included. */
+    uint32_t snaplen;       /**< Most raw bytes kept per datagram. */
+    mc_event_addr_t local;  /**< The endpoint's address, if given. */
+    uint8_t pad[4];
+};
+
+typedef struct mc_event mc_event_t;
+struct mc_event {
+    uint64_t time;          /**< Microseconds since the epoch. */
+    mn_peer_id_t peer;
+    uint32_t length;        /**< Datagram bytes, more than nbytes if cut at the snaplen. */
+    uint16_t msgid;
+    uint16_t nbytes;        /**< Raw bytes following the event. */
+    uint8_t type;
+    uint8_t code;
+    uint8_t pad[2];
+};
+
+/** A peer whose address the segment has recorded, the address too since ids can be reused. */
+typedef struct mc_event_log_peer mc_event_log_peer_t;
+struct mc_event_log_peer {
+    mn_peer_id_t peer;
+    mc_event_addr_t addr;
+};
+
+typedef struct mc_event_log mc_event_log_t;
+struct mc_event_log {
+    char* path;
+    ms_pages_t segment;             /**< The mapped segment being appended to. */
+    size_t pos;                     /**< Where the next event goes. */
+    uint64_t sequence;
+    uint32_t segsize;
+    uint32_t nsegments;
+    uint32_t snaplen;
+    uint32_t dropped;               /**< Events lost because a segment could not be mapped. */
+    mc_event_addr_t local;
+    volatile long lock;
+    mc_event_log_peer_t known[MC_EVENT_LOG_PEERS];  /**< Peers recorded in this segment. */
+};
+
+mc_event_log_t* mc_event_log_alloc();
+mc_event_log_t* mc_event_log_init(mc_event_log_t* log, const char* path, uint32_t segsize, uint32_t nsegments,
+                                  uint32_t snaplen, const sockaddr_t* local);
+mc_event_log_t* mc_event_log_deinit(mc_event_log_t* log);
+int mc_event_log_write(mc_event_log_t* log, uint8_t type, mn_peer_id_t peer, const sockaddr_t* addr,
+                       uint16_t msgid, uint8_t code, const uint8_t* bytes, uint32_t length);
+int mc_event_log_datagram(mc_event_log_t* log, uint8_t type, mn_peer_id_t peer, const sockaddr_t* addr,
+                          const uint8_t* bytes, uint32_t length);
+char* mc_event_log_segment_path(char* buffer, size_t size, const char* path, uint32_t segment);
+const mc_event_log_header_t* mc_event_log_header(const uint8_t* segment, size_t size);
+const mc_event_t* mc_event_log_next(const uint8_t* segment, size_t size, size_t* pos);
+mc_event_addr_t* mc_event_addr_init(mc_event_addr_t* event_addr, const sockaddr_t* addr);
+const char* mc_event_type_name(uint8_t type);
+
+/** @} */
+
+#endif
@@ -6,16 +6,16 @@
  
 #include "mcoap/mc_header.h"
 
-#define VERSION_MASK 0xC0000000
-#define MTYPE_MASK   0x30000000
-#define TKLEN_MASK   0x0F000000
-#define CODE_MASK    0x00FF0000
-#define MID_MASK     0x0000FFFF
+#define VERSION_MASK MC_HEADER_VERSION_MASK
+#define MTYPE_MASK   MC_HEADER_MTYPE_MASK
+#define TKLEN_MASK   MC_HEADER_TKLEN_MASK
+#define CODE_MASK    MC_HEADER_CODE_MASK
+#define MID_MASK     MC_HEADER_MID_MASK
 
-#define VERSION_OFFSET 30
-#define MTYPE_OFFSET   28
-#define TKLEN_OFFSET   24
-#define CODE_OFFSET    16
+#define VERSION_OFFSET MC_HEADER_VERSION_OFFSET
+#define MTYPE_OFFSET   MC_HEADER_MTYPE_OFFSET
+#define TKLEN_OFFSET   MC_HEADER_TKLEN_OFFSET
+#define CODE_OFFSET    MC_HEADER_CODE_OFFSET
 
 /**
  * Given the header components format the header.
@@ -9,6 +9,18 @@
 
 #include "msys/ms_config.h"
 
+/** Header field masks and offsets, in host byte order. */
+#define MC_HEADER_VERSION_MASK 0xC0000000
+#define MC_HEADER_MTYPE_MASK   0x30000000
+#define MC_HEADER_TKLEN_MASK   0x0F000000
+#define MC_HEADER_CODE_MASK    0x00FF0000
+#define MC_HEADER_MID_MASK     0x0000FFFF
+
+#define MC_HEADER_VERSION_OFFSET 30
+#define MC_HEADER_MTYPE_OFFSET   28
+#define MC_HEADER_TKLEN_OFFSET   24
+#define MC_HEADER_CODE_OFFSET    16
+
 uint32_t mc_header_create(uint8_t version, uint8_t message_type, uint32_t token_len, uint8_t code, uint16_t message_id);
 uint8_t mc_header_get_version(uint32_t header);
 uint8_t mc_header_get_message_type(uint32_t header);
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @ingroup header_batch
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_endian.h"
+#include "mcoap/mc_header.h"
+#include "mcoap/mc_option_scan.h"
+#include "mcoap/mc_header_batch.h"
+
+#define MESSAGE_VERSION 1
+#define MAX_TOKEN_LEN   8
+#define INVALID_POS     UINT32_MAX
+
+mc_header_batch_t* mc_header_batch_alloc() {
+    return ms_calloc(1, mc_header_batch_t);
+}
+
+/**
+ * Allocate the columns for up to capacity datagrams.
+ * @return the batch or 0 if allocation failed.
+ */
+mc_header_batch_t* mc_header_batch_init(mc_header_batch_t* batch, uint32_t capacity) {
+    batch->count = 0;
+    batch->capacity = capacity;
+    batch->header = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint32_t);
+    batch->type = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint8_t);
+    batch->code = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint8_t);
+    batch->msgid = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint16_t);
+    batch->tklen = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint8_t);
+    batch->optpos = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint16_t);
+    batch->plpos = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint16_t);
+    batch->valid = ms_calloc_tag(MS_MEM_MESSAGE, capacity, uint8_t);
+
+    if (!batch->header || !batch->type || !batch->code || !batch->msgid ||
+        !batch->tklen || !batch->optpos || !batch->plpos || !batch->valid) {
+        mc_header_batch_deinit(batch);
+        return 0;
+    }
+    return batch;
+}
+
+mc_header_batch_t* mc_header_batch_deinit(mc_header_batch_t* batch) {
+    if (batch->header) ms_free(batch->header);
+    if (batch->type) ms_free(batch->type);
+    if (batch->code) ms_free(batch->code);
+    if (batch->msgid) ms_free(batch->msgid);
+    if (batch->tklen) ms_free(batch->tklen);
+    if (batch->optpos) ms_free(batch->optpos);
+    if (batch->plpos) ms_free(batch->plpos);
+    if (batch->valid) ms_free(batch->valid);
+
+    memset(batch, 0, sizeof(mc_header_batch_t));
+    return batch;
+}
+
+/**
+ * Decode the headers of count datagrams (at most capacity) into the batch columns.
+ * Datagrams that are too short, have the wrong version, or have malformed options are marked invalid.
+ * @return the number of datagrams decoded.
+ */
+uint32_t mc_header_batch_decode(mc_header_batch_t* batch, const mc_buffer_t* datagrams, uint32_t count) {
+    uint32_t idx;
+    uint32_t header;
+    uint32_t plpos;
+    mc_option_scan_t scan;
+
+    if (count > batch->capacity) count = batch->capacity;
+    batch->count = count;
+
+    /* Gather the header words, anything too short or too long for a datagram is left as 0. */
+    for (idx = 0; idx < count; idx++) {
+        header = 0;
+        if (datagrams[idx].nbytes >= 4 && datagrams[idx].nbytes <= UINT16_MAX) {
+            memcpy(&header, datagrams[idx].bytes, sizeof(uint32_t));
+            header = ms_swap_u32(header);
+        }
+        batch->header[idx] = header;
+    }
+
+    /* Split the header words into columns, a branch free loop over the header column. */
+    for (idx = 0; idx < count; idx++) {
+        header = batch->header[idx];
+        batch->type[idx] = (uint8_t)((header & MC_HEADER_MTYPE_MASK) >> MC_HEADER_MTYPE_OFFSET);
+        batch->code[idx] = (uint8_t)((header & MC_HEADER_CODE_MASK) >> MC_HEADER_CODE_OFFSET);
+        batch->msgid[idx] = (uint16_t)(header & MC_HEADER_MID_MASK);
+        batch->tklen[idx] = (uint8_t)((header & MC_HEADER_TKLEN_MASK) >> MC_HEADER_TKLEN_OFFSET);
+        batch->optpos[idx] = (uint16_t)(4 + batch->tklen[idx]);
+        batch->valid[idx] = (uint8_t)(((header & MC_HEADER_VERSION_MASK) >> MC_HEADER_VERSION_OFFSET) == MESSAGE_VERSION);
+    }
+
+    /* Locate the payloads, the only per datagram walk. */
+    for (idx = 0; idx < count; idx++) {
+        plpos = INVALID_POS;
+        if (batch->valid[idx] && batch->tklen[idx] <= MAX_TOKEN_LEN && batch->optpos[idx] <= datagrams[idx].nbytes) {
+            if (mc_option_scan(&scan, datagrams[idx].bytes, datagrams[idx].nbytes, batch->optpos[idx])) {
+                plpos = scan.plpos;
+            }
+        }
+
+        if (plpos == INVALID_POS) {
+            batch->valid[idx] = 0;
+            batch->plpos[idx] = 0;
+        }
+        else {
+            batch->plpos[idx] = (uint16_t)plpos;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Count the valid datagrams of the given type.
+ */
+uint32_t mc_header_batch_count(const mc_header_batch_t* batch, uint8_t type) {
+    uint32_t idx;
+    uint32_t total = 0;
+
+    for (idx = 0; idx < batch->count; idx++) {
+        total += (batch->type[idx] == type) & batch->valid[idx];
+    }
+    return total;
+}
+
+/**
+ * Write the indexes of the valid datagrams of the given type into indexes,
+ * which must have room for batch->count entries.
+ * @return the number of indexes written.
+ */
+uint32_t mc_header_batch_select(const mc_header_batch_t* batch, uint8_t type, uint32_t* indexes) {
+    uint32_t idx;
+    uint32_t nselected = 0;
+
+    /* Always store, only advance on a match, so the loop has no data dependent branch. */
+    for (idx = 0; idx < batch->count; idx++) {
+        indexes[nselected] = idx;
+        nselected += (batch->type[idx] == type) & batch->valid[idx];
+    }
+    return nselected;
+}
+
+/**
+ * Find the first valid datagram at or after start with the given type and message id,
+ * e.g. to match an ACK against a confirmable message.
+ * @return the index of the datagram or -1 if not found.
+ */
+int mc_header_batch_find(const mc_header_batch_t* batch, uint32_t start, uint8_t type, uint16_t msgid) {
+    uint32_t idx;
+
+    for (idx = start; idx < batch->count; idx++) {
+        if (batch->msgid[idx] == msgid && batch->type[idx] == type && batch->valid[idx]) return (int)idx;
+    }
+    return -1;
+}
+
+/** @} */
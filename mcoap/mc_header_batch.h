@@ -0,0 +1,41 @@
+#ifndef MC_HEADER_BATCH_H
+#define MC_HEADER_BATCH_H
+
+/**
+ * @file
+ * @defgroup header_batch CoAP Header Batch
+ * @{
+ * Decode the fixed header of a batch of received datagrams into structure-of-arrays columns.
+ * Each column is indexed by datagram, so classifying a batch (ACK vs CON vs RST, matching
+ * message ids) is a tight loop over one small array before any mc_message_t is created.
+ * Field extraction follows the mc_header_get_* functions.
+ */
+
+#include "msys/ms_config.h"
+#include "mcoap/mc_buffer.h"
+
+typedef struct mc_header_batch mc_header_batch_t;
+struct mc_header_batch {
+    uint32_t count;         /**< Number of datagrams decoded. */
+    uint32_t capacity;      /**< Maximum number of datagrams per batch. */
+    uint32_t* header;       /**< Header word in host byte order. */
+    uint8_t* type;          /**< Message type, MC_CONFIRM, MC_NOCONFIRM, MC_ACK, or MC_RESET. */
+    uint8_t* code;
+    uint16_t* msgid;
+    uint8_t* tklen;
+    uint16_t* optpos;       /**< Offset of the first option (after the token). */
+    uint16_t* plpos;        /**< Offset of the payload (after the marker), the datagram length if none. */
+    uint8_t* valid;         /**< 1 if the datagram is a well formed CoAP message, 0 otherwise. */
+};
+
+mc_header_batch_t* mc_header_batch_alloc();
+mc_header_batch_t* mc_header_batch_init(mc_header_batch_t* batch, uint32_t capacity);
+mc_header_batch_t* mc_header_batch_deinit(mc_header_batch_t* batch);
+uint32_t mc_header_batch_decode(mc_header_batch_t* batch, const mc_buffer_t* datagrams, uint32_t count);
+uint32_t mc_header_batch_count(const mc_header_batch_t* batch, uint8_t type);
+uint32_t mc_header_batch_select(const mc_header_batch_t* batch, uint8_t type, uint32_t* indexes);
+int mc_header_batch_find(const mc_header_batch_t* batch, uint32_t start, uint8_t type, uint16_t msgid);
+
+/** @} */
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @ingroup mem_resource
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_mem_resource.h"
+
+/** Longest rendering of one tag, a name and two 64 bit counts. */
+#define MAX_ENTRY 96
+
+/**
+ * Render the usage of every tag as a JSON object.
+ * @return the length, not counting the terminating 0, or 0 if size is too small.
+ */
+uint32_t mc_mem_resource_render(char* json, uint32_t size) {
+    char entry[MAX_ENTRY];
+    uint32_t length = 1;
+    uint32_t tag;
+
+    if (size < 3) return 0;
+    json[0] = '{';
+
+    for (tag = 0; tag < MS_MEM_NTAGS; tag++) {
+        ms_mem_usage_t usage;
+        uint32_t nentry;
+
+        ms_mem_usage(tag, &usage);
+        nentry = (uint32_t)sprintf(entry, "%s\"%s\":{\"bytes\":%lld,\"objects\":%lld}", tag ? "," : "",
+                                   ms_mem_tag_name(tag), (long long)usage.bytes, (long long)usage.objects);
+        if (length + nentry + 2 > size) return 0;
+        memcpy(&json[length], entry, nentry);
+        length += nentry;
+    }
+
+    json[length++] = '}';
+    json[length] = 0;
+    return length;
+}
+
+/**
+ * Serve GET requests for the memory usage on path, MC_MEM_RESOURCE_PATH if path is 0.
+ * @return 1 on success, 0 if the path is taken or invalid.
+ */
+int mc_mem_resource_register(mc_router_t* router, const char* path) {
+    return mc_router_add(router, MC_GET, path ? path : MC_MEM_RESOURCE_PATH, mc_mem_resource_handler, 0);
+}
+
+/**
+ * Router handler for GET on the memory usage resource, arg is unused.
+ */
+int mc_mem_resource_handler(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg) {
+    char json[MC_MEM_RESOURCE_MAX];
+    uint32_t nbytes = mc_mem_resource_render(json, sizeof(json));
+    mc_option_t* options;
+
+    if (nbytes == 0) {
+        mc_endpt_udp_respond(endpt, request, MC_INTERNAL_SERVER_ERROR, 0, 0);
+        return 1;
+    }
+
+    options = mc_option_nalloc(1);
+    mc_option_init_uint32(&options[0], OPTION_CONTENT_FORMAT, CONTENT_JSON);
+    mc_endpt_udp_respond(endpt, request, MC_CONTENT, mc_options_list_init(mc_options_list_alloc(), 1, options),
+                         mc_buffer_init(mc_buffer_alloc(), nbytes, ms_mem_retag(ms_copy_uint8(nbytes, (const uint8_t*)json), MS_MEM_BUFFER)));
+    return 1;
+}
+
+/** @} */
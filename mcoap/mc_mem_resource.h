@@ -0,0 +1,25 @@
+#ifndef MC_MEM_RESOURCE_H
+#define MC_MEM_RESOURCE_H
+
+/**
+ * @file
+ * @defgroup mem_resource CoAP Memory Usage Resource
+ * @{
+ * Serve the live memory of each allocation tag (see ms_mem_usage()) as JSON, e.g.
+ * {"other":{"bytes":512,"objects":3},"message":{"bytes":16384,"objects":1},...}
+ * so a deployed gateway can be checked with a plain CoAP GET.
+ */
+
+#include "msys/ms_config.h"
+#include "mcoap/mc_router.h"
+
+#define MC_MEM_RESOURCE_PATH    "/memory"   /**< Default path. */
+#define MC_MEM_RESOURCE_MAX     1024        /**< Longest rendered payload, fits in one block. */
+
+uint32_t mc_mem_resource_render(char* json, uint32_t size);
+int mc_mem_resource_register(mc_router_t* router, const char* path);
+int mc_mem_resource_handler(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg);
+
+/** @} */
+
+#endif
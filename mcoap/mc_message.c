@@ -4,6 +4,8 @@
  * @{
  */
 
+#define MS_LOG_CATEGORY MS_LOG_CODEC
+
 #include <string.h>
 
 #include "msys/ms_memory.h"
@@ -12,9 +14,11 @@
 #include "msys/ms_log.h"
 #include "mnet/mn_sockaddr.h"
 #include "mcoap/mc_options_list.h"
+#include "mcoap/mc_option_scan.h"
 #include "mcoap/mc_message.h"
 #include "mcoap/mc_header.h"
 #include "mcoap/mc_buffer.h"
+#include "mcoap/mc_pool.h"
 
 #define MESSAGE_VERSION 1
 #define MESSAGE_VERSION_MASK   0xC0000000
@@ -24,8 +28,12 @@
 #define MESSAGE_MSG_ID_MASK    0x0000FFFF
 
 
+/** Allocate a message from the message pool, free it with mc_message_free. */
 mc_message_t* mc_message_alloc() {
-    return ms_calloc(1, mc_message_t);
+    mc_message_t* message = ms_pool_get(mc_pool_messages());
+
+    if (message) memset(message, 0, sizeof(mc_message_t));
+    return message;
 }
 
 mc_message_t* mc_message_init(
@@ -42,7 +50,9 @@ mc_message_t* mc_message_init(
     message->token = token;
     message->options = options;
     message->payload = payload;
-    message->from = 0;
+    message->shared = 0;
+    memset(&message->from, 0, sizeof(sockaddr_t));
+    message->peer = MN_PEER_NONE;
 
     return message;
 }
@@ -93,25 +103,50 @@ mc_message_t* mc_message_rst_init(
     
 mc_message_t* mc_message_deinit(mc_message_t* message) {
     if (message->token) {
-        ms_free(mc_buffer_deinit(message->token));
+        if (message->token != &message->tokenbuf) mc_buffer_free(message->token);
         message->token = 0;
     }
     if (message->options) {
         ms_free(mc_options_list_deinit(message->options));
         message->options = 0;
     }
-    if (message->payload) {
-        ms_free(mc_buffer_deinit(message->payload));
-        message->payload = 0;
+    if (message->shared) {
+        mc_shared_buffer_release(message->shared);
+        message->shared = 0;
     }
-    if (message->from) {
-        ms_free(message->from);
-        message->from = 0;
+    else if (message->payload) {
+        mc_buffer_free(message->payload);
     }
+    message->payload = 0;
+    memset(&message->from, 0, sizeof(sockaddr_t));
+    message->peer = MN_PEER_NONE;
 
     return 0;
 }
 
+/**
+ * Make a shared buffer the payload without copying it, e.g. to send the same payload to
+ * many peers. The message holds a reference until it is deinitialized, any previous payload
+ * is freed.
+ * @return the message.
+ */
+mc_message_t* mc_message_share_payload(mc_message_t* message, mc_shared_buffer_t* shared) {
+    mc_shared_buffer_retain(shared);
+    if (message->shared) mc_shared_buffer_release(message->shared);
+    else if (message->payload) mc_buffer_free(message->payload);
+
+    message->shared = shared;
+    message->payload = &shared->view;
+    return message;
+}
+
+/** Deinitialize a message from mc_message_alloc and return it to the pool, 0 is ignored. */
+void mc_message_free(mc_message_t* message) {
+    if (message == 0) return;
+    mc_message_deinit(message);
+    ms_pool_put(mc_pool_messages(), message);
+}
+
 uint8_t mc_message_get_version(mc_message_t* message) {
     return mc_header_get_version(message->header);
 }
@@ -149,14 +184,35 @@ mc_buffer_t* mc_message_copy_token(mc_message_t* const message) {
     return mc_buffer_copy(message->token, 0, mc_message_get_token_len(message));
 }
 
-uint32_t mc_message_buffer_size(mc_message_t* message) {
-    uint32_t size;
+/**
+ * Generate a random token in the message's inline storage, nothing is allocated.
+ * Pass the result as the token to one of the mc_message_*_init() functions.
+ * @return the inline token.
+ */
+mc_buffer_t* mc_message_random_token(mc_message_t* const message, uint8_t len, ms_random_t* rng) {
+    return mc_token_random(&message->tokenbuf, message->tokenbytes, len, rng);
+}
 
-    if (message == 0) return 0;
+/**
+ * Copy a request's token into the message's inline storage, nothing is allocated.
+ * Pass the result as the token of the response to one of the mc_message_*_init() functions.
+ * @return the inline token.
+ */
+mc_buffer_t* mc_message_echo_token(mc_message_t* const message, mc_message_t* const request) {
+    uint8_t len = mc_message_get_token_len(request);
+
+    memcpy(message->tokenbytes, request->token->bytes, len);
+    return mc_buffer_init(&message->tokenbuf, len, message->tokenbytes);
+}
+
+/* Size of the message with already encoded options (if any) ahead of message->options. */
+static uint32_t buffer_size(mc_message_t* message, const mc_buffer_t* encoded, uint16_t lastnum) {
+    uint32_t size;
 
     size = sizeof(message->header);
     size += message->token->nbytes;
-    size += mc_options_list_buffer_size(message->options);
+    if (encoded) size += encoded->nbytes;
+    size += mc_options_list_buffer_size_after(message->options, lastnum);
 
     // If there are payload bytes and 1 for the payload 0xff flag
     // in addition to the payload bytes.
@@ -168,12 +224,19 @@ uint32_t mc_message_buffer_size(mc_message_t* message) {
     return size;
 }
 
-uint32_t mc_message_to_buffer(mc_message_t* message, mc_buffer_t* buffer) {
+uint32_t mc_message_buffer_size(mc_message_t* message) {
+    if (message == 0) return 0;
+
+    return buffer_size(message, 0, 0);
+}
+
+static uint32_t to_buffer(mc_message_t* message, const mc_buffer_t* encoded, uint16_t lastnum, mc_buffer_t* buffer) {
     uint32_t bpos = 0;
     uint32_t tmp = ms_swap_u32(message->header);
+    uint32_t size = buffer_size(message, encoded, lastnum);
 
-    if (mc_message_buffer_size(message) > buffer->nbytes) {
-        ms_log_debug("buffer is too small small for message, %d < %d", buffer->nbytes, mc_message_buffer_size(message));
+    if (size > buffer->nbytes) {
+        ms_log_debug("buffer is too small small for message, %d < %d", buffer->nbytes, size);
         return 0;
     }
 
@@ -183,7 +246,12 @@ uint32_t mc_message_to_buffer(mc_message_t* message, mc_buffer_t* buffer) {
     if (mc_buffer_copy_to(buffer, bpos, message->token, 0, message->token->nbytes) == 0) return 0;
     bpos += message->token->nbytes;
 
-    if (mc_options_list_to_buffer(message->options, buffer, &bpos) == 0) return 0;
+    if (encoded && encoded->nbytes > 0) {
+        if (mc_buffer_copy_to(buffer, bpos, encoded, 0, encoded->nbytes) == 0) return 0;
+        bpos += encoded->nbytes;
+    }
+
+    if (mc_options_list_to_buffer_after(message->options, buffer, &bpos, lastnum) == 0) return 0;
 
     /* If there is a payload, append the start of payload marker and the payload. */
     if (message->payload && message->payload->nbytes > 0) {
@@ -198,13 +266,31 @@ uint32_t mc_message_to_buffer(mc_message_t* message, mc_buffer_t* buffer) {
     return bpos;
 }
 
-mc_message_t* mc_message_from_buffer(mc_message_t* message, mc_buffer_t* buffer, uint32_t* bpos) {
-    uint32_t remaining;
-    uint32_t marker;
+uint32_t mc_message_to_buffer(mc_message_t* message, mc_buffer_t* buffer) {
+    return to_buffer(message, 0, 0, buffer);
+}
+
+/**
+ * Serialize a message whose leading options are already encoded, e.g. cached URI options.
+ * The encoded options end with option number lastnum, message->options holds the rest of the
+ * options and must not contain option numbers less than lastnum.
+ * @return the number of bytes written or 0 on failure.
+ */
+uint32_t mc_message_to_buffer_encoded(mc_message_t* message, const mc_buffer_t* encoded, uint16_t lastnum, mc_buffer_t* buffer) {
+    if (message->options && message->options->noptions > 0 && message->options->options[0].option_num < lastnum) {
+        ms_log_debug("options must follow the encoded options, %d < %d", message->options->options[0].option_num, lastnum);
+        return 0;
+    }
+    return to_buffer(message, encoded, lastnum, buffer);
+}
+
+/* Decode a message, the payload references shared's bytes if it is set. */
+static mc_message_t* decode(mc_message_t* message, mc_buffer_t* buffer, uint32_t* bpos, mc_shared_buffer_t* shared) {
     uint32_t pllen;
     uint32_t tklen;
     uint8_t* tkdata = 0;
     uint32_t apos = 0;
+    mc_option_scan_t scan;
 
     if (message == 0) return 0;
     if (buffer == 0) return 0;
@@ -221,25 +307,34 @@ mc_message_t* mc_message_from_buffer(mc_message_t* message, mc_buffer_t* buffer,
     /* Read message components. */
     message->header = ms_swap_u32(mc_buffer_next_uint32(buffer, bpos));
     tklen = mc_header_get_token_length(message->header);
+    if (tklen > 8 || (buffer->nbytes - *bpos) < tklen) {
+        ms_log_debug("Invalid token length: %d", tklen);
+        return 0;
+    }
     tkdata = mc_buffer_next_ptr(buffer, tklen, bpos);
 
-    /* N.B. Assumes token and options are null. */
-    message->token = mc_buffer_init(mc_buffer_alloc(), tklen, ms_copy_uint8(tklen, tkdata));
-    message->options = mc_options_list_from_buffer(mc_options_list_alloc(), buffer, bpos);
-
-    remaining = buffer->nbytes - *bpos;
+    /* Reject malformed options and payload markers before allocating anything. */
+    if (!mc_option_scan(&scan, buffer->bytes, buffer->nbytes, *bpos)) {
+        ms_log_debug("Malformed options or payload marker at: %d", *bpos);
+        return 0;
+    }
 
-    if (remaining > 1) {
-        /* Advance past beginning of payload marker. */
-        marker = buffer->bytes[*bpos];
-        if (marker != 0xff) {
-            ms_log_debug("Invalid beginning of payload marker: 0x%x", marker);
-            return 0;
-        }
-        (*bpos)++;
+    /* N.B. Assumes token and options are null. */
+    message->token = mc_buffer_init(&message->tokenbuf, tklen, (uint8_t*)memcpy(message->tokenbytes, tkdata, tklen));
+    if (scan.noptions > 0) {
+        message->options = mc_options_list_from_scanned(mc_options_list_alloc(), buffer, bpos, scan.noptions);
+    }
 
-        pllen = remaining - 1;
-        message->payload = mc_buffer_init(mc_buffer_alloc(), pllen, ms_calloc(pllen, uint8_t));
+    /* The scan found the marker, the rest of the buffer is the payload. */
+    *bpos = scan.plpos;
+    pllen = buffer->nbytes - scan.plpos;
+    if (pllen > 0 && shared) {
+        message->shared = mc_shared_buffer_retain(shared);
+        message->payload = mc_buffer_init(&message->payloadbuf, pllen, &buffer->bytes[*bpos]);
+        *bpos += pllen;
+    }
+    else if (pllen > 0) {
+        message->payload = mc_buffer_init(mc_buffer_alloc(), pllen, ms_calloc_tag(MS_MEM_BUFFER, pllen, uint8_t));
 
         if (mc_buffer_copy_to(message->payload, 0, buffer, *bpos, pllen) == 0) return 0;
         *bpos += pllen;
@@ -250,4 +345,17 @@ mc_message_t* mc_message_from_buffer(mc_message_t* message, mc_buffer_t* buffer,
     return message;
 }
 
+mc_message_t* mc_message_from_buffer(mc_message_t* message, mc_buffer_t* buffer, uint32_t* bpos) {
+    return decode(message, buffer, bpos, 0);
+}
+
+/**
+ * Decode the datagram in a shared buffer, e.g. a receive slot, without copying the payload.
+ * The message holds a reference to shared while it has a payload.
+ * @return the message or 0 if the datagram is malformed.
+ */
+mc_message_t* mc_message_from_shared(mc_message_t* message, mc_shared_buffer_t* shared) {
+    return decode(message, &shared->view, 0, shared);
+}
+
 /** @} */
@@ -7,7 +7,11 @@
  * @{
  */
 
+#include "mnet/mn_socket.h"
+#include "mnet/mn_peer_table.h"
 #include "mcoap/mc_options_list.h"
+#include "mcoap/mc_shared_buffer.h"
+#include "mcoap/mc_token.h"
 
 #define MC_CONFIRM    0
 #define MC_NOCONFIRM  1
@@ -20,11 +24,18 @@ struct mc_message {
     mc_buffer_t* token;
     mc_options_list_t* options;
     mc_buffer_t* payload;
-    sockaddr_t* from;
+    mc_shared_buffer_t* shared; /**< Set if payload is a shared buffer's view, released instead of freed. */
+    sockaddr_t from;            /**< Sender, ss_family is AF_UNSPEC (0) unless received. */
+    mn_peer_id_t peer;          /**< Interned sender id, MN_PEER_NONE unless received. */
+    mc_buffer_t tokenbuf;       /**< Inline token, token points here for received and generated tokens. */
+    uint8_t tokenbytes[MC_TOKEN_MAX];
+    mc_buffer_t payloadbuf;     /**< Payload view into shared bytes, see mc_message_from_shared(). */
 };
 
 mc_message_t* mc_message_alloc();
 mc_message_t* mc_message_deinit(mc_message_t* message);
+void mc_message_free(mc_message_t* message);
+mc_message_t* mc_message_share_payload(mc_message_t* message, mc_shared_buffer_t* shared);
 
 mc_message_t* mc_message_init(
     mc_message_t* message,
@@ -77,10 +88,14 @@ uint8_t mc_message_get_token_len(mc_message_t* const message);
 uint8_t mc_message_get_code(mc_message_t* message);
 uint16_t mc_message_get_message_id(mc_message_t* message);
 mc_buffer_t* mc_message_copy_token(mc_message_t* const message);
+mc_buffer_t* mc_message_random_token(mc_message_t* const message, uint8_t len, ms_random_t* rng);
+mc_buffer_t* mc_message_echo_token(mc_message_t* const message, mc_message_t* const request);
 
 uint32_t mc_message_buffer_size(mc_message_t* message);
 uint32_t mc_message_to_buffer(mc_message_t* message, mc_buffer_t* buffer);
+uint32_t mc_message_to_buffer_encoded(mc_message_t* message, const mc_buffer_t* encoded, uint16_t lastnum, mc_buffer_t* buffer);
 mc_message_t* mc_message_from_buffer(mc_message_t* message, mc_buffer_t* buffer, uint32_t* bpos);
+mc_message_t* mc_message_from_shared(mc_message_t* message, mc_shared_buffer_t* shared);
 
 
 /** @} */
@@ -16,14 +16,14 @@
  * Allocate a mc_option_t struct.
  */
 mc_option_t* mc_option_alloc() {
-    return ms_calloc(1, mc_option_t);
+    return ms_calloc_tag(MS_MEM_OPTION, 1, mc_option_t);
 }
 
 /**
  * Allocate a block of mc_option_t structs.
  */
 mc_option_t* mc_option_nalloc(uint32_t count) {
-    return ms_calloc(count, mc_option_t);
+    return ms_calloc_tag(MS_MEM_OPTION, count, mc_option_t);
 }
 
 /**
@@ -82,16 +82,16 @@ mc_option_t* mc_option_init_uint32(mc_option_t* option, uint16_t option_num, uin
     if (option->value.bytes) ms_free(option->value.bytes);
     if (value <= UINT8_MAX) {
     	uint8_t temp = value;
-    	mc_buffer_init(&option->value, 1, ms_copy_uint8(1, &temp));
+    	mc_buffer_init(&option->value, 1, ms_mem_retag(ms_copy_uint8(1, &temp), MS_MEM_OPTION));
     }
     else if (value <= UINT16_MAX) {
     	uint16_t temp = value;
     	temp = ms_swap_u16(temp);
-    	mc_buffer_init(&option->value, 2, (uint8_t*)ms_copy_uint16(1, &temp));
+    	mc_buffer_init(&option->value, 2, ms_mem_retag(ms_copy_uint16(1, &temp), MS_MEM_OPTION));
     }
     else {
     	uint32_t temp = ms_swap_u32(value);
-    	mc_buffer_init(&option->value, 4, (uint8_t*)ms_copy_uint32(1, &temp));
+    	mc_buffer_init(&option->value, 4, ms_mem_retag(ms_copy_uint32(1, &temp), MS_MEM_OPTION));
     }
 
     return option;
@@ -106,28 +106,67 @@ mc_option_t* mc_option_copy_to(mc_option_t* to, mc_option_t* from) {
 
 	if (to == 0) return 0;
 
-	bytes = ms_copy_uint8(from->value.nbytes, from->value.bytes);
+	bytes = ms_mem_retag(ms_copy_uint8(from->value.nbytes, from->value.bytes), MS_MEM_OPTION);
 	return	mc_option_init(to, from->option_num, from->value.nbytes, bytes);
 }
 
+/**
+ * Decode a uint option value, stored in network order with leading zero bytes removed,
+ * so it may be 0 to 4 bytes long.
+ * @return the value, 0 if the option is null or the value is longer than 4 bytes.
+ */
 uint32_t mc_option_as_uint32(const mc_option_t* option) {
-	uint32_t result;
+	uint32_t result = 0;
+	uint32_t ibyte;
 
 	if (option == 0) return 0;
 	if (option->value.bytes == 0) return 0;
+	if (option->value.nbytes > 4) return 0;
 
-	if (option->value.nbytes == 1) {
-		result = *option->value.bytes;
-	}
-	else if (option->value.nbytes == 2) {
-		result = ms_swap_u16(*((uint16_t*)option->value.bytes));
-	}
-	else {
-		result = ms_swap_u32(*((uint32_t*)option->value.bytes));
+	for (ibyte = 0; ibyte < option->value.nbytes; ibyte++) {
+		result = (result << 8) | option->value.bytes[ibyte];
 	}
     return result;
 }
 
+/* Flags derived from the option number plus the registry's repeatable column. */
+#define OPTION_FLAGS(num, repeatable) (uint8_t)(MC_OPTION_KNOWN \
+    | (MC_OPTION_IS_CRITICAL(num) ? MC_OPTION_CRITICAL : 0) \
+    | (MC_OPTION_IS_UNSAFE(num) ? MC_OPTION_UNSAFE : 0) \
+    | (MC_OPTION_IS_NOCACHEKEY(num) ? MC_OPTION_NOCACHEKEY : 0) \
+    | ((repeatable) ? MC_OPTION_REPEATABLE : 0))
+
+/** Info table indexed by option number, unregistered numbers are all zero. */
+static const mc_option_info_t option_info[MC_OPTION_INFO_SIZE] = {
+#define OPTION_INFO(name, num, format, minlen, maxlen, repeatable) \
+    [num] = { #name, num, format, OPTION_FLAGS(num, repeatable), minlen, maxlen },
+    MC_OPTION_REGISTRY(OPTION_INFO)
+#undef OPTION_INFO
+};
+
+/**
+ * Look up the registry entry for an option number.
+ * @return the entry or 0 if the option is not known.
+ */
+const mc_option_info_t* mc_option_info(uint16_t option_num) {
+    if (option_num >= MC_OPTION_INFO_SIZE) return 0;
+    if ((option_info[option_num].flags & MC_OPTION_KNOWN) == 0) return 0;
+
+    return &option_info[option_num];
+}
+
+/**
+ * Check an option against the registry.
+ * A known option with a value length out of range is treated as unrecognized (RFC7252 5.4.3).
+ * @return 1 if the option is known and its length is in range, 0 otherwise.
+ */
+int mc_option_is_valid(const mc_option_t* option) {
+    const mc_option_info_t* info = mc_option_info(option->option_num);
+
+    if (info == 0) return 0;
+    return option->value.nbytes >= info->min_length && option->value.nbytes <= info->max_length;
+}
+
 static uint32_t extended_int_size(uint32_t delta) {
 	uint32_t result;
 
@@ -9,21 +9,71 @@
 
 #include "mcoap/mc_buffer.h"
 
-#define OPTION_IF_MATCH           1  // opaque 0-8
-#define OPTION_URI_HOST           3  // string 1-255
-#define OPTION_ETAG               4  // opaque 1-8
-#define OPTION_IF_NONE_MATCH      5  // empty  0
-#define OPTION_URI_PORT           7  // uint   0-2
-#define OPTION_LOCATION_PATH      8  // string 0-255
-#define OPTION_URI_PATH          11  // string 0-255
-#define OPTION_CONTENT_FORMAT    12  // uint   0-2
-#define OPTION_MAX_AGE           14  // uint   0-4
-#define OPTION_URI_QUERY         15  // string 0-255
-#define OPTION_ACCEPT            17  // uint   0-2
-#define OPTION_LOCATION_QUERY    20  // string 0-255
-#define OPTION_PROXY_URI         35  // string 1-1034
-#define OPTION_PROXY_SCHEME      39  // string 1-255
-#define OPTION_SIZE_1            60  // uint   0-4
+/** Option value formats (RFC7252 3.2). */
+#define MC_FORMAT_EMPTY   0
+#define MC_FORMAT_OPAQUE  1
+#define MC_FORMAT_UINT    2
+#define MC_FORMAT_STRING  3
+
+/**
+ * Registry of the known options, one X(name, number, format, min length, max length, repeatable)
+ * entry per option. Everything else about an option (the enum below, the info table, the
+ * validation and accessors) is generated from this list, so adding an option is one line.
+ */
+#define MC_OPTION_REGISTRY(X) \
+    X(IF_MATCH,        1, MC_FORMAT_OPAQUE, 0,    8, 1) \
+    X(URI_HOST,        3, MC_FORMAT_STRING, 1,  255, 0) \
+    X(ETAG,            4, MC_FORMAT_OPAQUE, 1,    8, 1) \
+    X(IF_NONE_MATCH,   5, MC_FORMAT_EMPTY,  0,    0, 0) \
+    X(OBSERVE,         6, MC_FORMAT_UINT,   0,    3, 0) \
+    X(URI_PORT,        7, MC_FORMAT_UINT,   0,    2, 0) \
+    X(LOCATION_PATH,   8, MC_FORMAT_STRING, 0,  255, 1) \
+    X(URI_PATH,       11, MC_FORMAT_STRING, 0,  255, 1) \
+    X(CONTENT_FORMAT, 12, MC_FORMAT_UINT,   0,    2, 0) \
+    X(MAX_AGE,        14, MC_FORMAT_UINT,   0,    4, 0) \
+    X(URI_QUERY,      15, MC_FORMAT_STRING, 0,  255, 1) \
+    X(ACCEPT,         17, MC_FORMAT_UINT,   0,    2, 0) \
+    X(LOCATION_QUERY, 20, MC_FORMAT_STRING, 0,  255, 1) \
+    X(BLOCK2,         23, MC_FORMAT_UINT,   0,    3, 0) \
+    X(BLOCK1,         27, MC_FORMAT_UINT,   0,    3, 0) \
+    X(SIZE_2,         28, MC_FORMAT_UINT,   0,    4, 0) \
+    X(PROXY_URI,      35, MC_FORMAT_STRING, 1, 1034, 0) \
+    X(PROXY_SCHEME,   39, MC_FORMAT_STRING, 1,  255, 0) \
+    X(SIZE_1,         60, MC_FORMAT_UINT,   0,    4, 0)
+
+/** Option numbers, OPTION_URI_PATH etc. */
+enum mc_option_num {
+#define MC_OPTION_ENUM(name, num, format, minlen, maxlen, repeatable) OPTION_##name = num,
+    MC_OPTION_REGISTRY(MC_OPTION_ENUM)
+#undef MC_OPTION_ENUM
+    OPTION_NUM_END
+};
+
+/** Every registered option number is below this value, the info table is indexed by number. */
+#define MC_OPTION_INFO_SIZE 64
+
+/** Option properties that are encoded in the option number (RFC7252 5.4.6). */
+#define MC_OPTION_IS_CRITICAL(num)   (((num) & 0x01) != 0)
+#define MC_OPTION_IS_UNSAFE(num)     (((num) & 0x02) != 0)
+#define MC_OPTION_IS_NOCACHEKEY(num) (((num) & 0x1e) == 0x1c)
+
+/** Bits in mc_option_info_t.flags. */
+#define MC_OPTION_KNOWN       0x01
+#define MC_OPTION_CRITICAL    0x02
+#define MC_OPTION_UNSAFE      0x04
+#define MC_OPTION_NOCACHEKEY  0x08
+#define MC_OPTION_REPEATABLE  0x10
+
+/** Registry entry for a known option. */
+typedef struct mc_option_info mc_option_info_t;
+struct mc_option_info {
+    const char* name;
+    uint16_t option_num;
+    uint8_t format;
+    uint8_t flags;
+    uint16_t min_length;
+    uint16_t max_length;
+};
 
 #define CONTENT_TEXT_PLAIN        0
 #define CONTENT_APP_LINK         40
@@ -48,6 +98,8 @@ mc_option_t* mc_option_init_uint32(mc_option_t* option, uint16_t option_num, uin
 mc_option_t* mc_option_init_str(mc_option_t* option, uint16_t option_num, char* value);
 mc_option_t* mc_option_copy_to(mc_option_t* to, mc_option_t* from);
 uint32_t mc_option_as_uint32(const mc_option_t* option);
+const mc_option_info_t* mc_option_info(uint16_t option_num);
+int mc_option_is_valid(const mc_option_t* option);
 uint32_t mc_option_buffer_size(const mc_option_t* option, uint32_t prev_option_num);
 
 /** @} */
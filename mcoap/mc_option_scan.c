@@ -0,0 +1,146 @@
+/**
+ * @file
+ * @ingroup option_scan
+ * @{
+ */
+
+#include "mcoap/mc_option_scan.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCAN_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && (defined(SCAN_AVX2) || defined(SCAN_SSE2))
+#include <intrin.h>
+#endif
+
+#define PAYLOAD_MARKER 0xff
+#define RESERVED_NIBBLE 15
+
+/** Number of extended bytes that follow a delta or length nibble, 15 is reserved. */
+static const uint8_t extended_size[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0 };
+
+#if defined(SCAN_AVX2) || defined(SCAN_SSE2)
+/** Index of the lowest set bit, mask must not be 0. */
+static uint32_t lowest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+/**
+ * Find the next byte equal to 0xff at or after bpos.
+ * @return its offset or nbytes if there is none.
+ */
+uint32_t mc_option_scan_find_marker(const uint8_t* bytes, uint32_t nbytes, uint32_t bpos) {
+#ifdef SCAN_AVX2
+    const __m256i marker32 = _mm256_set1_epi8((char)PAYLOAD_MARKER);
+    while (bpos + 32 <= nbytes) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(bytes + bpos));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, marker32));
+        if (mask) return bpos + lowest_bit(mask);
+        bpos += 32;
+    }
+#endif
+#ifdef SCAN_SSE2
+    const __m128i marker16 = _mm_set1_epi8((char)PAYLOAD_MARKER);
+    while (bpos + 16 <= nbytes) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(bytes + bpos));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, marker16));
+        if (mask) return bpos + lowest_bit(mask);
+        bpos += 16;
+    }
+#endif
+    while (bpos < nbytes && bytes[bpos] != PAYLOAD_MARKER) bpos++;
+    return bpos;
+}
+
+/*
+ * Step over one option whose header byte is at *bpos.
+ * @return 0 if the header uses a reserved nibble or the option runs past nbytes.
+ */
+static int skip_option(const uint8_t* bytes, uint32_t nbytes, uint32_t* bpos) {
+    uint8_t byte = bytes[*bpos];
+    uint8_t delta = byte >> 4;
+    uint8_t len = byte & 0x0f;
+    uint32_t pos = *bpos + 1 + extended_size[delta];
+    uint32_t optlen;
+
+    if ((delta == RESERVED_NIBBLE) | (len == RESERVED_NIBBLE)) return 0;
+    if (pos + extended_size[len] > nbytes) return 0;
+
+    if (len < 13) optlen = len;
+    else if (len == 13) optlen = bytes[pos] + 13;
+    else optlen = ((uint32_t)bytes[pos] << 8 | bytes[pos + 1]) + 269;
+
+    pos += extended_size[len] + optlen;
+    if (pos > nbytes) return 0;
+
+    *bpos = pos;
+    return 1;
+}
+
+/* Record the end of the options, a marker must be followed by at least one payload byte. */
+static int finish(mc_option_scan_t* scan, uint32_t nbytes, uint32_t noptions, uint32_t optend) {
+    scan->noptions = noptions;
+    scan->optend = optend;
+
+    if (optend >= nbytes) {
+        scan->plpos = nbytes;
+        return 1;
+    }
+
+    scan->plpos = optend + 1;
+    return scan->plpos < nbytes;
+}
+
+/**
+ * Scan the options starting at bpos, using the vectorized marker search.
+ * @return 1 if the options are well formed, 0 if the datagram is malformed.
+ */
+int mc_option_scan(mc_option_scan_t* scan, const uint8_t* bytes, uint32_t nbytes, uint32_t bpos) {
+    uint32_t noptions = 0;
+    uint32_t marker = mc_option_scan_find_marker(bytes, nbytes, bpos);
+
+    for (;;) {
+        /* No header byte before the candidate can be a marker, so just walk the headers. */
+        while (bpos < marker) {
+            if (!skip_option(bytes, nbytes, &bpos)) return 0;
+            noptions++;
+        }
+
+        /* Landed on the candidate (or the end), it is the payload marker. */
+        if (bpos == marker) return finish(scan, nbytes, noptions, bpos);
+
+        /* The candidate was inside an option value, look for the next one. */
+        marker = mc_option_scan_find_marker(bytes, nbytes, bpos);
+    }
+}
+
+/**
+ * Byte-at-a-time version of mc_option_scan(), checks each header byte for the marker.
+ * @return 1 if the options are well formed, 0 if the datagram is malformed.
+ */
+int mc_option_scan_scalar(mc_option_scan_t* scan, const uint8_t* bytes, uint32_t nbytes, uint32_t bpos) {
+    uint32_t noptions = 0;
+
+    while (bpos < nbytes) {
+        if (bytes[bpos] == PAYLOAD_MARKER) return finish(scan, nbytes, noptions, bpos);
+        if (!skip_option(bytes, nbytes, &bpos)) return 0;
+        noptions++;
+    }
+    return finish(scan, nbytes, noptions, nbytes);
+}
+
+/** @} */
@@ -0,0 +1,34 @@
+#ifndef MC_OPTION_SCAN_H
+#define MC_OPTION_SCAN_H
+
+/**
+ * @file
+ * @defgroup option_scan CoAP Option Scanner
+ * @{
+ * Single pass pre-scan of the options in a received message.
+ * The scan counts the options, checks every option header and length against the end of the
+ * datagram, and finds the payload marker, so the decoder can reject malformed datagrams before
+ * allocating anything.
+ *
+ * Option boundaries are inherently sequential (each length depends on the previous header), so
+ * the vectorized part is the search for 0xff payload marker candidates, done with AVX2 or SSE2
+ * when the compiler targets them. The option walk then runs up to the next candidate without
+ * testing each header byte for the marker. mc_option_scan_scalar() is the byte-at-a-time fallback.
+ */
+
+#include "msys/ms_config.h"
+
+typedef struct mc_option_scan mc_option_scan_t;
+struct mc_option_scan {
+    uint32_t noptions;  /**< Number of options found. */
+    uint32_t optend;    /**< Offset of the payload marker, or the datagram length if there is no payload. */
+    uint32_t plpos;     /**< Offset of the payload, or the datagram length if there is no payload. */
+};
+
+int mc_option_scan(mc_option_scan_t* scan, const uint8_t* bytes, uint32_t nbytes, uint32_t bpos);
+int mc_option_scan_scalar(mc_option_scan_t* scan, const uint8_t* bytes, uint32_t nbytes, uint32_t bpos);
+uint32_t mc_option_scan_find_marker(const uint8_t* bytes, uint32_t nbytes, uint32_t bpos);
+
+/** @} */
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * @file
+ * @ingroup options_builder
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_options_builder.h"
+
+mc_options_builder_t* mc_options_builder_alloc() {
+    return ms_calloc_tag(MS_MEM_OPTION, 1, mc_options_builder_t);
+}
+
+/**
+ * Initialize a builder with room for capacity options.
+ * @return the builder.
+ */
+mc_options_builder_t* mc_options_builder_init(mc_options_builder_t* builder, uint32_t capacity) {
+    builder->noptions = 0;
+    builder->capacity = 0;
+    builder->options = 0;
+    builder->sorted = 1;
+
+    return mc_options_builder_reserve(builder, capacity);
+}
+
+/**
+ * Free any options still held by the builder.
+ */
+mc_options_builder_t* mc_options_builder_deinit(mc_options_builder_t* builder) {
+    if (builder->options) {
+        mc_option_ndeinit(builder->options, builder->noptions);
+        ms_free(builder->options);
+    }
+    builder->noptions = 0;
+    builder->capacity = 0;
+    builder->options = 0;
+    builder->sorted = 1;
+
+    return builder;
+}
+
+/**
+ * Make sure there is room for at least capacity options.
+ * @return the builder or 0 if the allocation failed.
+ */
+mc_options_builder_t* mc_options_builder_reserve(mc_options_builder_t* builder, uint32_t capacity) {
+    mc_option_t* options;
+
+    if (capacity <= builder->capacity) return builder;
+
+    options = ms_realloc_tag(MS_MEM_OPTION, builder->options, capacity, mc_option_t);
+    if (options == 0) return 0;
+
+    memset(options + builder->capacity, 0, (capacity - builder->capacity) * sizeof(mc_option_t));
+    builder->options = options;
+    builder->capacity = capacity;
+
+    return builder;
+}
+
+/** Grow geometrically so a series of appends stays linear. */
+static mc_options_builder_t* ensure_room(mc_options_builder_t* builder, uint32_t nextra) {
+    uint32_t needed = builder->noptions + nextra;
+    uint32_t capacity = builder->capacity;
+
+    if (needed <= capacity) return builder;
+
+    if (capacity < 4) capacity = 4;
+    while (capacity < needed) capacity *= 2;
+
+    return mc_options_builder_reserve(builder, capacity);
+}
+
+/** Move an option value, leaving the source without bytes. */
+static void move_option(mc_option_t* to, mc_option_t* from) {
+    *to = *from;
+    from->value.nbytes = 0;
+    from->value.bytes = 0;
+}
+
+/**
+ * Append an option, the builder takes ownership of bytes.
+ * @return the added option or 0 if there is no room.
+ */
+mc_option_t* mc_options_builder_add(mc_options_builder_t* builder, uint16_t option_num, uint32_t nbytes, uint8_t* bytes) {
+    mc_option_t* option;
+
+    if (ensure_room(builder, 1) == 0) return 0;
+
+    if (builder->noptions > 0 && builder->options[builder->noptions - 1].option_num > option_num) {
+        builder->sorted = 0;
+    }
+
+    option = builder->options + builder->noptions;
+    option->option_num = option_num;
+    mc_buffer_init(&option->value, nbytes, bytes);
+    builder->noptions++;
+
+    return option;
+}
+
+/**
+ * Append an option by moving its value, the source option is left empty.
+ * @return the added option or 0 if there is no room.
+ */
+mc_option_t* mc_options_builder_move(mc_options_builder_t* builder, mc_option_t* option) {
+    mc_option_t* added = mc_options_builder_add(builder, option->option_num, option->value.nbytes, option->value.bytes);
+
+    if (added) {
+        option->value.nbytes = 0;
+        option->value.bytes = 0;
+    }
+    return added;
+}
+
+/*
+ * Merge the sorted list into the sorted builder, in place, from the back.
+ * On equal option numbers the builder's options stay first, so the merge is stable
+ * and repeated options (e.g. Uri-Path segments) keep their order.
+ */
+static void merge_sorted(mc_options_builder_t* builder, mc_options_list_t* list) {
+    mc_option_t* options = builder->options;
+    int64_t ileft = (int64_t)builder->noptions - 1;
+    int64_t iright = (int64_t)list->noptions - 1;
+    int64_t idest = ileft + iright + 1;
+
+    while (iright >= 0) {
+        if (ileft >= 0 && options[ileft].option_num > list->options[iright].option_num) {
+            options[idest--] = options[ileft--];
+        }
+        else {
+            move_option(&options[idest--], &list->options[iright--]);
+        }
+    }
+}
+
+/** @return true if the list is in non-decreasing option number order. */
+static int list_is_sorted(const mc_options_list_t* list) {
+    uint32_t ioption;
+
+    for (ioption = 1; ioption < list->noptions; ioption++) {
+        if (list->options[ioption - 1].option_num > list->options[ioption].option_num) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Move all the options from list into the builder.
+ * The list is left empty (but not freed) so the caller can deinit/free it as usual.
+ * @return the builder or 0 if there is no room.
+ */
+mc_options_builder_t* mc_options_builder_merge(mc_options_builder_t* builder, mc_options_list_t* list) {
+    uint32_t ioption;
+
+    if (list == 0 || list->noptions == 0) return builder;
+    if (ensure_room(builder, list->noptions) == 0) return 0;
+
+    if (builder->sorted && list_is_sorted(list)) {
+        merge_sorted(builder, list);
+    }
+    else {
+        for (ioption = 0; ioption < list->noptions; ioption++) {
+            move_option(&builder->options[builder->noptions + ioption], &list->options[ioption]);
+        }
+        builder->sorted = 0;
+    }
+    builder->noptions += list->noptions;
+
+    mc_options_list_deinit(list);
+    return builder;
+}
+
+/* Stable insertion sort, option lists are short so this beats qsort and keeps repeated options in order. */
+static void stable_sort(mc_option_t* options, uint32_t count) {
+    uint32_t ioption;
+    int64_t iprev;
+    mc_option_t current;
+
+    for (ioption = 1; ioption < count; ioption++) {
+        current = options[ioption];
+        iprev = (int64_t)ioption - 1;
+        while (iprev >= 0 && options[iprev].option_num > current.option_num) {
+            options[iprev + 1] = options[iprev];
+            iprev--;
+        }
+        options[iprev + 1] = current;
+    }
+}
+
+/**
+ * Hand the accumulated options to list, the builder is left empty.
+ * Any options list previously held by list is freed.
+ * @return the initialized list.
+ */
+mc_options_list_t* mc_options_builder_to_list(mc_options_builder_t* builder, mc_options_list_t* list) {
+    if (!builder->sorted) stable_sort(builder->options, builder->noptions);
+
+    if (list->options) mc_options_list_deinit(list);
+    mc_options_list_init(list, builder->noptions, builder->options);
+
+    builder->noptions = 0;
+    builder->capacity = 0;
+    builder->options = 0;
+    builder->sorted = 1;
+
+    return list;
+}
+
+/** @} */
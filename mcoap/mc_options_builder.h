@@ -0,0 +1,36 @@
+#ifndef MC_OPTIONS_BUILDER_H
+#define MC_OPTIONS_BUILDER_H
+
+/**
+ * @file
+ * @defgroup options_builder CoAP Options Builder
+ * @{
+ * Accumulate options for a message into a reserved array without copying option values.
+ * Options and lists added to the builder are moved, the builder takes ownership of their
+ * value bytes and leaves the source empty. When the inputs are already sorted by option number
+ * they are combined with a stable linear merge, otherwise the builder falls back to a stable
+ * insertion sort when the list is produced.
+ */
+
+#include "mcoap/mc_options_list.h"
+
+typedef struct mc_options_builder mc_options_builder_t;
+struct mc_options_builder {
+    uint32_t noptions;
+    uint32_t capacity;
+    mc_option_t* options;
+    int sorted;             /**< True while options are in non-decreasing option number order. */
+};
+
+mc_options_builder_t* mc_options_builder_alloc();
+mc_options_builder_t* mc_options_builder_init(mc_options_builder_t* builder, uint32_t capacity);
+mc_options_builder_t* mc_options_builder_deinit(mc_options_builder_t* builder);
+mc_options_builder_t* mc_options_builder_reserve(mc_options_builder_t* builder, uint32_t capacity);
+mc_option_t* mc_options_builder_add(mc_options_builder_t* builder, uint16_t option_num, uint32_t nbytes, uint8_t* bytes);
+mc_option_t* mc_options_builder_move(mc_options_builder_t* builder, mc_option_t* option);
+mc_options_builder_t* mc_options_builder_merge(mc_options_builder_t* builder, mc_options_list_t* list);
+mc_options_list_t* mc_options_builder_to_list(mc_options_builder_t* builder, mc_options_list_t* list);
+
+/** @} */
+
+#endif
@@ -10,10 +10,11 @@
 #include "msys/ms_copy.h"
 #include "msys/ms_memory.h"
 #include "msys/ms_endian.h"
+#include "mcoap/mc_option_scan.h"
 #include "mcoap/mc_options_list.h"
 
 mc_options_list_t* mc_options_list_alloc() {
-    return ms_calloc(1, mc_options_list_t);
+    return ms_calloc_tag(MS_MEM_OPTION, 1, mc_options_list_t);
 }
 
 mc_options_list_t* mc_options_list_deinit(mc_options_list_t* list) {
@@ -23,6 +24,7 @@ mc_options_list_t* mc_options_list_deinit(mc_options_list_t* list) {
 
 	list->noptions = 0;
 	list->options = 0;
+	list->present = 0;
 
     return list;
 }
@@ -38,8 +40,15 @@ static int compare_options (const void * left, const void * right) {
     return ( (ileft->option_num) - (iright->option_num) );
 }
 
-/** Sort an array of items by tag. */
+/** Sort an array of items by tag, decoded and built lists are usually sorted already. */
 static void options_sort(uint32_t count, mc_option_t* items) {
+    uint32_t item;
+
+    for (item = 1; item < count; item++) {
+        if (items[item - 1].option_num > items[item].option_num) break;
+    }
+    if (item >= count) return;
+
     qsort(items, count, sizeof(mc_option_t), compare_options);
 }
 
@@ -48,7 +57,7 @@ mc_options_list_t* mc_options_list_init(mc_options_list_t* list, uint32_t noptio
     list->options = options;
     if (options) options_sort(list->noptions, list->options);
 
-	return list;
+	return mc_options_list_index(list);
 }
 
 mc_options_list_t* mc_options_list_vinit(mc_options_list_t* list, uint32_t noptions, ...) {
@@ -63,7 +72,7 @@ mc_options_list_t* mc_options_list_vinit(mc_options_list_t* list, uint32_t nopti
         memcpy(options + ioption, option, sizeof(mc_option_t));
 
         /* Free the pointer but not the contents. */
-        free(option);
+        ms_free(option);
     }
     va_end(argp);
 
@@ -124,9 +133,15 @@ mc_options_list_t* mc_options_list_merge(mc_options_list_t* list1, mc_options_li
 }
 
 uint32_t mc_options_list_buffer_size(const mc_options_list_t* list) {
+	return mc_options_list_buffer_size_after(list, 0);
+}
+
+/**
+ * Size of the encoded options when they follow already encoded options ending with prev_option_num.
+ */
+uint32_t mc_options_list_buffer_size_after(const mc_options_list_t* list, uint16_t prev_option_num) {
 	mc_option_t* current;
 	uint32_t noption;
-	uint32_t prev_option_num = 0;
 	uint32_t size = 0;
 
 	if (list == 0) return 0;
@@ -273,8 +288,16 @@ static mc_buffer_t* option_to_buffer(mc_buffer_t* buffer, const mc_option_t* opt
 
 /** @return pointer to modified buffer or 0 if failure. */
 mc_buffer_t* mc_options_list_to_buffer(const mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos) {
+	return mc_options_list_to_buffer_after(list, buffer, bpos, 0);
+}
+
+/**
+ * Encode the options after already encoded options ending with prev_option_num,
+ * the first option number must not be less than prev_option_num.
+ * @return pointer to modified buffer or 0 if failure.
+ */
+mc_buffer_t* mc_options_list_to_buffer_after(const mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos, uint16_t prev_option_num) {
 	uint32_t ioption;
-	uint32_t prev_option_num = 0;
 	uint32_t apos = 0;
 
 	/* If no list return. */
@@ -327,48 +350,6 @@ static uint16_t option_num_from_buffer(const mc_buffer_t* buffer, uint8_t prefix
 	return value;
 }
 
-static uint32_t count_options(const mc_buffer_t* buffer, uint32_t bpos) {
-	uint8_t byte;
-	uint8_t delta;
-	uint8_t len;
-	uint16_t extended;
-	uint32_t total = 0;
-
-	/* Minimum buffer size is 3, one byte for the lead dela/len header, */
-	/* one byte for the data, and one byte for the terminating 0xff. */
-	if (buffer->nbytes < 4) return 0;
-
-	while (bpos < buffer->nbytes) {
-		byte = buffer->bytes[bpos];
-		bpos++;
-
-		/* If beginning of payload marker exit loop. */
-		if (byte == 0xff) break;
-
-		delta = byte >> 4;
-		len = byte & 0x0f;
-
-		/* Skip the extended part of the option delta. */
-		if (delta == 13) {
-			bpos += 1;
-		}
-		else if (delta == 14) {
-			bpos+=2;
-		}
-
-		/* Extract the option length and skip over it. */
-		extended = option_num_from_buffer(buffer, len, &bpos);
-		bpos += extended;
-
-		/* Check to see if implied size overflows the remaining bytes in the buffer. */
-		if (bpos > buffer->nbytes) return 0;
-
-		total++;
-	}
-
-	return total;
-}
-
 static mc_option_t* option_from_buffer(mc_option_t* option, const mc_buffer_t* buffer, uint16_t prevnum, uint32_t* bpos) {
 	uint16_t optnum;
 	uint16_t optlen;
@@ -391,22 +372,33 @@ static mc_option_t* option_from_buffer(mc_option_t* option, const mc_buffer_t* b
 	optlen = option_num_from_buffer(buffer, len, bpos);
 	optbytes = mc_buffer_next_ptr(buffer, optlen, bpos);
 
-	return mc_option_init(option, optnum, optlen, ms_copy_uint8(optlen, optbytes));
+	return mc_option_init(option, optnum, optlen, ms_mem_retag(ms_copy_uint8(optlen, optbytes), MS_MEM_OPTION));
 }
 
 /** @return pointer to created list buffer or 0 if failure. */
 mc_options_list_t* mc_options_list_from_buffer(mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos) {
-	mc_option_t* options;
-	mc_option_t* current;
-	uint16_t prevnum;
-	uint32_t ioption;
-	uint32_t noptions;
 	uint32_t apos = 0;
+	mc_option_scan_t scan;
 
 	/* Use position 0 if buffer position not specified. */
 	if (bpos == 0) bpos = &apos;
 
-	noptions = count_options(buffer, *bpos);
+	/* Validate every option against the end of the buffer before decoding any. */
+	if (!mc_option_scan(&scan, buffer->bytes, buffer->nbytes, *bpos)) return 0;
+	return mc_options_list_from_scanned(list, buffer, bpos, scan.noptions);
+}
+
+/**
+ * Decode noptions options that mc_option_scan() has already validated from bpos,
+ * e.g. when decoding a message, so the options are not scanned twice.
+ * @return pointer to created list buffer or 0 if failure.
+ */
+mc_options_list_t* mc_options_list_from_scanned(mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos,
+                                                uint32_t noptions) {
+	mc_option_t* options;
+	mc_option_t* current;
+	uint16_t prevnum;
+	uint32_t ioption;
 
 	if (noptions == 0) return 0;
 	options = mc_option_nalloc(noptions);
@@ -425,9 +417,84 @@ mc_options_list_t* mc_options_list_from_buffer(mc_options_list_t* list, mc_buffe
 	return mc_options_list_init(list, noptions, options);
 }
 
+/**
+ * Rebuild the index of a sorted list.
+ * Only needed if the caller modifies the options array after initializing the list.
+ * @return the list.
+ */
+mc_options_list_t* mc_options_list_index(mc_options_list_t* list) {
+	uint32_t ioption;
+	uint16_t num;
+
+	list->present = 0;
+
+	for (ioption = 0; ioption < list->noptions; ioption++) {
+		num = list->options[ioption].option_num;
+		if (num >= MC_OPTIONS_INDEX_SIZE) continue;
+
+		if (list->present & ((uint64_t)1 << num)) {
+			list->count[num]++;
+		}
+		else {
+			list->present |= ((uint64_t)1 << num);
+			list->first[num] = (uint16_t)ioption;
+			list->count[num] = 1;
+		}
+	}
+
+	return list;
+}
+
+/**
+ * Check for an option without scanning the list (for indexed option numbers).
+ * @return 1 if the list contains at least one option with the number, 0 otherwise.
+ */
+int mc_options_list_has(const mc_options_list_t* list, uint16_t num) {
+	return mc_options_list_count(list, num) > 0;
+}
+
+/**
+ * Count the occurences of an option, e.g. the number of Uri-Path segments.
+ * @return the number of options with the given number.
+ */
+uint32_t mc_options_list_count(const mc_options_list_t* list, uint16_t num) {
+	uint32_t ioption;
+	uint32_t count = 0;
+
+	if (list == 0) return 0;
+
+	if (num < MC_OPTIONS_INDEX_SIZE) {
+		if ((list->present & ((uint64_t)1 << num)) == 0) return 0;
+		return list->count[num];
+	}
+
+	for (ioption = 0; ioption < list->noptions; ioption++) {
+		if (list->options[ioption].option_num == num) count++;
+	}
+	return count;
+}
+
+/**
+ * Find the next option with the given number at or after start.
+ * @return the index of the option or -1 if not found.
+ */
 int mc_options_list_get_index(mc_options_list_t* list, uint32_t start, uint16_t optnum) {
 	int iopt;
 
+	if (list == 0) return -1;
+
+	/* Repeated options are contiguous, so the index gives the whole range. */
+	if (optnum < MC_OPTIONS_INDEX_SIZE) {
+		uint32_t first;
+
+		if ((list->present & ((uint64_t)1 << optnum)) == 0) return -1;
+
+		first = list->first[optnum];
+		if (start <= first) return (int)first;
+		if (start < first + list->count[optnum]) return (int)start;
+		return -1;
+	}
+
 	for (iopt = start; iopt < list->noptions; iopt++) {
 		if (list->options[iopt].option_num == optnum) {
 			return iopt;
@@ -438,7 +505,7 @@ int mc_options_list_get_index(mc_options_list_t* list, uint32_t start, uint16_t
 
 mc_option_t* mc_options_list_at(mc_options_list_t* list, int index) {
 	if (index < 0) return 0;
-	if (index > list->noptions) return 0;
+	if (index >= list->noptions) return 0;
 
 	return (list->options) + index;
 }
@@ -448,4 +515,133 @@ mc_option_t* mc_options_list_get(mc_options_list_t* list, uint16_t num) {
 	return mc_options_list_at(list, index);
 }
 
+/**
+ * Get all the occurrences of a (possibly repeated) option.
+ * Since the list is sorted the options are contiguous starting at the returned pointer.
+ * @return pointer to the first option with the number or 0 if none, count is set to the number found.
+ */
+mc_option_t* mc_options_list_get_all(mc_options_list_t* list, uint16_t num, uint32_t* count) {
+	int index = mc_options_list_get_index(list, 0, num);
+
+	*count = 0;
+	if (index < 0) return 0;
+
+	*count = mc_options_list_count(list, num);
+	return mc_options_list_at(list, index);
+}
+
+/**
+ * Length limits used by the validation loop, indexed by option number. The range is stored
+ * as (min, max - min + 1) so unregistered numbers, left zero, get an empty range and every
+ * check is the same branch free comparison.
+ */
+typedef struct option_limits option_limits_t;
+struct option_limits {
+	uint16_t min_length;
+	uint16_t span;
+	uint8_t repeatable;
+};
+
+static const option_limits_t option_limits[MC_OPTION_INFO_SIZE] = {
+#define OPTION_LIMITS(name, num, format, minlen, maxlen, repeatable) \
+	[num] = { minlen, (maxlen) - (minlen) + 1, repeatable },
+	MC_OPTION_REGISTRY(OPTION_LIMITS)
+#undef OPTION_LIMITS
+};
+
+/**
+ * Check the options of a received message against the option registry (RFC7252 5.4.1).
+ * Unknown options, known options with a bad length and extra occurrences of options that
+ * cannot be repeated are all unrecognized. Unrecognized elective options are ignored, the
+ * first unrecognized critical option means the message must be rejected (4.02 Bad Option
+ * for a confirmable request).
+ * @return the index of the first unrecognized critical option, -1 if there is none.
+ */
+int mc_options_list_validate(const mc_options_list_t* list) {
+	static const option_limits_t unknown = { 0, 0, 0 };
+	uint32_t ioption;
+	uint32_t prevnum = UINT32_MAX;
+
+	if (list == 0) return -1;
+
+	for (ioption = 0; ioption < list->noptions; ioption++) {
+		const mc_option_t* option = &list->options[ioption];
+		uint16_t num = option->option_num;
+		const option_limits_t* limit = num < MC_OPTION_INFO_SIZE ? &option_limits[num] : &unknown;
+		int bad = ((uint32_t)(option->value.nbytes - limit->min_length) >= limit->span)
+		        | ((num == prevnum) & !limit->repeatable);
+
+		if (bad & MC_OPTION_IS_CRITICAL(num)) return (int)ioption;
+		prevnum = num;
+	}
+	return -1;
+}
+
+/**
+ * Typed accessor for uint options, only the first occurrence is used.
+ * @return 1 if the option is present and valid and value is set, 0 otherwise.
+ */
+int mc_options_list_get_uint32(mc_options_list_t* list, uint16_t num, uint32_t* value) {
+	const mc_option_info_t* info = mc_option_info(num);
+	mc_option_t* option;
+
+	if (info == 0 || info->format != MC_FORMAT_UINT) return 0;
+
+	option = mc_options_list_get(list, num);
+	if (option == 0 || !mc_option_is_valid(option)) return 0;
+
+	*value = mc_option_as_uint32(option);
+	return 1;
+}
+
+/**
+ * Accessor for opaque and string options (strings are not null terminated).
+ * @return the value of the first occurrence if present and valid, 0 otherwise.
+ */
+const mc_buffer_t* mc_options_list_get_value(mc_options_list_t* list, uint16_t num) {
+	mc_option_t* option = mc_options_list_get(list, num);
+
+	if (option == 0 || !mc_option_is_valid(option)) return 0;
+	return &option->value;
+}
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+static uint64_t fnv_bytes(uint64_t hash, uint32_t nbytes, const uint8_t* bytes) {
+	uint32_t ibyte;
+
+	for (ibyte = 0; ibyte < nbytes; ibyte++) {
+		hash = (hash ^ bytes[ibyte]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Compute a cache key for a request in one pass over the options (RFC7252 5.6).
+ * The key covers the code and every option except the NoCacheKey ones (e.g. Size1).
+ * @return a 64 bit FNV-1a hash of the key.
+ */
+uint64_t mc_options_list_cache_key(const mc_options_list_t* list, uint8_t code) {
+	uint64_t hash = fnv_bytes(FNV_OFFSET, 1, &code);
+	uint32_t ioption;
+
+	if (list == 0) return hash;
+
+	for (ioption = 0; ioption < list->noptions; ioption++) {
+		const mc_option_t* option = &list->options[ioption];
+		uint8_t prefix[4];
+
+		if (MC_OPTION_IS_NOCACHEKEY(option->option_num)) continue;
+
+		prefix[0] = (uint8_t)(option->option_num >> 8);
+		prefix[1] = (uint8_t)option->option_num;
+		prefix[2] = (uint8_t)(option->value.nbytes >> 8);
+		prefix[3] = (uint8_t)option->value.nbytes;
+		hash = fnv_bytes(hash, sizeof(prefix), prefix);
+		hash = fnv_bytes(hash, option->value.nbytes, option->value.bytes);
+	}
+	return hash;
+}
+
 /** @} */
@@ -9,11 +9,23 @@
 
 #include "mcoap/mc_option.h"
 
-/** In memory (vs on-the-wire) option list. */
+/** Option numbers below this value are tracked by the list index. */
+#define MC_OPTIONS_INDEX_SIZE 64
+
+/**
+ * In memory (vs on-the-wire) option list.
+ * The options are kept sorted by option number, so repeated options are contiguous.
+ * For option numbers less than MC_OPTIONS_INDEX_SIZE the list keeps a presence bitmap
+ * and the position and number of occurrences of each option, built when the list is
+ * initialized, so lookups of the registered options do not scan the list.
+ */
 typedef struct mc_options_list mc_options_list_t;
 struct mc_options_list {
     uint32_t noptions;
     mc_option_t* options;
+    uint64_t present;                       /**< Bit n is set if option n is in the list. */
+    uint16_t first[MC_OPTIONS_INDEX_SIZE];  /**< Index of the first occurrence of option n. */
+    uint16_t count[MC_OPTIONS_INDEX_SIZE];  /**< Number of occurrences of option n. */
 };
 
 mc_options_list_t* mc_options_list_alloc();
@@ -23,12 +35,24 @@ mc_options_list_t* mc_options_list_vinit(mc_options_list_t* list, uint32_t nopti
 mc_options_list_t* mc_options_list_copy(mc_options_list_t* list);
 mc_options_list_t* mc_options_list_merge(mc_options_list_t* list1, mc_options_list_t* list2);
 mc_options_list_t* mc_options_list_from_buffer(mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos);
+mc_options_list_t* mc_options_list_from_scanned(mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos,
+                                                uint32_t noptions);
 int mc_options_list_get_index(mc_options_list_t* list, uint32_t start, uint16_t optnum);
 mc_option_t* mc_options_list_at(mc_options_list_t* list, int index);
 mc_option_t* mc_options_list_get(mc_options_list_t* list, uint16_t num);
+mc_options_list_t* mc_options_list_index(mc_options_list_t* list);
+int mc_options_list_has(const mc_options_list_t* list, uint16_t num);
+uint32_t mc_options_list_count(const mc_options_list_t* list, uint16_t num);
+mc_option_t* mc_options_list_get_all(mc_options_list_t* list, uint16_t num, uint32_t* count);
+int mc_options_list_validate(const mc_options_list_t* list);
+int mc_options_list_get_uint32(mc_options_list_t* list, uint16_t num, uint32_t* value);
+const mc_buffer_t* mc_options_list_get_value(mc_options_list_t* list, uint16_t num);
+uint64_t mc_options_list_cache_key(const mc_options_list_t* list, uint8_t code);
 
 uint32_t mc_options_list_buffer_size(const mc_options_list_t* list);
+uint32_t mc_options_list_buffer_size_after(const mc_options_list_t* list, uint16_t prev_option_num);
 mc_buffer_t* mc_options_list_to_buffer(const mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos);
+mc_buffer_t* mc_options_list_to_buffer_after(const mc_options_list_t* list, mc_buffer_t* buffer, uint32_t* bpos, uint16_t prev_option_num);
 
 /** @} */
 
@@ -0,0 +1,36 @@
+/**
+ * @file
+ * @ingroup coap_pool
+ * @{
+ */
+
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_pool.h"
+
+static ms_pool_t messages = MS_POOL_STATIC_TAG("mc_message_t", sizeof(mc_message_t), MS_MEM_MESSAGE);
+static ms_pool_t buffers = MS_POOL_STATIC_TAG("mc_buffer_t", sizeof(mc_buffer_t), MS_MEM_BUFFER);
+
+ms_pool_t* mc_pool_messages() {
+    return &messages;
+}
+
+ms_pool_t* mc_pool_buffers() {
+    return &buffers;
+}
+
+/**
+ * Preallocate the pools, e.g. for the number of requests a server handles at once.
+ * @return 1 on success, 0 if allocation fails.
+ */
+int mc_pool_reserve(uint32_t nmessages, uint32_t nbuffers) {
+    return ms_pool_reserve(&messages, nmessages)
+        && ms_pool_reserve(&buffers, nbuffers);
+}
+
+/** Return the calling thread's cached objects, call before a thread using the library exits. */
+void mc_pool_flush() {
+    ms_pool_flush(&messages);
+    ms_pool_flush(&buffers);
+}
+
+/** @} */
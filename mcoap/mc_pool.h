@@ -0,0 +1,25 @@
+#ifndef MC_POOL_H
+#define MC_POOL_H
+
+/**
+ * @file
+ * @defgroup coap_pool CoAP Object Pools
+ * @{
+ * Slab pools for the objects the endpoint allocates for every datagram: messages and buffer
+ * headers. mc_message_alloc and mc_buffer_alloc take from these pools, mc_message_free and
+ * mc_buffer_free give back to them.
+ *
+ * The pools grow on demand. A server can reserve its working set at startup with
+ * mc_pool_reserve and check ms_pool_stats for the high-water mark.
+ */
+
+#include "msys/ms_pool.h"
+
+ms_pool_t* mc_pool_messages();
+ms_pool_t* mc_pool_buffers();
+int mc_pool_reserve(uint32_t nmessages, uint32_t nbuffers);
+void mc_pool_flush();
+
+/** @} */
+
+#endif
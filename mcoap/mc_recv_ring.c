@@ -0,0 +1,112 @@
+/**
+ * @file
+ * @ingroup recv_ring
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_atomic.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_recv_ring.h"
+
+mc_recv_ring_t* mc_recv_ring_alloc() {
+    return ms_calloc(1, mc_recv_ring_t);
+}
+
+/* The last reference to a slot was released, put it back on the free list. */
+static void slot_release(mc_shared_buffer_t* shared) {
+    mc_recv_slot_t* slot = (mc_recv_slot_t*)shared;
+    mc_recv_ring_t* ring = slot->ring;
+
+    ms_spin_lock(&ring->lock);
+    slot->next = ring->freelist;
+    ring->freelist = (uint32_t)(slot - ring->slots) + 1;
+    ring->nfree++;
+    ms_spin_unlock(&ring->lock);
+}
+
+/**
+ * Map nslots slots of at least slotsize bytes, trying huge pages first if huge is set.
+ * @return the ring or 0 if allocation fails.
+ */
+mc_recv_ring_t* mc_recv_ring_init(mc_recv_ring_t* ring, uint32_t nslots, uint32_t slotsize, int huge) {
+    uint32_t islot;
+
+    memset(ring, 0, sizeof(mc_recv_ring_t));
+    if (nslots == 0 || slotsize == 0) return 0;
+
+    ring->slotsize = (slotsize + MC_RECV_SLOT_ALIGN - 1) / MC_RECV_SLOT_ALIGN * MC_RECV_SLOT_ALIGN;
+    ring->slots = ms_calloc_tag(MS_MEM_BUFFER, nslots, mc_recv_slot_t);
+    if (ring->slots == 0) return 0;
+    if (ms_pages_init(&ring->pages, (size_t)nslots * ring->slotsize, huge) == 0) {
+        mc_recv_ring_deinit(ring);
+        return 0;
+    }
+    ms_mem_account(MS_MEM_BUFFER, (int64_t)ring->pages.size, 1);
+    ring->nslots = nslots;
+
+    /* Link in reverse so the first slot is handed out first. */
+    islot = nslots;
+    while (islot-- > 0) {
+        mc_recv_slot_t* slot = &ring->slots[islot];
+
+        slot->shared.free_fn = slot_release;
+        mc_buffer_init(&slot->shared.view, ring->slotsize, (uint8_t*)ring->pages.base + (size_t)islot * ring->slotsize);
+        slot->ring = ring;
+        slot->next = ring->freelist;
+        ring->freelist = islot + 1;
+    }
+    ring->nfree = nslots;
+
+    return ring;
+}
+
+/**
+ * Unmap the slots, none may still be referenced.
+ */
+mc_recv_ring_t* mc_recv_ring_deinit(mc_recv_ring_t* ring) {
+    if (ring->nslots) ms_mem_account(MS_MEM_BUFFER, -(int64_t)ring->pages.size, -1);
+    ms_pages_deinit(&ring->pages);
+    ms_free(ring->slots);
+    memset(ring, 0, sizeof(mc_recv_ring_t));
+
+    return ring;
+}
+
+/**
+ * Move the slots of src into the empty dest and leave src empty. None may be referenced.
+ */
+mc_recv_ring_t* mc_recv_ring_move(mc_recv_ring_t* dest, mc_recv_ring_t* src) {
+    uint32_t islot;
+
+    *dest = *src;
+    for (islot = 0; islot < dest->nslots; islot++) dest->slots[islot].ring = dest;
+    memset(src, 0, sizeof(mc_recv_ring_t));
+
+    return dest;
+}
+
+/**
+ * Take a free slot holding one reference, its view covers the whole slot.
+ * Release it with mc_shared_buffer_release().
+ * @return the slot's buffer or 0 if every slot is referenced.
+ */
+mc_shared_buffer_t* mc_recv_ring_acquire(mc_recv_ring_t* ring) {
+    mc_recv_slot_t* slot = 0;
+
+    ms_spin_lock(&ring->lock);
+    if (ring->freelist) {
+        slot = &ring->slots[ring->freelist - 1];
+        ring->freelist = slot->next;
+        ring->nfree--;
+    }
+    ms_spin_unlock(&ring->lock);
+
+    if (slot == 0) return 0;
+    slot->shared.refs = 1;
+    slot->shared.view.nbytes = ring->slotsize;
+    return &slot->shared;
+}
+
+/** @} */
@@ -0,0 +1,51 @@
+#ifndef MC_RECV_RING_H
+#define MC_RECV_RING_H
+
+/**
+ * @file
+ * @defgroup recv_ring CoAP Receive Ring
+ * @{
+ * Fixed size receive slots carved out of one page mapping, optionally backed by huge pages.
+ *
+ * Each slot is a mc_shared_buffer_t, so a message decoded from a datagram can reference the
+ * slot for its payload instead of copying it, and the slot goes back to the ring when the
+ * last reference is released, on any thread. Free slots are handed out most recently
+ * released first so the slot being filled is likely still cached.
+ *
+ * Slot sizes are rounded up to a multiple of the cache line so slots never share one.
+ */
+
+#include "msys/ms_config.h"
+#include "msys/ms_pages.h"
+#include "mcoap/mc_shared_buffer.h"
+
+#define MC_RECV_SLOT_ALIGN  64      /**< Cache line size. */
+
+typedef struct mc_recv_ring mc_recv_ring_t;
+
+typedef struct mc_recv_slot mc_recv_slot_t;
+struct mc_recv_slot {
+    mc_shared_buffer_t shared;      /**< First, so a released buffer is its slot. */
+    mc_recv_ring_t* ring;
+    uint32_t next;                  /**< Next free slot + 1 while free. */
+};
+
+struct mc_recv_ring {
+    ms_pages_t pages;
+    mc_recv_slot_t* slots;
+    uint32_t nslots;
+    uint32_t slotsize;              /**< Bytes in each slot. */
+    uint32_t nfree;
+    uint32_t freelist;              /**< First free slot + 1. */
+    volatile long lock;
+};
+
+mc_recv_ring_t* mc_recv_ring_alloc();
+mc_recv_ring_t* mc_recv_ring_init(mc_recv_ring_t* ring, uint32_t nslots, uint32_t slotsize, int huge);
+mc_recv_ring_t* mc_recv_ring_deinit(mc_recv_ring_t* ring);
+mc_recv_ring_t* mc_recv_ring_move(mc_recv_ring_t* dest, mc_recv_ring_t* src);
+mc_shared_buffer_t* mc_recv_ring_acquire(mc_recv_ring_t* ring);
+
+/** @} */
+
+#endif
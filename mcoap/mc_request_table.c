@@ -0,0 +1,246 @@
+/**
+ * @file
+ * @ingroup request_table
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_request_table.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+mc_request_table_t* mc_request_table_alloc() {
+    return ms_calloc(1, mc_request_table_t);
+}
+
+/* Rebuild the buckets and free list after the request array was (re)allocated. */
+static void rehash(mc_request_table_t* table) {
+    uint32_t mask = table->nbuckets - 1;
+    uint32_t slot;
+
+    memset(table->buckets, 0, table->nbuckets * sizeof(uint32_t));
+    table->freelist = 0;
+
+    /* Walk down so the free list hands out low slots first. */
+    slot = table->capacity;
+    while (slot-- > 0) {
+        mc_request_t* request = &table->requests[slot];
+        uint32_t* link = request->used ? &table->buckets[request->hash & mask] : &table->freelist;
+
+        request->chain = *link;
+        *link = slot + 1;
+    }
+}
+
+/**
+ * Grow to hold capacity requests, keeping the ones already in the table.
+ * @return 1 on success, 0 if allocation fails.
+ */
+static int resize(mc_request_table_t* table, uint32_t capacity) {
+    mc_request_t* requests = ms_realloc_tag(MS_MEM_QUEUE, table->requests, capacity, mc_request_t);
+    uint32_t* heap;
+    uint32_t* buckets;
+    uint32_t nbuckets = 1;
+
+    if (requests == 0) return 0;
+    table->requests = requests;
+
+    heap = ms_realloc_tag(MS_MEM_QUEUE, table->heap, capacity, uint32_t);
+    if (heap == 0) return 0;
+    table->heap = heap;
+
+    while (nbuckets < capacity) nbuckets <<= 1;
+    buckets = ms_realloc_tag(MS_MEM_QUEUE, table->buckets, nbuckets, uint32_t);
+    if (buckets == 0) return 0;
+    table->buckets = buckets;
+    table->nbuckets = nbuckets;
+
+    memset(&requests[table->capacity], 0, (capacity - table->capacity) * sizeof(mc_request_t));
+    table->capacity = capacity;
+    rehash(table);
+
+    return 1;
+}
+
+mc_request_table_t* mc_request_table_init(mc_request_table_t* table, uint32_t capacity) {
+    memset(table, 0, sizeof(mc_request_table_t));
+    if (capacity == 0) capacity = 1;
+
+    if (!resize(table, capacity)) {
+        mc_request_table_deinit(table);
+        return 0;
+    }
+    return table;
+}
+
+mc_request_table_t* mc_request_table_deinit(mc_request_table_t* table) {
+    ms_free(table->requests);
+    ms_free(table->heap);
+    ms_free(table->buckets);
+    memset(table, 0, sizeof(mc_request_table_t));
+
+    return table;
+}
+
+/* FNV-1a over the peer id and the token. */
+static uint32_t key_hash(mn_peer_id_t peer, const uint8_t* token, uint32_t toklen) {
+    uint32_t hash = FNV_OFFSET;
+    uint32_t ibyte;
+
+    for (ibyte = 0; ibyte < sizeof(mn_peer_id_t); ibyte++) {
+        hash ^= (peer >> (ibyte * 8)) & 0xff;
+        hash *= FNV_PRIME;
+    }
+    for (ibyte = 0; ibyte < toklen; ibyte++) {
+        hash ^= token[ibyte];
+        hash *= FNV_PRIME;
+    }
+    return hash ^ toklen;
+}
+
+/* Heap helpers, the heap is a min-heap of slots on deadline. */
+static int heap_less(const mc_request_table_t* table, uint32_t left, uint32_t right) {
+    return table->requests[table->heap[left]].deadline < table->requests[table->heap[right]].deadline;
+}
+
+static void heap_swap(mc_request_table_t* table, uint32_t left, uint32_t right) {
+    uint32_t slot = table->heap[left];
+
+    table->heap[left] = table->heap[right];
+    table->heap[right] = slot;
+    table->requests[table->heap[left]].heappos = left;
+    table->requests[table->heap[right]].heappos = right;
+}
+
+static void heap_up(mc_request_table_t* table, uint32_t pos) {
+    while (pos > 0 && heap_less(table, pos, (pos - 1) / 2)) {
+        heap_swap(table, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void heap_down(mc_request_table_t* table, uint32_t pos) {
+    for (;;) {
+        uint32_t least = pos;
+        uint32_t left = 2 * pos + 1;
+        uint32_t right = left + 1;
+
+        if (left < table->count && heap_less(table, left, least)) least = left;
+        if (right < table->count && heap_less(table, right, least)) least = right;
+        if (least == pos) return;
+
+        heap_swap(table, pos, least);
+        pos = least;
+    }
+}
+
+/**
+ * Add a request, growing the table if it is full.
+ * @return the request, with responsefn for the caller to set, or 0 if (peer, token)
+ * is already outstanding or allocation fails.
+ */
+mc_request_t* mc_request_table_add(mc_request_table_t* table, mn_peer_id_t peer, const mc_buffer_t* token, uint16_t msgid, double deadline) {
+    uint32_t toklen = token ? token->nbytes : 0;
+    uint32_t slot;
+    uint32_t* bucket;
+    mc_request_t* request;
+
+    if (toklen > MC_TOKEN_MAX) return 0;
+    if (mc_request_table_find(table, peer, token)) return 0;
+    if (table->freelist == 0 && !resize(table, table->capacity * 2)) return 0;
+
+    slot = table->freelist - 1;
+    request = &table->requests[slot];
+    table->freelist = request->chain;
+
+    memset(request, 0, sizeof(mc_request_t));
+    request->peer = peer;
+    request->msgid = msgid;
+    request->toklen = (uint8_t)toklen;
+    if (toklen) memcpy(request->token, token->bytes, toklen);
+    request->deadline = deadline;
+    request->hash = key_hash(peer, request->token, toklen);
+    request->used = 1;
+
+    bucket = &table->buckets[request->hash & (table->nbuckets - 1)];
+    request->chain = *bucket;
+    *bucket = slot + 1;
+
+    request->heappos = table->count;
+    table->heap[table->count++] = slot;
+    heap_up(table, request->heappos);
+
+    return request;
+}
+
+/**
+ * Find the outstanding request for a response's peer and token.
+ * @return the request or 0.
+ */
+mc_request_t* mc_request_table_find(const mc_request_table_t* table, mn_peer_id_t peer, const mc_buffer_t* token) {
+    uint32_t toklen = token ? token->nbytes : 0;
+    const uint8_t* bytes = token ? token->bytes : 0;
+    uint32_t hash;
+    uint32_t next;
+
+    if (toklen > MC_TOKEN_MAX) return 0;
+    hash = key_hash(peer, bytes, toklen);
+
+    next = table->buckets[hash & (table->nbuckets - 1)];
+    while (next) {
+        mc_request_t* request = &table->requests[next - 1];
+        if (request->hash == hash && request->peer == peer && request->toklen == toklen
+            && (toklen == 0 || memcmp(request->token, bytes, toklen) == 0)) {
+            return request;
+        }
+        next = request->chain;
+    }
+    return 0;
+}
+
+void mc_request_table_remove(mc_request_table_t* table, mc_request_t* request) {
+    uint32_t slot = (uint32_t)(request - table->requests);
+    uint32_t* link = &table->buckets[request->hash & (table->nbuckets - 1)];
+    uint32_t pos = request->heappos;
+
+    while (*link && *link != slot + 1) link = &table->requests[*link - 1].chain;
+    if (*link) *link = request->chain;
+
+    /* Move the last heap entry into the hole and restore the heap order. */
+    table->count--;
+    if (pos != table->count) {
+        heap_swap(table, pos, table->count);
+        heap_down(table, pos);
+        heap_up(table, pos);
+    }
+
+    request->used = 0;
+    request->chain = table->freelist;
+    table->freelist = slot + 1;
+}
+
+/** Move a request's deadline, e.g. when an observe notification arrives. */
+void mc_request_table_set_deadline(mc_request_table_t* table, mc_request_t* request, double deadline) {
+    request->deadline = deadline;
+    heap_down(table, request->heappos);
+    heap_up(table, request->heappos);
+}
+
+/**
+ * Return the request with the earliest deadline if it is at or before now.
+ * Call repeatedly, removing each request, to drain all the expired ones.
+ * @return the expired request or 0.
+ */
+mc_request_t* mc_request_table_expired(const mc_request_table_t* table, double now) {
+    mc_request_t* earliest;
+
+    if (table->count == 0) return 0;
+    earliest = &table->requests[table->heap[0]];
+
+    return earliest->deadline <= now ? earliest : 0;
+}
+
+/** @} */
@@ -0,0 +1,69 @@
+#ifndef MC_REQUEST_TABLE_H
+#define MC_REQUEST_TABLE_H
+
+/**
+ * @file
+ * @defgroup request_table CoAP Outstanding Request Table
+ * @{
+ * Outstanding client requests keyed by (peer id, token).
+ *
+ * Responses are matched to requests by the interned peer they came from and their token,
+ * so piggybacked, separate, and observe responses for CON and NON requests all use the
+ * same O(1) hash lookup. Each request has a deadline. A binary heap orders the deadlines,
+ * so the earliest expired request is found without scanning the table.
+ *
+ * The table grows as needed. Request pointers are only valid until the next add.
+ */
+
+#include "msys/ms_config.h"
+#include "mnet/mn_peer_table.h"
+#include "mcoap/mc_buffer_queue.h"
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_token.h"
+
+/** Default initial number of requests. */
+#define MC_REQUEST_TABLE_SIZE 32
+
+/**
+ * Called with a response to a request, or with a null response when the request's deadline passes.
+ * For observe notifications returning 0 stops tracking the request.
+ */
+typedef int (*mc_endpt_response_fn_t)(mc_endpt_id_t endpt, uint16_t msgid, mc_message_t* response);
+
+typedef struct mc_request mc_request_t;
+struct mc_request {
+    mn_peer_id_t peer;
+    uint16_t msgid;
+    uint8_t toklen;
+    uint8_t token[MC_TOKEN_MAX];
+    double deadline;                /**< mn_gettime() seconds. */
+    mc_endpt_response_fn_t responsefn;
+    uint32_t hash;
+    uint32_t chain;                 /**< Next slot + 1 in the bucket or free list, 0 ends it. */
+    uint32_t heappos;               /**< Index of this slot in the deadline heap. */
+    uint8_t used;
+};
+
+typedef struct mc_request_table mc_request_table_t;
+struct mc_request_table {
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t nbuckets;              /**< A power of 2, at least capacity. */
+    uint32_t* buckets;              /**< First slot + 1 in each bucket, 0 if empty. */
+    uint32_t freelist;              /**< First free slot + 1. */
+    uint32_t* heap;                 /**< Slots ordered by deadline, count long. */
+    mc_request_t* requests;
+};
+
+mc_request_table_t* mc_request_table_alloc();
+mc_request_table_t* mc_request_table_init(mc_request_table_t* table, uint32_t capacity);
+mc_request_table_t* mc_request_table_deinit(mc_request_table_t* table);
+mc_request_t* mc_request_table_add(mc_request_table_t* table, mn_peer_id_t peer, const mc_buffer_t* token, uint16_t msgid, double deadline);
+mc_request_t* mc_request_table_find(const mc_request_table_t* table, mn_peer_id_t peer, const mc_buffer_t* token);
+void mc_request_table_remove(mc_request_table_t* table, mc_request_t* request);
+void mc_request_table_set_deadline(mc_request_table_t* table, mc_request_t* request, double deadline);
+mc_request_t* mc_request_table_expired(const mc_request_table_t* table, double now);
+
+/** @} */
+
+#endif
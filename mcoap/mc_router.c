@@ -0,0 +1,365 @@
+/**
+ * @file
+ * @ingroup router
+ * @{
+ */
+
+#define MS_LOG_CATEGORY MS_LOG_MCOAP
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_log.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_uri.h"
+#include "mcoap/mc_router.h"
+
+/** Longest encoded template, each segment is a length byte and up to 255 bytes. */
+#define MAX_ENCODED 1024
+
+mc_router_t* mc_router_alloc() {
+    return ms_calloc(1, mc_router_t);
+}
+
+mc_router_t* mc_router_init(mc_router_t* router) {
+    memset(router, 0, sizeof(mc_router_t));
+    return router;
+}
+
+static void node_deinit(mc_router_node_t* node) {
+    uint32_t ichild;
+
+    for (ichild = 0; ichild < node->nchildren; ichild++) {
+        node_deinit(node->children[ichild]);
+        ms_free(node->children[ichild]);
+    }
+    if (node->wildcard) {
+        node_deinit(node->wildcard);
+        ms_free(node->wildcard);
+    }
+    ms_free(node->label);
+    ms_free(node->keys);
+    ms_free(node->children);
+    memset(node, 0, sizeof(mc_router_node_t));
+}
+
+mc_router_t* mc_router_deinit(mc_router_t* router) {
+    node_deinit(&router->root);
+    router->nresources = 0;
+    return router;
+}
+
+/**
+ * Binary search the children on their first label byte.
+ * @return the index of the child starting with key, or where it would be inserted if found is 0.
+ */
+static uint32_t find_child(const mc_router_node_t* node, uint8_t key, int* found) {
+    uint32_t low = 0;
+    uint32_t high = node->nchildren;
+
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (node->keys[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    *found = low < node->nchildren && node->keys[low] == key;
+    return low;
+}
+
+static mc_router_node_t* node_create(const uint8_t* label, uint32_t nlabel) {
+    mc_router_node_t* node = ms_calloc(1, mc_router_node_t);
+
+    if (node == 0) return 0;
+    if (nlabel) {
+        node->label = ms_malloc(nlabel, uint8_t);
+        if (node->label == 0) {
+            ms_free(node);
+            return 0;
+        }
+        memcpy(node->label, label, nlabel);
+        node->nlabel = nlabel;
+    }
+    return node;
+}
+
+/** @return 1 on success, 0 if allocation fails. */
+static int add_child(mc_router_node_t* node, uint32_t pos, mc_router_node_t* child) {
+    uint8_t* keys = ms_realloc(node->keys, (node->nchildren + 1), uint8_t);
+    mc_router_node_t** children;
+
+    if (keys == 0) return 0;
+    node->keys = keys;
+    children = ms_realloc(node->children, (node->nchildren + 1), mc_router_node_t*);
+    if (children == 0) return 0;
+    node->children = children;
+
+    memmove(&keys[pos + 1], &keys[pos], node->nchildren - pos);
+    memmove(&children[pos + 1], &children[pos], (node->nchildren - pos) * sizeof(mc_router_node_t*));
+    keys[pos] = child->label[0];
+    children[pos] = child;
+    node->nchildren++;
+
+    return 1;
+}
+
+/**
+ * Split the child at pos after nprefix label bytes. The new node takes the prefix and the
+ * child keeps the rest, so pointers to existing nodes stay valid.
+ * @return the new node or 0 if allocation fails.
+ */
+static mc_router_node_t* split_child(mc_router_node_t* node, uint32_t pos, uint32_t nprefix) {
+    mc_router_node_t* child = node->children[pos];
+    mc_router_node_t* mid = node_create(child->label, nprefix);
+
+    if (mid == 0) return 0;
+    mid->keys = ms_malloc(1, uint8_t);
+    mid->children = ms_malloc(1, mc_router_node_t*);
+    if (mid->keys == 0 || mid->children == 0) {
+        node_deinit(mid);
+        ms_free(mid);
+        return 0;
+    }
+
+    child->nlabel -= nprefix;
+    memmove(child->label, &child->label[nprefix], child->nlabel);
+    mid->keys[0] = child->label[0];
+    mid->children[0] = child;
+    mid->nchildren = 1;
+    node->children[pos] = mid;
+
+    return mid;
+}
+
+/**
+ * Insert the encoded bytes below node, splitting edges as needed.
+ * @return the node the bytes end at, or 0 if allocation fails.
+ */
+static mc_router_node_t* insert_bytes(mc_router_node_t* node, const uint8_t* bytes, uint32_t nbytes) {
+    while (nbytes > 0) {
+        int found;
+        uint32_t pos = find_child(node, bytes[0], &found);
+        mc_router_node_t* child;
+        uint32_t common;
+
+        if (!found) {
+            child = node_create(bytes, nbytes);
+            if (child == 0) return 0;
+            if (!add_child(node, pos, child)) {
+                node_deinit(child);
+                ms_free(child);
+                return 0;
+            }
+            return child;
+        }
+
+        child = node->children[pos];
+        common = 1;
+        while (common < child->nlabel && common < nbytes && child->label[common] == bytes[common]) common++;
+
+        if (common < child->nlabel) {
+            child = split_child(node, pos, common);
+            if (child == 0) return 0;
+        }
+        node = child;
+        bytes += common;
+        nbytes -= common;
+    }
+    return node;
+}
+
+/**
+ * Register a handler for a method on a path template.
+ * @return 1 on success, 0 if the method is not GET, POST, PUT or DELETE, the template is
+ * invalid, the method is already registered for it, or allocation fails.
+ */
+int mc_router_add(mc_router_t* router, uint8_t method, const char* path, mc_router_handler_fn_t handler, void* arg) {
+    uint8_t encoded[MAX_ENCODED];
+    uint32_t nencoded = 0;
+    uint32_t nwildcards = 0;
+    mc_router_node_t* node = &router->root;
+    const char* segment;
+
+    if (method < MC_GET || method > MC_DELETE || handler == 0 || path == 0) return 0;
+    if (*path == '/') path++;
+
+    /* An empty template is the root, otherwise each '/' separated segment is one Uri-Path. */
+    segment = *path ? path : 0;
+    while (segment) {
+        const char* end = strchr(segment, '/');
+        uint32_t nchars = end ? (uint32_t)(end - segment) : (uint32_t)strlen(segment);
+
+        if (nchars == 1 && segment[0] == '*') {
+            if (++nwildcards > MC_ROUTER_MAX_WILDCARDS) return 0;
+
+            /* Flush the literal run so the wildcard hangs off an explicit node. */
+            node = insert_bytes(node, encoded, nencoded);
+            if (node == 0) return 0;
+            nencoded = 0;
+
+            if (node->wildcard == 0) node->wildcard = node_create(0, 0);
+            node = node->wildcard;
+            if (node == 0) return 0;
+        }
+        else {
+            int32_t nbytes;
+
+            /* Decoding never produces more bytes than characters. */
+            if (nencoded + 1 + nchars > MAX_ENCODED) return 0;
+            nbytes = mc_uri_percent_decode(&encoded[nencoded + 1], segment, nchars);
+            if (nbytes < 0 || nbytes > UINT8_MAX) return 0;
+            encoded[nencoded] = (uint8_t)nbytes;
+            nencoded += 1 + nbytes;
+        }
+        segment = end ? end + 1 : 0;
+    }
+
+    node = insert_bytes(node, encoded, nencoded);
+    if (node == 0) return 0;
+    if (node->handlers[method - 1]) return 0;
+
+    node->handlers[method - 1] = handler;
+    node->args[method - 1] = arg;
+    if (!node->resource) {
+        node->resource = 1;
+        router->nresources++;
+    }
+    return 1;
+}
+
+/* Position in the trie, off label bytes into the edge leading to node. */
+typedef struct {
+    const mc_router_node_t* node;
+    uint32_t off;
+} cursor_t;
+
+static int step(cursor_t* cursor, uint8_t byte) {
+    const mc_router_node_t* node = cursor->node;
+    uint32_t pos;
+    int found;
+
+    if (cursor->off < node->nlabel) {
+        if (node->label[cursor->off] != byte) return 0;
+        cursor->off++;
+        return 1;
+    }
+
+    pos = find_child(node, byte, &found);
+    if (!found) return 0;
+    cursor->node = node->children[pos];
+    cursor->off = 1;
+    return 1;
+}
+
+/* Match one segment literally, the cursor is undefined on failure. */
+static int step_segment(cursor_t* cursor, const mc_buffer_t* segment) {
+    uint32_t ibyte;
+
+    if (segment->nbytes > UINT8_MAX || !step(cursor, (uint8_t)segment->nbytes)) return 0;
+    for (ibyte = 0; ibyte < segment->nbytes; ibyte++) {
+        if (!step(cursor, segment->bytes[ibyte])) return 0;
+    }
+    return 1;
+}
+
+/* The wildcard child at the cursor, only explicit nodes have them. */
+static const mc_router_node_t* wildcard_at(const cursor_t* cursor) {
+    return cursor->off == cursor->node->nlabel ? cursor->node->wildcard : 0;
+}
+
+/* Most wildcards passed over that are remembered for a retry, the shallowest are forgotten first. */
+#define MAX_BRANCHES 32
+
+/* A wildcard passed over for a literal segment, retried if the literal path fails. */
+typedef struct {
+    const mc_router_node_t* wildcard;
+    uint32_t isegment;
+    uint32_t nwildcards;
+} branch_t;
+
+/**
+ * Find the handler for a request's method and Uri-Path.
+ * Literal segments are tried first. If they do not lead to a resource with a handler for the
+ * method, matching retries from the deepest wildcard it passed over, so the path is walked at
+ * most once more for each wildcard alternative along it. Never allocates.
+ * @return 0 with handler, arg and match set, MC_NOT_FOUND if no template matches the path,
+ * or MC_METHOD_NOT_ALLOWED if the path matches but not for the request's method.
+ */
+uint8_t mc_router_match(const mc_router_t* router, mc_message_t* const request, mc_router_handler_fn_t* handler,
+                        void** arg, mc_router_match_t* match) {
+    uint8_t method = mc_message_get_code(request);
+    uint8_t result = MC_NOT_FOUND;
+    const mc_option_t* segments = 0;
+    branch_t branches[MAX_BRANCHES];
+    branch_t* branch;
+    uint32_t nbranches = 0;
+    uint32_t nsegments = 0;
+    uint32_t isegment = 0;
+    cursor_t cursor;
+
+    match->nwildcards = 0;
+    if (request->options) segments = mc_options_list_get_all(request->options, OPTION_URI_PATH, &nsegments);
+
+    cursor.node = &router->root;
+    cursor.off = 0;
+    for (;;) {
+        while (isegment < nsegments) {
+            const mc_router_node_t* wildcard = wildcard_at(&cursor);
+
+            if (wildcard && match->nwildcards < MC_ROUTER_MAX_WILDCARDS) {
+                if (nbranches == MAX_BRANCHES) memmove(branches, branches + 1, --nbranches * sizeof(branch_t));
+                branch = &branches[nbranches++];
+                branch->wildcard = wildcard;
+                branch->isegment = isegment;
+                branch->nwildcards = match->nwildcards;
+            }
+            if (!step_segment(&cursor, &segments[isegment].value)) break;
+            isegment++;
+        }
+
+        if (isegment == nsegments && cursor.off == cursor.node->nlabel && cursor.node->resource) {
+            if (method >= MC_GET && method <= MC_DELETE && cursor.node->handlers[method - 1]) {
+                *handler = cursor.node->handlers[method - 1];
+                *arg = cursor.node->args[method - 1];
+                return 0;
+            }
+            result = MC_METHOD_NOT_ALLOWED;
+        }
+
+        /* Take the deepest wildcard passed over for the segment it was passed over for. */
+        if (nbranches == 0) return result;
+        branch = &branches[--nbranches];
+        isegment = branch->isegment;
+        match->nwildcards = branch->nwildcards;
+        match->wildcards[match->nwildcards++] = &segments[isegment++].value;
+        cursor.node = branch->wildcard;
+        cursor.off = 0;
+    }
+}
+
+/**
+ * Route a request to its handler. Use from an endpoint read function.
+ * If no handler matches a confirmable request, a piggybacked 4.04 or 4.05 is sent,
+ * other unmatched requests are dropped. Messages that are not requests are ignored.
+ * @return the handler's result or 1 if no handler was called.
+ */
+int mc_router_dispatch(const mc_router_t* router, mc_endpt_udp_t* const endpt, mc_message_t* const request) {
+    mc_router_handler_fn_t handler;
+    mc_router_match_t match;
+    void* arg;
+    uint8_t code = mc_message_get_code(request);
+
+    if (code == 0 || mc_code_get_category(code) != MC_CODE_REQUEST) return 1;
+
+    code = mc_router_match(router, request, &handler, &arg, &match);
+    if (code == 0) return (*handler)(endpt, request, &match, arg);
+
+    if (mc_message_is_confirmable(request) && request->from.ss_family) {
+        mc_endpt_udp_respond(endpt, request, code, 0, 0);
+    }
+    else {
+        ms_log_debug("Dropping request for unrouted path, code %d.%02d", mc_code_get_category(code), mc_code_get_detail(code));
+    }
+    return 1;
+}
+
+/** @} */
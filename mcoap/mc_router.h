@@ -0,0 +1,74 @@
+#ifndef MC_ROUTER_H
+#define MC_ROUTER_H
+
+/**
+ * @file
+ * @defgroup router CoAP Resource Router
+ * @{
+ * Dispatch requests to handlers registered by path template and method.
+ *
+ * Templates are paths like "/devices/ * /temp" (without the space), where a segment that is
+ * exactly "*" matches any one Uri-Path segment. Segments are percent-decoded when registered
+ * so they compare directly with the decoded Uri-Path option values.
+ *
+ * The resources are kept in a compressed radix trie over the path encoded as a length byte
+ * followed by the segment bytes for each segment. Matching walks the request's Uri-Path
+ * option values byte by byte, choosing children by binary search on their first byte, so a
+ * lookup without wildcards costs O(path length) however many resources are registered.
+ * A literal segment takes precedence over a wildcard at the same position. If the literal
+ * path does not lead to a handler, matching retries from the deepest wildcard it passed over,
+ * e.g. with "/a/b/c" and "/a/ * /d" registered "/a/b/d" matches the wildcard template.
+ */
+
+#include "msys/ms_config.h"
+#include "mcoap/mc_endpt_udp.h"
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_option.h"
+
+#define MC_ROUTER_METHODS       4       /**< GET, POST, PUT, DELETE. */
+#define MC_ROUTER_MAX_WILDCARDS 8       /**< Most wildcard segments in one template. */
+
+/** The Uri-Path values that matched the wildcard segments, in path order. */
+typedef struct mc_router_match mc_router_match_t;
+struct mc_router_match {
+    uint32_t nwildcards;
+    const mc_buffer_t* wildcards[MC_ROUTER_MAX_WILDCARDS];
+};
+
+/**
+ * Handle a request routed to a resource.
+ * @return 0 to stop the endpoint's read loop, non zero to keep running.
+ */
+typedef int (*mc_router_handler_fn_t)(mc_endpt_udp_t* const endpt, mc_message_t* const request,
+                                      const mc_router_match_t* match, void* arg);
+
+typedef struct mc_router_node mc_router_node_t;
+struct mc_router_node {
+    uint8_t* label;                 /**< Encoded path bytes on the edge into this node. */
+    uint32_t nlabel;
+    uint32_t nchildren;
+    uint8_t* keys;                  /**< First label byte of each child, sorted. */
+    mc_router_node_t** children;
+    mc_router_node_t* wildcard;     /**< Child for a * segment, only at segment boundaries. */
+    mc_router_handler_fn_t handlers[MC_ROUTER_METHODS];
+    void* args[MC_ROUTER_METHODS];
+    int resource;                   /**< 1 if a template ends here. */
+};
+
+typedef struct mc_router mc_router_t;
+struct mc_router {
+    mc_router_node_t root;
+    uint32_t nresources;
+};
+
+mc_router_t* mc_router_alloc();
+mc_router_t* mc_router_init(mc_router_t* router);
+mc_router_t* mc_router_deinit(mc_router_t* router);
+int mc_router_add(mc_router_t* router, uint8_t method, const char* path, mc_router_handler_fn_t handler, void* arg);
+uint8_t mc_router_match(const mc_router_t* router, mc_message_t* const request, mc_router_handler_fn_t* handler,
+                        void** arg, mc_router_match_t* match);
+int mc_router_dispatch(const mc_router_t* router, mc_endpt_udp_t* const endpt, mc_message_t* const request);
+
+/** @} */
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file
+ * @ingroup shared_buffer
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_atomic.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_shared_buffer.h"
+
+/**
+ * Create a buffer holding one reference, with a copy of bytes or zeroed if bytes is 0.
+ * @return the buffer or 0 if allocation fails.
+ */
+mc_shared_buffer_t* mc_shared_buffer_create(uint32_t nbytes, const uint8_t* bytes) {
+    mc_shared_buffer_t* shared = (mc_shared_buffer_t*)ms_malloc_tag(MS_MEM_BUFFER, sizeof(mc_shared_buffer_t) + nbytes, uint8_t);
+
+    if (shared == 0) return 0;
+    shared->refs = 1;
+    shared->free_fn = 0;
+    mc_buffer_init(&shared->view, nbytes, (uint8_t*)(shared + 1));
+    if (bytes) memcpy(shared->view.bytes, bytes, nbytes);
+    else memset(shared->view.bytes, 0, nbytes);
+
+    return shared;
+}
+
+/** Add a reference. @return shared. */
+mc_shared_buffer_t* mc_shared_buffer_retain(mc_shared_buffer_t* shared) {
+    ms_atomic_increment(&shared->refs);
+    return shared;
+}
+
+/** Drop a reference, freeing the buffer with the last one, 0 is ignored. */
+void mc_shared_buffer_release(mc_shared_buffer_t* shared) {
+    if (shared == 0 || ms_atomic_decrement(&shared->refs) != 0) return;
+
+    if (shared->free_fn) (*shared->free_fn)(shared);
+    else ms_free(shared);
+}
+
+/** @} */
@@ -0,0 +1,33 @@
+#ifndef MC_SHARED_BUFFER_H
+#define MC_SHARED_BUFFER_H
+
+/**
+ * @file
+ * @defgroup shared_buffer CoAP Shared Buffer
+ * @{
+ * Reference counted, immutable bytes that several owners can hold without copying, e.g. a
+ * serialized message in the confirm queue or one payload sent to many peers.
+ *
+ * The count is atomic so references can be retained and released on different threads.
+ * The bytes are allocated with the header and freed when the last reference is released.
+ * The view is a borrowed mc_buffer_t for the mc_buffer_t API, it must not be deinitialized
+ * or written once the buffer is shared.
+ */
+
+#include "msys/ms_config.h"
+#include "mcoap/mc_buffer.h"
+
+typedef struct mc_shared_buffer mc_shared_buffer_t;
+struct mc_shared_buffer {
+    volatile long refs;
+    mc_buffer_t view;       /**< The bytes, which follow this struct unless it is a receive slot. */
+    void (*free_fn)(mc_shared_buffer_t* shared);    /**< Called by the last release instead of ms_free if set. */
+};
+
+mc_shared_buffer_t* mc_shared_buffer_create(uint32_t nbytes, const uint8_t* bytes);
+mc_shared_buffer_t* mc_shared_buffer_retain(mc_shared_buffer_t* shared);
+void mc_shared_buffer_release(mc_shared_buffer_t* shared);
+
+/** @} */
+
+#endif
@@ -16,9 +16,9 @@
  * that helps minimize the chance of collisions.
  */
 mc_buffer_t* mc_token_create1(uint8_t prefix) {
-	uint8_t* buffer = ms_calloc(5, uint8_t);
+	uint8_t* buffer = ms_calloc_tag(MS_MEM_MESSAGE, 5, uint8_t);
 
-	uint32_t suffix = rand();
+	uint32_t suffix = (uint32_t)ms_random_next(ms_random_thread());
 	size_t len = sizeof(int);
 
 	if (len > 4) len = 4;
@@ -35,9 +35,9 @@ mc_buffer_t* mc_token_create1(uint8_t prefix) {
  * that helps minimize the chance of collisions.
  */
 mc_buffer_t* mc_token_create2(uint16_t prefix) {
-	uint8_t* buffer = ms_malloc(6, uint8_t);
+	uint8_t* buffer = ms_malloc_tag(MS_MEM_MESSAGE, 6, uint8_t);
 
-	uint32_t suffix = rand();
+	uint32_t suffix = (uint32_t)ms_random_next(ms_random_thread());
 	size_t len = sizeof(int);
 
 	if (len > 4) len = 4;
@@ -54,9 +54,9 @@ mc_buffer_t* mc_token_create2(uint16_t prefix) {
  * that helps minimize the chance of collisions.
  */
 mc_buffer_t* mc_token_create4(uint32_t prefix) {
-	uint8_t* buffer = ms_malloc(8, uint8_t);
+	uint8_t* buffer = ms_malloc_tag(MS_MEM_MESSAGE, 8, uint8_t);
 
-	uint32_t suffix = rand();
+	uint32_t suffix = (uint32_t)ms_random_next(ms_random_thread());
 	size_t len = sizeof(int);
 
 	if (len > 4) len = 4;
@@ -67,4 +67,16 @@ mc_buffer_t* mc_token_create4(uint32_t prefix) {
 	return mc_buffer_init(mc_buffer_alloc(), 8, buffer);
 }
 
+/**
+ * Initialize a token of len random bytes over caller owned storage, e.g. a message's
+ * inline token bytes, so nothing is allocated. len is limited to MC_TOKEN_MAX.
+ * @return the token, which must not be mc_buffer_deinit'ed.
+ */
+mc_buffer_t* mc_token_random(mc_buffer_t* token, uint8_t* bytes, uint8_t len, ms_random_t* rng) {
+	if (len > MC_TOKEN_MAX) len = MC_TOKEN_MAX;
+
+	ms_random_fill(rng, bytes, len);
+	return mc_buffer_init(token, len, bytes);
+}
+
 /** @} */
@@ -7,11 +7,16 @@
  * @{
  */
 
+#include "msys/ms_random.h"
 #include "mcoap/mc_buffer.h"
 
+#define MC_TOKEN_MAX 8     /**< Longest token allowed by the header. */
+#define MC_TOKEN_LEN 8     /**< Length of tokens generated for requests. */
+
 mc_buffer_t* mc_token_create1(uint8_t prefix);
 mc_buffer_t* mc_token_create2(uint16_t prefix);
 mc_buffer_t* mc_token_create4(uint32_t prefix);
+mc_buffer_t* mc_token_random(mc_buffer_t* token, uint8_t* bytes, uint8_t len, ms_random_t* rng);
 
 /** @} */
 #endif
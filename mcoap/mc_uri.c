@@ -4,344 +4,462 @@
  * @{
  */
 #include "msys/ms_memory.h"
-#include "msys/ms_copy.h"
 #include "mnet/mn_sockaddr.h"
 #include "mcoap/mc_uri.h"
 #include <string.h>
 
+/** Uri-Host is at most 255 bytes, longer hosts are rejected. */
+#define MAX_HOST_LEN 255
 
-/** Extract the scheme from the URI. */
-static char* getscheme(char* const uri) {
-	size_t schemelen;
-	char* colon;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define URI_SSE2 1
+#endif
 
-	colon = strstr(uri, ":");
-	if (!colon) return 0;
+#if defined(_MSC_VER) && defined(URI_SSE2)
+#include <intrin.h>
+#endif
 
-	schemelen = colon - uri;
-	return ms_copy_cstr(schemelen, uri);
-}
+static const char hexdigits[] = "0123456789ABCDEF";
 
-/** Valid if it is "coap" or "coaps". */
-static int validscheme(char* const scheme) {
-	if (scheme == 0) return 0;
-	if (strcmp(scheme, "coap") == 0) return 1;
-	if (strcmp(scheme, "coaps") == 0) return 1;
-	return 0;
+static int hexvalue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
 }
 
 /**
- * Return a pointer into str offset by prefix.
- * prefix *must* match the contents of str character-by-character,
- * otherwise its an error.
- * @return pointer in str advanced by length of prefix or 0 on error.
+ * Characters left as is by the encoder: RFC3986 pchar (unreserved, sub-delims, ':' and '@')
+ * except '&', which joins Uri-Query arguments. '/' and '?' are always encoded since they
+ * would split a Uri-Path value.
  */
-static char* advanceby(char* const str, char* const prefix) {
-	char* spos = str;
-	char* ppos = prefix;
-
-	if (!str || !prefix) return 0;
-
-	while (*ppos) {
-		if (*spos == 0) return 0;
-		if (*spos != *ppos) return 0;
-		spos++;
-		ppos++;
+static int is_plain(uint8_t c) {
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return 1;
+	switch (c) {
+	case '-': case '.': case '_': case '~':
+	case '!': case '$': case '\'': case '(': case ')': case '*': case '+': case ',': case ';': case '=':
+	case ':': case '@':
+		return 1;
+	default:
+		return 0;
 	}
-	return spos;
 }
 
-/**
- * Get an IP v6 host by extracting anything between []'s.
+/*
+ * Decode the escape at src[*ichar], which is a '%'.
+ * @return 1 on success, 0 if the escape is truncated or not hex.
  */
-static char* getip6host(char* const uri) {
-	char* current;
-	size_t nchar;
+static int decode_escape(uint8_t* dest, const char* src, uint32_t nchars, uint32_t* ichar) {
+	int high;
+	int low;
+
+	if (*ichar + 2 >= nchars) return 0;
+	high = hexvalue(src[*ichar + 1]);
+	low = hexvalue(src[*ichar + 2]);
+	if ((high | low) < 0) return 0;
+
+	*dest = (uint8_t)((high << 4) | low);
+	*ichar += 3;
+	return 1;
+}
 
-	if (!uri) return 0;
+static void encode_byte(char* dest, uint8_t c) {
+	dest[0] = '%';
+	dest[1] = hexdigits[c >> 4];
+	dest[2] = hexdigits[c & 0x0f];
+}
+
+#ifdef URI_SSE2
+/** Index of the lowest set bit, mask must not be 0. */
+static uint32_t lowest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(mask);
+#endif
+}
 
-	current = advanceby(uri, "[");
-	nchar = strcspn(current, "]");
+/* Bytes of chunk in [low, high], bytes >= 0x80 are negative and never in an ASCII range. */
+static __m128i in_range(__m128i chunk, char low, char high) {
+	return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8((char)(low - 1))),
+	                     _mm_cmplt_epi8(chunk, _mm_set1_epi8((char)(high + 1))));
+}
+
+/* Mask of the alphanumerics and '-', '.', '_' and '~' in 16 bytes, the common plain characters. */
+static uint32_t unreserved_mask(__m128i chunk) {
+	__m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+	__m128i plain = _mm_or_si128(in_range(lower, 'a', 'z'), in_range(chunk, '0', '9'));
 
-	if (nchar == 0) return 0;
-	if (current[nchar] != ']') return 0;
+	plain = _mm_or_si128(plain, in_range(chunk, '-', '.'));
+	plain = _mm_or_si128(plain, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+	plain = _mm_or_si128(plain, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('~')));
 
-	return ms_copy_cstr(nchar, current);
+	return (uint32_t)_mm_movemask_epi8(plain);
 }
+#endif
 
 /**
- * Get any characters from start of URI to next : or /.
- * Won't work for IP v6, treat it as a special case.
+ * Percent-decode nchars characters of src into dest, dest must have room for nchars bytes.
+ * Runs without escapes are found 16 characters at a time with SSE2 when the compiler targets it,
+ * mc_uri_percent_decode_scalar() is the character at a time fallback.
+ * @return the number of decoded bytes or -1 if an escape is malformed.
  */
-static char* gethost(char* const uri) {
-	size_t nchar;
-
-	if (!uri) return 0;
+int32_t mc_uri_percent_decode(uint8_t* dest, const char* src, uint32_t nchars) {
+#ifdef URI_SSE2
+	const __m128i percent16 = _mm_set1_epi8('%');
+	uint32_t ichar = 0;
+	int32_t nbytes = 0;
+
+	while (ichar + 16 <= nchars) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(src + ichar));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, percent16));
+		uint32_t run = mask ? lowest_bit(mask) : 16;
+
+		/* Decoding never grows, so dest has room for the whole chunk. */
+		_mm_storeu_si128((__m128i*)(dest + nbytes), chunk);
+		nbytes += run;
+		ichar += run;
+		if (mask && !decode_escape(&dest[nbytes++], src, nchars, &ichar)) return -1;
+	}
 
-	nchar = strcspn(uri, ":/\0");
-	return ms_copy_cstr(nchar, uri);
+	while (ichar < nchars) {
+		if (src[ichar] != '%') dest[nbytes++] = (uint8_t)src[ichar++];
+		else if (!decode_escape(&dest[nbytes++], src, nchars, &ichar)) return -1;
+	}
+	return nbytes;
+#else
+	return mc_uri_percent_decode_scalar(dest, src, nchars);
+#endif
 }
 
-/** Get host address from URI, IP v6 is a special case. */
-static char* getaddress(char* const uri) {
-	char* address;
+/** Character at a time mc_uri_percent_decode(). */
+int32_t mc_uri_percent_decode_scalar(uint8_t* dest, const char* src, uint32_t nchars) {
+	uint32_t ichar = 0;
+	int32_t nbytes = 0;
 
-	if (*uri == '[') {
-		address = getip6host(uri);
-	}
-	else {
-		address = gethost(uri);
+	while (ichar < nchars) {
+		if (src[ichar] != '%') dest[nbytes++] = (uint8_t)src[ichar++];
+		else if (!decode_escape(&dest[nbytes++], src, nchars, &ichar)) return -1;
 	}
-	return address;
+	return nbytes;
 }
 
 /**
- * Get port from URI.
- * Note: If port is invalid with respect to atoi conversions this
- * function still returns the default port.
- * @return port or 0 if none.
+ * Percent-encode nbytes of an option value into dest for a Uri-Path or Uri-Query segment,
+ * dest must have room for 3 * nbytes characters and is not null terminated.
+ * Runs of unreserved characters are copied 16 at a time with SSE2 when the compiler targets it,
+ * mc_uri_percent_encode_scalar() is the byte at a time fallback.
+ * @return the number of characters written.
  */
-static uint32_t getport(char* const uri) {
-	size_t nchar;
-	char* current;
-	char* portstr;
-	uint32_t port;
-
-	if (!uri) return 0;
-	if (*uri != ':') return MC_DEFAULT_PORT;
-
-	current = advanceby(uri, ":");
-	nchar = strcspn(current, "/\0");
-	portstr = ms_copy_cstr(nchar, current);
-	port = atoi(portstr);
-	if (!port) port = MC_DEFAULT_PORT;
-
-	ms_free(portstr);
-	return port;
+uint32_t mc_uri_percent_encode(char* dest, const uint8_t* src, uint32_t nbytes) {
+#ifdef URI_SSE2
+	uint32_t ibyte = 0;
+	uint32_t nchars = 0;
+
+	while (ibyte + 16 <= nbytes) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(src + ibyte));
+		uint32_t mask = ~unreserved_mask(chunk) & 0xffff;
+		uint32_t run = mask ? lowest_bit(mask) : 16;
+
+		_mm_storeu_si128((__m128i*)(dest + nchars), chunk);
+		nchars += run;
+		ibyte += run;
+		if (mask) {
+			uint8_t c = src[ibyte++];
+			if (is_plain(c)) dest[nchars++] = (char)c;
+			else {
+				encode_byte(dest + nchars, c);
+				nchars += 3;
+			}
+		}
+	}
+
+	return nchars + mc_uri_percent_encode_scalar(dest + nchars, src + ibyte, nbytes - ibyte);
+#else
+	return mc_uri_percent_encode_scalar(dest, src, nbytes);
+#endif
 }
 
-/**
- * Advance to next character in chars, if *not* found advances
- * to end-of-string.
- * @return pointer to first found string character or end of string.
- */
-static char* advanceto(char* const str, char* const chars) {
-	size_t nbytes = strcspn(str, chars);
-	if (nbytes == 0) nbytes = strlen(str);
-	return str + nbytes;
+/** Byte at a time mc_uri_percent_encode(). */
+uint32_t mc_uri_percent_encode_scalar(char* dest, const uint8_t* src, uint32_t nbytes) {
+	uint32_t ibyte;
+	uint32_t nchars = 0;
+
+	for (ibyte = 0; ibyte < nbytes; ibyte++) {
+		if (is_plain(src[ibyte])) dest[nchars++] = (char)src[ibyte];
+		else {
+			encode_byte(dest + nchars, src[ibyte]);
+			nchars += 3;
+		}
+	}
+	return nchars;
+}
+
+/** Case insensitive match of a scheme slice. */
+static int scheme_is(const char* uri, uint32_t length, const char* scheme) {
+	uint32_t ichar;
+
+	if (strlen(scheme) != length) return 0;
+	for (ichar = 0; ichar < length; ichar++) {
+		if ((uri[ichar] | 0x20) != scheme[ichar]) return 0;
+	}
+	return 1;
 }
 
 /**
- * Estimate the number of path and query options needed by counting /, ?, and & characters.
- * @return the number of estimated options.
+ * Split a coap or coaps URI into slices of the caller's string in a single pass.
+ * Path segments and query arguments are counted but not copied or decoded.
+ * An IP v6 host slice excludes the []'s.
+ *
+ * Rejects URI's with fragments (RFC7252 6.4 Step 4), an empty host, or a bad port.
+ *
+ * @return 1 on success, 0 if the URI is malformed.
  */
-static uint32_t estimatenopts(char* const str) {
-	uint32_t nopts = 0;
-	char* pos = str;
+int mc_uri_parse(mc_uri_parts_t* const parts, const char* const uri) {
+	uint32_t pos = 0;
+	char c;
+
+	memset(parts, 0, sizeof(mc_uri_parts_t));
+	if (uri == 0) return 0;
+
+	/* scheme "://" */
+	while ((c = uri[pos]) != ':') {
+		if (c == 0 || c == '/' || c == '?' || c == '#') return 0;
+		pos++;
+	}
+	parts->scheme.length = pos;
+	if (scheme_is(uri, pos, "coaps")) parts->secure = 1;
+	else if (!scheme_is(uri, pos, "coap")) return 0;
+
+	if (uri[pos + 1] != '/' || uri[pos + 2] != '/') return 0;
+	pos += 3;
+
+	/* host, an IP v6 literal is between []'s. */
+	if (uri[pos] == '[') {
+		parts->ipv6 = 1;
+		parts->host.offset = ++pos;
+		while ((c = uri[pos]) != ']') {
+			if (c == 0) return 0;
+			pos++;
+		}
+		parts->host.length = pos - parts->host.offset;
+		pos++;
+	}
+	else {
+		parts->host.offset = pos;
+		while ((c = uri[pos]) && c != ':' && c != '/' && c != '?' && c != '#') pos++;
+		parts->host.length = pos - parts->host.offset;
+	}
+	if (parts->host.length == 0 || parts->host.length > MAX_HOST_LEN) return 0;
+
+	/* ":" port, an empty port means the default. */
+	parts->portnum = parts->secure ? MC_DEFAULT_SECURE_PORT : MC_DEFAULT_PORT;
+	if (uri[pos] == ':') {
+		uint32_t port = 0;
+
+		parts->port.offset = ++pos;
+		while ((c = uri[pos]) >= '0' && c <= '9') {
+			port = port * 10 + (uint32_t)(c - '0');
+			if (port > UINT16_MAX) return 0;
+			pos++;
+		}
+		parts->port.length = pos - parts->port.offset;
+		if (port) parts->portnum = (uint16_t)port;
+	}
+	if ((c = uri[pos]) && c != '/' && c != '?' && c != '#') return 0;
 
-	while (*pos) {
-		if ((*pos == '/') || (*pos == '?') || (*pos == '&'))
-			nopts++;
+	/* path, each / starts a segment. */
+	parts->path.offset = pos;
+	while ((c = uri[pos]) && c != '?' && c != '#') {
+		parts->npaths += (c == '/');
 		pos++;
 	}
-	return nopts;
+	parts->path.length = pos - parts->path.offset;
+
+	/* An empty path and "/" both mean no Uri-Path options (RFC7252 6.4 Step 8). */
+	if (parts->path.length == 1) parts->npaths = 0;
+
+	/* "?" query, arguments are separated by &'s. */
+	if (uri[pos] == '?') {
+		parts->query.offset = ++pos;
+		parts->nqueries = 1;
+		while ((c = uri[pos]) && c != '#') {
+			parts->nqueries += (c == '&');
+			pos++;
+		}
+		parts->query.length = pos - parts->query.offset;
+		if (parts->query.length == 0) parts->nqueries = 0;
+	}
+
+	return uri[pos] != '#';
 }
 
 /**
- * Get next path componenent.
- * Must begin with / and goes up until next /, ? or end of line.
- * @return path or 0 if no more.
+ * Copy the host slice into a null terminated stack buffer for the resolver.
+ * @return host.
  */
-static char* getpath(char* const uri) {
-	size_t nchar;
-	char* current;
-
-	if (!uri) return 0;
-	if (*uri != '/') return 0;
+static char* host_cstr(char* host, const mc_uri_parts_t* parts, const char* uri) {
+	memcpy(host, uri + parts->host.offset, parts->host.length);
+	host[parts->host.length] = 0;
 
-	current = advanceby(uri, "/");
-	nchar = strcspn(current, "/?");
-	return ms_copy_cstr(nchar, current);
+	return host;
 }
 
 /**
- * Get next query component.
- * Must begin with ? or & and goes up until next & or end of line.
- * @return path or 0 if no more.
+ * Percent-decode nchars of uri straight into the value of a new option.
+ * @return the option or 0 if an escape is malformed.
  */
-static char* getquery(char* const uri) {
-	size_t nchar;
-	char* current = (char*)uri;
-
-	if (!current) return 0;
-	if ((*current != '?') && (*current != '&')) return 0;
+static mc_option_t* decode_option(mc_option_t* option, uint16_t num, const char* uri, uint32_t nchars) {
+	uint8_t* bytes = nchars ? ms_calloc_tag(MS_MEM_URI, nchars, uint8_t) : 0;
+	int32_t nbytes = mc_uri_percent_decode(bytes, uri, nchars);
 
-	current++;
-	nchar = strcspn(current, "&");
-	return ms_copy_cstr(nchar, current);
+	if (nbytes < 0) {
+		ms_free(bytes);
+		return 0;
+	}
+	return mc_option_init(option, num, (uint32_t)nbytes, bytes);
 }
 
+/**
+ * Write one option per delimited segment of the slice [start, end) of uri.
+ * @return the number of options written or -1 on a decoding error.
+ */
+static int32_t segments_to_options(mc_option_t* options, uint32_t count, uint16_t num, const char* uri, uint32_t start, uint32_t end, char delim) {
+	uint32_t iseg;
 
+	for (iseg = 0; iseg < count; iseg++) {
+		const char* next = memchr(uri + start, delim, end - start);
+		uint32_t stop = next ? (uint32_t)(next - uri) : end;
 
-static int equaladdr(sockaddr_t* const left, sockaddr_t* const right) {
-	int result;
-
-    /* If both address are equal (including if 0) return true.
-	if (left == right) return 1;
+		if (!decode_option(&options[iseg], num, uri + start, stop - start)) return -1;
+		start = stop + 1;
+	}
+	return (int32_t)count;
+}
 
-	/* If one address is null and the other is not return false. */
-	if (left == 0) return 0;
-	if (right == 0) return 0;
+/**
+ * Write the host, port, path, and query options of a parsed URI.
+ * @return the number of options written or -1 on a decoding error.
+ */
+static int32_t parts_to_options(mc_option_t* options, const mc_uri_parts_t* parts, const char* uri, int elide) {
+	int32_t iopt = 0;
+	int32_t npaths;
+	int32_t nqueries;
 
-	/* Compare contents. */
-	if (left->sa_family != right->sa_family) return 0;
-	if (left->sa_family == AF_INET) {
-		result = (0 == memcmp(left, right, sizeof(struct sockaddr_in)));
-	}
-	else {
-		result = (0 == memcmp(left, right, sizeof(struct sockaddr_in6)));
+	if (!elide) {
+		if (!decode_option(&options[iopt], OPTION_URI_HOST, uri + parts->host.offset, parts->host.length)) return -1;
+		iopt++;
+		mc_option_init_uint32(&options[iopt], OPTION_URI_PORT, parts->portnum);
+		iopt++;
 	}
 
-	return result;
+	/* Skip the leading / of the path. */
+	npaths = segments_to_options(options + iopt, parts->npaths, OPTION_URI_PATH, uri,
+	                             parts->path.offset + 1, parts->path.offset + parts->path.length, '/');
+	if (npaths < 0) return -1;
+	iopt += npaths;
+
+	nqueries = segments_to_options(options + iopt, parts->nqueries, OPTION_URI_QUERY, uri,
+	                               parts->query.offset, parts->query.offset + parts->query.length, '&');
+	if (nqueries < 0) return -1;
+
+	return iopt + nqueries;
 }
 
 /**
- * Parse host, port, path, and query components from uri.
- * If destination host and/or port are in the URI they are elided
- * from the options list.
- *
- * @todo Does not reject URI's with fragments (RFC7252 6.4 Step 4).
- * @todo Does perform percent-decoding.
- *
- * Note: Host is elided if it matches desthost, RFC7252 says this only
- * happens if desthost is IP v6 or v4 literal. We rely on the caller
- * to only pass in the desthost string if it is an IP literal.
+ * Convert a URI to host, port, path, and query options (RFC7252 6.4).
+ * The URI is parsed in one pass with mc_uri_parse() and each option value is percent-decoded
+ * straight from the URI string, there are no intermediate strings.
+ * If the host is an IP literal matching dest the host and port are elided from the options
+ * list (RFC7252 6.4 step 5), host names are kept and never resolved.
  *
  * @return the corresponding options list or 0 on error.
  */
 mc_options_list_t* mc_uri_to_options(mc_options_list_t* const list, sockaddr_t* const dest, char* const uri) {
+	char host[MAX_HOST_LEN + 1];
+	mc_uri_parts_t parts;
 	mc_option_t* options;
 	sockaddr_t uriaddr;
-	char* host;
-	char* path;
-	char* query;
-	uint32_t port;
 	uint32_t nopts;
-	uint32_t iopt;
+	int32_t nwritten;
+	int elide = 0;
 
-	char* current = (char*)uri;
-	char* scheme = getscheme(current);
-	if (!validscheme(scheme)) {
-		if (scheme) ms_free(scheme);
-		return 0;
-	}
-	ms_free(scheme);
+	if (!mc_uri_parse(&parts, uri)) return 0;
 
-	current = advanceto(current, ":");
-	current = advanceby(current, "://");
-	if (!current) {
-		return 0;
+	/* Only an IP literal is ever elided, so names are not resolved here. */
+	if (dest) {
+		elide = mn_sockaddr_inet_literal(&uriaddr, host_cstr(host, &parts, uri), parts.portnum) != 0
+		        && mn_sockaddr_equal(&uriaddr, dest);
 	}
 
-	host = getaddress(current);
-	if (!host) {
-		return 0;
-	}
+	nopts = (elide ? 0 : 2) + parts.npaths + parts.nqueries;
+	options = mc_option_nalloc(nopts);
 
-	if (strlen(host) == 0) {
-		ms_free(host);
+	nwritten = parts_to_options(options, &parts, uri, elide);
+	if (nwritten < 0) {
+		ms_free(mc_option_ndeinit(options, nopts));
 		return 0;
 	}
 
-	/* Check and compensate for IP v6 []'s if needed. */
-	if (current && (*current == '[')) current += 2;
-
-	current += strlen(host);
-	port = getport(current);
-	current = advanceto(current, "/?");
+	return mc_options_list_init(list, (uint32_t)nwritten, options);
+}
 
-	/* Estimate the number of options needed based on remaining path, */
-	/* and if the destination matches the URI, then allocate the option array. */
-	/* Note the RFC only omits the host if it is an IP literal. */
-	nopts = estimatenopts(current);
-	mn_sockaddr_inet_init(&uriaddr, host, port);
-	if (!equaladdr(&uriaddr, dest)) {
-		nopts += 2;
-	}
-	options = ms_calloc(nopts, mc_option_t);
+/*
+ * Append each option with number num to dest, percent-encoded and preceded by first for the
+ * first one and by sep for the others.
+ * @return the new length or -1 if dest is too small.
+ */
+static int32_t append_segments(char* dest, uint32_t size, int32_t nchars, mc_options_list_t* list, uint16_t num, char first, char sep) {
+	uint32_t count;
+	uint32_t iopt;
+	mc_option_t* options = mc_options_list_get_all(list, num, &count);
 
-	/* Note does not properly account for IP literal requirement in section 6.4 step 5. */
-	iopt = 0;
-	if (!equaladdr(&uriaddr, dest)) {
-		mc_option_init_str(&options[iopt], OPTION_URI_HOST, host);
-		iopt++;
+	for (iopt = 0; iopt < count; iopt++) {
+		const mc_buffer_t* value = &options[iopt].value;
 
-		mc_option_init_uint32(&options[iopt], OPTION_URI_PORT, port);
-		iopt++;
+		/* Check for the worst case, every byte escaped, plus the separator and the null. */
+		if ((uint64_t)nchars + 2 + 3 * (uint64_t)value->nbytes > size) return -1;
+		dest[nchars++] = iopt == 0 ? first : sep;
+		nchars += (int32_t)mc_uri_percent_encode(dest + nchars, value->bytes, value->nbytes);
 	}
+	return nchars;
+}
 
-	path = getpath(current);
-	while (path) {
-		mc_option_init_str(&options[iopt], OPTION_URI_PATH, ms_copy_str(path));
-		iopt++;
-		current = advanceto(++current, "/?");
-		ms_free(path);
-		path = getpath(current);
-	}
+/**
+ * Rebuild the path and query of a request from its Uri-Path and Uri-Query options,
+ * e.g. for a Proxy-Uri or for logging, as a null terminated string in dest.
+ * @return the length of the string or -1 if it does not fit in size characters.
+ */
+int32_t mc_uri_format_path(char* dest, uint32_t size, mc_options_list_t* list) {
+	int32_t nchars = 0;
 
-	query = getquery(current);
-	while (query) {
-		mc_option_init_str(&options[iopt], OPTION_URI_QUERY, ms_copy_str(query));
-		iopt++;
-		current = advanceto(++current, "&");
-		ms_free(query);
-		query= getquery(current);
+	if (list) nchars = append_segments(dest, size, 0, list, OPTION_URI_PATH, '/', '/');
+	if (nchars == 0) {
+		if (size < 2) return -1;
+		dest[nchars++] = '/';
 	}
+	if (nchars > 0 && list) nchars = append_segments(dest, size, nchars, list, OPTION_URI_QUERY, '?', '&');
+	if (nchars < 0) return -1;
 
-	return mc_options_list_init(mc_options_list_alloc(), iopt, options);
+	dest[nchars] = 0;
+	return nchars;
 }
 
 /**
  * Initialize a socket address from a coap URI.
+ * Note this blocks while a host name is resolved, see mn_resolver_t.
  * @return a pointer to the address or 0 on failure.
  */
 sockaddr_t* mc_uri_to_address(sockaddr_t* const addr, char* const uri) {
-	sockaddr_t* result;
-	char* host;
-	uint32_t port;
-
-	/* Skip the scheme. */
-	char* current = advanceto(uri, ":");
-	current = advanceby(current, "://");
-	if (!current) {
-		return 0;
-	}
+	char host[MAX_HOST_LEN + 1];
+	mc_uri_parts_t parts;
 
-	host = getaddress(current);
-	if (!host) {
-		return 0;
-	}
-
-	if (strlen(host) == 0) {
-		ms_free(host);
-		return 0;
-	}
-
-	/* Check and compensate for IP v6 []'s if needed. */
-	if (current && (*current == '[')) current += 2;
+	if (!mc_uri_parse(&parts, uri)) return 0;
 
-	current += strlen(host);
-	port = getport(current);
-	if (port == 0) {
-		ms_free(host);
-		return 0;
-	}
-
-	result = mn_sockaddr_inet_init(addr, host, port);
-	ms_free(host);
-
-	return result;
+	return mn_sockaddr_inet_init(addr, host_cstr(host, &parts, uri), parts.portnum);
 }
 
-
 /** @} */
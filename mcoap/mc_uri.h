@@ -12,7 +12,36 @@
 #include "mcoap/mc_options_list.h"
 
 #define MC_DEFAULT_PORT 5683
+#define MC_DEFAULT_SECURE_PORT 5684
 
+/** A part of a URI string, as an offset and length into the caller's string. */
+typedef struct mc_uri_slice mc_uri_slice_t;
+struct mc_uri_slice {
+    uint32_t offset;
+    uint32_t length;
+};
+
+/** The components of a parsed coap URI, nothing is copied or decoded. */
+typedef struct mc_uri_parts mc_uri_parts_t;
+struct mc_uri_parts {
+    mc_uri_slice_t scheme;
+    mc_uri_slice_t host;    /**< Without the []'s of an IP v6 literal. */
+    mc_uri_slice_t port;    /**< Empty if the URI has no port. */
+    mc_uri_slice_t path;    /**< Including the leading /. */
+    mc_uri_slice_t query;   /**< Without the leading ?. */
+    uint32_t npaths;        /**< Number of Uri-Path options the path needs. */
+    uint32_t nqueries;      /**< Number of Uri-Query options the query needs. */
+    uint16_t portnum;       /**< The port, or the scheme's default port. */
+    uint8_t secure;         /**< 1 if the scheme is coaps. */
+    uint8_t ipv6;           /**< 1 if the host is an IP v6 literal. */
+};
+
+int mc_uri_parse(mc_uri_parts_t* const parts, const char* const uri);
+int32_t mc_uri_percent_decode(uint8_t* dest, const char* src, uint32_t nchars);
+int32_t mc_uri_percent_decode_scalar(uint8_t* dest, const char* src, uint32_t nchars);
+uint32_t mc_uri_percent_encode(char* dest, const uint8_t* src, uint32_t nbytes);
+uint32_t mc_uri_percent_encode_scalar(char* dest, const uint8_t* src, uint32_t nbytes);
+int32_t mc_uri_format_path(char* dest, uint32_t size, mc_options_list_t* list);
 mc_options_list_t* mc_uri_to_options(mc_options_list_t* const list, sockaddr_t* const dest, char* const uri);
 sockaddr_t* mc_uri_to_address(sockaddr_t* const addr, char* const uri);
 
@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @ingroup uri_cache
+ * @{
+ */
+
+#define MS_LOG_CATEGORY MS_LOG_MCOAP
+
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_log.h"
+#include "mnet/mn_sockaddr.h"
+#include "mcoap/mc_uri.h"
+#include "mcoap/mc_uri_cache.h"
+
+mc_uri_cache_t* mc_uri_cache_alloc() {
+    return ms_calloc(1, mc_uri_cache_t);
+}
+
+mc_uri_cache_t* mc_uri_cache_init(mc_uri_cache_t* cache, uint32_t capacity) {
+    cache->capacity = capacity;
+    cache->entries = ms_calloc_tag(MS_MEM_URI, capacity, mc_uri_cache_entry_t);
+    cache->tick = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+
+    return cache;
+}
+
+static mc_uri_cache_entry_t* entry_deinit(mc_uri_cache_entry_t* entry) {
+    if (entry->uri) ms_free(entry->uri);
+    if (entry->host) ms_free(entry->host);
+    mc_buffer_deinit(&entry->options);
+    memset(entry, 0, sizeof(mc_uri_cache_entry_t));
+
+    return entry;
+}
+
+mc_uri_cache_t* mc_uri_cache_deinit(mc_uri_cache_t* cache) {
+    uint32_t ientry;
+
+    for (ientry = 0; ientry < cache->capacity; ientry++) {
+        entry_deinit(&cache->entries[ientry]);
+    }
+    ms_free(cache->entries);
+    cache->entries = 0;
+    cache->capacity = 0;
+
+    return cache;
+}
+
+/* FNV-1a hash of a C string. */
+static uint64_t hash_uri(const char* uri) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    while (*uri) {
+        hash = (hash ^ (uint8_t)*uri) * 1099511628211ULL;
+        uri++;
+    }
+    return hash;
+}
+
+static int entry_matches(const mc_uri_cache_entry_t* entry, uint64_t hash, sockaddr_t* const dest, const char* uri) {
+    if (entry->uri == 0 || entry->hash != hash) return 0;
+    if (entry->hasdest != (dest != 0)) return 0;
+    if (dest && !mn_sockaddr_equal(&entry->dest, dest)) return 0;
+
+    return strcmp(entry->uri, uri) == 0;
+}
+
+/**
+ * Fill an entry from the URI. Without a destination the URI's own address (for an IP literal)
+ * is used to decide if the host and port options are elided.
+ * @return the entry or 0 if the URI can not be converted.
+ */
+static mc_uri_cache_entry_t* entry_init(mc_uri_cache_entry_t* entry, uint64_t hash, sockaddr_t* const dest, char* const uri) {
+    mc_options_list_t list;
+    mc_uri_parts_t parts;
+    uint32_t bpos = 0;
+    uint32_t nbytes;
+
+    memset(&list, 0, sizeof(list));
+    if (!mc_uri_parse(&parts, uri)) return 0;
+
+    entry->host = ms_mem_retag(ms_copy_cstr(parts.host.length, uri + parts.host.offset), MS_MEM_URI);
+    entry->port = parts.portnum;
+    entry->resolved = mn_sockaddr_inet_literal(&entry->addr, entry->host, entry->port) != 0;
+    entry->hasdest = dest != 0;
+    if (dest) entry->dest = *dest;
+
+    if (mc_uri_to_options(&list, dest ? dest : (entry->resolved ? &entry->addr : 0), uri) == 0) return 0;
+
+    nbytes = mc_options_list_buffer_size(&list);
+    mc_buffer_init(&entry->options, nbytes, nbytes ? ms_calloc_tag(MS_MEM_URI, nbytes, uint8_t) : 0);
+    mc_options_list_to_buffer(&list, &entry->options, &bpos);
+    entry->lastnum = list.noptions ? list.options[list.noptions - 1].option_num : 0;
+    mc_options_list_deinit(&list);
+
+    entry->uri = ms_mem_retag(ms_copy_str(uri), MS_MEM_URI);
+    entry->hash = hash;
+
+    return entry;
+}
+
+/**
+ * Find the entry for (uri, dest), converting the URI and evicting the least recently used
+ * entry on a miss. dest may be 0, in which case the URI's host is the destination.
+ * The entry is owned by the cache and valid until the next call.
+ * @return the entry or 0 if the URI is not valid.
+ */
+const mc_uri_cache_entry_t* mc_uri_cache_get(mc_uri_cache_t* cache, sockaddr_t* const dest, char* const uri) {
+    uint64_t hash;
+    uint32_t ientry;
+    mc_uri_cache_entry_t* victim;
+
+    if (uri == 0 || cache->capacity == 0) return 0;
+
+    hash = hash_uri(uri);
+    victim = &cache->entries[0];
+    cache->tick++;
+
+    for (ientry = 0; ientry < cache->capacity; ientry++) {
+        mc_uri_cache_entry_t* entry = &cache->entries[ientry];
+
+        if (entry_matches(entry, hash, dest, uri)) {
+            entry->used = cache->tick;
+            cache->hits++;
+            return entry;
+        }
+        if (entry->used < victim->used) victim = entry;
+    }
+
+    cache->misses++;
+    entry_deinit(victim);
+    if (entry_init(victim, hash, dest, uri) == 0) {
+        ms_log_debug("Unable to convert uri to options: %s", uri);
+        entry_deinit(victim);
+        return 0;
+    }
+    victim->used = cache->tick;
+
+    return victim;
+}
+
+/** @} */
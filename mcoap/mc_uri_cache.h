@@ -0,0 +1,55 @@
+#ifndef MC_URI_CACHE_H
+#define MC_URI_CACHE_H
+
+/**
+ * @file
+ * @defgroup uri_cache CoAP URI Cache
+ * @{
+ * Bounded LRU cache of URI to option conversions.
+ * Clients usually send to a small fixed set of URIs, so the cache keeps, per (URI, destination),
+ * the URI's host and port, its address if the host is an IP literal, and the URI options
+ * already encoded in wire format. A hit skips parsing, option building, and option encoding.
+ * Host names are never resolved here, the endpoint uses its resolver for them.
+ *
+ * The cache is small and scanned linearly, the stored hash makes mismatches cheap.
+ */
+
+#include "msys/ms_config.h"
+#include "mnet/mn_socket.h"
+#include "mcoap/mc_buffer.h"
+
+/** Default number of entries per endpoint. */
+#define MC_URI_CACHE_SIZE 16
+
+typedef struct mc_uri_cache_entry mc_uri_cache_entry_t;
+struct mc_uri_cache_entry {
+    char* uri;                  /**< Copy of the URI, 0 if the entry is unused. */
+    uint64_t hash;              /**< Hash of the URI. */
+    uint64_t used;              /**< Cache tick of the last use, for LRU eviction. */
+    int hasdest;                /**< 0 if the entry was created without a destination. */
+    sockaddr_t dest;            /**< Destination the options were built for. */
+    char* host;                 /**< The URI host, without []'s. */
+    uint16_t port;              /**< The URI port. */
+    sockaddr_t addr;            /**< Address of the URI host if it is an IP literal. */
+    int resolved;               /**< 1 if addr is valid. */
+    mc_buffer_t options;        /**< URI options in wire format. */
+    uint16_t lastnum;           /**< Number of the last encoded option, 0 if none. */
+};
+
+typedef struct mc_uri_cache mc_uri_cache_t;
+struct mc_uri_cache {
+    uint32_t capacity;
+    mc_uri_cache_entry_t* entries;
+    uint64_t tick;
+    uint32_t hits;
+    uint32_t misses;
+};
+
+mc_uri_cache_t* mc_uri_cache_alloc();
+mc_uri_cache_t* mc_uri_cache_init(mc_uri_cache_t* cache, uint32_t capacity);
+mc_uri_cache_t* mc_uri_cache_deinit(mc_uri_cache_t* cache);
+const mc_uri_cache_entry_t* mc_uri_cache_get(mc_uri_cache_t* cache, sockaddr_t* const dest, char* const uri);
+
+/** @} */
+
+#endif
@@ -11,6 +11,8 @@ const char *mn_error(int err) {
         case MN_CLOSED: return "closed";
         case MN_DONE: return "done";
         case MN_TIMEOUT: return "timeout";
+        case MN_PENDING: return "pending";
+        case MN_NOHOST: return "host not found";
         default: return "unknown"; 
     }
 }
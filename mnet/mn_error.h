@@ -14,7 +14,9 @@ enum {
     MN_DONE = 0,        /* operation completed successfully */
     MN_TIMEOUT = -1,    /* operation timed out */
     MN_CLOSED = -2,     /* the connection has been closed */
-    MN_UNKNOWN = -3
+    MN_UNKNOWN = -3,
+    MN_PENDING = -4,    /* operation queued, e.g. waiting for the resolver */
+    MN_NOHOST = -5      /* the host name could not be resolved */
 };
 
 const char *mn_error(int err);
@@ -0,0 +1,289 @@
+/**
+ * @file
+ * @ingroup peer_table
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mnet/mn_peer_table.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+mn_peer_table_t* mn_peer_table_alloc() {
+    return ms_calloc(1, mn_peer_table_t);
+}
+
+/**
+ * Initialize a table holding up to capacity peers (clamped to 1..MN_PEER_MAX).
+ * All memory is allocated here, interning never allocates.
+ * @return the table or 0 if allocation fails.
+ */
+mn_peer_table_t* mn_peer_table_init(mn_peer_table_t* table, uint32_t capacity) {
+    if (capacity == 0) capacity = 1;
+    if (capacity > MN_PEER_MAX) capacity = MN_PEER_MAX;
+
+    table->capacity = capacity;
+    table->count = 0;
+    table->nbuckets = 1;
+    while (table->nbuckets < capacity) table->nbuckets <<= 1;
+    table->newest = 0;
+    table->oldest = 0;
+    table->evictions = 0;
+    table->peers = ms_calloc_tag(MS_MEM_SOCKADDR, capacity, mn_peer_t);
+    table->buckets = ms_calloc_tag(MS_MEM_SOCKADDR, table->nbuckets, uint32_t);
+
+    if (table->peers == 0 || table->buckets == 0) {
+        mn_peer_table_deinit(table);
+        return 0;
+    }
+    return table;
+}
+
+mn_peer_table_t* mn_peer_table_deinit(mn_peer_table_t* table) {
+    ms_free(table->peers);
+    ms_free(table->buckets);
+    table->peers = 0;
+    table->buckets = 0;
+    table->capacity = 0;
+    table->count = 0;
+    table->newest = 0;
+    table->oldest = 0;
+
+    return table;
+}
+
+/**
+ * Build the compact key for an address.
+ * @return 1 for IPv4 and IPv6 addresses, 0 for any other family.
+ */
+static int key_init(mn_peer_key_t* key, const sockaddr_t* addr) {
+    memset(key, 0, sizeof(mn_peer_key_t));
+    key->family = (uint16_t)addr->ss_family;
+
+    if (addr->ss_family == AF_INET) {
+        const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+        memcpy(key->addr, &in->sin_addr, sizeof(in->sin_addr));
+        key->port = in->sin_port;
+        return 1;
+    }
+    if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)addr;
+        memcpy(key->addr, &in6->sin6_addr, sizeof(in6->sin6_addr));
+        key->port = in6->sin6_port;
+        key->scope = in6->sin6_scope_id;
+        return 1;
+    }
+    return 0;
+}
+
+/* FNV-1a over the key bytes. */
+static uint32_t key_hash(const mn_peer_key_t* key) {
+    const uint8_t* bytes = (const uint8_t*)key;
+    uint32_t hash = FNV_OFFSET;
+    size_t ibyte;
+
+    for (ibyte = 0; ibyte < sizeof(mn_peer_key_t); ibyte++) {
+        hash ^= bytes[ibyte];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static mn_peer_id_t mk_id(const mn_peer_table_t* table, uint32_t slot) {
+    return ((mn_peer_id_t)table->peers[slot].generation << MN_PEER_INDEX_BITS) | slot;
+}
+
+/**
+ * Find the slot holding key.
+ * @return the slot + 1 or 0 if the key is not in the table.
+ */
+static uint32_t find_slot(const mn_peer_table_t* table, const mn_peer_key_t* key, uint32_t hash) {
+    uint32_t next = table->buckets[hash & (table->nbuckets - 1)];
+
+    while (next) {
+        const mn_peer_t* peer = &table->peers[next - 1];
+        if (peer->hash == hash && memcmp(&peer->key, key, sizeof(mn_peer_key_t)) == 0) return next;
+        next = peer->chain;
+    }
+    return 0;
+}
+
+static void bucket_remove(mn_peer_table_t* table, uint32_t slot) {
+    uint32_t* link = &table->buckets[table->peers[slot].hash & (table->nbuckets - 1)];
+
+    while (*link && *link != slot + 1) link = &table->peers[*link - 1].chain;
+    if (*link) *link = table->peers[slot].chain;
+    table->peers[slot].chain = 0;
+}
+
+static void lru_remove(mn_peer_table_t* table, uint32_t slot) {
+    mn_peer_t* peer = &table->peers[slot];
+
+    if (peer->newer) table->peers[peer->newer - 1].older = peer->older;
+    else table->newest = peer->older;
+
+    if (peer->older) table->peers[peer->older - 1].newer = peer->newer;
+    else table->oldest = peer->newer;
+
+    peer->newer = 0;
+    peer->older = 0;
+}
+
+static void lru_push(mn_peer_table_t* table, uint32_t slot) {
+    mn_peer_t* peer = &table->peers[slot];
+
+    peer->newer = 0;
+    peer->older = table->newest;
+    if (table->newest) table->peers[table->newest - 1].newer = slot + 1;
+    table->newest = slot + 1;
+    if (table->oldest == 0) table->oldest = slot + 1;
+}
+
+/**
+ * Claim a slot for a new peer, reclaiming the least recently interned unpinned one if the
+ * table is full. The slot's generation is bumped so ids of the previous occupant are no longer live.
+ * @return the slot or capacity if every peer is pinned.
+ */
+static uint32_t claim_slot(mn_peer_table_t* table) {
+    uint32_t slot;
+
+    if (table->count < table->capacity) {
+        slot = table->count++;
+    }
+    else {
+        uint32_t nchecked;
+
+        /* A pinned peer is in use, move it to the newest end so it is not checked each time. */
+        for (nchecked = 0; table->peers[table->oldest - 1].pins; nchecked++) {
+            if (nchecked == table->count) return table->capacity;
+            slot = table->oldest - 1;
+            lru_remove(table, slot);
+            lru_push(table, slot);
+        }
+
+        slot = table->oldest - 1;
+        bucket_remove(table, slot);
+        lru_remove(table, slot);
+        table->evictions++;
+    }
+
+    /* Generation 0 is reserved so MN_PEER_NONE is never a valid id. */
+    table->peers[slot].generation = (uint8_t)(table->peers[slot].generation == UINT8_MAX ? 1 : table->peers[slot].generation + 1);
+    table->peers[slot].used = 1;
+
+    return slot;
+}
+
+/**
+ * Return the id for an address, adding it to the table if it is new.
+ * The peer becomes the most recently used.
+ * @return the peer id or MN_PEER_NONE if the address is not IPv4 or IPv6 or every peer is pinned.
+ */
+mn_peer_id_t mn_peer_table_intern(mn_peer_table_t* table, const sockaddr_t* addr) {
+    mn_peer_key_t key;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t found;
+    uint32_t* bucket;
+
+    if (!key_init(&key, addr)) return MN_PEER_NONE;
+    hash = key_hash(&key);
+
+    found = find_slot(table, &key, hash);
+    if (found) {
+        slot = found - 1;
+        if (table->newest != found) {
+            lru_remove(table, slot);
+            lru_push(table, slot);
+        }
+        return mk_id(table, slot);
+    }
+
+    slot = claim_slot(table);
+    if (slot == table->capacity) return MN_PEER_NONE;
+    table->peers[slot].key = key;
+    table->peers[slot].hash = hash;
+    table->peers[slot].flowinfo = addr->ss_family == AF_INET6 ? ((const struct sockaddr_in6*)addr)->sin6_flowinfo : 0;
+
+    bucket = &table->buckets[hash & (table->nbuckets - 1)];
+    table->peers[slot].chain = *bucket;
+    *bucket = slot + 1;
+    lru_push(table, slot);
+
+    return mk_id(table, slot);
+}
+
+/**
+ * Return the id for an address without adding it or changing its LRU position.
+ * @return the peer id or MN_PEER_NONE if the address has not been interned.
+ */
+mn_peer_id_t mn_peer_table_find(const mn_peer_table_t* table, const sockaddr_t* addr) {
+    mn_peer_key_t key;
+    uint32_t found;
+
+    if (!key_init(&key, addr)) return MN_PEER_NONE;
+
+    found = find_slot(table, &key, key_hash(&key));
+    return found ? mk_id(table, found - 1) : MN_PEER_NONE;
+}
+
+/**
+ * Check that an id still names the peer it was issued for, i.e. its slot has not been reclaimed.
+ * @return 1 if the id is live, 0 otherwise.
+ */
+int mn_peer_table_is_live(const mn_peer_table_t* table, mn_peer_id_t id) {
+    uint32_t slot = MN_PEER_INDEX(id);
+
+    if (id == MN_PEER_NONE || slot >= table->count) return 0;
+    return table->peers[slot].used && table->peers[slot].generation == MN_PEER_GENERATION(id);
+}
+
+/**
+ * Keep a live peer from being reclaimed until as many mn_peer_table_unpin() calls.
+ * @return 1 if pinned, 0 if the id is not live.
+ */
+int mn_peer_table_pin(mn_peer_table_t* table, mn_peer_id_t id) {
+    if (!mn_peer_table_is_live(table, id)) return 0;
+    table->peers[MN_PEER_INDEX(id)].pins++;
+    return 1;
+}
+
+/** Release a pin taken with mn_peer_table_pin(), ids that are not live are ignored. */
+void mn_peer_table_unpin(mn_peer_table_t* table, mn_peer_id_t id) {
+    if (mn_peer_table_is_live(table, id) && table->peers[MN_PEER_INDEX(id)].pins > 0) {
+        table->peers[MN_PEER_INDEX(id)].pins--;
+    }
+}
+
+/**
+ * Rebuild the socket address of a live peer.
+ * @return addr or 0 if the id is not live.
+ */
+sockaddr_t* mn_peer_table_address(const mn_peer_table_t* table, mn_peer_id_t id, sockaddr_t* addr) {
+    const mn_peer_key_t* key;
+
+    if (!mn_peer_table_is_live(table, id)) return 0;
+    key = &table->peers[MN_PEER_INDEX(id)].key;
+
+    memset(addr, 0, sizeof(sockaddr_t));
+    if (key->family == AF_INET) {
+        struct sockaddr_in* in = (struct sockaddr_in*)addr;
+        in->sin_family = AF_INET;
+        in->sin_port = key->port;
+        memcpy(&in->sin_addr, key->addr, sizeof(in->sin_addr));
+    }
+    else {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)addr;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = key->port;
+        in6->sin6_scope_id = key->scope;
+        in6->sin6_flowinfo = table->peers[MN_PEER_INDEX(id)].flowinfo;
+        memcpy(&in6->sin6_addr, key->addr, sizeof(in6->sin6_addr));
+    }
+    return addr;
+}
+
+/** @} */
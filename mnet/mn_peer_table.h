@@ -0,0 +1,87 @@
+#ifndef MN_PEER_TABLE_H
+#define MN_PEER_TABLE_H
+
+/**
+ * @file
+ * @defgroup peer_table Peer Address Interning
+ * @{
+ * Map socket addresses to small dense peer ids.
+ *
+ * Each distinct address interned gets a slot in a fixed size table and an id made of the
+ * slot index and a generation tag. Per peer state can then live in arrays indexed by
+ * MN_PEER_INDEX(id) and be keyed on 32 bit ids instead of full addresses. When the table
+ * is full the least recently interned peer is reclaimed and its slot's generation is
+ * bumped, so stale ids held elsewhere stop matching (see mn_peer_table_is_live()).
+ *
+ * The generation is only 8 bits and wraps after 255 reclaims of a slot, so an id kept
+ * across evictions must be pinned with mn_peer_table_pin(). A pinned peer is never
+ * reclaimed, e.g. while a message to it waits in a confirm queue, and interning fails
+ * if every peer is pinned.
+ *
+ * Addresses are stored as a compact 24 byte key (family, port, up to 16 address bytes and
+ * the IPv6 scope id), so memory is bounded by the capacity given at init, about 52 bytes per
+ * peer plus 4 bytes per hash bucket. The scope id is part of the key because the same
+ * link-local address on two interfaces is two peers.
+ */
+
+#include "msys/ms_config.h"
+#include "mnet/mn_socket.h"
+
+#define MN_PEER_INDEX_BITS  24                                  /**< Slot index bits in an id. */
+#define MN_PEER_INDEX_MASK  ((1u << MN_PEER_INDEX_BITS) - 1)
+#define MN_PEER_MAX         MN_PEER_INDEX_MASK                  /**< Largest table capacity. */
+#define MN_PEER_NONE        0                                   /**< Never a valid peer id. */
+
+/** Slot index of a peer id, for indexing per peer arrays. */
+#define MN_PEER_INDEX(id)       ((id) & MN_PEER_INDEX_MASK)
+/** Generation tag of a peer id, never 0 for a valid id. */
+#define MN_PEER_GENERATION(id)  ((id) >> MN_PEER_INDEX_BITS)
+
+typedef uint32_t mn_peer_id_t;
+
+typedef struct mn_peer_key mn_peer_key_t;
+struct mn_peer_key {
+    uint8_t addr[16];       /**< IPv4 addresses use the first 4 bytes. */
+    uint16_t port;          /**< Network byte order. */
+    uint16_t family;
+    uint32_t scope;         /**< IPv6 scope id, 0 for IPv4. */
+};
+
+typedef struct mn_peer mn_peer_t;
+struct mn_peer {
+    mn_peer_key_t key;
+    uint32_t hash;
+    uint32_t chain;         /**< Next slot + 1 in the bucket, 0 ends the chain. */
+    uint32_t newer;         /**< LRU neighbours as slot + 1, 0 for none. */
+    uint32_t older;
+    uint32_t pins;          /**< Holders of the id, the slot is not reclaimed while non zero. */
+    uint32_t flowinfo;      /**< IPv6 flow info of the address first interned, not part of the key. */
+    uint8_t generation;     /**< 0 if the slot has never been used. */
+    uint8_t used;
+};
+
+typedef struct mn_peer_table mn_peer_table_t;
+struct mn_peer_table {
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t nbuckets;      /**< A power of 2. */
+    uint32_t* buckets;      /**< First slot + 1 in each bucket, 0 if empty. */
+    uint32_t newest;        /**< LRU ends as slot + 1. */
+    uint32_t oldest;
+    uint32_t evictions;
+    mn_peer_t* peers;
+};
+
+mn_peer_table_t* mn_peer_table_alloc();
+mn_peer_table_t* mn_peer_table_init(mn_peer_table_t* table, uint32_t capacity);
+mn_peer_table_t* mn_peer_table_deinit(mn_peer_table_t* table);
+mn_peer_id_t mn_peer_table_intern(mn_peer_table_t* table, const sockaddr_t* addr);
+mn_peer_id_t mn_peer_table_find(const mn_peer_table_t* table, const sockaddr_t* addr);
+int mn_peer_table_is_live(const mn_peer_table_t* table, mn_peer_id_t id);
+int mn_peer_table_pin(mn_peer_table_t* table, mn_peer_id_t id);
+void mn_peer_table_unpin(mn_peer_table_t* table, mn_peer_id_t id);
+sockaddr_t* mn_peer_table_address(const mn_peer_table_t* table, mn_peer_id_t id, sockaddr_t* addr);
+
+/** @} */
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * @ingroup resolver
+ * @{
+ */
+
+#define MS_LOG_CATEGORY MS_LOG_MNET
+
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_log.h"
+#include "mnet/mn_sockaddr.h"
+#include "mnet/mn_timeout.h"
+#include "mnet/mn_resolver.h"
+
+mn_resolver_t* mn_resolver_alloc() {
+    return ms_calloc(1, mn_resolver_t);
+}
+
+/* Find a queued name for the worker, called with the mutex held. */
+static mn_resolver_entry_t* next_queued(mn_resolver_t* resolver) {
+    uint32_t ientry;
+
+    for (ientry = 0; ientry < resolver->capacity; ientry++) {
+        mn_resolver_entry_t* entry = &resolver->entries[ientry];
+        if (entry->host[0] && entry->status == MN_PENDING && !entry->inprogress) return entry;
+    }
+    return 0;
+}
+
+/* Blocking lookup of the first IPv4 and IPv6 addresses, done by the worker without the mutex held. */
+static int resolve(const char* host, mn_resolver_entry_t* result) {
+    struct addrinfo hints;
+    struct addrinfo* info = 0;
+    struct addrinfo* next;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, 0, &hints, &info) != 0 || info == 0) return MN_NOHOST;
+
+    for (next = info; next; next = next->ai_next) {
+        if (next->ai_family == AF_INET && !result->has4) {
+            result->addr = ((struct sockaddr_in*)next->ai_addr)->sin_addr;
+            result->has4 = 1;
+        }
+        else if (next->ai_family == AF_INET6 && !result->has6) {
+            result->addr6 = ((struct sockaddr_in6*)next->ai_addr)->sin6_addr;
+            result->has6 = 1;
+        }
+    }
+    freeaddrinfo(info);
+
+    return result->has4 || result->has6 ? MN_DONE : MN_NOHOST;
+}
+
+/** Worker thread, resolves queued names one at a time until the resolver is deinitialized. */
+static void resolver_worker(void* data) {
+    mn_resolver_t* resolver = (mn_resolver_t*)data;
+    char host[MN_RESOLVER_HOST_MAX + 1];
+    mn_resolver_entry_t resolved;
+    mn_resolver_entry_t* entry;
+    int status;
+
+    ms_mutex_lock(resolver->mutex);
+    while (resolver->running) {
+        entry = next_queued(resolver);
+        if (entry == 0) {
+            ms_cond_wait(resolver->cond, resolver->mutex);
+            continue;
+        }
+
+        entry->inprogress = 1;
+        strcpy(host, entry->host);
+        ms_mutex_unlock(resolver->mutex);
+
+        memset(&resolved, 0, sizeof(resolved));
+        status = resolve(host, &resolved);
+
+        ms_mutex_lock(resolver->mutex);
+        entry->inprogress = 0;
+
+        /* The entry may have been evicted and reused while we were resolving. */
+        if (strcmp(entry->host, host) != 0) continue;
+
+        entry->status = status;
+        if (status == MN_DONE) {
+            entry->addr = resolved.addr;
+            entry->addr6 = resolved.addr6;
+            entry->has4 = resolved.has4;
+            entry->has6 = resolved.has6;
+            entry->valid = 1;
+            entry->expires = mn_gettime() + resolver->ttl;
+        }
+        else {
+            ms_log_debug("Unable to resolve %s", host);
+            entry->valid = 0;
+            entry->expires = mn_gettime() + MN_RESOLVER_NEG_TTL;
+        }
+    }
+    ms_mutex_unlock(resolver->mutex);
+}
+
+/**
+ * Initialize the cache and start the worker thread.
+ * @return the resolver.
+ */
+mn_resolver_t* mn_resolver_init(mn_resolver_t* resolver, uint32_t capacity, double ttl) {
+    resolver->capacity = capacity;
+    resolver->entries = ms_calloc_tag(MS_MEM_SOCKADDR, capacity, mn_resolver_entry_t);
+    resolver->ttl = ttl;
+    resolver->running = 1;
+    resolver->mutex = ms_mutex_init(ms_mutex_alloc());
+    resolver->cond = ms_cond_init(ms_cond_alloc());
+    resolver->thread = ms_thread_init(ms_thread_alloc(), resolver_worker, resolver);
+
+    return resolver;
+}
+
+/**
+ * Stop the worker and free the cache.
+ * Waits for a lookup in progress to finish.
+ */
+mn_resolver_t* mn_resolver_deinit(mn_resolver_t* resolver) {
+    ms_mutex_lock(resolver->mutex);
+    resolver->running = 0;
+    ms_cond_broadcast(resolver->cond);
+    ms_mutex_unlock(resolver->mutex);
+
+    ms_free(ms_thread_deinit(resolver->thread));
+    ms_free(ms_cond_deinit(resolver->cond));
+    ms_free(ms_mutex_deinit(resolver->mutex));
+    ms_free(resolver->entries);
+    resolver->entries = 0;
+    resolver->capacity = 0;
+
+    return resolver;
+}
+
+/* Find the entry for host or claim the least recently used one, called with the mutex held. */
+static mn_resolver_entry_t* find_entry(mn_resolver_t* resolver, const char* host, int* found) {
+    mn_resolver_entry_t* victim = &resolver->entries[0];
+    uint32_t ientry;
+
+    for (ientry = 0; ientry < resolver->capacity; ientry++) {
+        mn_resolver_entry_t* entry = &resolver->entries[ientry];
+
+        if (strcmp(entry->host, host) == 0) {
+            *found = 1;
+            return entry;
+        }
+        if (entry->used < victim->used) victim = entry;
+    }
+
+    *found = 0;
+    memset(victim, 0, sizeof(mn_resolver_entry_t));
+    strcpy(victim->host, host);
+    victim->status = MN_PENDING;
+    return victim;
+}
+
+/**
+ * Set addr to the entry's address a socket of the family can reach.
+ * @return addr or 0 if the name has no such address.
+ */
+static sockaddr_t* set_addr(sockaddr_t* addr, const mn_resolver_entry_t* entry, unsigned short port, int family) {
+    memset(addr, 0, sizeof(sockaddr_t));
+
+    if (entry->has6 && (family == AF_INET6 || (family == AF_UNSPEC && !entry->has4))) {
+        struct sockaddr_in6* sin6 = (struct sockaddr_in6*)addr;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_addr = entry->addr6;
+        sin6->sin6_port = htons(port);
+        return addr;
+    }
+    if (entry->has4) {
+        struct sockaddr_in* sin = (struct sockaddr_in*)addr;
+        sin->sin_family = AF_INET;
+        sin->sin_addr = entry->addr;
+        sin->sin_port = htons(port);
+        return mn_sockaddr_to_family(addr, family);
+    }
+    return 0;
+}
+
+/**
+ * Look up a host without blocking, for a socket of the family (AF_INET, AF_INET6 or AF_UNSPEC for either).
+ * @return MN_DONE with addr set, MN_PENDING if the name is being resolved (try again later),
+ * or MN_NOHOST if the name recently failed to resolve or has no address of the family.
+ */
+int mn_resolver_lookup(mn_resolver_t* resolver, const char* host, unsigned short port, int family, sockaddr_t* addr) {
+    mn_resolver_entry_t* entry;
+    double now;
+    int found;
+    int result;
+
+    if (host == 0 || host[0] == 0 || strlen(host) > MN_RESOLVER_HOST_MAX) return MN_NOHOST;
+    if (mn_sockaddr_inet_literal(addr, host, port)) return mn_sockaddr_to_family(addr, family) ? MN_DONE : MN_NOHOST;
+    if (resolver->capacity == 0) return MN_NOHOST;
+
+    now = mn_gettime();
+    ms_mutex_lock(resolver->mutex);
+
+    entry = find_entry(resolver, host, &found);
+    entry->used = now;
+
+    /* Queue new names and refresh expired ones, an expired address is still served meanwhile. */
+    if (!found || (entry->status != MN_PENDING && entry->expires <= now)) {
+        entry->status = MN_PENDING;
+        ms_cond_signal(resolver->cond);
+    }
+
+    if (entry->valid) {
+        result = set_addr(addr, entry, port, family) ? MN_DONE : MN_NOHOST;
+    }
+    else {
+        result = entry->status;
+    }
+
+    ms_mutex_unlock(resolver->mutex);
+    return result;
+}
+
+/** @} */
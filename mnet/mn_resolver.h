@@ -0,0 +1,67 @@
+#ifndef MN_RESOLVER_H
+#define MN_RESOLVER_H
+
+/**
+ * @file
+ * @defgroup resolver Asynchronous Host Name Resolver
+ * @{
+ * Non-blocking host name resolution with a TTL cache.
+ *
+ * mn_resolver_lookup() never blocks on the network: IP literals are converted directly, cached
+ * names are returned from the cache, and unknown names are queued for a worker thread that
+ * calls getaddrinfo() and returns MN_PENDING. Callers poll again later (e.g. from their
+ * queue check). getaddrinfo() does not report DNS TTLs, so entries live for a fixed ttl;
+ * an expired name keeps being served while the worker refreshes it. Failures are cached
+ * for a shorter negative ttl.
+ *
+ * Names resolve to both IPv4 and IPv6 addresses, a lookup picks the one a socket of the given
+ * family can reach: an IPv6 socket prefers IPv6 and reaches IPv4 hosts through IPv4-mapped
+ * addresses, an IPv4 socket only takes IPv4.
+ *
+ * All entry access is under the resolver mutex, so one resolver may be shared by threads.
+ */
+
+#include "msys/ms_config.h"
+#include "msys/ms_cond.h"
+#include "msys/ms_mutex.h"
+#include "msys/ms_thread.h"
+#include "mnet/mn_socket.h"
+
+#define MN_RESOLVER_SIZE     64      /**< Default number of cached names. */
+#define MN_RESOLVER_TTL      300.0   /**< Default seconds a resolved name is cached. */
+#define MN_RESOLVER_NEG_TTL  10.0    /**< Seconds a failed name is cached. */
+#define MN_RESOLVER_HOST_MAX 255     /**< Longest host name. */
+
+typedef struct mn_resolver_entry mn_resolver_entry_t;
+struct mn_resolver_entry {
+    char host[MN_RESOLVER_HOST_MAX + 1];    /**< Empty if the entry is unused. */
+    struct in_addr addr;
+    struct in6_addr addr6;
+    int has4;                               /**< 1 if the name has an IPv4 address in addr. */
+    int has6;                               /**< 1 if the name has an IPv6 address in addr6. */
+    int valid;                              /**< 1 if the name resolved to at least one address. */
+    int status;                             /**< MN_DONE, MN_PENDING (queued or in progress), or MN_NOHOST. */
+    int inprogress;                         /**< 1 while the worker is resolving the name. */
+    double expires;
+    double used;
+};
+
+typedef struct mn_resolver mn_resolver_t;
+struct mn_resolver {
+    ms_mutex_t* mutex;
+    ms_cond_t* cond;
+    ms_thread_t* thread;
+    int running;
+    double ttl;
+    uint32_t capacity;
+    mn_resolver_entry_t* entries;
+};
+
+mn_resolver_t* mn_resolver_alloc();
+mn_resolver_t* mn_resolver_init(mn_resolver_t* resolver, uint32_t capacity, double ttl);
+mn_resolver_t* mn_resolver_deinit(mn_resolver_t* resolver);
+int mn_resolver_lookup(mn_resolver_t* resolver, const char* host, unsigned short port, int family, sockaddr_t* addr);
+
+/** @} */
+
+#endif
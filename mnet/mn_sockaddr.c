@@ -13,27 +13,25 @@
 /**
  * Convert a host name to an in_addr structure.
  * First assume its an IPv4 decimal dotted address, if not
- * try looking it up by name.
+ * try looking it up by name. The lookup blocks, see mn_resolver_t for a non-blocking one.
  * @return MN_DONE on success.
  */
 static int host2addr(struct in_addr* addr, const char* hostname) {
-    int err;
-    int success;
+    struct addrinfo hints;
+    struct addrinfo* info = 0;
 
     /* Try to convert from decimal dotted form to address. */
-    success = inet_pton(AF_INET, hostname, addr);
+    if (inet_pton(AF_INET, hostname, addr) == 1) return MN_DONE;
 
     /* If conversion failed assume it is a hostname and look it up. */
-    if (!success) {
-        hostent_t* hostent = NULL;
-        struct in_addr** inaddr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(hostname, 0, &hints, &info) != 0 || info == 0) return MN_NOHOST;
 
-        err = mn_gethostbyname(hostname, &hostent);
-        if (err != MN_DONE) return err;
+    memcpy(addr, &((struct sockaddr_in*)info->ai_addr)->sin_addr, sizeof(struct in_addr));
+    freeaddrinfo(info);
 
-        inaddr = (struct in_addr**)hostent->h_addr_list;
-        memcpy(addr, *inaddr, sizeof(struct in_addr));
-    }
     return MN_DONE;
 }
 
@@ -41,7 +39,7 @@ static int host2addr(struct in_addr* addr, const char* hostname) {
  * Allocate a sockaddr struct.
  */
 sockaddr_t* mn_sockaddr_alloc() {
-    return ms_calloc(1, sockaddr_t);
+    return ms_calloc_tag(MS_MEM_SOCKADDR, 1, sockaddr_t);
 }
 /**
  * Create a copy of src.
@@ -51,9 +49,44 @@ sockaddr_t* mn_sockaddr_copy(sockaddr_t* src) {
     return (sockaddr_t*)memcpy(mn_sockaddr_alloc(), src, sizeof(sockaddr_t));
 }
 
+/**
+ * Return the length of the address for its family, as passed to sendto() and bind().
+ * @return sizeof(struct sockaddr_in6) for IPv6, otherwise sizeof(struct sockaddr_in).
+ */
+socklen_t mn_sockaddr_len(const sockaddr_t* addr) {
+    if (addr->ss_family == AF_INET6) return (socklen_t)sizeof(struct sockaddr_in6);
+    return (socklen_t)sizeof(struct sockaddr_in);
+}
+
+/**
+ * Compare two addresses by family, address, and port (padding is ignored).
+ * @return 1 if they are equal (or both null), 0 otherwise.
+ */
+int mn_sockaddr_equal(const sockaddr_t* left, const sockaddr_t* right) {
+    if (left == right) return 1;
+    if (left == 0 || right == 0) return 0;
+    if (left->ss_family != right->ss_family) return 0;
+
+    if (left->ss_family == AF_INET) {
+        const struct sockaddr_in* lin = (const struct sockaddr_in*)left;
+        const struct sockaddr_in* rin = (const struct sockaddr_in*)right;
+
+        return lin->sin_port == rin->sin_port && lin->sin_addr.s_addr == rin->sin_addr.s_addr;
+    }
+    if (left->ss_family == AF_INET6) {
+        const struct sockaddr_in6* lin6 = (const struct sockaddr_in6*)left;
+        const struct sockaddr_in6* rin6 = (const struct sockaddr_in6*)right;
+
+        return lin6->sin6_port == rin6->sin6_port
+            && memcmp(&lin6->sin6_addr, &rin6->sin6_addr, sizeof(lin6->sin6_addr)) == 0;
+    }
+    return memcmp(left, right, sizeof(sockaddr_t)) == 0;
+}
+
 /**
  * Initialize an internet address structure.
  * If the hostname is the * wildcard we use INADDR_ANY for the address.
+ * IPv6 literals (e.g. ::1) give an AF_INET6 address, names are looked up as IPv4.
  * @return pointer to the initialized address or 0.
  */
 sockaddr_t* mn_sockaddr_inet_init(sockaddr_t* addr, const char *hostname, unsigned short port) {
@@ -61,12 +94,13 @@ sockaddr_t* mn_sockaddr_inet_init(sockaddr_t* addr, const char *hostname, unsign
     struct sockaddr_in* inaddr;
 
     if (!addr) return 0;
-    inaddr = (struct sockaddr_in*)addr;
+    if (mn_sockaddr_inet_literal(addr, hostname, port)) return addr;
 
+    inaddr = (struct sockaddr_in*)addr;
+    inaddr->sin_family = AF_INET;
     inaddr->sin_port = htons(port);
 
     if (strcmp(hostname, "*")) {
-        inaddr->sin_family = AF_INET;
         err = host2addr(&inaddr->sin_addr, hostname);
         if (err != MN_DONE) return 0;
     }
@@ -76,4 +110,62 @@ sockaddr_t* mn_sockaddr_inet_init(sockaddr_t* addr, const char *hostname, unsign
     return addr;
 }
 
+/**
+ * Initialize an internet address structure from an IP literal only, names are never looked up.
+ * @return pointer to the initialized address or 0 if hostname is not an IPv4 or IPv6 literal.
+ */
+sockaddr_t* mn_sockaddr_inet_literal(sockaddr_t* addr, const char* hostname, unsigned short port) {
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)addr;
+    struct sockaddr_in6* in6addr = (struct sockaddr_in6*)addr;
+
+    memset(addr, 0, sizeof(sockaddr_t));
+    if (inet_pton(AF_INET, hostname, &inaddr->sin_addr) == 1) {
+        inaddr->sin_family = AF_INET;
+        inaddr->sin_port = htons(port);
+        return addr;
+    }
+    if (inet_pton(AF_INET6, hostname, &in6addr->sin6_addr) == 1) {
+        in6addr->sin6_family = AF_INET6;
+        in6addr->sin6_port = htons(port);
+        return addr;
+    }
+    return 0;
+}
+
+/**
+ * Convert an address for a socket of the family, an IPv4 address becomes IPv4-mapped (::ffff:a.b.c.d)
+ * for an IPv6 socket and an IPv4-mapped one plain IPv4 for an IPv4 socket. AF_UNSPEC leaves it as is.
+ * @return addr or 0 if the socket can not reach it, e.g. an IPv6 address from an IPv4 socket.
+ */
+sockaddr_t* mn_sockaddr_to_family(sockaddr_t* addr, int family) {
+    static const uint8_t mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)addr;
+    struct sockaddr_in6* in6addr = (struct sockaddr_in6*)addr;
+    struct in_addr in;
+    unsigned short port;
+
+    if (family == AF_UNSPEC || addr->ss_family == family) return addr;
+
+    if (family == AF_INET6 && addr->ss_family == AF_INET) {
+        in = inaddr->sin_addr;
+        port = inaddr->sin_port;
+        memset(addr, 0, sizeof(sockaddr_t));
+        in6addr->sin6_family = AF_INET6;
+        in6addr->sin6_port = port;
+        memcpy(&in6addr->sin6_addr, mapped, sizeof(mapped));
+        memcpy((uint8_t*)&in6addr->sin6_addr + sizeof(mapped), &in, sizeof(in));
+        return addr;
+    }
+    if (family == AF_INET && addr->ss_family == AF_INET6 && memcmp(&in6addr->sin6_addr, mapped, sizeof(mapped)) == 0) {
+        memcpy(&in, (uint8_t*)&in6addr->sin6_addr + sizeof(mapped), sizeof(in));
+        port = in6addr->sin6_port;
+        memset(addr, 0, sizeof(sockaddr_t));
+        inaddr->sin_family = AF_INET;
+        inaddr->sin_port = port;
+        inaddr->sin_addr = in;
+        return addr;
+    }
+    return 0;
+}
+
 /** @} */
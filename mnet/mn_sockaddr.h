@@ -12,7 +12,11 @@
 
 sockaddr_t* mn_sockaddr_alloc();
 sockaddr_t* mn_sockaddr_copy(sockaddr_t* src);
+socklen_t mn_sockaddr_len(const sockaddr_t* addr);
+int mn_sockaddr_equal(const sockaddr_t* left, const sockaddr_t* right);
 sockaddr_t* mn_sockaddr_inet_init(sockaddr_t* addr, const char *hostname, unsigned short port);
+sockaddr_t* mn_sockaddr_inet_literal(sockaddr_t* addr, const char* hostname, unsigned short port);
+sockaddr_t* mn_sockaddr_to_family(sockaddr_t* addr, int family);
 
 /** @} */
 
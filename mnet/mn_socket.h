@@ -20,8 +20,9 @@
 /*
  * typdef some standard socket structs to _t names for convenience,
  * but without the mn_ prefix.We name sockaddr_in structs inetaddr_t.
+ * sockaddr_t is storage sized so it can hold IPv4 and IPv6 addresses inline.
  */
-typedef struct sockaddr sockaddr_t;
+typedef struct sockaddr_storage sockaddr_t;
 typedef struct sockaddr_in inetaddr_t;
 typedef struct hostent hostent_t;
 
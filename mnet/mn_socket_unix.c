@@ -106,8 +106,12 @@ int mn_socket_destroy(mn_socket_t* sock) {
  */
 int mn_socket_create(mn_socket_t* sock, int domain, int type, int protocol) {
     int reuse = 1;
+    int v6only = 0;
     *sock = socket(domain, type, protocol);
     if (*sock == MN_SOCKET_INVALID) return errno;
+
+    /* Let IPv6 sockets reach IPv4 peers through IPv4-mapped addresses. */
+    if (domain == AF_INET6) setsockopt(*sock, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
     
     /* Set reuseaddr so we can restart the socket in case of a crash. */
     return setsockopt(*sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
@@ -120,7 +124,7 @@ int mn_socket_bind(mn_socket_t* sock, sockaddr_t* addr, socklen_t len) {
     int err = mn_socket_setblocking(sock);
     if (err != MN_DONE) return err;
 
-    if (bind(*sock, addr, len) < 0) return errno;
+    if (bind(*sock, (struct sockaddr*)addr, len) < 0) return errno;
     return mn_socket_setnonblocking(sock);
 }
 
@@ -154,7 +158,7 @@ int mn_socket_connect(mn_socket_t* sock, sockaddr_t* addr, socklen_t len, mn_tim
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     
     /* call connect until done or failed without being interrupted */
-    do if (connect(*sock, addr, len) == 0) return MN_DONE;
+    do if (connect(*sock, (struct sockaddr*)addr, len) == 0) return MN_DONE;
     
     while ((err = errno) == EINTR);
     
@@ -183,7 +187,7 @@ int mn_socket_accept(mn_socket_t* sock, mn_socket_t* asock, sockaddr_t* addr, so
     if (!len) len = &dlen;
     for ( ;; ) {
         int err;
-        if ((*asock = accept(*sock, addr, len)) != MN_SOCKET_INVALID) return MN_DONE;
+        if ((*asock = accept(*sock, (struct sockaddr*)addr, len)) != MN_SOCKET_INVALID) return MN_DONE;
         err = errno;
         if (err == EINTR) continue;
         if (err != EAGAIN && err != ECONNABORTED) return err;
@@ -240,7 +244,7 @@ int mn_socket_sendto(mn_socket_t* sock, const char *data, size_t count, size_t *
     *sent = 0;
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     for ( ;; ) {
-        long put = (long) sendto(*sock, data, count, 0, addr, len);  
+        long put = (long) sendto(*sock, data, count, 0, (struct sockaddr*)addr, len);  
         if (put > 0) {
             *sent = put;
             return MN_DONE;
@@ -285,7 +289,7 @@ int mn_socket_recvfrom(mn_socket_t* sock, char *data, size_t count, size_t *got,
     *got = 0;
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     for ( ;; ) {
-        long taken = (long)recvfrom(*sock, data, count, 0, addr, len);
+        long taken = (long)recvfrom(*sock, data, count, 0, (struct sockaddr*)addr, len);
         if (taken > 0) {
             *got = taken;
             return MN_DONE;
@@ -220,9 +220,13 @@ void mn_socket_shutdown(mn_socket_t* sock, int how) {
  * Creates and sets up a socket
  */
 int mn_socket_create(mn_socket_t* sock, int domain, int type, int protocol) {
+    DWORD v6only = 0;
     *sock = socket(domain, type, protocol);
-    if (*sock != MN_SOCKET_INVALID) return MN_DONE;
-    else return WSAGetLastError();
+    if (*sock == MN_SOCKET_INVALID) return WSAGetLastError();
+
+    /* Let IPv6 sockets reach IPv4 peers through IPv4-mapped addresses, Windows defaults to v6 only. */
+    if (domain == AF_INET6) setsockopt(*sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6only, sizeof(v6only));
+    return MN_DONE;
 }
 
 /**
@@ -236,7 +240,7 @@ int mn_socket_connect(mn_socket_t* sock, sockaddr_t* addr, socklen_t len, mn_tim
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     
     /* ask system to connect */
-    if (connect(*sock, addr, len) == 0) return MN_DONE;
+    if (connect(*sock, (struct sockaddr*)addr, len) == 0) return MN_DONE;
     
     /* make sure the system is trying to connect */
     err = WSAGetLastError();
@@ -268,7 +272,7 @@ int mn_socket_connect(mn_socket_t* sock, sockaddr_t* addr, socklen_t len, mn_tim
 int mn_socket_bind(mn_socket_t* sock, sockaddr_t* addr, socklen_t len) {
     int err = MN_DONE;
     mn_socket_setblocking(sock);
-    if (bind(*sock, addr, len) < 0) err = WSAGetLastError();
+    if (bind(*sock, (struct sockaddr*)addr, len) < 0) err = WSAGetLastError();
     mn_socket_setnonblocking(sock);
     return err;
 }
@@ -297,7 +301,7 @@ int mn_socket_accept(mn_socket_t* sock, mn_socket_t* asock, sockaddr_t* addr, so
         int err;
         
         /* try to get client socket */
-        if ((*asock = accept(*sock, addr, len)) != MN_SOCKET_INVALID) return MN_DONE;
+        if ((*asock = accept(*sock, (struct sockaddr*)addr, len)) != MN_SOCKET_INVALID) return MN_DONE;
         
         /* find out why we failed */
         err = WSAGetLastError(); 
@@ -360,7 +364,7 @@ int mn_socket_sendto(mn_socket_t* sock, const char* data, size_t count, size_t*
     *sent = 0;
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     for ( ;; ) {
-        int put = sendto(*sock, data, (int) count, 0, addr, len);
+        int put = sendto(*sock, data, (int) count, 0, (struct sockaddr*)addr, len);
         if (put > 0) {
             *sent = put;
             return MN_DONE;
@@ -404,7 +408,7 @@ int mn_socket_recvfrom(mn_socket_t* sock, char* data, size_t count, size_t* got,
     *got = 0;
     if (*sock == MN_SOCKET_INVALID) return MN_CLOSED;
     for ( ;; ) {
-        int taken = recvfrom(*sock, data, (int) count, 0, addr, len);
+        int taken = recvfrom(*sock, data, (int) count, 0, (struct sockaddr*)addr, len);
         if (taken > 0) {
             *got = taken;
             return MN_DONE;
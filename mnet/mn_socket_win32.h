@@ -10,6 +10,7 @@
 /* Socket module for Win32 */
 
 #include <winsock2.h>
+#include <ws2tcpip.h>
 
 typedef int socklen_t;
 typedef SOCKET mn_socket_t;
@@ -0,0 +1,56 @@
+#ifndef MS_ATOMIC_H
+#define MS_ATOMIC_H
+
+/**
+ * @file
+ * @defgroup atomic Atomic operations.
+ * @{
+ * Atomic operations on a volatile long, full barriers unless noted.
+ */
+
+#include "msys/ms_config.h"
+
+#if defined(_MSC_VER)
+
+/** Add 1. @return the new value. */
+#define ms_atomic_increment(ptr) InterlockedIncrement(ptr)
+
+/** Subtract 1. @return the new value. */
+#define ms_atomic_decrement(ptr) InterlockedDecrement(ptr)
+
+/** Store value. @return the previous value. */
+#define ms_atomic_exchange(ptr, value) InterlockedExchange(ptr, value)
+
+/** Store 0 with release ordering, e.g. to unlock. */
+#define ms_atomic_clear(ptr) InterlockedExchange(ptr, 0)
+
+/** Add value to a volatile int64_t. @return the new value. */
+#define ms_atomic_add64(ptr, value) (InterlockedExchangeAdd64(ptr, value) + (value))
+
+/** Full memory barrier, e.g. between writing a record and publishing its index. */
+#define ms_atomic_barrier() MemoryBarrier()
+
+#else
+
+#define ms_atomic_increment(ptr) __sync_add_and_fetch(ptr, 1)
+#define ms_atomic_decrement(ptr) __sync_sub_and_fetch(ptr, 1)
+#define ms_atomic_exchange(ptr, value) __sync_lock_test_and_set(ptr, value)
+#define ms_atomic_clear(ptr) __sync_lock_release(ptr)
+#define ms_atomic_add64(ptr, value) __sync_add_and_fetch(ptr, value)
+#define ms_atomic_barrier() __sync_synchronize()
+
+#endif
+
+/** Spin until the lock, a volatile long that is 0 when free, is taken. */
+#define ms_spin_lock(ptr) \
+    do { \
+        while (ms_atomic_exchange(ptr, 1)) { \
+            while (*(ptr)) {} \
+        } \
+    } while (0)
+
+#define ms_spin_unlock(ptr) ms_atomic_clear(ptr)
+
+/** @} */
+
+#endif
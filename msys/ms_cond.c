@@ -0,0 +1,5 @@
+#ifdef WIN32
+#include "msys/win/ms_cond_win.c"
+#else
+#include "msys/posix/ms_cond_posix.c"
+#endif
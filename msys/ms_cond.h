@@ -0,0 +1,35 @@
+#ifndef MS_COND_H
+#define MS_COND_H
+
+/**
+ * @file
+ * @defgroup cond Simple cross platform condition variable functions.
+ * @{
+ * Simple cross platform condition variable definitions, used with ms_mutex_t.
+ */
+
+#include "msys/ms_mutex.h"
+
+typedef void* ms_cond_t;
+
+/**  Allocate a condition variable. */
+ms_cond_t* ms_cond_alloc();
+
+/**  Initialize a condition variable. */
+ms_cond_t* ms_cond_init(ms_cond_t* cond);
+
+/** Deinitialize. */
+ms_cond_t* ms_cond_deinit(ms_cond_t* cond);
+
+/**  Wait on a condition variable, mutex must be locked by the caller. */
+int ms_cond_wait(ms_cond_t* cond, ms_mutex_t* mutex);
+
+/**  Wake one waiting thread. */
+int ms_cond_signal(ms_cond_t* cond);
+
+/**  Wake all waiting threads. */
+int ms_cond_broadcast(ms_cond_t* cond);
+
+/** @} */
+
+#endif
@@ -54,6 +54,15 @@ typedef double float64_t;
 typedef uint64_t float64_t;
 #endif
 
+/** Declare a variable with one instance per thread. */
+#if defined(_MSC_VER)
+#define MS_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define MS_THREAD_LOCAL _Thread_local
+#else
+#define MS_THREAD_LOCAL __thread
+#endif
+
 /* VC++ defines _DEBUG if /MTd or /Md is set, take advantage of this to simplify vcproj files. */
 #ifdef _DEBUG
 #ifndef DEBUG
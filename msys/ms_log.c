@@ -4,7 +4,14 @@
 #include <stdarg.h>
 #include <ctype.h>
 
+#include "msys/ms_atomic.h"
 #include "msys/ms_log.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 /**
  * @file
@@ -25,6 +32,12 @@ static FILE* logfile = 0;
  */
 static ms_log_level_t loglevel = ms_fatal;
 
+volatile uint8_t ms_log_levels[MS_LOG_NCATEGORIES] = { ms_fatal, ms_fatal, ms_fatal, ms_fatal, ms_fatal, ms_fatal };
+
+static const char* category_names[MS_LOG_NCATEGORIES] = {
+    "app", "msys", "mnet", "mcoap", "mcoap.endpt", "mcoap.codec"
+};
+
 /**
  * Set the global logfile pointer.
  */
@@ -33,10 +46,13 @@ void ms_log_setfile(FILE* newfile) {
 }
 
 /**
- * Set the global log level.
+ * Set the global log level, and the level of every category.
  */
 void ms_log_setlevel(ms_log_level_t level) {
+    int category;
+
     loglevel = level;
+    for (category = 0; category < MS_LOG_NCATEGORIES; category++) ms_log_levels[category] = (uint8_t)level;
 }
 
 /**
@@ -46,6 +62,43 @@ ms_log_level_t ms_log_getlevel() {
     return loglevel;
 }
 
+/**
+ * Set the level of one category, e.g. to debug the endpoint without the codec's messages.
+ */
+void ms_log_set_category_level(ms_log_category_t category, ms_log_level_t level) {
+    if (category < MS_LOG_NCATEGORIES) ms_log_levels[category] = (uint8_t)level;
+}
+
+ms_log_level_t ms_log_get_category_level(ms_log_category_t category) {
+    return category < MS_LOG_NCATEGORIES ? (ms_log_level_t)ms_log_levels[category] : loglevel;
+}
+
+/**
+ * Set the level of the categories with a name, or under it, e.g. "mcoap" also sets
+ * "mcoap.endpt" and "mcoap.codec".
+ * @return the number of categories set.
+ */
+int ms_log_set_named_level(const char* name, ms_log_level_t level) {
+    size_t length = strlen(name);
+    int category;
+    int nset = 0;
+
+    for (category = 0; category < MS_LOG_NCATEGORIES; category++) {
+        const char* cname = category_names[category];
+
+        if (strncmp(cname, name, length) == 0 && (cname[length] == 0 || cname[length] == '.')) {
+            ms_log_levels[category] = (uint8_t)level;
+            nset++;
+        }
+    }
+    return nset;
+}
+
+/** @return the name of a category, e.g. "mcoap.endpt". */
+const char* ms_log_category_name(ms_log_category_t category) {
+    return category < MS_LOG_NCATEGORIES ? category_names[category] : "unknown";
+}
+
 /*
  * Get the current log level as a string.
  */
@@ -82,51 +135,372 @@ static const char* getname(const char* fname) {
     return fname;
 }
 
-/* Define a slightly different form under WinCE because it does not support posix time calls. */
-#ifdef WINCE
+#define RECORD_TEXT     1   /* The record holds message text. */
+#define RECORD_BYTES    2   /* The record holds bytes to dump. */
+
+/** Bytes dumped per record, each takes 6 characters formatted. */
+#define BYTES_PER_RECORD 64
+
+/** Seconds the writer sleeps when the rings are empty. */
+#define WRITER_NAP      0.001
+
+/* A message waiting for the writer. */
+typedef struct record record_t;
+struct record {
+    double time;
+    const char* fname;
+    uint32_t line;
+    uint16_t length;
+    uint8_t level;
+    uint8_t kind;
+    char text[MS_LOG_TEXT];
+};
+
+/*
+ * A thread's messages. The producer only writes head and dropped, the writer only writes tail,
+ * they are on separate cache lines.
+ */
+typedef struct ring ring_t;
+struct ring {
+    volatile uint32_t head;         /* Records written, the next one goes at head % size. */
+    uint32_t dropped;
+    char pad0[56];
+    volatile uint32_t tail;         /* Records written out. */
+    uint32_t reported;              /* Drops the writer has reported. */
+    char pad1[56];
+    record_t records[MS_LOG_RING_RECORDS];
+};
+
+static ring_t* rings[MS_LOG_MAX_RINGS];
+static volatile long nrings;
+static volatile long rings_lock;
+
+/* For threads past MS_LOG_MAX_RINGS, producers take shared_lock. */
+static ring_t shared;
+static volatile long shared_lock;
+
+static MS_THREAD_LOCAL ring_t* thread_ring;
+
+static ms_thread_t* writer;
+static volatile long running;
+static volatile uint32_t passes;    /* Times the writer went over all the rings. */
+
+/* Seconds since the epoch without taking a lock. */
+static double now() {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return ft.dwLowDateTime / 1.0e7 + ft.dwHighDateTime * (4294967296.0 / 1.0e7) - 11644473600.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+#endif
+}
+
+/* The calling thread's ring, added on its first message. */
+static ring_t* get_ring() {
+    ring_t* ring = thread_ring;
+
+    if (ring) return ring;
+
+    ms_spin_lock(&rings_lock);
+    if (nrings < MS_LOG_MAX_RINGS) {
+        ring = ms_calloc(1, ring_t);
+        if (ring) {
+            rings[nrings] = ring;
+            nrings++;
+        }
+    }
+    ms_spin_unlock(&rings_lock);
+
+    thread_ring = ring ? ring : &shared;
+    return thread_ring;
+}
+
+/* @return the record to fill or 0 if the ring is full, the message is then counted as dropped. */
+static record_t* reserve(ring_t* ring) {
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= MS_LOG_RING_RECORDS) {
+        ring->dropped++;
+        return 0;
+    }
+    return &ring->records[head & (MS_LOG_RING_RECORDS - 1)];
+}
+
+/* Publish the reserved record to the writer. */
+static void commit(ring_t* ring) {
+    ms_atomic_barrier();
+    ring->head = ring->head + 1;
+}
+
+/* Format a message into the calling thread's ring. */
+static void enqueue_text(ms_log_level_t level, const char* fname, unsigned int line, const char* message, va_list args) {
+    ring_t* ring = get_ring();
+    record_t* record;
+    int length;
+
+    if (ring == &shared) ms_spin_lock(&shared_lock);
+
+    record = reserve(ring);
+    if (record) {
+        record->time = now();
+        record->fname = fname;
+        record->line = line;
+        record->level = (uint8_t)level;
+        record->kind = RECORD_TEXT;
+
+        length = vsnprintf(record->text, MS_LOG_TEXT, message, args);
+        if (length < 0) length = 0;
+        if (length >= MS_LOG_TEXT) length = MS_LOG_TEXT - 1;
+        record->length = (uint16_t)length;
+        commit(ring);
+    }
+
+    if (ring == &shared) ms_spin_unlock(&shared_lock);
+}
+
+/* Copy bytes to dump into the calling thread's ring, BYTES_PER_RECORD to a record. */
+static void enqueue_bytes(ms_log_level_t level, uint32_t count, const uint8_t* bytes) {
+    ring_t* ring = get_ring();
+    uint32_t ibyte = 0;
+    double time = now();
+
+    if (ring == &shared) ms_spin_lock(&shared_lock);
+
+    while (ibyte < count) {
+        uint32_t nbytes = count - ibyte < BYTES_PER_RECORD ? count - ibyte : BYTES_PER_RECORD;
+        record_t* record = reserve(ring);
+
+        if (record == 0) break;
+        record->time = time;
+        record->fname = 0;
+        record->line = 0;
+        record->level = (uint8_t)level;
+        record->kind = RECORD_BYTES;
+        record->length = (uint16_t)nbytes;
+        memcpy(record->text, &bytes[ibyte], nbytes);
+        commit(ring);
+        ibyte += nbytes;
+    }
+
+    if (ring == &shared) ms_spin_unlock(&shared_lock);
+}
+
+/* Format the time of day, only calling localtime when the second changes. */
+static const char* time_of_day(double time, time_t* cached, char* datebuf, size_t size) {
+    time_t seconds = (time_t)time;
+
+    if (seconds != *cached) {
+        *cached = seconds;
+        strftime(datebuf, size, "%X", localtime(&seconds));
+    }
+    return datebuf;
+}
+
+static void write_record(FILE* file, const record_t* record, const char* date) {
+    uint32_t ibyte;
+
+    if (record->kind == RECORD_TEXT) {
+        fprintf(file, "%s@%s:%d (%s) %.*s\n", getlevel((ms_log_level_t)record->level), getname(record->fname),
+                record->line, date, (int)record->length, record->text);
+        return;
+    }
+
+    for (ibyte = 0; ibyte < record->length; ibyte++) fprintf(file, "0x%02x ", (uint8_t)record->text[ibyte]);
+    fprintf(file, "\n");
+    for (ibyte = 0; ibyte < record->length; ibyte++) fputc(isprint((uint8_t)record->text[ibyte]) ? record->text[ibyte] : '.', file);
+    fprintf(file, "\n");
+}
+
+/* Write out what is in a ring. @return the number of records written. */
+static uint32_t drain_ring(ring_t* ring, FILE* file, time_t* cached, char* datebuf, size_t size) {
+    uint32_t head = ring->head;
+    uint32_t tail = ring->tail;
+    uint32_t dropped = ring->dropped;
+    uint32_t count = head - tail;
+
+    ms_atomic_barrier();
+    while (tail != head) {
+        const record_t* record = &ring->records[tail & (MS_LOG_RING_RECORDS - 1)];
+
+        if (file) write_record(file, record, time_of_day(record->time, cached, datebuf, size));
+        tail++;
+    }
+    ms_atomic_barrier();
+    ring->tail = tail;
+
+    if (dropped != ring->reported) {
+        if (file) fprintf(file, "%s@%s (%s) dropped %u messages\n", getlevel(ms_warn), getname(__FILE__),
+                          time_of_day(now(), cached, datebuf, size), dropped - ring->reported);
+        ring->reported = dropped;
+        count++;
+    }
+    return count;
+}
+
+/* Write out all the rings. @return the number of records written. */
+static uint32_t drain(time_t* cached, char* datebuf, size_t size) {
+    FILE* file = logfile;
+    uint32_t count = 0;
+    long iring;
+
+    for (iring = 0; iring < nrings; iring++) count += drain_ring(rings[iring], file, cached, datebuf, size);
+    count += drain_ring(&shared, file, cached, datebuf, size);
+
+    if (count && file) fflush(file);
+    passes++;
+    return count;
+}
+
+static void writer_main(void* arg) {
+    time_t cached = 0;
+    char datebuf[16];
+
+    datebuf[0] = 0;
+    while (running) {
+        if (drain(&cached, datebuf, sizeof(datebuf)) == 0) ms_thread_sleep(WRITER_NAP);
+    }
+    drain(&cached, datebuf, sizeof(datebuf));
+}
+
 /**
- * General purpose logging function. "message" must be a printf-style formatting string.
+ * Start logging from a background thread, see ms_log.h.
+ * @return 1 if the writer is running, 0 if it could not be allocated.
  */
-void ms_log(ms_log_level_t level, const char* fname, unsigned int line, const char* message, ...) {
-    va_list args;
+int ms_log_start() {
+    if (writer) return 1;
+
+    writer = ms_thread_alloc();
+    if (writer == 0) return 0;
+    running = 1;
+    ms_thread_init(writer, writer_main, 0);
+    return 1;
+}
+
+/**
+ * Write out the queued messages and stop the background thread, messages are written on the
+ * calling thread again. Messages logged while it stops may stay queued until the next start.
+ */
+void ms_log_stop() {
+    if (writer == 0) return;
+
+    running = 0;
+    ms_free(ms_thread_deinit(writer));
+    writer = 0;
+}
+
+/**
+ * Wait until the messages logged so far have been written and flushed.
+ */
+void ms_log_flush() {
+    uint32_t pass = passes;
+
+    if (writer == 0) {
+        if (logfile) fflush(logfile);
+        return;
+    }
+
+    /* The pass in progress may have missed the latest messages, the one after it will not. */
+    while (running && passes - pass < 2) ms_thread_sleep(WRITER_NAP);
+}
+
+/**
+ * @return the number of messages dropped because a ring was full.
+ */
+uint32_t ms_log_dropped() {
+    uint32_t dropped = shared.dropped;
+    long iring;
+
+    for (iring = 0; iring < nrings; iring++) dropped += rings[iring]->dropped;
+    return dropped;
+}
 
+/* Define a slightly different form under WinCE because it does not support posix time calls. */
+#ifdef WINCE
+/* Write or enqueue a message whose level has been checked. */
+static void vlog(ms_log_level_t level, const char* fname, unsigned int line, const char* message, va_list args) {
     if (!logfile) return;
-    if (level < loglevel) return;
+
+    if (writer) {
+        enqueue_text(level, fname, line, message, args);
+        return;
+    }
 
     /* Don't know how to get formatted time yet on WinCE. */
     fprintf(logfile, "%s@%s:%d ", getlevel(level), getname(fname), line);
-
-    va_start(args, message);
     vfprintf(logfile, message, args);
-    va_end(args);
-
     fprintf(logfile, "\n");
     fflush(logfile);
 }
 
 #else
-/**
- * General purpose logging function. "message" must be a printf-style formatting string.
- */
-
-void ms_log(ms_log_level_t level, const char* fname, unsigned int line, const char* message, ...) {
+/* Write or enqueue a message whose level has been checked. */
+static void vlog(ms_log_level_t level, const char* fname, unsigned int line, const char* message, va_list args) {
     time_t seconds;
     char datebuf[16];
-    va_list args;
 
     /* if (!logfile) return; */
-    if (level < loglevel) return;
+    if (writer) {
+        enqueue_text(level, fname, line, message, args);
+        return;
+    }
 
     seconds = time(0);
     strftime(datebuf, (sizeof datebuf), "%X", localtime(&seconds));
     fprintf(logfile, "%s@%s:%d (%s) ", getlevel(level), getname(fname), line, datebuf);
+    vfprintf(logfile, message, args);
+    fprintf(logfile, "\n");
+    fflush(logfile);
+}
+#endif
+
+/**
+ * General purpose logging function, checked against the global level.
+ * "message" must be a printf-style formatting string.
+ */
+void ms_log(ms_log_level_t level, const char* fname, unsigned int line, const char* message, ...) {
+    va_list args;
+
+    if (level < loglevel) return;
 
     va_start(args, message);
-    vfprintf(logfile, message, args);
+    vlog(level, fname, line, message, args);
+    va_end(args);
+}
+
+/**
+ * Log a message checked against its category's level, what the logging macros call.
+ * "message" must be a printf-style formatting string.
+ */
+void ms_log_category(ms_log_category_t category, ms_log_level_t level, const char* fname, unsigned int line,
+                     const char* message, ...) {
+    va_list args;
+
+    if (category >= MS_LOG_NCATEGORIES || level < ms_log_levels[category]) return;
+
+    va_start(args, message);
+    vlog(level, fname, line, message, args);
     va_end(args);
+}
 
-    fprintf(logfile, "\n");
-    fflush(logfile);
+/**
+ * Count a message from a rate limited call site. The first call in a new second logs how
+ * many messages the site suppressed the last second it was busy.
+ * @return 1 if the message may be logged, 0 if the site has used up this second's burst.
+ */
+int ms_log_limit(ms_log_limit_t* limit, ms_log_category_t category, ms_log_level_t level, const char* fname, unsigned int line) {
+    long second = (long)now();
+
+    if (limit->second != second && ms_atomic_exchange(&limit->second, second) != second) {
+        long count = ms_atomic_exchange(&limit->count, 0);
+
+        if (count > MS_LOG_LIMIT_BURST) {
+            ms_log_category(category, level, fname, line, "suppressed %ld messages", count - MS_LOG_LIMIT_BURST);
+        }
+    }
+    return ms_atomic_increment(&limit->count) <= MS_LOG_LIMIT_BURST;
 }
 
 void ms_log_bytes(ms_log_level_t level, uint32_t count, uint8_t* bytes) {
@@ -136,6 +510,11 @@ void ms_log_bytes(ms_log_level_t level, uint32_t count, uint8_t* bytes) {
     /* if (!logfile) return; */
     if (level < loglevel) return;
 
+    if (writer) {
+        enqueue_bytes(level, count, bytes);
+        return;
+    }
+
     for(ibyte = 0; ibyte < count; ibyte++) {
         fprintf(logfile, "0x%02x ", bytes[ibyte]);
     }
@@ -151,6 +530,4 @@ void ms_log_bytes(ms_log_level_t level, uint32_t count, uint8_t* bytes) {
     fprintf(logfile, "\n");
 }
 
-#endif
-
 /** @} */
@@ -8,6 +8,21 @@
  * Logging functions and helper macros for SBX for C
  * The macro forms capture the current value of the __FILE__ and __LINE__ macros
  * and call out to the base logging function.
+ *
+ * By default a message is formatted and written on the calling thread. After ms_log_start()
+ * a call only formats the message text into a record in the calling thread's ring, and a
+ * background thread adds the time and call site and writes the records in batches. Rings
+ * are lock free, single producer and single consumer. When a ring is full the message is
+ * dropped and counted, and the writer reports how many were dropped.
+ *
+ * Each source file logs under a category, set by defining MS_LOG_CATEGORY before including
+ * any header, e.g. #define MS_LOG_CATEGORY MS_LOG_ENDPT. Every category has its own runtime
+ * level, and the macros test it with one load before making a call. Call sites below
+ * MS_LOG_FLOOR are removed by the preprocessor. The floor defaults to debug if DEBUG is
+ * defined and to warn otherwise, and can be raised for a whole build or a single file.
+ *
+ * The _limited macros log at most MS_LOG_LIMIT_BURST messages a second from their call
+ * site and then say how many were suppressed, for error paths that can fire in a loop.
  */
 
 #include <stdio.h>
@@ -23,31 +38,118 @@ enum ms_log_level {
     ms_fatal    /**< The executing function has put the program into an unsafe state. */
 };
 
+/** The levels as numbers the preprocessor can compare with MS_LOG_FLOOR. */
+#define MS_LOG_DEBUG    0
+#define MS_LOG_WARN     1
+#define MS_LOG_FATAL    2
+#define MS_LOG_NONE     3   /**< A floor that removes every call site. */
+
+/** Categories with their own runtime level, see ms_log_category_name(). */
+typedef enum ms_log_category ms_log_category_t;
+enum ms_log_category {
+    MS_LOG_APP,         /**< Code that does not set a category. */
+    MS_LOG_MSYS,
+    MS_LOG_MNET,
+    MS_LOG_MCOAP,       /**< CoAP code that is neither the endpoint nor the codec. */
+    MS_LOG_ENDPT,       /**< The CoAP endpoint's send, receive and retransmit paths. */
+    MS_LOG_CODEC,       /**< Parsing and serializing CoAP messages. */
+    MS_LOG_NCATEGORIES
+};
+
+#ifndef MS_LOG_CATEGORY
+#define MS_LOG_CATEGORY MS_LOG_APP
+#endif
+
+#ifndef MS_LOG_FLOOR
+#ifdef DEBUG
+#define MS_LOG_FLOOR MS_LOG_DEBUG
+#else
+#define MS_LOG_FLOOR MS_LOG_WARN
+#endif
+#endif
+
+#define MS_LOG_LIMIT_BURST  5   /**< Messages a second a _limited call site may log. */
+
+/** State of a rate limited call site. */
+typedef struct ms_log_limit ms_log_limit_t;
+struct ms_log_limit {
+    volatile long second;       /**< The second being counted. */
+    volatile long count;        /**< Messages in that second, logged or not. */
+};
+
+/** Runtime level of each category, only set through the functions. */
+extern volatile uint8_t ms_log_levels[MS_LOG_NCATEGORIES];
+
+#define MS_LOG_TEXT         224     /**< Longest async message text, longer ones are cut. */
+#define MS_LOG_RING_RECORDS 1024    /**< Records in a thread's ring, a power of 2. */
+#define MS_LOG_MAX_RINGS    32      /**< Threads with a ring of their own, others share one under a lock. */
+
 void ms_log_setfile(FILE* newfile);
 void ms_log_setlevel(ms_log_level_t level);
 ms_log_level_t ms_log_getlevel();
+void ms_log_set_category_level(ms_log_category_t category, ms_log_level_t level);
+ms_log_level_t ms_log_get_category_level(ms_log_category_t category);
+int ms_log_set_named_level(const char* name, ms_log_level_t level);
+const char* ms_log_category_name(ms_log_category_t category);
 
 void ms_log(ms_log_level_t level, const char* fname, unsigned int line, const char* message, ...);
+void ms_log_category(ms_log_category_t category, ms_log_level_t level, const char* fname, unsigned int line,
+                     const char* message, ...);
+int ms_log_limit(ms_log_limit_t* limit, ms_log_category_t category, ms_log_level_t level, const char* fname, unsigned int line);
 void ms_log_bytes(ms_log_level_t level, uint32_t count, uint8_t* bytes);
 
-/**
- * If DEBUG is set enable debug logging.
- */
-#ifdef DEBUG
+int ms_log_start();
+void ms_log_stop();
+void ms_log_flush();
+uint32_t ms_log_dropped();
 
-/** Log a debug message. */
-#define ms_log_debug(message,...) ms_log(ms_debug, __FILE__, __LINE__, message, ##__VA_ARGS__)
+/** 1 if the calling file's category logs messages of a level. */
+#define ms_log_enabled(level) ((level) >= ms_log_levels[MS_LOG_CATEGORY])
+
+/** Log under the calling file's category if its level allows. */
+#define MS_LOG_AT(level, message, ...) \
+    do { \
+        if (ms_log_enabled(level)) { \
+            ms_log_category(MS_LOG_CATEGORY, level, __FILE__, __LINE__, message, ##__VA_ARGS__); \
+        } \
+    } while (0)
 
+/** Log under the calling file's category if its level and the call site's rate allow. */
+#define MS_LOG_LIMITED(level, message, ...) \
+    do { \
+        static ms_log_limit_t ms_log_site; \
+        if (ms_log_enabled(level) && ms_log_limit(&ms_log_site, MS_LOG_CATEGORY, level, __FILE__, __LINE__)) { \
+            ms_log_category(MS_LOG_CATEGORY, level, __FILE__, __LINE__, message, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if MS_LOG_FLOOR <= MS_LOG_DEBUG
+/** Log a debug message. */
+#define ms_log_debug(message,...) MS_LOG_AT(ms_debug, message, ##__VA_ARGS__)
+/** Log a debug message, rate limited per call site. */
+#define ms_log_debug_limited(message,...) MS_LOG_LIMITED(ms_debug, message, ##__VA_ARGS__)
 #else
-/** Noop version of debug logging macro. */
-#define ms_log_debug(message,...) 
+/** Noop versions, still a statement so "if (x) ms_log_debug(...);" has a body. */
+#define ms_log_debug(message,...) do { } while (0)
+#define ms_log_debug_limited(message,...) do { } while (0)
 #endif
 
+#if MS_LOG_FLOOR <= MS_LOG_WARN
 /** Log a warning message. */
-#define ms_log_warn(message,...) ms_log(ms_warn, __FILE__, __LINE__, message, ##__VA_ARGS__)
+#define ms_log_warn(message,...) MS_LOG_AT(ms_warn, message, ##__VA_ARGS__)
+/** Log a warning message, rate limited per call site. */
+#define ms_log_warn_limited(message,...) MS_LOG_LIMITED(ms_warn, message, ##__VA_ARGS__)
+#else
+#define ms_log_warn(message,...) do { } while (0)
+#define ms_log_warn_limited(message,...) do { } while (0)
+#endif
 
+#if MS_LOG_FLOOR <= MS_LOG_FATAL
 /** Log a fatal message. */
-#define ms_log_fatal(message,...) ms_log(ms_fatal, __FILE__, __LINE__, message, ##__VA_ARGS__)
+#define ms_log_fatal(message,...) MS_LOG_AT(ms_fatal, message, ##__VA_ARGS__)
+#else
+#define ms_log_fatal(message,...) do { } while (0)
+#endif
 
 /** @} */
 
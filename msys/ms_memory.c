@@ -0,0 +1,216 @@
+/**
+ * @file
+ * @ingroup mem
+ * @{
+ */
+
+#include "msys/ms_atomic.h"
+#include "msys/ms_memory.h"
+
+/** Header bytes before each block, a multiple of malloc's alignment. */
+#define HEADER_BYTES    16
+
+#define HEADER(ptr) ((header_t*)((char*)(ptr) - HEADER_BYTES))
+#define BLOCK(header) ((void*)((char*)(header) + HEADER_BYTES))
+
+typedef struct header header_t;
+struct header {
+    size_t size;
+    uint32_t tag;
+};
+
+/* Counters written by one thread, summed by readers. */
+typedef struct counters counters_t;
+struct counters {
+    volatile int64_t bytes[MS_MEM_NTAGS];
+    volatile int64_t objects[MS_MEM_NTAGS];
+};
+
+static const char* tag_names[MS_MEM_NTAGS] = { "other", "message", "option", "buffer", "queue", "sockaddr", "uri" };
+
+/*
+ * Each thread gets its own counters the first time it allocates. Threads past MS_MEM_THREADS
+ * share the last ones and update them atomically. Counters are never reclaimed, a block
+ * freed by another thread than the one that allocated it just makes the sum come out right.
+ */
+static counters_t counters[MS_MEM_THREADS + 1];
+static volatile long nthreads;
+static MS_THREAD_LOCAL counters_t* thread_counters;
+
+static void* libc_malloc(void* ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* libc_calloc(void* ctx, size_t count, size_t size) {
+    (void)ctx;
+    return calloc(count, size);
+}
+
+static void* libc_realloc(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void libc_free(void* ctx, void* ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const ms_allocator_t libc_allocator = { libc_malloc, libc_calloc, libc_realloc, libc_free, 0 };
+
+static const ms_allocator_t* allocator = &libc_allocator;
+
+/**
+ * Install an allocator for all the library's allocations, 0 restores the C library's.
+ * The allocator is not copied and must stay valid while it is installed.
+ * @return the previous allocator.
+ */
+const ms_allocator_t* ms_allocator_set(const ms_allocator_t* next) {
+    const ms_allocator_t* previous = allocator;
+
+    allocator = next ? next : &libc_allocator;
+    return previous;
+}
+
+const ms_allocator_t* ms_allocator_get() {
+    return allocator;
+}
+
+/** The C library's allocator, e.g. for a custom allocator to fall back on. */
+const ms_allocator_t* ms_allocator_default() {
+    return &libc_allocator;
+}
+
+static void tally(uint32_t tag, int64_t bytes, int64_t objects) {
+    counters_t* mine = thread_counters;
+
+    if (mine == 0) {
+        long index = nthreads < MS_MEM_THREADS ? ms_atomic_increment(&nthreads) - 1 : MS_MEM_THREADS;
+
+        mine = &counters[index < MS_MEM_THREADS ? index : MS_MEM_THREADS];
+        thread_counters = mine;
+    }
+
+    if (mine == &counters[MS_MEM_THREADS]) {
+        ms_atomic_add64(&mine->bytes[tag], bytes);
+        ms_atomic_add64(&mine->objects[tag], objects);
+    }
+    else {
+        mine->bytes[tag] += bytes;
+        mine->objects[tag] += objects;
+    }
+}
+
+/** @return the block after the header, or 0 if header is 0. */
+static void* start_block(header_t* header, uint32_t tag, size_t size) {
+    if (header == 0) return 0;
+
+    if (tag >= MS_MEM_NTAGS) tag = MS_MEM_OTHER;
+    header->size = size;
+    header->tag = tag;
+    tally(tag, (int64_t)size, 1);
+
+    return BLOCK(header);
+}
+
+void* ms_mem_malloc(size_t size) {
+    return ms_mem_malloc_tag(MS_MEM_OTHER, size);
+}
+
+void* ms_mem_calloc(size_t count, size_t size) {
+    return ms_mem_calloc_tag(MS_MEM_OTHER, count, size);
+}
+
+/** Resize a block, it keeps its tag. */
+void* ms_mem_realloc(void* ptr, size_t size) {
+    return ms_mem_realloc_tag(ptr ? HEADER(ptr)->tag : MS_MEM_OTHER, ptr, size);
+}
+
+/** Free a block, 0 is ignored like free(). */
+void ms_mem_free(void* ptr) {
+    header_t* header;
+
+    if (ptr == 0) return;
+
+    header = HEADER(ptr);
+    tally(header->tag, -(int64_t)header->size, -1);
+    allocator->free_fn(allocator->ctx, header);
+}
+
+void* ms_mem_malloc_tag(uint32_t tag, size_t size) {
+    if (size > SIZE_MAX - HEADER_BYTES) return 0;
+    return start_block(allocator->malloc_fn(allocator->ctx, HEADER_BYTES + size), tag, size);
+}
+
+void* ms_mem_calloc_tag(uint32_t tag, size_t count, size_t size) {
+    if (size && count > (SIZE_MAX - HEADER_BYTES) / size) return 0;
+    return start_block(allocator->calloc_fn(allocator->ctx, 1, HEADER_BYTES + count * size), tag, count * size);
+}
+
+/**
+ * Resize a block and count it under tag from now on.
+ * @return the block, or 0 if allocation fails and ptr is unchanged.
+ */
+void* ms_mem_realloc_tag(uint32_t tag, void* ptr, size_t size) {
+    header_t* header;
+    size_t previous;
+
+    if (ptr == 0) return ms_mem_malloc_tag(tag, size);
+    if (size > SIZE_MAX - HEADER_BYTES) return 0;
+
+    previous = HEADER(ptr)->size;
+    header = allocator->realloc_fn(allocator->ctx, HEADER(ptr), HEADER_BYTES + size);
+    if (header == 0) return 0;
+
+    tally(header->tag, -(int64_t)previous, -1);
+    return start_block(header, tag, size);
+}
+
+/**
+ * Count a block under another tag, e.g. a copy made by ms_copy_str that holds a URI.
+ * @return ptr.
+ */
+void* ms_mem_retag(void* ptr, uint32_t tag) {
+    header_t* header;
+
+    if (ptr == 0) return 0;
+
+    header = HEADER(ptr);
+    tally(header->tag, -(int64_t)header->size, -1);
+    return start_block(header, tag, header->size);
+}
+
+/**
+ * Count memory that does not come from the allocator, e.g. mapped pages.
+ * Negative values take it off again.
+ */
+void ms_mem_account(uint32_t tag, int64_t bytes, int64_t objects) {
+    tally(tag < MS_MEM_NTAGS ? tag : MS_MEM_OTHER, bytes, objects);
+}
+
+/**
+ * Sum the live memory of a tag over all threads. The sum is not a snapshot, blocks
+ * allocated or freed while it is taken may or may not be counted.
+ * @return usage.
+ */
+ms_mem_usage_t* ms_mem_usage(uint32_t tag, ms_mem_usage_t* usage) {
+    uint32_t ithread;
+
+    usage->bytes = 0;
+    usage->objects = 0;
+    if (tag >= MS_MEM_NTAGS) return usage;
+
+    for (ithread = 0; ithread <= MS_MEM_THREADS; ithread++) {
+        usage->bytes += counters[ithread].bytes[tag];
+        usage->objects += counters[ithread].objects[tag];
+    }
+    return usage;
+}
+
+/** @return the tag's name, e.g. "option", or 0 if there is no such tag. */
+const char* ms_mem_tag_name(uint32_t tag) {
+    return tag < MS_MEM_NTAGS ? tag_names[tag] : 0;
+}
+
+/** @} */
@@ -8,11 +8,69 @@
  * Wrappers for standand C memory management functions:  free, malloc, calloc, realloc.
  * This allows custom allocators to be use in the library.
  *
+ * Every allocation in the libraries goes through the installed ms_allocator_t, which is
+ * the C library's allocator unless ms_allocator_set() installs another one, e.g. a pool,
+ * an arena or a counting allocator. Install it before anything is allocated, memory must
+ * be freed by the allocator that allocated it.
+ *
+ * Each block is also tagged with the kind of object it holds, e.g. ms_malloc_tag(MS_MEM_OPTION, ...),
+ * and the live bytes and blocks of each tag are counted. ms_mem_usage() reads the counts,
+ * e.g. to see which kind of object is growing in a long running process. Untagged blocks
+ * count as MS_MEM_OTHER. Blocks carry a small header with their size and tag, and each
+ * thread updates its own counters so counting takes no locks. Counters are not reclaimed
+ * when a thread exits, the threads after the first MS_MEM_THREADS share one set of counters
+ * updated atomically.
+ *
  * Caution! Using a custom allocation macro must allways be mached by the free macro.
  * Mixing custom and standard allocators is not allowed.
  */
 
-#include <stdlib.h>
+#include "msys/ms_config.h"
+
+/** Memory tags, what a block holds. */
+#define MS_MEM_OTHER        0
+#define MS_MEM_MESSAGE      1       /**< Messages, tokens and headers. */
+#define MS_MEM_OPTION       2       /**< Option lists and values. */
+#define MS_MEM_BUFFER       3       /**< Payloads and serialized messages. */
+#define MS_MEM_QUEUE        4       /**< Confirm queue, request table and requests waiting to be sent. */
+#define MS_MEM_SOCKADDR     5       /**< Addresses, peers and resolved hosts. */
+#define MS_MEM_URI          6       /**< Parsed URIs, host names and the URI cache. */
+#define MS_MEM_NTAGS        7
+
+#define MS_MEM_THREADS      64      /**< Threads that ever allocated with counters of their own. */
+
+/** Live memory of one tag. */
+typedef struct ms_mem_usage ms_mem_usage_t;
+struct ms_mem_usage {
+    int64_t bytes;          /**< Bytes requested, not counting block headers. */
+    int64_t objects;        /**< Blocks, or e.g. slabs for pooled objects. */
+};
+
+/** An allocator, ctx is passed to each function. */
+typedef struct ms_allocator ms_allocator_t;
+struct ms_allocator {
+    void* (*malloc_fn)(void* ctx, size_t size);
+    void* (*calloc_fn)(void* ctx, size_t count, size_t size);
+    void* (*realloc_fn)(void* ctx, void* ptr, size_t size);
+    void (*free_fn)(void* ctx, void* ptr);
+    void* ctx;
+};
+
+const ms_allocator_t* ms_allocator_set(const ms_allocator_t* allocator);
+const ms_allocator_t* ms_allocator_get();
+const ms_allocator_t* ms_allocator_default();
+
+void* ms_mem_malloc(size_t size);
+void* ms_mem_calloc(size_t count, size_t size);
+void* ms_mem_realloc(void* ptr, size_t size);
+void ms_mem_free(void* ptr);
+void* ms_mem_malloc_tag(uint32_t tag, size_t size);
+void* ms_mem_calloc_tag(uint32_t tag, size_t count, size_t size);
+void* ms_mem_realloc_tag(uint32_t tag, void* ptr, size_t size);
+void* ms_mem_retag(void* ptr, uint32_t tag);
+void ms_mem_account(uint32_t tag, int64_t bytes, int64_t objects);
+ms_mem_usage_t* ms_mem_usage(uint32_t tag, ms_mem_usage_t* usage);
+const char* ms_mem_tag_name(uint32_t tag);
 
 /**
  * Free memory.
@@ -22,17 +80,26 @@
  */
 #define ms_free(ptr) \
     do { \
-        free(ptr); \
+        ms_mem_free(ptr); \
     } while (0)
 
 /** Alloc fixed size block. */
-#define ms_malloc(count, decl) (decl*)malloc(count * sizeof(decl))
+#define ms_malloc(count, decl) (decl*)ms_mem_malloc((count) * sizeof(decl))
 
 /** Alloc and clear a fixed size block. */
-#define ms_calloc(count, decl) (decl*)calloc(count, sizeof(decl))
+#define ms_calloc(count, decl) (decl*)ms_mem_calloc(count, sizeof(decl))
 
 /** Reallocate and existing block to a new size. */
-#define ms_realloc(ptr, count, decl) (decl*)realloc(ptr, count*sizeof(decl))
+#define ms_realloc(ptr, count, decl) (decl*)ms_mem_realloc(ptr, (count) * sizeof(decl))
+
+/** Alloc a fixed size block counted under tag. */
+#define ms_malloc_tag(tag, count, decl) (decl*)ms_mem_malloc_tag(tag, (count) * sizeof(decl))
+
+/** Alloc and clear a fixed size block counted under tag. */
+#define ms_calloc_tag(tag, count, decl) (decl*)ms_mem_calloc_tag(tag, count, sizeof(decl))
+
+/** Reallocate a block to a new size counted under tag. */
+#define ms_realloc_tag(tag, ptr, count, decl) (decl*)ms_mem_realloc_tag(tag, ptr, (count) * sizeof(decl))
 
 /** @} */
 
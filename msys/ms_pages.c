@@ -0,0 +1,17 @@
+/**
+ * @file
+ * @ingroup pages
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_pages.h"
+
+#ifdef WIN32
+#include "msys/win/ms_pages_win.c"
+#else
+#include "msys/posix/ms_pages_posix.c"
+#endif
+
+/** @} */
@@ -0,0 +1,37 @@
+#ifndef MS_PAGES_H
+#define MS_PAGES_H
+
+/**
+ * @file
+ * @defgroup pages Page mappings.
+ * @{
+ * Large, page aligned blocks mapped directly from the operating system, bypassing the
+ * installed allocator, e.g. for receive buffers that stay mapped for the process lifetime.
+ *
+ * Huge pages cut TLB misses when the block is walked at high rates. They are only used if
+ * asked for and the system has them available, otherwise normal pages are mapped (on Linux
+ * with a transparent huge page hint).
+ *
+ * A file can be mapped shared instead, stores then reach the file without write calls and
+ * are kept by the operating system even if the process crashes.
+ */
+
+#include "msys/ms_config.h"
+
+#define MS_PAGES_HUGE_SIZE  (2 * 1024 * 1024)   /**< Size huge mappings are rounded up to. */
+
+typedef struct ms_pages ms_pages_t;
+struct ms_pages {
+    void* base;
+    size_t size;        /**< Mapped bytes, the requested size rounded up to whole pages. */
+    int huge;           /**< 1 if backed by huge pages. */
+    int file;           /**< 1 if mapped from a file. */
+};
+
+ms_pages_t* ms_pages_init(ms_pages_t* pages, size_t size, int huge);
+ms_pages_t* ms_pages_map_file(ms_pages_t* pages, const char* path, size_t size);
+ms_pages_t* ms_pages_deinit(ms_pages_t* pages);
+
+/** @} */
+
+#endif
@@ -0,0 +1,341 @@
+/**
+ * @file
+ * @ingroup pool
+ * @{
+ */
+
+#include <string.h>
+
+#include "msys/ms_atomic.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_pool.h"
+
+/** Object and slab alignment, what malloc guarantees on common platforms. */
+#define ALIGNMENT   (2 * sizeof(void*))
+#define SLAB_BYTES  16384
+#define MIN_PER_SLAB 8
+
+/*
+ * The shared lists are guarded by a spin lock rather than an ms_mutex_t so that pools can be
+ * statically initialized. It is only held to move a batch of objects or to add a slab.
+ */
+#define lock(ptr) ms_spin_lock(ptr)
+#define unlock(ptr) ms_spin_unlock(ptr)
+
+/*
+ * A pool's id holds a generation above the index of its thread free lists, so one read of
+ * the id without the lock tells the lists of a pool from those of an earlier use of the index.
+ */
+#define INDEX_BITS      5
+#define INDEX(id)       ((uint32_t)((id) & ((1 << INDEX_BITS) - 1)))
+#define GENERATIONS     ((1L << (31 - INDEX_BITS)) - 1)
+
+/** A thread's free list for one pool. */
+typedef struct thread_list thread_list_t;
+struct thread_list {
+    void* head;
+    uint32_t count;
+    long id;                    /**< Of the pool the list belongs to. */
+    ms_pool_counts_t* counts;   /**< The thread's gets and puts for the pool. */
+    int64_t others;             /**< Objects other threads had out when this one last moved a batch. */
+    int64_t peak;               /**< Most objects out seen by this thread, not yet in the pool's stats. */
+};
+
+static MS_THREAD_LOCAL thread_list_t thread_lists[MS_POOL_MAX];
+
+static volatile long registry_lock;
+static ms_pool_t* registry[MS_POOL_MAX];
+static long generations;
+
+#define NEXT(object) (*(void**)(object))
+#define SHARED_COUNTS(pool) (&(pool)->counts[MS_POOL_THREADS])
+
+static size_t stride_of(size_t size) {
+    if (size < sizeof(void*)) size = sizeof(void*);
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+ms_pool_t* ms_pool_alloc() {
+    return ms_calloc(1, ms_pool_t);
+}
+
+ms_pool_t* ms_pool_init(ms_pool_t* pool, const char* name, size_t size) {
+    memset(pool, 0, sizeof(ms_pool_t));
+    pool->name = name;
+    pool->size = size;
+    pool->stride = stride_of(size);
+
+    return pool;
+}
+
+/**
+ * Free all the slabs. Every object must have been put back or no longer be used.
+ */
+ms_pool_t* ms_pool_deinit(ms_pool_t* pool) {
+    void* slab = pool->slabs;
+
+    while (slab) {
+        void* next = NEXT(slab);
+        ms_free(slab);
+        slab = next;
+    }
+
+    lock(&registry_lock);
+    if (INDEX(pool->id) && INDEX(pool->id) <= MS_POOL_MAX) registry[INDEX(pool->id) - 1] = 0;
+    unlock(&registry_lock);
+
+    pool->id = 0;
+    pool->freelist = 0;
+    pool->slabs = 0;
+    memset(&pool->stats, 0, sizeof(ms_pool_stats_t));
+    pool->nthreads = 0;
+    memset(pool->counts, 0, sizeof(pool->counts));
+
+    return pool;
+}
+
+/**
+ * Give the pool a thread free list index, or MS_POOL_MAX + 1 if they are all taken.
+ * @return the pool's id.
+ */
+static long register_pool(ms_pool_t* pool) {
+    uint32_t slot;
+    long id;
+
+    lock(&registry_lock);
+    if (pool->id == 0) {
+        for (slot = 0; slot < MS_POOL_MAX && registry[slot]; slot++) {}
+        if (slot < MS_POOL_MAX) {
+            registry[slot] = pool;
+            generations = generations == GENERATIONS ? 1 : generations + 1;
+            pool->id = generations << INDEX_BITS | (long)(slot + 1);
+        }
+        else {
+            pool->id = MS_POOL_MAX + 1;
+        }
+    }
+    id = pool->id;
+    unlock(&registry_lock);
+
+    return id;
+}
+
+/** Hand the calling thread counts of its own, or the shared ones once they have run out. */
+static ms_pool_counts_t* claim_counts(ms_pool_t* pool) {
+    long index = pool->nthreads < MS_POOL_THREADS ? ms_atomic_increment(&pool->nthreads) - 1 : MS_POOL_THREADS;
+
+    return &pool->counts[index < MS_POOL_THREADS ? index : MS_POOL_THREADS];
+}
+
+/** @return the calling thread's free list for the pool or 0 if it has none. */
+static thread_list_t* thread_list(ms_pool_t* pool) {
+    thread_list_t* list;
+    long id = pool->id;
+
+    if (id == 0) id = register_pool(pool);
+    if (INDEX(id) > MS_POOL_MAX) return 0;
+
+    list = &thread_lists[INDEX(id) - 1];
+    if (list->id != id) {
+        /* Left over from a pool that was deinitialized, its objects are gone. */
+        memset(list, 0, sizeof(thread_list_t));
+        list->id = id;
+        list->counts = claim_counts(pool);
+    }
+    return list;
+}
+
+/** Count a get or put, the shared counts are updated atomically. */
+static void count(ms_pool_t* pool, volatile int64_t* counter) {
+    if ((char*)counter >= (char*)SHARED_COUNTS(pool)) ms_atomic_add64(counter, 1);
+    else (*counter)++;
+}
+
+/** @return the objects out, summed over the threads' counts. */
+static int64_t outstanding(const ms_pool_t* pool) {
+    long nthreads = pool->nthreads < MS_POOL_THREADS ? pool->nthreads : MS_POOL_THREADS;
+    int64_t sum = SHARED_COUNTS(pool)->gets - SHARED_COUNTS(pool)->puts;
+    long ithread;
+
+    for (ithread = 0; ithread < nthreads; ithread++) sum += pool->counts[ithread].gets - pool->counts[ithread].puts;
+    return sum;
+}
+
+/** Raise the high-water mark, call locked. */
+static void raise_highwater(ms_pool_t* pool, int64_t out) {
+    if (out > (int64_t)pool->stats.highwater) pool->stats.highwater = (uint32_t)out;
+}
+
+/** Fold the thread's peak into the stats and see what the other threads have out, call locked. */
+static void sync_counts(ms_pool_t* pool, thread_list_t* list) {
+    raise_highwater(pool, list->peak);
+    list->others = outstanding(pool) - (list->counts->gets - list->counts->puts);
+}
+
+/** Add a slab to the shared free list, call locked. @return 0 if allocation fails. */
+static int add_slab(ms_pool_t* pool) {
+    uint32_t perslab;
+    uint32_t iobject;
+    char* slab;
+
+    if (pool->stride == 0) pool->stride = stride_of(pool->size);
+    perslab = (uint32_t)((SLAB_BYTES - ALIGNMENT) / pool->stride);
+    if (perslab < MIN_PER_SLAB) perslab = MIN_PER_SLAB;
+
+    slab = ms_malloc_tag(pool->tag, ALIGNMENT + perslab * pool->stride, char);
+    if (slab == 0) return 0;
+    NEXT(slab) = pool->slabs;
+    pool->slabs = slab;
+
+    /* Push in reverse so objects are handed out in address order. */
+    iobject = perslab;
+    while (iobject-- > 0) {
+        void* object = slab + ALIGNMENT + iobject * pool->stride;
+        NEXT(object) = pool->freelist;
+        pool->freelist = object;
+    }
+    pool->stats.nslabs++;
+    pool->stats.capacity += perslab;
+
+    return 1;
+}
+
+/** Pop from the shared free list, call locked. @return the object or 0 if allocation fails. */
+static void* pop_shared(ms_pool_t* pool) {
+    void* object;
+
+    if (pool->freelist == 0 && !add_slab(pool)) return 0;
+    object = pool->freelist;
+    pool->freelist = NEXT(object);
+
+    return object;
+}
+
+/** Push onto the shared free list, call locked. */
+static void push_shared(ms_pool_t* pool, void* object) {
+    NEXT(object) = pool->freelist;
+    pool->freelist = object;
+}
+
+/** Move up to nobjects from the thread's list to the shared one. */
+static void give_back(ms_pool_t* pool, thread_list_t* list, uint32_t nobjects) {
+    lock(&pool->lock);
+    while (nobjects-- > 0 && list->head) {
+        void* object = list->head;
+        list->head = NEXT(object);
+        list->count--;
+        push_shared(pool, object);
+    }
+    sync_counts(pool, list);
+    unlock(&pool->lock);
+}
+
+/**
+ * Make sure the pool holds at least count objects, e.g. to preallocate the working set.
+ * @return 1 on success, 0 if allocation fails.
+ */
+int ms_pool_reserve(ms_pool_t* pool, uint32_t count) {
+    int result = 1;
+
+    lock(&pool->lock);
+    while (result && pool->stats.capacity < count) result = add_slab(pool);
+    unlock(&pool->lock);
+
+    return result;
+}
+
+/**
+ * Take an object from the pool, its contents are undefined.
+ * @return the object or 0 if allocation fails.
+ */
+void* ms_pool_get(ms_pool_t* pool) {
+    thread_list_t* list = thread_list(pool);
+    void* object;
+    int64_t out;
+
+    if (list == 0) {
+        lock(&pool->lock);
+        object = pop_shared(pool);
+        if (object) {
+            count(pool, &SHARED_COUNTS(pool)->gets);
+            raise_highwater(pool, outstanding(pool));
+        }
+        unlock(&pool->lock);
+        return object;
+    }
+
+    if (list->head == 0) {
+        uint32_t nobjects;
+
+        lock(&pool->lock);
+        for (nobjects = 0; nobjects < MS_POOL_BATCH; nobjects++) {
+            object = pop_shared(pool);
+            if (object == 0) break;
+            NEXT(object) = list->head;
+            list->head = object;
+            list->count++;
+        }
+        sync_counts(pool, list);
+        unlock(&pool->lock);
+        if (list->head == 0) return 0;
+    }
+
+    object = list->head;
+    list->head = NEXT(object);
+    list->count--;
+
+    count(pool, &list->counts->gets);
+    out = list->counts->gets - list->counts->puts + list->others;
+    if (out > list->peak) list->peak = out;
+    return object;
+}
+
+/** Return an object to the pool it came from, 0 is ignored. */
+void ms_pool_put(ms_pool_t* pool, void* object) {
+    thread_list_t* list;
+
+    if (object == 0) return;
+    list = thread_list(pool);
+    if (list == 0) {
+        lock(&pool->lock);
+        push_shared(pool, object);
+        count(pool, &SHARED_COUNTS(pool)->puts);
+        unlock(&pool->lock);
+        return;
+    }
+
+    NEXT(object) = list->head;
+    list->head = object;
+    list->count++;
+    count(pool, &list->counts->puts);
+    if (list->count > 2 * MS_POOL_BATCH) give_back(pool, list, MS_POOL_BATCH);
+}
+
+/** Return the calling thread's cached objects to the shared free list. */
+void ms_pool_flush(ms_pool_t* pool) {
+    thread_list_t* list = thread_list(pool);
+
+    if (list) give_back(pool, list, list->count);
+}
+
+/**
+ * Copy the pool's statistics. The counts are summed over the threads without stopping them,
+ * and another thread's high-water mark is only seen once it next moves a batch or flushes.
+ * @return stats.
+ */
+ms_pool_stats_t* ms_pool_stats(ms_pool_t* pool, ms_pool_stats_t* stats) {
+    thread_list_t* list = thread_list(pool);
+    int64_t out;
+
+    lock(&pool->lock);
+    if (list) sync_counts(pool, list);
+    out = outstanding(pool);
+    raise_highwater(pool, out);
+    memcpy(stats, &pool->stats, sizeof(ms_pool_stats_t));
+    stats->outstanding = out > 0 ? (uint32_t)out : 0;
+    unlock(&pool->lock);
+
+    return stats;
+}
+
+/** @} */
@@ -0,0 +1,75 @@
+#ifndef MS_POOL_H
+#define MS_POOL_H
+
+/**
+ * @file
+ * @defgroup pool Fixed size object pools.
+ * @{
+ * Slab pools for objects of one size that are allocated and freed over and over.
+ *
+ * Objects are carved out of slabs allocated with ms_malloc and are never given back to the
+ * allocator until the pool is deinitialized. Each thread keeps a short free list per pool,
+ * so ms_pool_get and ms_pool_put are a pointer pop and push. The shared free list is only
+ * locked to move a batch of objects between it and a thread's list. Each thread also counts
+ * its own gets and puts, ms_pool_stats sums them.
+ *
+ * A pool can be defined statically with MS_POOL_STATIC and used without an init call.
+ * Objects cached by a thread that exits stay in its list and are not reused, a thread that
+ * allocated from a pool should call ms_pool_flush before it exits.
+ */
+
+#include "msys/ms_config.h"
+#include "msys/ms_memory.h"
+
+#define MS_POOL_MAX     16      /**< Pools that can have thread free lists at once, others always lock. */
+#define MS_POOL_BATCH   32      /**< Objects moved between a thread's free list and the shared one. */
+#define MS_POOL_THREADS 64      /**< Threads with their own counts per pool, later threads share one. */
+
+/** Define a pool in a static initializer. */
+#define MS_POOL_STATIC(name, size) MS_POOL_STATIC_TAG(name, size, MS_MEM_OTHER)
+
+/** Define a pool whose slabs are counted under a memory tag, see ms_mem_usage(). */
+#define MS_POOL_STATIC_TAG(name, size, tag) { name, size, 0, tag, 0, 0, 0, 0, { 0, 0, 0, 0 }, 0, { { 0, 0 } } }
+
+typedef struct ms_pool_stats ms_pool_stats_t;
+struct ms_pool_stats {
+    uint32_t nslabs;
+    uint32_t capacity;          /**< Objects in all the slabs. */
+    uint32_t outstanding;       /**< Objects taken with ms_pool_get and not put back. */
+    uint32_t highwater;         /**< Most objects outstanding at once, other threads' as of their last batch. */
+};
+
+/** One thread's gets and puts, written by that thread. */
+typedef struct ms_pool_counts ms_pool_counts_t;
+struct ms_pool_counts {
+    volatile int64_t gets;
+    volatile int64_t puts;
+};
+
+typedef struct ms_pool ms_pool_t;
+struct ms_pool {
+    const char* name;
+    size_t size;                /**< Requested object size. */
+    size_t stride;              /**< Object size rounded up for alignment. */
+    uint32_t tag;               /**< Memory tag of the slabs, MS_MEM_OTHER unless set. */
+    volatile long lock;
+    volatile long id;           /**< Generation and thread free list index + 1 in one word, 0 until first used. */
+    void* freelist;
+    void* slabs;
+    ms_pool_stats_t stats;
+    volatile long nthreads;     /**< Threads that took counts of their own. */
+    ms_pool_counts_t counts[MS_POOL_THREADS + 1];   /**< The last are shared by the threads past MS_POOL_THREADS. */
+};
+
+ms_pool_t* ms_pool_alloc();
+ms_pool_t* ms_pool_init(ms_pool_t* pool, const char* name, size_t size);
+ms_pool_t* ms_pool_deinit(ms_pool_t* pool);
+int ms_pool_reserve(ms_pool_t* pool, uint32_t count);
+void* ms_pool_get(ms_pool_t* pool);
+void ms_pool_put(ms_pool_t* pool, void* object);
+void ms_pool_flush(ms_pool_t* pool);
+ms_pool_stats_t* ms_pool_stats(ms_pool_t* pool, ms_pool_stats_t* stats);
+
+/** @} */
+
+#endif
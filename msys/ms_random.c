@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @ingroup random
+ * @{
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_random.h"
+
+#ifdef WIN32
+#include "msys/win/ms_random_win.c"
+#else
+#include "msys/posix/ms_random_posix.c"
+#endif
+
+static MS_THREAD_LOCAL ms_random_t thread_rng;
+static MS_THREAD_LOCAL int thread_rng_seeded;
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/* splitmix64, used to expand a 64 bit seed into the xoshiro state. */
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+ms_random_t* ms_random_alloc() {
+    return ms_calloc(1, ms_random_t);
+}
+
+/**
+ * Seed a generator from the operating system's entropy source.
+ * If that fails the seed falls back to the clock and the state's address.
+ * @return the generator.
+ */
+ms_random_t* ms_random_init(ms_random_t* rng) {
+    uint64_t seed;
+
+    if (!ms_random_os_bytes((uint8_t*)rng->s, sizeof(rng->s))) {
+        seed = (uint64_t)time(0) ^ (uint64_t)(uintptr_t)rng ^ (uint64_t)clock();
+        return ms_random_init_seed(rng, seed);
+    }
+
+    /* The all zero state is a fixed point. */
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) return ms_random_init_seed(rng, 0);
+    return rng;
+}
+
+/**
+ * Seed a generator deterministically, the same seed gives the same sequence.
+ * @return the generator.
+ */
+ms_random_t* ms_random_init_seed(ms_random_t* rng, uint64_t seed) {
+    rng->s[0] = splitmix64(&seed);
+    rng->s[1] = splitmix64(&seed);
+    rng->s[2] = splitmix64(&seed);
+    rng->s[3] = splitmix64(&seed);
+
+    return rng;
+}
+
+/**
+ * Return the calling thread's generator, seeding it on first use.
+ * The pointer must not be shared with other threads.
+ */
+ms_random_t* ms_random_thread() {
+    if (!thread_rng_seeded) {
+        ms_random_init(&thread_rng);
+        thread_rng_seeded = 1;
+    }
+    return &thread_rng;
+}
+
+/** @return the next 64 random bits. */
+uint64_t ms_random_next(ms_random_t* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+/** @return a random double in [0, 1). */
+double ms_random_fraction(ms_random_t* rng) {
+    return (double)(ms_random_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Fill bytes with random bytes, 8 at a time. */
+void ms_random_fill(ms_random_t* rng, uint8_t* bytes, size_t nbytes) {
+    uint64_t value;
+
+    while (nbytes >= sizeof(uint64_t)) {
+        value = ms_random_next(rng);
+        memcpy(bytes, &value, sizeof(uint64_t));
+        bytes += sizeof(uint64_t);
+        nbytes -= sizeof(uint64_t);
+    }
+    if (nbytes > 0) {
+        value = ms_random_next(rng);
+        memcpy(bytes, &value, nbytes);
+    }
+}
+
+/** @} */
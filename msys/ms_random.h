@@ -0,0 +1,35 @@
+#ifndef MS_RANDOM_H
+#define MS_RANDOM_H
+
+/**
+ * @file
+ * @defgroup random Random Numbers
+ * @{
+ * Fast non-cryptographic pseudo random numbers (xoshiro256**).
+ *
+ * Each ms_random_t holds its own state, so generators owned by one thread never contend
+ * with each other the way rand() does on libc's global state. ms_random_thread() returns a
+ * generator local to the calling thread, seeded from the OS on first use.
+ */
+
+#include <stddef.h>
+
+#include "msys/ms_config.h"
+
+typedef struct ms_random ms_random_t;
+struct ms_random {
+    uint64_t s[4];
+};
+
+ms_random_t* ms_random_alloc();
+ms_random_t* ms_random_init(ms_random_t* rng);
+ms_random_t* ms_random_init_seed(ms_random_t* rng, uint64_t seed);
+ms_random_t* ms_random_thread();
+uint64_t ms_random_next(ms_random_t* rng);
+double ms_random_fraction(ms_random_t* rng);
+void ms_random_fill(ms_random_t* rng, uint8_t* bytes, size_t nbytes);
+int ms_random_os_bytes(uint8_t* bytes, size_t nbytes);
+
+/** @} */
+
+#endif
@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <pthread.h>
+
+#include "msys/ms_config.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_cond.h"
+
+/**
+ * @file
+ * @defgroup cond
+ * @{
+ * Simple cross platform condition variable implementations using posix calls.
+ */
+
+/** Implementation private condition variable structure. */
+typedef struct cond_posix cond_posix_t;
+struct cond_posix {
+    pthread_cond_t cond; /**< condition variable. */
+};
+
+/**
+ * Allocate a condition variable.
+ * @return the allocated condition variable.
+ */
+ms_cond_t* ms_cond_alloc() {
+    return (ms_cond_t*)ms_calloc(1, cond_posix_t);
+}
+
+/**
+ * Initialize a condition variable.
+ * @return the initialized condition variable.
+ */
+ms_cond_t* ms_cond_init(ms_cond_t* cond) {
+    int rc;
+    cond_posix_t* mycond = (cond_posix_t*)cond;
+
+    rc = pthread_cond_init(&mycond->cond, NULL);
+    assert(rc == 0);
+    return cond;
+}
+
+/**
+ * Deinitialize a condition variable.
+ */
+ms_cond_t* ms_cond_deinit(ms_cond_t* cond) {
+    int rc;
+    cond_posix_t* mycond = (cond_posix_t*)cond;
+
+    rc = pthread_cond_destroy(&mycond->cond);
+    assert(rc == 0);
+    return cond;
+}
+
+/**
+ * Wait on a condition variable.
+ * The posix mutex structure starts with its pthread_mutex_t.
+ * @return 0 on failure.
+ */
+int ms_cond_wait(ms_cond_t* cond, ms_mutex_t* mutex) {
+    cond_posix_t* mycond = (cond_posix_t*)cond;
+
+    return pthread_cond_wait(&mycond->cond, (pthread_mutex_t*)mutex) == 0;
+}
+
+/**
+ * Wake one waiting thread.
+ * @return 0 on failure.
+ */
+int ms_cond_signal(ms_cond_t* cond) {
+    cond_posix_t* mycond = (cond_posix_t*)cond;
+
+    return pthread_cond_signal(&mycond->cond) == 0;
+}
+
+/**
+ * Wake all waiting threads.
+ * @return 0 on failure.
+ */
+int ms_cond_broadcast(ms_cond_t* cond) {
+    cond_posix_t* mycond = (cond_posix_t*)cond;
+
+    return pthread_cond_broadcast(&mycond->cond) == 0;
+}
+
+/** @} */
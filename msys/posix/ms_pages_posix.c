@@ -0,0 +1,101 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "msys/ms_config.h"
+#include "msys/ms_pages.h"
+
+/**
+ * @file
+ * @ingroup pages
+ * @{
+ * Page mappings with mmap(), huge pages with MAP_HUGETLB where it is defined.
+ * Files are mapped MAP_SHARED.
+ */
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static size_t round_up(size_t size, size_t unit) {
+    return (size + unit - 1) / unit * unit;
+}
+
+/**
+ * Map zeroed memory, trying huge pages first if huge is set.
+ * @return the initialized pages or 0 if the mapping fails.
+ */
+ms_pages_t* ms_pages_init(ms_pages_t* pages, size_t size, int huge) {
+    size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    void* base = MAP_FAILED;
+
+    memset(pages, 0, sizeof(ms_pages_t));
+    if (size == 0) return 0;
+
+#ifdef MAP_HUGETLB
+    if (huge) {
+        pages->size = round_up(size, MS_PAGES_HUGE_SIZE);
+        base = mmap(0, pages->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        pages->huge = base != MAP_FAILED;
+    }
+#endif
+
+    if (base == MAP_FAILED) {
+        pages->size = round_up(size, pagesize);
+        base = mmap(0, pages->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            memset(pages, 0, sizeof(ms_pages_t));
+            return 0;
+        }
+#ifdef MADV_HUGEPAGE
+        if (huge) madvise(base, pages->size, MADV_HUGEPAGE);
+#endif
+    }
+
+    pages->base = base;
+    return pages;
+}
+
+/**
+ * Map a file of at least size bytes shared and writable. The file is created, or truncated
+ * if it exists, and reads as zeros until written.
+ * @return the initialized pages or 0 if the file can not be created or mapped.
+ */
+ms_pages_t* ms_pages_map_file(ms_pages_t* pages, const char* path, size_t size) {
+    void* base;
+    int fd;
+
+    memset(pages, 0, sizeof(ms_pages_t));
+    if (size == 0) return 0;
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+
+    pages->size = round_up(size, (size_t)sysconf(_SC_PAGESIZE));
+    base = ftruncate(fd, (off_t)pages->size) == 0
+         ? mmap(0, pages->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+         : MAP_FAILED;
+
+    /* The mapping keeps the file open. */
+    close(fd);
+    if (base == MAP_FAILED) {
+        memset(pages, 0, sizeof(ms_pages_t));
+        return 0;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(base, pages->size, MADV_SEQUENTIAL);
+#endif
+
+    pages->base = base;
+    pages->file = 1;
+    return pages;
+}
+
+ms_pages_t* ms_pages_deinit(ms_pages_t* pages) {
+    if (pages->base) munmap(pages->base, pages->size);
+    memset(pages, 0, sizeof(ms_pages_t));
+
+    return pages;
+}
+
+/** @} */
@@ -0,0 +1,56 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+
+#include "msys/ms_config.h"
+#include "msys/ms_random.h"
+
+/**
+ * @file
+ * @ingroup random
+ * @{
+ * Operating system entropy for seeding using getrandom() or /dev/urandom.
+ */
+
+/* Read nbytes from /dev/urandom. */
+static int urandom_bytes(uint8_t* bytes, size_t nbytes) {
+    int fd = open("/dev/urandom", O_RDONLY);
+    size_t got = 0;
+
+    if (fd < 0) return 0;
+    while (got < nbytes) {
+        ssize_t n = read(fd, bytes + got, nbytes - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+
+    return got == nbytes;
+}
+
+/**
+ * Fill bytes from the operating system's entropy source.
+ * @return 1 on success, 0 on failure.
+ */
+int ms_random_os_bytes(uint8_t* bytes, size_t nbytes) {
+#ifdef __linux__
+    size_t got = 0;
+
+    while (got < nbytes) {
+        ssize_t n = getrandom(bytes + got, nbytes - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return urandom_bytes(bytes, nbytes);
+        got += (size_t)n;
+    }
+    return 1;
+#else
+    return urandom_bytes(bytes, nbytes);
+#endif
+}
+
+/** @} */
@@ -1,4 +1,5 @@
 #include <signal.h>
+#include <time.h>
 #include <assert.h>
 #include <pthread.h>
 
@@ -14,7 +15,7 @@
 
 typedef struct thread_posix thread_posix_t;
 struct thread_posix {
-    ms_thread_fn_t* thread_fn;
+    ms_thread_fn_t thread_fn;
     void* rdata;
     pthread_t handle;
 };
@@ -33,7 +34,7 @@ static void* thread_main_fn(void* arg) {
     return NULL;
 }
 
-ms_thread_t* ms_thread_init (ms_thread_t* thread, ms_thread_fn_t* thread_fn, void* rdata) {
+ms_thread_t* ms_thread_init (ms_thread_t* thread, ms_thread_fn_t thread_fn, void* rdata) {
     int rc;
     sigset_t new_sigmask;
     sigset_t old_sigmask;
@@ -70,4 +71,15 @@ ms_thread_t* ms_thread_deinit(ms_thread_t* thread) {
     return thread;
 }
 
+/** Sleep the calling thread for at least seconds. */
+void ms_thread_sleep(double seconds) {
+    struct timespec t;
+    struct timespec r;
+
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)((seconds - t.tv_sec) * 1.0e9);
+    if (t.tv_nsec >= 1000000000) t.tv_nsec = 999999999;
+    while (nanosleep(&t, &r) != 0) t = r;
+}
+
 /** @} */
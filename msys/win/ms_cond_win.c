@@ -0,0 +1,57 @@
+#include <assert.h>
+
+#include "msys/ms_config.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_cond.h"
+
+/**
+ * @file
+ * @defgroup cond
+ * @{
+ * Simple cross platform condition variable implementations for windows.
+ */
+
+typedef struct cond_win cond_win_t;
+struct cond_win {
+    CONDITION_VARIABLE cond;
+};
+
+/**  Allocate a condition variable. */
+ms_cond_t* ms_cond_alloc() {
+    return (ms_cond_t*)ms_calloc(1, cond_win_t);
+}
+
+ms_cond_t* ms_cond_init(ms_cond_t* cond) {
+    cond_win_t* mycond = (cond_win_t*)cond;
+
+    InitializeConditionVariable(&mycond->cond);
+    return cond;
+}
+
+/** Windows condition variables need no cleanup. */
+ms_cond_t* ms_cond_deinit(ms_cond_t* cond) {
+    return cond;
+}
+
+/** The windows mutex structure starts with its CRITICAL_SECTION. */
+int ms_cond_wait(ms_cond_t* cond, ms_mutex_t* mutex) {
+    cond_win_t* mycond = (cond_win_t*)cond;
+
+    return SleepConditionVariableCS(&mycond->cond, (CRITICAL_SECTION*)mutex, INFINITE) != 0;
+}
+
+int ms_cond_signal(ms_cond_t* cond) {
+    cond_win_t* mycond = (cond_win_t*)cond;
+
+    WakeConditionVariable(&mycond->cond);
+    return 1;
+}
+
+int ms_cond_broadcast(ms_cond_t* cond) {
+    cond_win_t* mycond = (cond_win_t*)cond;
+
+    WakeAllConditionVariable(&mycond->cond);
+    return 1;
+}
+
+/** @} */
@@ -0,0 +1,95 @@
+#include <windows.h>
+
+#include "msys/ms_config.h"
+#include "msys/ms_pages.h"
+
+/**
+ * @file
+ * @ingroup pages
+ * @{
+ * Page mappings with VirtualAlloc(), huge pages with MEM_LARGE_PAGES, which needs the
+ * SeLockMemoryPrivilege. Files are mapped with MapViewOfFile().
+ */
+
+static size_t round_up(size_t size, size_t unit) {
+    return (size + unit - 1) / unit * unit;
+}
+
+/**
+ * Map zeroed memory, trying large pages first if huge is set.
+ * @return the initialized pages or 0 if the mapping fails.
+ */
+ms_pages_t* ms_pages_init(ms_pages_t* pages, size_t size, int huge) {
+    SYSTEM_INFO info;
+    SIZE_T large = GetLargePageMinimum();
+    void* base = 0;
+
+    memset(pages, 0, sizeof(ms_pages_t));
+    if (size == 0) return 0;
+
+    if (huge && large > 0) {
+        pages->size = round_up(size, large);
+        base = VirtualAlloc(0, pages->size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        pages->huge = base != 0;
+    }
+
+    if (base == 0) {
+        GetSystemInfo(&info);
+        pages->size = round_up(size, info.dwPageSize);
+        base = VirtualAlloc(0, pages->size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (base == 0) {
+            memset(pages, 0, sizeof(ms_pages_t));
+            return 0;
+        }
+    }
+
+    pages->base = base;
+    return pages;
+}
+
+/**
+ * Map a file of at least size bytes shared and writable. The file is created, or truncated
+ * if it exists, and reads as zeros until written.
+ * @return the initialized pages or 0 if the file can not be created or mapped.
+ */
+ms_pages_t* ms_pages_map_file(ms_pages_t* pages, const char* path, size_t size) {
+    SYSTEM_INFO info;
+    HANDLE file;
+    HANDLE mapping;
+    void* base = 0;
+
+    memset(pages, 0, sizeof(ms_pages_t));
+    if (size == 0) return 0;
+
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    GetSystemInfo(&info);
+    pages->size = round_up(size, info.dwPageSize);
+
+    /* Creating the mapping extends the file, the view keeps both open. */
+    mapping = CreateFileMappingA(file, 0, PAGE_READWRITE, (DWORD)((uint64_t)pages->size >> 32), (DWORD)pages->size, 0);
+    if (mapping) {
+        base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, pages->size);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (base == 0) {
+        memset(pages, 0, sizeof(ms_pages_t));
+        return 0;
+    }
+
+    pages->base = base;
+    pages->file = 1;
+    return pages;
+}
+
+ms_pages_t* ms_pages_deinit(ms_pages_t* pages) {
+    if (pages->base && pages->file) UnmapViewOfFile(pages->base);
+    else if (pages->base) VirtualFree(pages->base, 0, MEM_RELEASE);
+    memset(pages, 0, sizeof(ms_pages_t));
+
+    return pages;
+}
+
+/** @} */
@@ -0,0 +1,22 @@
+#include "msys/ms_config.h"
+#include "msys/ms_random.h"
+
+#include <bcrypt.h>
+
+/**
+ * @file
+ * @ingroup random
+ * @{
+ * Operating system entropy for seeding using BCryptGenRandom().
+ */
+
+/**
+ * Fill bytes from the operating system's entropy source.
+ * @return 1 on success, 0 on failure.
+ */
+int ms_random_os_bytes(uint8_t* bytes, size_t nbytes) {
+    NTSTATUS status = BCryptGenRandom(NULL, bytes, (ULONG)nbytes, BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+    return BCRYPT_SUCCESS(status);
+}
+
+/** @} */
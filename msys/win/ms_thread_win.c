@@ -14,7 +14,7 @@
 
 typedef struct thread_win thread_win_t;
 struct thread_win {
-    ms_thread_fn_t* thread_fn;
+    ms_thread_fn_t thread_fn;
     void* rdata;
     HANDLE handle;
 };
@@ -32,7 +32,7 @@ static unsigned int __stdcall thread_main_fn(void* arg) {
     return 0;
 }
 
-ms_thread_t* ms_thread_init(ms_thread_t* thread, ms_thread_fn_t* thread_fn, void* rdata) {
+ms_thread_t* ms_thread_init(ms_thread_t* thread, ms_thread_fn_t thread_fn, void* rdata) {
     thread_win_t* mythread = (thread_win_t*)thread;
     
     mythread->thread_fn = thread_fn;
@@ -58,4 +58,9 @@ ms_thread_t* ms_thread_deinit(ms_thread_t* thread) {
     return thread;
 }
 
+/** Sleep the calling thread for at least seconds. */
+void ms_thread_sleep(double seconds) {
+    Sleep((DWORD)(seconds * 1000.0 + 0.5));
+}
+
 /** @} */
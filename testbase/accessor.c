@@ -12,16 +12,16 @@
  */
 mc_buffer_t* mc_endpt_udp_copy_queued_token(mc_endpt_udp_t* endpt, uint16_t msgid) {
     mc_buffer_queue_t* queue = &endpt->confirmq;
-    mc_buffer_queue_entry_t* entry = mc_buffer_queue_get(queue, msgid);
+    uint32_t slot = mc_buffer_queue_get(queue, msgid);
     uint32_t header;
     uint32_t tklen;
     uint32_t bpos;
 
-    if (entry == 0) return 0;
+    if (slot == MC_BUFFER_QUEUE_NONE) return 0;
 
     bpos = 0;
-    header = ms_swap_u32(mc_buffer_next_uint32(entry->msg, &bpos));
+    header = ms_swap_u32(mc_buffer_next_uint32(&queue->msgs[slot]->view, &bpos));
     tklen = (uint32_t)mc_header_get_token_length(header);
 
-    return mc_buffer_copy(entry->msg, 4, tklen);
+    return mc_buffer_copy(&queue->msgs[slot]->view, 4, tklen);
 }
\ No newline at end of file
@@ -87,8 +87,8 @@ static void test_get_con(CuTest* tc) {
     cformat = get_option(msg->options, OPTION_CONTENT_FORMAT);
     CuAssert(tc, "Format option should exist", cformat != 0);
 
-    if (token) ms_free(mc_buffer_deinit(token));
-    if (msg) ms_free(mc_message_deinit(msg));
+    if (token) mc_buffer_free(token);
+    if (msg) mc_message_free(msg);
     mc_endpt_udp_deinit(&endpt);
 }
 
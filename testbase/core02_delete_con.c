@@ -90,8 +90,8 @@ static void test_delete_con(CuTest* tc) {
         ms_log_debug("The payload is null");
     }
 
-    if (token) ms_free(mc_buffer_deinit(token));
-    if (msg) ms_free(mc_message_deinit(msg));
+    if (token) mc_buffer_free(token);
+    if (msg) mc_message_free(msg);
     mc_endpt_udp_deinit(&endpt);
 }
 
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_endpt_udp.h"
+#include "testmc/mc_alloc_budget_test.h"
+
+#include "cutest/CuTest.h"
+
+/*
+ * Steady state heap allocations allowed per message. Lower these when an allocation is
+ * removed from the path, a change that raises them has to justify it here.
+ * What is left is decoding received options: the list, its option array and each value,
+ * and for a confirmable request the copy kept in the confirm queue for retransmission.
+ */
+#define ECHO_ALLOCS_PER_MESSAGE     3.0
+#define REQUEST_ALLOCS_PER_MESSAGE  2.0
+
+#define WARMUP_EXCHANGES    100
+#define EXCHANGES           2000
+
+static const char* uri = "coap://127.0.0.1:5679/time";
+
+/* Counts the allocations and the bytes requested, delegating to the default allocator. */
+typedef struct {
+    uint32_t allocs;
+    uint64_t bytes;
+} counts_t;
+
+static void* count_malloc(void* ctx, size_t size) {
+    ((counts_t*)ctx)->allocs++;
+    ((counts_t*)ctx)->bytes += size;
+    return ms_allocator_default()->malloc_fn(0, size);
+}
+
+static void* count_calloc(void* ctx, size_t count, size_t size) {
+    ((counts_t*)ctx)->allocs++;
+    ((counts_t*)ctx)->bytes += count * size;
+    return ms_allocator_default()->calloc_fn(0, count, size);
+}
+
+static void* count_realloc(void* ctx, void* ptr, size_t size) {
+    ((counts_t*)ctx)->allocs++;
+    ((counts_t*)ctx)->bytes += size;
+    return ms_allocator_default()->realloc_fn(0, ptr, size);
+}
+
+static void count_free(void* ctx, void* ptr) {
+    ms_allocator_default()->free_fn(0, ptr);
+}
+
+static int acks;
+static int responses;
+
+static int count_ack(mc_endpt_id_t endpt, uint16_t msgid, int status) {
+    if (status == MN_DONE) acks++;
+    return 1;
+}
+
+static int count_response(mc_endpt_id_t endpt, uint16_t msgid, mc_message_t* response) {
+    if (response && mc_message_get_code(response) == MC_CONTENT) responses++;
+    return 1;
+}
+
+/* The tmserver path: a non-confirmable GET that the server echoes back. */
+static int echo_exchange(mc_endpt_udp_t* client, mc_endpt_udp_t* server) {
+    mc_message_t* msg;
+    int ok;
+
+    mc_endpt_udp_get(client, 0, 0, (char*)uri, 0);
+    msg = mc_endpt_udp_recv(server);
+    if (msg == 0) return 0;
+    mc_endpt_udp_send(server, &msg->from, msg, 0);
+    mc_message_free(msg);
+
+    msg = mc_endpt_udp_recv(client);
+    ok = msg != 0;
+    mc_message_free(msg);
+    return ok;
+}
+
+/* A confirmable GET, queued until the ack that piggybacks its response. */
+static int request_exchange(mc_endpt_udp_t* client, mc_endpt_udp_t* server) {
+    mc_message_t* msg;
+    int before = responses;
+    int acked = acks;
+
+    mc_endpt_udp_request(client, 0, MC_GET, (char*)uri, 0, 0, count_ack, count_response);
+    msg = mc_endpt_udp_recv(server);
+    if (msg == 0) return 0;
+    mc_endpt_udp_respond(server, msg, MC_CONTENT, 0, 0);
+    mc_message_free(msg);
+
+    mc_endpt_udp_recv(client);
+    return responses == before + 1 && acks == acked + 1;
+}
+
+/**
+ * Run warmed up exchanges through a counting allocator.
+ * @return the allocations per message, two messages per exchange, or -1 if an exchange failed.
+ */
+static double measure(const char* name, int (*exchange)(mc_endpt_udp_t*, mc_endpt_udp_t*)) {
+    counts_t counts = { 0, 0 };
+    ms_allocator_t counting = { count_malloc, count_calloc, count_realloc, count_free, &counts };
+    mc_endpt_udp_t client;
+    mc_endpt_udp_t server;
+    const ms_allocator_t* previous;
+    double nmessages = 2.0 * EXCHANGES;
+    int ok = 1;
+    int iexchange;
+
+    mc_endpt_udp_init(&client, 1024, 1024, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&server, 1024, 1024, "127.0.0.1", 5679);
+
+    for (iexchange = 0; ok && iexchange < WARMUP_EXCHANGES; iexchange++) ok = (*exchange)(&client, &server);
+
+    previous = ms_allocator_set(&counting);
+    for (iexchange = 0; ok && iexchange < EXCHANGES; iexchange++) ok = (*exchange)(&client, &server);
+    ms_allocator_set(previous);
+
+    mc_endpt_udp_deinit(&client);
+    mc_endpt_udp_deinit(&server);
+
+    printf("%s: %.2f allocations, %.1f bytes per message\n", name, counts.allocs / nmessages, counts.bytes / nmessages);
+    return ok ? counts.allocs / nmessages : -1.0;
+}
+
+/**
+ *  Given a client and a server that echoes requests, warmed up,
+ *  When they exchange non-confirmable GETs,
+ *  Then the allocations per message stay within the budget.
+ */
+static void test_budget_echo(CuTest* tc) {
+    double allocs = measure("echo", echo_exchange);
+
+    CuAssert(tc, "exchanges completed", allocs >= 0.0);
+    CuAssert(tc, "within budget", allocs <= ECHO_ALLOCS_PER_MESSAGE);
+}
+
+/**
+ *  Given a client and a server, warmed up,
+ *  When the client sends confirmable GETs, each acked with its piggybacked response,
+ *  Then the allocations per message stay within the budget.
+ */
+static void test_budget_request(CuTest* tc) {
+    double allocs = measure("request/response", request_exchange);
+
+    CuAssert(tc, "exchanges completed", allocs >= 0.0);
+    CuAssert(tc, "within budget", allocs <= REQUEST_ALLOCS_PER_MESSAGE);
+}
+
+CuSuite* mc_alloc_budget_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_budget_echo);
+    SUITE_ADD_TEST(suite, test_budget_request);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MC_ALLOC_BUDGET_TEST_H
+#define MC_ALLOC_BUDGET_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_alloc_budget_suite();
+
+#endif
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_buffer_queue.h"
+#include "testmc/mc_buffer_queue_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_EXCHANGES 100000
+#define BENCH_SCANS     100
+
+/** Bytes of slot arrays per queued message. */
+#define SLOT_BYTES (sizeof(double) + sizeof(float) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(mn_peer_id_t) \
+                    + sizeof(mc_endpt_result_fn_t) + sizeof(mc_shared_buffer_t*) + sizeof(uint32_t))
+
+static mc_shared_buffer_t* mk_msg(uint16_t msgid) {
+    return mc_shared_buffer_create(sizeof(msgid), (const uint8_t*)&msgid);
+}
+
+/**
+ *  Given a queue,
+ *  When we add and remove messages,
+ *  Then they are found by message id, removed slots are reused and the queue holds a reference to each message.
+ */
+static void test_queue_slots(CuTest* tc) {
+    mc_buffer_queue_t queue;
+    mc_shared_buffer_t* msg = mk_msg(7);
+    uint32_t slots[3];
+    uint32_t slot;
+
+    mc_buffer_queue_init(&queue);
+    mc_shared_buffer_retain(msg);
+    slots[0] = mc_buffer_queue_add(&queue, 7, 1, msg, 0);
+    slots[1] = mc_buffer_queue_add(&queue, 8, 2, mk_msg(8), 0);
+    slots[2] = mc_buffer_queue_add(&queue, 9, 1, mk_msg(9), 0);
+
+    CuAssert(tc, "three queued", mc_buffer_queue_count(&queue) == 3);
+    CuAssert(tc, "found by msgid", mc_buffer_queue_get(&queue, 8) == slots[1]);
+    CuAssert(tc, "unknown msgid", mc_buffer_queue_get(&queue, 10) == MC_BUFFER_QUEUE_NONE);
+    CuAssert(tc, "peer kept", queue.peers[slots[2]] == 1);
+    CuAssert(tc, "queue holds a reference", msg->refs == 2);
+
+    CuAssert(tc, "removed", mc_buffer_queue_remove(&queue, 7) == 7);
+    CuAssert(tc, "reference released", msg->refs == 1);
+    CuAssert(tc, "removed not found", mc_buffer_queue_get(&queue, 7) == MC_BUFFER_QUEUE_NONE);
+    CuAssert(tc, "remove unknown", mc_buffer_queue_remove(&queue, 7) == UINT32_MAX);
+
+    slot = mc_buffer_queue_add(&queue, 11, 3, mk_msg(11), 0);
+    CuAssert(tc, "free slot reused", slot == slots[0]);
+    CuAssert(tc, "slots not grown", queue.nslots == 3);
+
+    mc_buffer_queue_remove(&queue, 8);
+    mc_buffer_queue_remove(&queue, 9);
+    mc_buffer_queue_remove(&queue, 11);
+    CuAssert(tc, "empty", mc_buffer_queue_count(&queue) == 0 && queue.nslots == 0);
+
+    mc_buffer_queue_deinit(&queue);
+    mc_shared_buffer_release(msg);
+}
+
+/**
+ *  Given a queue with slots that are past and before their deadlines,
+ *  When we scan for timeouts and back off,
+ *  Then only the expired slots are returned and the back off doubles the wait.
+ */
+static void test_queue_timeouts(CuTest* tc) {
+    mc_buffer_queue_t queue;
+    uint32_t islot;
+    uint32_t slot;
+    uint32_t nexpired = 0;
+    double now = mn_gettime();
+    float timeout;
+
+    mc_buffer_queue_init(&queue);
+    for (islot = 0; islot < 40; islot++) {
+        slot = mc_buffer_queue_add(&queue, (uint16_t)islot, 1, mk_msg((uint16_t)islot), 0);
+        if (islot % 10 == 3) queue.deadlines[slot] = now - 1.0;
+    }
+    CuAssert(tc, "slots survive growth", mc_buffer_queue_get(&queue, 39) == 39 && queue.capacity >= 40);
+    CuAssert(tc, "has timeout", mc_buffer_queue_has_timeout(&queue));
+
+    slot = mc_buffer_queue_next_timeout(&queue, 0, now);
+    while (slot != MC_BUFFER_QUEUE_NONE) {
+        CuAssert(tc, "expired slot", queue.msgids[slot] % 10 == 3);
+        nexpired++;
+
+        timeout = queue.timeouts[slot];
+        mc_buffer_queue_backoff(&queue, slot, now);
+        CuAssert(tc, "wait doubled", queue.timeouts[slot] == 2.0f * timeout && queue.deadlines[slot] > now);
+        slot = mc_buffer_queue_next_timeout(&queue, slot + 1, now);
+    }
+    CuAssert(tc, "four expired", nexpired == 4);
+    CuAssert(tc, "none left", !mc_buffer_queue_has_timeout(&queue));
+
+    mc_buffer_queue_remove(&queue, 13);
+    queue.deadlines[mc_buffer_queue_get(&queue, 20)] = now - 1.0;
+    CuAssert(tc, "free slots never time out", mc_buffer_queue_next_timeout(&queue, 0, now) == 20);
+
+    mc_buffer_queue_deinit(&queue);
+}
+
+/**
+ *  Benchmark the timeout scan and msgid lookup with 100k outstanding messages.
+ */
+static void bench_queue(CuTest* tc) {
+    mc_buffer_queue_t queue;
+    mc_shared_buffer_t* msg = mk_msg(0);
+    uint32_t iexchange;
+    uint32_t iscan;
+    uint32_t found = 0;
+    double now = mn_gettime();
+    double start;
+    double scan_us;
+    double lookup_us;
+
+    mc_buffer_queue_init(&queue);
+    for (iexchange = 0; iexchange < BENCH_EXCHANGES; iexchange++) {
+        mc_shared_buffer_retain(msg);
+        mc_buffer_queue_add(&queue, (uint16_t)iexchange, iexchange % 1000 + 1, msg, 0);
+    }
+
+    start = mn_gettime();
+    for (iscan = 0; iscan < BENCH_SCANS; iscan++) {
+        found += mc_buffer_queue_next_timeout(&queue, 0, now) != MC_BUFFER_QUEUE_NONE;
+    }
+    scan_us = (mn_gettime() - start) * 1.0e6 / BENCH_SCANS;
+
+    start = mn_gettime();
+    for (iscan = 0; iscan < BENCH_SCANS; iscan++) {
+        found += mc_buffer_queue_get(&queue, (uint16_t)(UINT16_MAX - iscan)) != MC_BUFFER_QUEUE_NONE;
+    }
+    lookup_us = (mn_gettime() - start) * 1.0e6 / BENCH_SCANS;
+
+    printf("confirm queue: %u messages, %.1f bytes each, timeout scan %.1f us, msgid lookup %.1f us\n",
+           queue.count, (double)queue.capacity * SLOT_BYTES / queue.count, scan_us, lookup_us);
+    CuAssert(tc, "all queued", queue.count == BENCH_EXCHANGES);
+    CuAssert(tc, "lookups found", found == BENCH_SCANS);
+
+    mc_buffer_queue_deinit(&queue);
+    CuAssert(tc, "references released", msg->refs == 1);
+    mc_shared_buffer_release(msg);
+}
+
+CuSuite* mc_buffer_queue_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_queue_slots);
+    SUITE_ADD_TEST(suite, test_queue_timeouts);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_buffer_queue_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_queue);
+
+    return suite;
+}
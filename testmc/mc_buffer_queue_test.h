@@ -0,0 +1,9 @@
+#ifndef MC_BUFFER_QUEUE_TEST_H
+#define MC_BUFFER_QUEUE_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_buffer_queue_suite();
+CuSuite* mc_buffer_queue_bench_suite();
+
+#endif
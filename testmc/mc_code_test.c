@@ -55,6 +55,18 @@ static void test_create_code(CuTest* tc) {
     CuAssert(tc, "code is 0x22",  code == 0x22);
 }
 
+/**
+ *  Given the response code constants
+ *  When we compare them to codes created from class and detail
+ *  Then they match, e.g. 4.02 Bad Option is 0x82.
+ */
+static void test_response_codes(CuTest* tc) {
+    CuAssert(tc, "2.05 content",  MC_CONTENT == mc_code_create(2, 5));
+    CuAssert(tc, "4.02 is 0x82",  MC_BAD_OPTION == 0x82);
+    CuAssert(tc, "4.04 not found",  MC_NOT_FOUND == mc_code_create(4, 4));
+    CuAssert(tc, "5.03 service unavailable",  MC_SERVICE_UNAVAILABLE == mc_code_create(5, 3));
+}
+
 /* Run all of the tests in this test suite. */
 CuSuite* mc_code_suite() {
     CuSuite* suite = CuSuiteNew();
@@ -62,6 +74,7 @@ CuSuite* mc_code_suite() {
     SUITE_ADD_TEST(suite, test_create_category);
     SUITE_ADD_TEST(suite, test_create_detail);
     SUITE_ADD_TEST(suite, test_create_code);
+    SUITE_ADD_TEST(suite, test_response_codes);
         
     return suite;
 }
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_discovery.h"
+#include "testmc/mc_discovery_test.h"
+
+#include "cutest/CuTest.h"
+
+static int response_calls;
+static uint32_t response_block2;
+static uint32_t response_size2;
+static uint32_t response_nbytes;
+
+/* Compare a query result with the expected link-format. */
+static int query_is(mc_discovery_t* disc, char* query, const char* expected) {
+    mc_buffer_t buffer;
+    uint32_t nbytes;
+    const char* result = mc_discovery_query(disc, query ? mc_buffer_init(&buffer, (uint32_t)strlen(query), (uint8_t*)query) : 0, &nbytes);
+
+    return nbytes == strlen(expected) && memcmp(result, expected, nbytes) == 0;
+}
+
+/**
+ *  Given a discovery,
+ *  When we add, replace and remove resources,
+ *  Then the stored payload always holds exactly the current links in order.
+ */
+static void test_discovery_payload(CuTest* tc) {
+    mc_discovery_t disc;
+
+    mc_discovery_init(&disc);
+    CuAssert(tc, "empty", query_is(&disc, 0, ""));
+
+    CuAssert(tc, "added", mc_discovery_add(&disc, "/sensors/temp", "temperature", "sensor", CONTENT_TEXT_PLAIN));
+    CuAssert(tc, "added light", mc_discovery_add(&disc, "/sensors/light", "light-lux", 0, -1));
+    CuAssert(tc, "added fw", mc_discovery_add(&disc, "/fw", 0, 0, CONTENT_OCTET));
+    CuAssert(tc, "relative path rejected", !mc_discovery_add(&disc, "fw", 0, 0, -1));
+    CuAssert(tc, "quote rejected", !mc_discovery_add(&disc, "/q", "a\"b", 0, -1));
+    CuAssert(tc, "rendered", query_is(&disc, 0,
+             "</sensors/temp>;rt=\"temperature\";if=\"sensor\";ct=0,</sensors/light>;rt=\"light-lux\",</fw>;ct=42"));
+
+    CuAssert(tc, "middle removed", mc_discovery_remove(&disc, "/sensors/light"));
+    CuAssert(tc, "cut middle", query_is(&disc, 0, "</sensors/temp>;rt=\"temperature\";if=\"sensor\";ct=0,</fw>;ct=42"));
+    CuAssert(tc, "first removed", mc_discovery_remove(&disc, "/sensors/temp"));
+    CuAssert(tc, "cut first", query_is(&disc, 0, "</fw>;ct=42"));
+    CuAssert(tc, "unknown not removed", !mc_discovery_remove(&disc, "/sensors/temp"));
+
+    CuAssert(tc, "replaced", mc_discovery_add(&disc, "/fw", "firmware", 0, -1));
+    CuAssert(tc, "readded", mc_discovery_add(&disc, "/sensors/temp", "temperature", 0, -1));
+    CuAssert(tc, "replaced in place of the removed", query_is(&disc, 0, "</fw>;rt=\"firmware\",</sensors/temp>;rt=\"temperature\""));
+    CuAssert(tc, "old ct not indexed", query_is(&disc, "ct=42", ""));
+
+    mc_discovery_deinit(&disc);
+}
+
+/**
+ *  Given a discovery with resources,
+ *  When we query with filters,
+ *  Then indexed, prefix and href filters return the matching links.
+ */
+static void test_discovery_query(CuTest* tc) {
+    mc_discovery_t disc;
+
+    mc_discovery_init(&disc);
+    mc_discovery_add(&disc, "/t1", "temperature", "sensor", CONTENT_TEXT_PLAIN);
+    mc_discovery_add(&disc, "/h1", "humidity temperature-c", "sensor", CONTENT_JSON);
+    mc_discovery_add(&disc, "/t2", "temperature", "core.a", CONTENT_JSON);
+
+    CuAssert(tc, "rt", query_is(&disc, "rt=temperature", "</t1>;rt=\"temperature\";if=\"sensor\";ct=0,</t2>;rt=\"temperature\";if=\"core.a\";ct=50"));
+    CuAssert(tc, "rt token", query_is(&disc, "rt=humidity", "</h1>;rt=\"humidity temperature-c\";if=\"sensor\";ct=50"));
+    CuAssert(tc, "if", query_is(&disc, "if=core.a", "</t2>;rt=\"temperature\";if=\"core.a\";ct=50"));
+    CuAssert(tc, "ct", query_is(&disc, "ct=50", "</h1>;rt=\"humidity temperature-c\";if=\"sensor\";ct=50,</t2>;rt=\"temperature\";if=\"core.a\";ct=50"));
+    CuAssert(tc, "rt prefix", query_is(&disc, "rt=temperature-*", "</h1>;rt=\"humidity temperature-c\";if=\"sensor\";ct=50"));
+    CuAssert(tc, "href", query_is(&disc, "href=/t2", "</t2>;rt=\"temperature\";if=\"core.a\";ct=50"));
+    CuAssert(tc, "href prefix", query_is(&disc, "href=/h*", "</h1>;rt=\"humidity temperature-c\";if=\"sensor\";ct=50"));
+    CuAssert(tc, "no match", query_is(&disc, "rt=light", ""));
+    CuAssert(tc, "unknown attribute", query_is(&disc, "title=x", ""));
+
+    mc_discovery_remove(&disc, "/t1");
+    CuAssert(tc, "removed from index", query_is(&disc, "rt=temperature", "</t2>;rt=\"temperature\";if=\"core.a\";ct=50"));
+
+    mc_discovery_deinit(&disc);
+}
+
+/**
+ *  Given a discovery with a few resources,
+ *  When many other resources come and go,
+ *  Then the indexes and the payload shrink back and the remaining links are still found.
+ */
+static void test_discovery_churn(CuTest* tc) {
+    mc_discovery_t disc;
+    char path[32];
+    char rt[32];
+    uint32_t iresource;
+
+    mc_discovery_init(&disc);
+    mc_discovery_add(&disc, "/t1", "temperature", 0, CONTENT_TEXT_PLAIN);
+    mc_discovery_add(&disc, "/t2", "temperature", 0, -1);
+
+    for (iresource = 0; iresource < 1000; iresource++) {
+        sprintf(path, "/sensors/%u", iresource);
+        sprintf(rt, "type-%u", iresource);
+        mc_discovery_add(&disc, path, rt, "sensor", (int32_t)iresource);
+        if (iresource >= 10) {
+            sprintf(path, "/sensors/%u", iresource - 10);
+            mc_discovery_remove(&disc, path);
+        }
+    }
+    for (iresource = 990; iresource < 1000; iresource++) {
+        sprintf(path, "/sensors/%u", iresource);
+        mc_discovery_remove(&disc, path);
+    }
+
+    CuAssert(tc, "removed links compacted as they pile up", disc.npayload < 1024);
+    CuAssert(tc, "hrefs shrunk", disc.hrefs.count == 2);
+    CuAssert(tc, "rts shrunk", disc.rts.count == 1);
+    CuAssert(tc, "ifs shrunk", disc.ifs.count == 0);
+    CuAssert(tc, "cts shrunk", disc.cts.count == 1);
+    CuAssert(tc, "rt found", query_is(&disc, "rt=temperature", "</t1>;rt=\"temperature\";ct=0,</t2>;rt=\"temperature\""));
+    CuAssert(tc, "ct found", query_is(&disc, "ct=0", "</t1>;rt=\"temperature\";ct=0"));
+    CuAssert(tc, "payload", query_is(&disc, 0, "</t1>;rt=\"temperature\";ct=0,</t2>;rt=\"temperature\""));
+    CuAssert(tc, "compacted", disc.ngarbage == 0);
+    CuAssert(tc, "t2 removed", mc_discovery_remove(&disc, "/t2"));
+    CuAssert(tc, "t1 still found", query_is(&disc, "href=/t1", "</t1>;rt=\"temperature\";ct=0"));
+
+    mc_discovery_deinit(&disc);
+}
+
+static int test_handler(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg) {
+    return 1;
+}
+
+/**
+ *  Given a router and a discovery,
+ *  When we register resources with their link attributes,
+ *  Then they are routed and advertised, except for templates with wildcards.
+ */
+static void test_discovery_router_add(CuTest* tc) {
+    mc_router_t router;
+    mc_discovery_t disc;
+
+    mc_router_init(&router);
+    mc_discovery_init(&disc);
+    mc_discovery_register(&disc, &router);
+
+    CuAssert(tc, "added", mc_discovery_router_add(&disc, &router, MC_GET, "/t1", test_handler, 0, "temperature", 0, CONTENT_TEXT_PLAIN));
+    CuAssert(tc, "other method added", mc_discovery_router_add(&disc, &router, MC_PUT, "/t1", test_handler, 0, "temperature", 0, CONTENT_TEXT_PLAIN));
+    CuAssert(tc, "wildcard added", mc_discovery_router_add(&disc, &router, MC_GET, "/devices/*/temp", test_handler, 0, "temperature", 0, -1));
+    CuAssert(tc, "duplicate rejected", !mc_discovery_router_add(&disc, &router, MC_GET, "/t1", test_handler, 0, "other", 0, -1));
+    CuAssert(tc, "quote rejected", !mc_discovery_router_add(&disc, &router, MC_GET, "/q", test_handler, 0, "a\"b", 0, -1));
+    CuAssert(tc, "routed", router.nresources == 3);
+    CuAssert(tc, "advertised once", query_is(&disc, 0, "</t1>;rt=\"temperature\";ct=0"));
+
+    mc_discovery_deinit(&disc);
+    mc_router_deinit(&router);
+}
+
+static int test_response_fn(mc_endpt_id_t endpt, uint16_t msgid, mc_message_t* response) {
+    response_calls++;
+    response_block2 = 0;
+    response_size2 = 0;
+    response_nbytes = response && response->payload ? response->payload->nbytes : 0;
+    if (response && response->options) {
+        mc_options_list_get_uint32(response->options, OPTION_BLOCK2, &response_block2);
+        mc_options_list_get_uint32(response->options, OPTION_SIZE_2, &response_size2);
+    }
+    return 1;
+}
+
+/* Have alice get /.well-known/core from bob, asking for a Block2 block if block2 is not 0. */
+static void get_core(mc_endpt_udp_t* alice, mc_endpt_udp_t* bob, mc_router_t* router, uint32_t block2) {
+    mc_options_list_t* extra = 0;
+    mc_message_t* msg;
+
+    if (block2) {
+        mc_option_t* option = mc_option_nalloc(1);
+        mc_option_init_uint32(option, OPTION_BLOCK2, block2);
+        extra = mc_options_list_init(mc_options_list_alloc(), 1, option);
+    }
+
+    mc_endpt_udp_request(alice, 0, MC_GET, "coap://127.0.0.1:5679/.well-known/core", extra, 0, 0, test_response_fn);
+    if (extra) ms_free(mc_options_list_deinit(extra));
+
+    msg = mc_endpt_udp_recv(bob);
+    if (msg) {
+        mc_router_dispatch(router, bob, msg);
+        mc_message_free(msg);
+    }
+    mc_endpt_udp_recv(alice);
+}
+
+/**
+ *  Given a server with more links than fit in one block,
+ *  When a client gets /.well-known/core,
+ *  Then the payload comes in Block2 blocks with the total size on the first.
+ */
+static void test_discovery_block2(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_router_t router;
+    mc_discovery_t disc;
+    char path[32];
+    uint32_t total;
+    uint32_t last;
+    uint32_t iresource;
+
+    mc_endpt_udp_init(&alice, 2048, 2048, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 2048, 2048, "127.0.0.1", 5679);
+    mc_router_init(&router);
+    mc_discovery_init(&disc);
+    mc_discovery_register(&disc, &router);
+
+    for (iresource = 0; iresource < 100; iresource++) {
+        sprintf(path, "/sensors/%u", iresource);
+        mc_discovery_add(&disc, path, "temperature", 0, CONTENT_TEXT_PLAIN);
+    }
+    mc_discovery_query(&disc, 0, &total);
+
+    response_calls = 0;
+    get_core(&alice, &bob, &router, 0);
+    CuAssert(tc, "first block", response_calls == 1 && response_nbytes == 1024);
+    CuAssert(tc, "block 0 more", response_block2 == ((0 << 4) | 0x08 | 6));
+    CuAssert(tc, "size2", response_size2 == total);
+
+    last = (total - 1) / 1024;
+    get_core(&alice, &bob, &router, (last << 4) | 6);
+    CuAssert(tc, "last block", response_calls == 2 && response_nbytes == total - last * 1024);
+    CuAssert(tc, "last block no more", response_block2 == ((last << 4) | 6));
+
+    get_core(&alice, &bob, &router, (1 << 4) | 2);
+    CuAssert(tc, "small block", response_calls == 3 && response_nbytes == 64 && response_block2 == ((1 << 4) | 0x08 | 2));
+
+    mc_discovery_deinit(&disc);
+    mc_router_deinit(&router);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+CuSuite* mc_discovery_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_discovery_payload);
+    SUITE_ADD_TEST(suite, test_discovery_query);
+    SUITE_ADD_TEST(suite, test_discovery_churn);
+    SUITE_ADD_TEST(suite, test_discovery_router_add);
+    SUITE_ADD_TEST(suite, test_discovery_block2);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MC_DISCOVERY_TEST_H
+#define MC_DISCOVERY_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_discovery_suite();
+
+#endif
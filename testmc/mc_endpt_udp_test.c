@@ -2,6 +2,7 @@
 #include <stdlib.h>
 
 #include "msys/ms_memory.h"
+#include "mnet/mn_sockaddr.h"
 #include "mcoap/mc_code.h"
 #include "mcoap/mc_uri.h"
 
@@ -39,15 +40,7 @@ static void print_msg(mc_message_t* const msg) {
 }
 
 static int msg_is_in_queue(mc_endpt_udp_t* endpt, uint16_t msgid) {
-    mc_buffer_queue_entry_t* current;
-
-    current = endpt->confirmq.first;
-    while (current) {
-        if (current->msgid == msgid) return 1;
-        current = current->next;
-    }
-
-    return 0;
+    return mc_buffer_queue_get(&endpt->confirmq, msgid) != MC_BUFFER_QUEUE_NONE;
 }
 
 /**
@@ -79,13 +72,87 @@ static void test_send_recv(CuTest* tc) {
 
     print_msg(amsg);
 
-    if (amsg) ms_free(mc_message_deinit(amsg));
+    if (amsg) mc_message_free(amsg);
     mc_endpt_udp_deinit(&alice);
     mc_endpt_udp_deinit(&bob);
 
     CuAssert(tc, "msgid's are equal",  amsgid == bmsgid);
 }
 
+/** Send a GET with extra from alice to bob. @return 1 if bob received it with the extra option. */
+static int send_with_extra(mc_endpt_udp_t* alice, mc_endpt_udp_t* bob, sockaddr_t* addr, char* uri,
+                           mc_options_list_t* extra, uint16_t option_num) {
+    mc_message_t* bmsg;
+    int found;
+
+    mc_endpt_udp_get(alice, addr, 0, uri, extra);
+    bmsg = mc_endpt_udp_recv(bob);
+    found = bmsg != 0 && mc_options_list_has(bmsg->options, option_num);
+
+    if (bmsg) mc_message_free(bmsg);
+    return found;
+}
+
+/**
+ *  Given extra options that sort after the URI options and extra options that sort before them,
+ *  when alice sends bob two requests with each list,
+ *  then every request carries the extra option and the lists are left as they were.
+ */
+static void test_send_keeps_extra(CuTest* tc) {
+    sockaddr_t addr;
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_options_list_t* after;
+    mc_options_list_t* before;
+    char* uri = "coap://127.0.0.1:5679/test";
+
+    mc_uri_to_address(&addr, uri);
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+    after = mc_options_list_vinit(mc_options_list_alloc(), 1, mc_option_init_uint32(mc_option_alloc(), OPTION_ACCEPT, 50));
+    before = mc_options_list_vinit(mc_options_list_alloc(), 1, mc_option_init_uint32(mc_option_alloc(), OPTION_IF_MATCH, 7));
+
+    CuAssert(tc, "first accept", send_with_extra(&alice, &bob, &addr, uri, after, OPTION_ACCEPT));
+    CuAssert(tc, "second accept", send_with_extra(&alice, &bob, &addr, uri, after, OPTION_ACCEPT));
+    CuAssert(tc, "first if-match", send_with_extra(&alice, &bob, &addr, uri, before, OPTION_IF_MATCH));
+    CuAssert(tc, "second if-match", send_with_extra(&alice, &bob, &addr, uri, before, OPTION_IF_MATCH));
+    CuAssert(tc, "lists kept", after->noptions == 1 && mc_options_list_has(after, OPTION_ACCEPT)
+                               && before->noptions == 1 && mc_options_list_has(before, OPTION_IF_MATCH));
+
+    ms_free(mc_options_list_deinit(after));
+    ms_free(mc_options_list_deinit(before));
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given an endpoint bound to a port,
+ *  when it is deinitialized,
+ *  then its socket is closed and another endpoint can bind the port and receive on it.
+ */
+static void test_deinit_closes_socket(CuTest* tc) {
+    sockaddr_t addr;
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t* bmsg;
+    char* uri = "coap://127.0.0.1:5679/test";
+
+    mc_uri_to_address(&addr, uri);
+    CuAssert(tc, "first bound", mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679) != 0);
+    mc_endpt_udp_deinit(&bob);
+    CuAssert(tc, "socket closed", bob.sock == MN_SOCKET_INVALID);
+
+    CuAssert(tc, "bound again", mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679) != 0);
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_get(&alice, &addr, 0, uri, 0);
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "received", bmsg != 0);
+
+    if (bmsg) mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
 static int test_status;
 static uint16_t test_msgid;
 
@@ -97,12 +164,9 @@ int test_result_fn(mc_endpt_id_t endpt, uint16_t msgid, int status) {
     return 0;
 }
 
-/**
- * Compute a new start value that will force the check queue function to timeout.
- */
-static double recompute_start(mn_timeout_t *tmout) {
-    static double epsilon = 0.01;
-    return tmout->start - tmout->total - epsilon;
+/** Move a queued message's deadline into the past. */
+static void expire(mc_endpt_udp_t* endpt, uint32_t slot) {
+    endpt->confirmq.deadlines[slot] = 0.0;
 }
 
 /**
@@ -116,22 +180,24 @@ static void test_rexmit_con_msg(CuTest* tc) {
     uint16_t amsgid;
     char* uri = "coap://localhost:5679/test";
     uint16_t aport = 5678;
+    uint32_t slot;
     int ctr;
 
     mc_uri_to_address(&addr, uri);
     mc_endpt_udp_init(&alice, 512, 512, "0.0.0.0", aport);
 
     amsgid = mc_endpt_udp_get(&alice, &addr, test_result_fn, uri, 0);
+    slot = mc_buffer_queue_get(&alice.confirmq, amsgid);
 
-    ctr = alice.confirmq.first->xmitcounter;
+    ctr = alice.confirmq.xmits[slot];
     CuAssert(tc, "message is enqueued", msg_is_in_queue(&alice, amsgid));
     CuAssert(tc, "msg was sent once", ctr == 1);
 
     // Update the timeout entry to force a retransmission.
-    alice.confirmq.first->timeout.start = recompute_start(&alice.confirmq.first->timeout);
+    expire(&alice, slot);
 
     mc_endpt_udp_check_queues(&alice);
-    ctr = alice.confirmq.first->xmitcounter;
+    ctr = alice.confirmq.xmits[slot];
 
     // Cleanup
     mc_endpt_udp_deinit(&alice);
@@ -150,6 +216,7 @@ static void test_max_rexmit_con_msg(CuTest* tc) {
     uint16_t amsgid;
     char* uri = "coap://localhost:5679/test";
     uint16_t aport = 5678;
+    uint32_t slot;
 
     /* Set the test flags. */
     test_status = MN_DONE;
@@ -159,12 +226,13 @@ static void test_max_rexmit_con_msg(CuTest* tc) {
     mc_endpt_udp_init(&alice, 512, 512, "0.0.0.0", aport);
 
     amsgid = mc_endpt_udp_get(&alice, &addr, test_result_fn, uri, 0);
+    slot = mc_buffer_queue_get(&alice.confirmq, amsgid);
 
     do {
         // Update the timeout entry to force a retransmission.
-        alice.confirmq.first->timeout.start = recompute_start(&alice.confirmq.first->timeout);
+        expire(&alice, slot);
         mc_endpt_udp_check_queues(&alice);
-    } while (alice.confirmq.first && (alice.confirmq.first->xmitcounter <= MAX_RETRANSMIT));
+    } while (msg_is_in_queue(&alice, amsgid) && (alice.confirmq.xmits[slot] <= MAX_RETRANSMIT));
 
     /* Check the test flags. */
     printf("test_status: %d\n", test_status);
@@ -208,7 +276,7 @@ static void test_send_ack(CuTest* tc) {
     amsg = mc_endpt_udp_recv(&bob);
     resp_token = mc_message_copy_token(amsg);
     if (amsg) {
-        ms_free(mc_message_deinit(amsg));
+        mc_message_free(amsg);
     }
 
     mc_endpt_udp_ack(&bob, &alice_addr, resp_token, amsgid);
@@ -219,7 +287,7 @@ static void test_send_ack(CuTest* tc) {
 
     bmsg = mc_endpt_udp_recv(&alice);
     if (bmsg) {
-        ms_free(mc_message_deinit(bmsg));
+        mc_message_free(bmsg);
     }
 
     CuAssert(tc, "message is dequeued", msg_is_in_queue(&alice, amsgid) == 0);
@@ -232,15 +300,302 @@ static void test_send_ack(CuTest* tc) {
     CuAssert(tc, "msg id was acked", test_msgid == amsgid);
 }
 
+/**
+ *  Given two endpoints and a URI with a host name,
+ *  when alice sends to the URI without an address,
+ *  then the request waits for the resolver instead of blocking and bob receives it once resolved.
+ */
+static void test_send_to_host_name(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    uint16_t amsgid;
+    mc_message_t* bmsg;
+    char* uri = "coap://localhost:5679/test";
+    double start;
+
+    mc_endpt_udp_init(&alice, 512, 512, "0.0.0.0", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "0.0.0.0", 5679);
+
+    amsgid = mc_endpt_udp_get(&alice, 0, 0, uri, 0);
+    CuAssert(tc, "request is accepted", amsgid != 0);
+    CuAssert(tc, "request waits for the resolver", alice.pending != 0);
+
+    start = mn_gettime();
+    while (alice.pending && mn_gettime() - start < 5.0) {
+        mc_endpt_udp_check_queues(&alice);
+    }
+    CuAssert(tc, "request was sent", alice.pending == 0);
+
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "msg received", bmsg != 0);
+    CuAssert(tc, "msgid's are equal", bmsg != 0 && mc_message_get_message_id(bmsg) == amsgid);
+    CuAssert(tc, "host name is sent", bmsg != 0 && mc_options_list_has(bmsg->options, OPTION_URI_HOST));
+
+    if (bmsg) mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given alice bound to the IPv6 any address and bob to IPv4,
+ *  when alice sends to a URI with a host name that resolves to IPv4,
+ *  then the request goes out to the IPv4-mapped address and bob receives it.
+ */
+static void test_send_to_host_name_ipv6(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    uint16_t amsgid;
+    mc_message_t* bmsg;
+    char* uri = "coap://localhost:5679/test";
+    double start;
+
+    CuAssert(tc, "alice binds", mc_endpt_udp_init(&alice, 512, 512, "::", 5678) != 0);
+    CuAssert(tc, "bob binds", mc_endpt_udp_init(&bob, 512, 512, "0.0.0.0", 5679) != 0);
+
+    amsgid = mc_endpt_udp_get(&alice, 0, 0, uri, 0);
+    start = mn_gettime();
+    while (alice.pending && mn_gettime() - start < 5.0) {
+        mc_endpt_udp_check_queues(&alice);
+    }
+    CuAssert(tc, "request was sent", amsgid != 0 && alice.pending == 0);
+
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "msg received", bmsg != 0);
+    CuAssert(tc, "msgid's are equal", bmsg != 0 && mc_message_get_message_id(bmsg) == amsgid);
+
+    if (bmsg) mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given two endpoints bound to the IPv6 loopback,
+ *  when alice sends a confirmable request to bob's literal URI and bob acks it,
+ *  then bob sees alice's IPv6 address and the ack reaches alice's confirm queue.
+ */
+static void test_send_recv_ipv6(CuTest* tc) {
+    sockaddr_t alice_addr;
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    uint16_t amsgid;
+    mc_message_t* bmsg;
+    mc_message_t* amsg;
+    char* uri = "coap://[::1]:5679/test";
+
+    mn_sockaddr_inet_init(&alice_addr, "::1", 5678);
+    CuAssert(tc, "alice binds", mc_endpt_udp_init(&alice, 512, 512, "::1", 5678) != 0);
+    CuAssert(tc, "bob binds", mc_endpt_udp_init(&bob, 512, 512, "::1", 5679) != 0);
+
+    amsgid = mc_endpt_udp_get(&alice, 0, test_result_fn, uri, 0);
+    CuAssert(tc, "literal is sent without waiting", amsgid != 0 && alice.pending == 0);
+
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "msg received", bmsg != 0);
+    CuAssert(tc, "sender is IPv6", bmsg->from.ss_family == AF_INET6);
+    CuAssert(tc, "sender is alice", mn_sockaddr_equal(&bmsg->from, &alice_addr));
+    CuAssert(tc, "sender is interned", bmsg->peer == mn_peer_table_find(&bob.peers, &alice_addr) && bmsg->peer != MN_PEER_NONE);
+    CuAssert(tc, "literal host is elided", !mc_options_list_has(bmsg->options, OPTION_URI_HOST));
+
+    test_status = MN_UNKNOWN;
+    mc_endpt_udp_ack(&bob, &bmsg->from, mc_message_copy_token(bmsg), mc_message_get_message_id(bmsg));
+    amsg = mc_endpt_udp_recv(&alice);
+
+    CuAssert(tc, "ack received", amsg != 0 && mc_message_is_ack(amsg));
+    CuAssert(tc, "msg was acked", test_status == MN_DONE && test_msgid == amsgid);
+    CuAssert(tc, "confirm queue is empty", mc_buffer_queue_count(&alice.confirmq) == 0);
+
+    if (amsg) mc_message_free(amsg);
+    mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+static int response_calls;
+static uint16_t response_msgid;
+static uint8_t response_code;
+
+static int test_response_fn(mc_endpt_id_t endpt, uint16_t msgid, mc_message_t* response) {
+    response_calls++;
+    response_msgid = msgid;
+    response_code = response ? mc_message_get_code(response) : 0;
+    return 1;
+}
+
+/**
+ *  Given alice sends a request with a response fn to bob,
+ *  when bob answers with a piggybacked response carrying the request's token,
+ *  then alice's response fn gets it, recv does not return it, and the request is done.
+ */
+static void test_request_response(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t response;
+    mc_message_t* bmsg;
+    mc_message_t* amsg;
+    uint16_t amsgid;
+    char* uri = "coap://127.0.0.1:5679/test";
+
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+    response_calls = 0;
+
+    amsgid = mc_endpt_udp_request(&alice, 0, MC_GET, uri, 0, 0, test_result_fn, test_response_fn);
+    CuAssert(tc, "request is tracked", alice.requests.count == 1);
+
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "request received", bmsg != 0);
+
+    mc_message_ack_init(&response, MC_CONTENT, mc_message_get_message_id(bmsg), mc_message_copy_token(bmsg), 0, 0);
+    mc_endpt_udp_send(&bob, &bmsg->from, &response, 0);
+    mc_message_deinit(&response);
+
+    amsg = mc_endpt_udp_recv(&alice);
+    CuAssert(tc, "response is not returned", amsg == 0);
+    CuAssert(tc, "response fn called", response_calls == 1 && response_msgid == amsgid && response_code == MC_CONTENT);
+    CuAssert(tc, "request is done", alice.requests.count == 0);
+    CuAssert(tc, "request is acked", mc_buffer_queue_count(&alice.confirmq) == 0);
+
+    mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given alice sends a non-confirmable request with a response fn to bob,
+ *  when alice sees more other peers than its peer table holds before bob answers,
+ *  then the response still matches the request.
+ */
+static void test_request_survives_peer_churn(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t* bmsg;
+    mc_message_t* amsg;
+    sockaddr_t other;
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)&other;
+    uint16_t amsgid;
+    uint32_t n;
+
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+    response_calls = 0;
+
+    amsgid = mc_endpt_udp_request(&alice, 0, MC_GET, "coap://127.0.0.1:5679/test", 0, 0, 0, test_response_fn);
+    bmsg = mc_endpt_udp_recv(&bob);
+    CuAssert(tc, "request received", bmsg != 0);
+
+    mn_sockaddr_inet_init(&other, "10.0.0.0", 5683);
+    for (n = 1; n <= 2 * MC_PEER_TABLE_SIZE; n++) {
+        inaddr->sin_addr.s_addr = htonl(0x0a000000 | n);
+        mn_peer_table_intern(&alice.peers, &other);
+    }
+    CuAssert(tc, "peers were evicted", alice.peers.evictions > MC_PEER_TABLE_SIZE);
+
+    mc_endpt_udp_respond(&bob, bmsg, MC_CONTENT, 0, 0);
+    amsg = mc_endpt_udp_recv(&alice);
+    CuAssert(tc, "response is not returned", amsg == 0);
+    CuAssert(tc, "response fn called", response_calls == 1 && response_msgid == amsgid && response_code == MC_CONTENT);
+    CuAssert(tc, "request is done", alice.requests.count == 0);
+
+    if (amsg) mc_message_free(amsg);
+    mc_message_free(bmsg);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given alice sends a confirmable message to bob that is not acked,
+ *  when alice sees more other peers than its peer table holds before it times out,
+ *  then the retransmission still reaches bob.
+ */
+static void test_rexmit_survives_peer_churn(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t* bmsg;
+    sockaddr_t addr;
+    sockaddr_t other;
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)&other;
+    char* uri = "coap://127.0.0.1:5679/test";
+    uint16_t amsgid;
+    uint32_t slot;
+    uint32_t n;
+    int first;
+    int again;
+
+    mc_uri_to_address(&addr, uri);
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+
+    amsgid = mc_endpt_udp_get(&alice, &addr, test_result_fn, uri, 0);
+    slot = mc_buffer_queue_get(&alice.confirmq, amsgid);
+    bmsg = mc_endpt_udp_recv(&bob);
+    first = bmsg != 0 && mc_message_get_message_id(bmsg) == amsgid;
+    if (bmsg) mc_message_free(bmsg);
+
+    mn_sockaddr_inet_init(&other, "10.0.0.0", 5683);
+    for (n = 1; n <= 2 * MC_PEER_TABLE_SIZE; n++) {
+        inaddr->sin_addr.s_addr = htonl(0x0a000000 | n);
+        mn_peer_table_intern(&alice.peers, &other);
+    }
+    CuAssert(tc, "peers were evicted", alice.peers.evictions > MC_PEER_TABLE_SIZE);
+
+    expire(&alice, slot);
+    mc_endpt_udp_check_queues(&alice);
+    bmsg = mc_endpt_udp_recv(&bob);
+    again = bmsg != 0 && mc_message_get_message_id(bmsg) == amsgid;
+    if (bmsg) mc_message_free(bmsg);
+
+    CuAssert(tc, "sent", first);
+    CuAssert(tc, "still queued", msg_is_in_queue(&alice, amsgid) && alice.confirmq.xmits[slot] == 2);
+    CuAssert(tc, "retransmitted to bob", again);
+
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+}
+
+/**
+ *  Given a non-confirmable request with a response fn that is never answered,
+ *  when its deadline passes and we check the queues,
+ *  then the response fn is called with no response and the request is dropped.
+ */
+static void test_request_expires(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    uint16_t amsgid;
+
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    response_calls = 0;
+
+    amsgid = mc_endpt_udp_request(&alice, 0, MC_GET, "coap://127.0.0.1:5679/test", 0, 0, 0, test_response_fn);
+    CuAssert(tc, "request is tracked", alice.requests.count == 1);
+
+    mc_endpt_udp_check_queues(&alice);
+    CuAssert(tc, "not expired yet", response_calls == 0);
+
+    mc_request_table_set_deadline(&alice.requests, &alice.requests.requests[alice.requests.heap[0]], 0.0);
+    mc_endpt_udp_check_queues(&alice);
+
+    CuAssert(tc, "response fn called without response", response_calls == 1 && response_msgid == amsgid && response_code == 0);
+    CuAssert(tc, "request is dropped", alice.requests.count == 0);
+
+    mc_endpt_udp_deinit(&alice);
+}
 
 /* Run all of the tests in this test suite. */
 CuSuite* mc_endpt_udp_suite() {
     CuSuite* suite = CuSuiteNew();
 
     SUITE_ADD_TEST(suite, test_send_recv);
+    SUITE_ADD_TEST(suite, test_send_keeps_extra);
+    SUITE_ADD_TEST(suite, test_deinit_closes_socket);
     SUITE_ADD_TEST(suite, test_rexmit_con_msg);
     SUITE_ADD_TEST(suite, test_max_rexmit_con_msg);
     SUITE_ADD_TEST(suite, test_send_ack);
+    SUITE_ADD_TEST(suite, test_send_to_host_name);
+    SUITE_ADD_TEST(suite, test_send_to_host_name_ipv6);
+    SUITE_ADD_TEST(suite, test_send_recv_ipv6);
+    SUITE_ADD_TEST(suite, test_request_response);
+    SUITE_ADD_TEST(suite, test_request_survives_peer_churn);
+    SUITE_ADD_TEST(suite, test_rexmit_survives_peer_churn);
+    SUITE_ADD_TEST(suite, test_request_expires);
 
     return suite;
 }
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mnet/mn_sockaddr.h"
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_endpt_udp.h"
+#include "mcoap/mc_event_log.h"
+#include "mcoap/mc_uri.h"
+#include "testmc/mc_event_log_test.h"
+
+#include "cutest/CuTest.h"
+
+#define LOG_PATH        "mc_event_log_test"
+#define BENCH_EVENTS    200000
+
+/** A segment read back from its file. */
+typedef struct segment segment_t;
+struct segment {
+    uint8_t* bytes;
+    size_t size;
+    const mc_event_log_header_t* header;
+    size_t pos;
+};
+
+static int read_segment(segment_t* segment, const char* path, uint32_t number) {
+    char name[256];
+    FILE* file;
+    long size;
+
+    memset(segment, 0, sizeof(segment_t));
+    file = fopen(mc_event_log_segment_path(name, sizeof(name), path, number), "rb");
+    if (file == 0) return 0;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    segment->bytes = ms_malloc((size_t)size, uint8_t);
+    segment->size = fread(segment->bytes, 1, (size_t)size, file);
+    fclose(file);
+
+    segment->header = mc_event_log_header(segment->bytes, segment->size);
+    return segment->header != 0;
+}
+
+static void remove_segments(const char* path, uint32_t nsegments) {
+    char name[256];
+    uint32_t isegment;
+
+    for (isegment = 0; isegment < nsegments; isegment++) {
+        remove(mc_event_log_segment_path(name, sizeof(name), path, isegment));
+    }
+}
+
+/** A CoAP header followed by zeros. */
+static uint8_t* mk_datagram(uint8_t* bytes, uint32_t nbytes, uint8_t code, uint16_t msgid) {
+    memset(bytes, 0, nbytes);
+    bytes[0] = 0x40;
+    bytes[1] = code;
+    bytes[2] = (uint8_t)(msgid >> 8);
+    bytes[3] = (uint8_t)msgid;
+    return bytes;
+}
+
+static int ignore_result(mc_endpt_id_t endpt, uint16_t msgid, int status) {
+    return 0;
+}
+
+/** Receive on endpt. @return 1 if a message arrived. */
+static int recv_one(mc_endpt_udp_t* endpt) {
+    mc_message_t* msg = mc_endpt_udp_recv(endpt);
+
+    if (msg) mc_message_free(msg);
+    return msg != 0;
+}
+
+/**
+ *  Given a log with a 16 byte snaplen,
+ *  When we write a short datagram, a long one and a timeout,
+ *  Then they read back in order after the peer's address, the long one cut at the snaplen.
+ */
+static void test_event_log_events(CuTest* tc) {
+    mc_event_log_t log;
+    segment_t segment;
+    sockaddr_t local;
+    sockaddr_t peer;
+    mc_event_addr_t addr;
+    const mc_event_t* events[5];
+    uint8_t bytes[100];
+    int nevents = 0;
+
+    mn_sockaddr_inet_init(&local, "127.0.0.1", 5683);
+    mn_sockaddr_inet_init(&peer, "127.0.0.1", 5679);
+    remove_segments(LOG_PATH, 2);
+    CuAssert(tc, "initialized", mc_event_log_init(&log, LOG_PATH, 4096, 2, 16, &local) != 0);
+
+    mc_event_log_datagram(&log, MC_EVENT_SEND, 7, &peer, mk_datagram(bytes, 12, MC_GET, 1234), 12);
+    mc_event_log_datagram(&log, MC_EVENT_RECV, 7, &peer, mk_datagram(bytes, 100, MC_CONTENT, 1234), 100);
+    mc_event_log_write(&log, MC_EVENT_TIMEOUT, 7, 0, 1235, MC_GET, 0, 0);
+    mc_event_log_deinit(&log);
+
+    CuAssert(tc, "segment read", read_segment(&segment, LOG_PATH, 0));
+    CuAssert(tc, "header", segment.header->sequence == 0 && segment.header->snaplen == 16);
+    CuAssert(tc, "local address", memcmp(&segment.header->local, mc_event_addr_init(&addr, &local), sizeof(addr)) == 0);
+
+    while (nevents < 5 && (events[nevents] = mc_event_log_next(segment.bytes, segment.size, &segment.pos)) != 0) nevents++;
+    CuAssert(tc, "four events", nevents == 4);
+
+    mc_event_addr_init(&addr, &peer);
+    CuAssert(tc, "peer first", events[0]->type == MC_EVENT_PEER && events[0]->peer == 7
+                               && memcmp(events[0] + 1, &addr, sizeof(addr)) == 0);
+    CuAssert(tc, "send", events[1]->type == MC_EVENT_SEND && events[1]->msgid == 1234 && events[1]->code == MC_GET
+                         && events[1]->length == 12 && events[1]->nbytes == 12);
+    CuAssert(tc, "recv cut", events[2]->type == MC_EVENT_RECV && events[2]->code == MC_CONTENT
+                             && events[2]->length == 100 && events[2]->nbytes == 16);
+    CuAssert(tc, "timeout", events[3]->type == MC_EVENT_TIMEOUT && events[3]->msgid == 1235 && events[3]->nbytes == 0);
+    CuAssert(tc, "in time order", events[1]->time <= events[3]->time);
+
+    ms_free(segment.bytes);
+    remove_segments(LOG_PATH, 2);
+}
+
+/** @return the msgid of the first event in a segment file with the sequence number, -1 if none. */
+static int first_msgid(const char* path, uint32_t number, uint64_t sequence) {
+    segment_t segment;
+    const mc_event_t* event;
+    int msgid = -1;
+
+    if (read_segment(&segment, path, number) && segment.header->sequence == sequence) {
+        event = mc_event_log_next(segment.bytes, segment.size, &segment.pos);
+        if (event) msgid = event->msgid;
+    }
+    ms_free(segment.bytes);
+    return msgid;
+}
+
+/**
+ *  Given a log that recorded an event and was closed, as by a crash,
+ *  When it is opened again on the same path and records another,
+ *  Then it continues in the next segment and the first event survives.
+ */
+static void test_event_log_reopen(CuTest* tc) {
+    mc_event_log_t log;
+    uint8_t bytes[12];
+
+    remove_segments(LOG_PATH, 3);
+    CuAssert(tc, "initialized", mc_event_log_init(&log, LOG_PATH, 4096, 3, 64, 0) != 0);
+    mc_event_log_datagram(&log, MC_EVENT_SEND, 7, 0, mk_datagram(bytes, sizeof(bytes), MC_GET, 1), sizeof(bytes));
+    mc_event_log_deinit(&log);
+
+    CuAssert(tc, "reopened", mc_event_log_init(&log, LOG_PATH, 4096, 3, 64, 0) != 0);
+    CuAssert(tc, "next sequence", log.sequence == 1);
+    mc_event_log_datagram(&log, MC_EVENT_SEND, 7, 0, mk_datagram(bytes, sizeof(bytes), MC_GET, 2), sizeof(bytes));
+    mc_event_log_deinit(&log);
+
+    CuAssert(tc, "first run kept", first_msgid(LOG_PATH, 0, 0) == 1);
+    CuAssert(tc, "second run after it", first_msgid(LOG_PATH, 1, 1) == 2);
+    remove_segments(LOG_PATH, 3);
+}
+
+/**
+ *  Given a log of three one page segments,
+ *  When we write enough events to fill ten,
+ *  Then the files hold the last three segments, each starting with the peer's address.
+ */
+static void test_event_log_rotate(CuTest* tc) {
+    mc_event_log_t log;
+    segment_t segment;
+    sockaddr_t peer;
+    const mc_event_t* event;
+    uint8_t bytes[64];
+    uint64_t sequences = 0;
+    uint64_t last;
+    uint32_t isegment;
+    uint32_t nevents = 0;
+    uint16_t lastid = 0;
+    uint16_t msgid;
+
+    mn_sockaddr_inet_init(&peer, "127.0.0.1", 5679);
+    remove_segments(LOG_PATH, 3);
+    CuAssert(tc, "initialized", mc_event_log_init(&log, LOG_PATH, 4096, 3, 64, 0) != 0);
+    for (msgid = 0; log.sequence < 10; msgid++) {
+        mc_event_log_datagram(&log, MC_EVENT_SEND, 1, &peer, mk_datagram(bytes, 64, MC_GET, msgid), 64);
+    }
+    last = log.sequence;
+    mc_event_log_deinit(&log);
+
+    for (isegment = 0; isegment < 3; isegment++) {
+        CuAssert(tc, "segment read", read_segment(&segment, LOG_PATH, isegment));
+        CuAssert(tc, "recent segment", segment.header->sequence + 3 > last && segment.header->sequence % 3 == isegment);
+        sequences += segment.header->sequence;
+
+        event = mc_event_log_next(segment.bytes, segment.size, &segment.pos);
+        CuAssert(tc, "peer recorded", event && event->type == MC_EVENT_PEER);
+        while ((event = mc_event_log_next(segment.bytes, segment.size, &segment.pos)) != 0) {
+            if (segment.header->sequence == last) lastid = event->msgid;
+            nevents++;
+        }
+        ms_free(segment.bytes);
+    }
+    remove_segments(LOG_PATH, 3);
+
+    CuAssert(tc, "last three segments", sequences == last + (last - 1) + (last - 2));
+    CuAssert(tc, "last event kept", lastid == (uint16_t)(msgid - 1));
+    CuAssert(tc, "older segments filled", nevents > 2 * (4096 / (sizeof(mc_event_t) + 64) - 2));
+}
+
+/**
+ *  Given two endpoints each with an event log,
+ *  When alice sends bob a confirmable GET and retransmits it,
+ *  Then alice logs a send and a retransmit and bob logs both receipts from alice's address.
+ */
+static void test_event_log_endpt(CuTest* tc) {
+    sockaddr_t addr;
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_event_log_t alog;
+    mc_event_log_t blog;
+    segment_t segment;
+    const mc_event_t* event;
+    mc_event_addr_t from;
+    char* uri = "coap://localhost:5679/test";
+    uint8_t atypes[4] = { 0 };
+    uint8_t btypes[4] = { 0 };
+    uint16_t from_port = 0;
+    uint16_t amsgid;
+    int nrecv = 0;
+    int nmatched = 0;
+    int ievent;
+
+    mc_uri_to_address(&addr, uri);
+    mc_endpt_udp_init(&alice, 512, 512, "0.0.0.0", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "0.0.0.0", 5679);
+    remove_segments(LOG_PATH "_alice", 1);
+    remove_segments(LOG_PATH "_bob", 1);
+    mc_endpt_udp_set_event_log(&alice, mc_event_log_init(&alog, LOG_PATH "_alice", 4096, 1, 512, 0));
+    mc_endpt_udp_set_event_log(&bob, mc_event_log_init(&blog, LOG_PATH "_bob", 4096, 1, 512, 0));
+
+    amsgid = mc_endpt_udp_get(&alice, &addr, ignore_result, uri, 0);
+    nrecv += recv_one(&bob);
+
+    /* Expire the message so it is sent again. */
+    alice.confirmq.deadlines[mc_buffer_queue_get(&alice.confirmq, amsgid)] = 0.0;
+    mc_endpt_udp_check_queues(&alice);
+    nrecv += recv_one(&bob);
+
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+    mc_event_log_deinit(&alog);
+    mc_event_log_deinit(&blog);
+
+    if (read_segment(&segment, LOG_PATH "_alice", 0)) {
+        for (ievent = 0; ievent < 4 && (event = mc_event_log_next(segment.bytes, segment.size, &segment.pos)) != 0; ievent++) {
+            atypes[ievent] = event->type;
+            nmatched += event->type != MC_EVENT_PEER && event->msgid == amsgid;
+        }
+    }
+    ms_free(segment.bytes);
+
+    if (read_segment(&segment, LOG_PATH "_bob", 0)) {
+        for (ievent = 0; ievent < 4 && (event = mc_event_log_next(segment.bytes, segment.size, &segment.pos)) != 0; ievent++) {
+            btypes[ievent] = event->type;
+            nmatched += event->type != MC_EVENT_PEER && event->msgid == amsgid;
+            if (event->type == MC_EVENT_PEER) {
+                memcpy(&from, event + 1, sizeof(from));
+                from_port = ntohs(from.port);
+            }
+        }
+    }
+    ms_free(segment.bytes);
+    remove_segments(LOG_PATH "_alice", 1);
+    remove_segments(LOG_PATH "_bob", 1);
+
+    CuAssert(tc, "both received", nrecv == 2);
+    CuAssert(tc, "alice sent", atypes[0] == MC_EVENT_PEER && atypes[1] == MC_EVENT_SEND
+                               && atypes[2] == MC_EVENT_RETRANSMIT && atypes[3] == MC_EVENT_END);
+    CuAssert(tc, "bob received", btypes[0] == MC_EVENT_PEER && btypes[1] == MC_EVENT_RECV
+                                 && btypes[2] == MC_EVENT_RECV && btypes[3] == MC_EVENT_END);
+    CuAssert(tc, "from alice", from_port == 5678);
+    CuAssert(tc, "msgids logged", nmatched == 4);
+}
+
+/**
+ *  Benchmark appending 64 byte datagrams across eight 1MB segments.
+ */
+static void bench_event_log(CuTest* tc) {
+    mc_event_log_t log;
+    sockaddr_t peer;
+    uint8_t bytes[64];
+    uint32_t ievent;
+    uint32_t written = 0;
+    double start;
+    double elapsed;
+
+    mn_sockaddr_inet_init(&peer, "127.0.0.1", 5679);
+    mk_datagram(bytes, sizeof(bytes), MC_GET, 0);
+    remove_segments(LOG_PATH, 8);
+    CuAssert(tc, "initialized", mc_event_log_init(&log, LOG_PATH, 1024 * 1024, 8, 64, 0) != 0);
+
+    start = mn_gettime();
+    for (ievent = 0; ievent < BENCH_EVENTS; ievent++) {
+        written += mc_event_log_datagram(&log, MC_EVENT_RECV, ievent % 100 + 1, &peer, bytes, sizeof(bytes));
+    }
+    elapsed = mn_gettime() - start;
+
+    printf("event log: %u events in %u segments, %.0f ns each\n", written, (uint32_t)log.sequence + 1,
+           elapsed * 1.0e9 / BENCH_EVENTS);
+    mc_event_log_deinit(&log);
+    remove_segments(LOG_PATH, 8);
+
+    CuAssert(tc, "all written", written == BENCH_EVENTS);
+}
+
+CuSuite* mc_event_log_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_event_log_events);
+    SUITE_ADD_TEST(suite, test_event_log_rotate);
+    SUITE_ADD_TEST(suite, test_event_log_reopen);
+    SUITE_ADD_TEST(suite, test_event_log_endpt);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_event_log_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_event_log);
+
+    return suite;
+}
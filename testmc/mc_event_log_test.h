@@ -0,0 +1,9 @@
+#ifndef MC_EVENT_LOG_TEST_H
+#define MC_EVENT_LOG_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_event_log_suite();
+CuSuite* mc_event_log_bench_suite();
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_header.h"
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_header_batch.h"
+#include "testmc/mc_header_batch_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_BATCH 256
+#define BENCH_ROUNDS 2000
+
+/* Serialize a message with a one byte token, a Uri-Path option, and an optional payload. */
+static mc_buffer_t* mk_datagram(mc_buffer_t* datagram, uint8_t type, uint8_t code, uint16_t msgid, const char* payload) {
+    mc_message_t msg;
+    uint8_t tkval = 7;
+    mc_buffer_t* plbuf = 0;
+    uint32_t nbytes;
+
+    if (payload) plbuf = mc_buffer_init(mc_buffer_alloc(), strlen(payload), (uint8_t*)ms_copy_str(payload));
+
+    mc_message_init(
+        &msg, 1, type, code, msgid,
+        mc_buffer_init(mc_buffer_alloc(), 1, ms_copy_uint8(1, &tkval)),
+        mc_options_list_vinit(mc_options_list_alloc(), 1, mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("test"))),
+        plbuf);
+
+    nbytes = mc_message_buffer_size(&msg);
+    mc_buffer_init(datagram, nbytes, ms_calloc(nbytes, uint8_t));
+    mc_message_to_buffer(&msg, datagram);
+    mc_message_deinit(&msg);
+
+    return datagram;
+}
+
+/**
+ *  Given a batch of datagrams of each message type, plus malformed ones,
+ *  When we decode the batch,
+ *  Then the columns match mc_header_get_* and malformed datagrams are marked invalid.
+ */
+static void test_batch_decode(CuTest* tc) {
+    mc_header_batch_t batch;
+    mc_buffer_t datagrams[6];
+    uint32_t indexes[6];
+    uint8_t truncated[] = { 0x41, 0x01, 0x00, 0x05, 0x07, 0xbd };
+    uint8_t short_dgram[] = { 0x40, 0x01 };
+    uint32_t ndecoded;
+    uint32_t nacks;
+    uint32_t idx;
+
+    mk_datagram(&datagrams[0], MC_CONFIRM, 1, 100, "hello");
+    mk_datagram(&datagrams[1], MC_ACK, 0x45, 100, 0);
+    mk_datagram(&datagrams[2], MC_NOCONFIRM, 2, 101, 0);
+    mk_datagram(&datagrams[3], MC_ACK, 0x45, 102, "x");
+    mc_buffer_init(&datagrams[4], sizeof(truncated), truncated);
+    mc_buffer_init(&datagrams[5], sizeof(short_dgram), short_dgram);
+
+    mc_header_batch_init(&batch, 8);
+    ndecoded = mc_header_batch_decode(&batch, datagrams, 6);
+
+    CuAssert(tc, "decoded 6", ndecoded == 6);
+    for (idx = 0; idx < 4; idx++) {
+        uint32_t header = batch.header[idx];
+        CuAssert(tc, "valid", batch.valid[idx]);
+        CuAssert(tc, "type matches", batch.type[idx] == mc_header_get_message_type(header));
+        CuAssert(tc, "code matches", batch.code[idx] == mc_header_get_code(header));
+        CuAssert(tc, "msgid matches", batch.msgid[idx] == mc_header_get_message_id(header));
+        CuAssert(tc, "token length is 1", batch.tklen[idx] == 1);
+        CuAssert(tc, "options start after token", batch.optpos[idx] == 5);
+    }
+
+    CuAssert(tc, "payload of 0 is hello", strncmp((char*)datagrams[0].bytes + batch.plpos[0], "hello", 5) == 0);
+    CuAssert(tc, "1 has no payload", batch.plpos[1] == datagrams[1].nbytes);
+    CuAssert(tc, "payload of 3 is x", datagrams[3].bytes[batch.plpos[3]] == 'x');
+    CuAssert(tc, "truncated option is invalid", batch.valid[4] == 0);
+    CuAssert(tc, "short datagram is invalid", batch.valid[5] == 0);
+
+    nacks = mc_header_batch_select(&batch, MC_ACK, indexes);
+    CuAssert(tc, "two acks", nacks == 2 && mc_header_batch_count(&batch, MC_ACK) == 2);
+    CuAssert(tc, "acks are 1 and 3", indexes[0] == 1 && indexes[1] == 3);
+    CuAssert(tc, "ack for 100 is 1", mc_header_batch_find(&batch, 0, MC_ACK, 100) == 1);
+    CuAssert(tc, "no ack for 101", mc_header_batch_find(&batch, 0, MC_ACK, 101) == -1);
+
+    for (idx = 0; idx < 4; idx++) mc_buffer_deinit(&datagrams[idx]);
+    mc_header_batch_deinit(&batch);
+}
+
+/**
+ *  Benchmark decoding a batch into columns against decoding each datagram into a message.
+ */
+static void bench_batch_decode(CuTest* tc) {
+    mc_header_batch_t batch;
+    mc_buffer_t datagrams[BENCH_BATCH];
+    uint32_t idx;
+    uint32_t round;
+    uint32_t nacks = 0;
+    double start;
+    double batch_ns;
+    double message_ns;
+
+    for (idx = 0; idx < BENCH_BATCH; idx++) {
+        mk_datagram(&datagrams[idx], (uint8_t)(idx % 4), 0x45, (uint16_t)idx, (idx % 2) ? "payload" : 0);
+    }
+    mc_header_batch_init(&batch, BENCH_BATCH);
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        mc_header_batch_decode(&batch, datagrams, BENCH_BATCH);
+        nacks += mc_header_batch_count(&batch, MC_ACK);
+    }
+    batch_ns = (mn_gettime() - start) * 1.0e9 / ((double)BENCH_ROUNDS * BENCH_BATCH);
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS / 10; round++) {
+        for (idx = 0; idx < BENCH_BATCH; idx++) {
+            uint32_t bpos = 0;
+            mc_message_t* msg = mc_message_from_buffer(mc_message_alloc(), &datagrams[idx], &bpos);
+            nacks += mc_message_is_ack(msg);
+            mc_message_free(msg);
+        }
+    }
+    message_ns = (mn_gettime() - start) * 1.0e9 / ((double)(BENCH_ROUNDS / 10) * BENCH_BATCH);
+
+    printf("header batch decode: %.1f ns/datagram, message decode: %.1f ns/datagram (%u acks)\n", batch_ns, message_ns, nacks);
+
+    for (idx = 0; idx < BENCH_BATCH; idx++) mc_buffer_deinit(&datagrams[idx]);
+    mc_header_batch_deinit(&batch);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_header_batch_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_batch_decode);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_header_batch_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_batch_decode);
+
+    return suite;
+}
@@ -0,0 +1,9 @@
+#ifndef MC_HEADER_BATCH_TEST_H
+#define MC_HEADER_BATCH_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_header_batch_suite();
+CuSuite* mc_header_batch_bench_suite();
+
+#endif
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_mem_resource.h"
+#include "testmc/mc_mem_resource_test.h"
+
+#include "cutest/CuTest.h"
+
+static uint32_t response_format;
+static char response_json[MC_MEM_RESOURCE_MAX];
+
+/* Keep the content format and payload of the response. */
+static int test_response_fn(mc_endpt_id_t endpt, uint16_t msgid, mc_message_t* response) {
+    response_format = UINT32_MAX;
+    response_json[0] = 0;
+    if (response && response->options) mc_options_list_get_uint32(response->options, OPTION_CONTENT_FORMAT, &response_format);
+    if (response && response->payload && response->payload->nbytes < sizeof(response_json)) {
+        memcpy(response_json, response->payload->bytes, response->payload->nbytes);
+        response_json[response->payload->nbytes] = 0;
+    }
+    return 1;
+}
+
+/**
+ *  Given tagged allocations,
+ *  When the usage is rendered,
+ *  Then every tag is in the JSON object and a buffer that is too small is refused.
+ */
+static void test_mem_resource_render(CuTest* tc) {
+    char json[MC_MEM_RESOURCE_MAX];
+    char* block = ms_malloc_tag(MS_MEM_SOCKADDR, 1, char);
+    uint32_t length = mc_mem_resource_render(json, sizeof(json));
+
+    ms_free(block);
+    CuAssert(tc, "rendered", length > 0 && length == strlen(json));
+    CuAssert(tc, "object", json[0] == '{' && json[length - 1] == '}');
+    CuAssert(tc, "first tag", strncmp(json, "{\"other\":{\"bytes\":", 18) == 0);
+    CuAssert(tc, "all tags", strstr(json, "\"message\":") && strstr(json, "\"option\":") && strstr(json, "\"buffer\":")
+             && strstr(json, "\"queue\":") && strstr(json, "\"sockaddr\":") && strstr(json, "\"uri\":"));
+    CuAssert(tc, "too small", mc_mem_resource_render(json, 40) == 0);
+}
+
+/**
+ *  Given a server with the memory resource registered,
+ *  When a client gets it,
+ *  Then the usage comes back as JSON.
+ */
+static void test_mem_resource_get(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_router_t router;
+    mc_message_t* msg;
+    int registered;
+
+    mc_endpt_udp_init(&alice, 2048, 2048, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 2048, 2048, "127.0.0.1", 5679);
+    mc_router_init(&router);
+    registered = mc_mem_resource_register(&router, 0);
+
+    response_format = UINT32_MAX;
+    mc_endpt_udp_request(&alice, 0, MC_GET, "coap://127.0.0.1:5679/memory", 0, 0, 0, test_response_fn);
+    msg = mc_endpt_udp_recv(&bob);
+    if (msg) {
+        mc_router_dispatch(&router, &bob, msg);
+        mc_message_free(msg);
+    }
+    mc_endpt_udp_recv(&alice);
+
+    mc_router_deinit(&router);
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+
+    CuAssert(tc, "registered", registered);
+    CuAssert(tc, "json", response_format == CONTENT_JSON);
+    CuAssert(tc, "usage", strstr(response_json, "\"buffer\":{\"bytes\":") != 0);
+}
+
+CuSuite* mc_mem_resource_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_mem_resource_render);
+    SUITE_ADD_TEST(suite, test_mem_resource_get);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MC_MEM_RESOURCE_TEST_H
+#define MC_MEM_RESOURCE_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_mem_resource_suite();
+
+#endif
@@ -110,8 +110,8 @@ static void test_empty_payload_to_roundtrip(CuTest* tc) {
     CuAssert(tc, "Same token nbytes", actual->token->nbytes == message->token->nbytes);
     CuAssert(tc, "Same payload (0)", (actual->payload == message->payload) && (actual->payload == 0));
 
-    ms_free(mc_message_deinit(actual));
-    ms_free(mc_message_deinit(message));
+    mc_message_free(actual);
+    mc_message_free(message);
 }
 
 /**
@@ -158,7 +158,7 @@ static void test_message_to_buffer(CuTest* tc) {
     CuAssert(tc, "byte[7] is 0xff", buffer->bytes[7] == (uint8_t)0xff); // Payload flag
     CuAssert(tc, "byte[8] is 0x0a", buffer->bytes[8] == (uint8_t)0x0a); // Payload
 
-    ms_free(mc_message_deinit(message));
+    mc_message_free(message);
 }
 
 /**
@@ -214,8 +214,39 @@ static void test_message_roundtrip(CuTest* tc) {
     CuAssert(tc, "Has payload bytes", actual->payload->nbytes == 1);
     CuAssert(tc, "Has payload value", actual->payload->bytes[0] == pl_value);
 
-    ms_free(mc_message_deinit(actual));
-    ms_free(mc_message_deinit(message));
+    mc_message_free(actual);
+    mc_message_free(message);
+}
+
+/**
+ *  Given a message with a generated token,
+ *  When we serialize it, then deserialize it,
+ *  Then both tokens live in their message's inline storage and match.
+ */
+static void test_message_random_token(CuTest* tc) {
+    ms_random_t rng;
+    mc_message_t message;
+    mc_message_t actual;
+    mc_buffer_t buffer;
+    uint8_t bytes[32];
+    uint32_t pos = 0;
+
+    ms_random_init_seed(&rng, 1);
+    mc_message_con_init(&message, 1, 2, mc_message_random_token(&message, MC_TOKEN_LEN, &rng), 0, 0);
+    mc_buffer_init(&buffer, sizeof(bytes), bytes);
+    buffer.nbytes = mc_message_to_buffer(&message, &buffer);
+
+    memset(&actual, 0, sizeof(actual));
+    CuAssert(tc, "decoded", mc_message_from_buffer(&actual, &buffer, &pos) != 0);
+
+    CuAssert(tc, "token is inline", message.token == &message.tokenbuf);
+    CuAssert(tc, "token length", mc_message_get_token_len(&message) == MC_TOKEN_LEN);
+    CuAssert(tc, "received token is inline", actual.token == &actual.tokenbuf);
+    CuAssert(tc, "tokens match", actual.token->nbytes == MC_TOKEN_LEN
+             && memcmp(actual.token->bytes, message.token->bytes, MC_TOKEN_LEN) == 0);
+
+    mc_message_deinit(&actual);
+    mc_message_deinit(&message);
 }
 
 /* Run all of the tests in this test suite. */
@@ -226,6 +257,7 @@ CuSuite* mc_message_suite() {
     SUITE_ADD_TEST(suite, test_empty_payload_to_roundtrip);
     SUITE_ADD_TEST(suite, test_message_to_buffer);
     SUITE_ADD_TEST(suite, test_message_roundtrip);
+    SUITE_ADD_TEST(suite, test_message_random_token);
     
     return suite;
 }
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_option_scan.h"
+#include "mcoap/mc_options_list.h"
+#include "testmc/mc_option_scan_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_NOPTIONS 48
+#define BENCH_ROUNDS 50000
+
+/*
+ * Fill bytes with noptions small options (alternating 1 and 2 byte values, optionally containing 0xff)
+ * followed by a payload marker and a payload of 0xff bytes.
+ * @return the number of bytes used.
+ */
+static uint32_t mk_options(uint8_t* bytes, uint32_t noptions, uint32_t plbytes, int ffvalues) {
+    uint32_t bpos = 0;
+    uint32_t ioption;
+
+    for (ioption = 0; ioption < noptions; ioption++) {
+        if (ioption % 2) {
+            bytes[bpos++] = 0x12;
+            bytes[bpos++] = ffvalues ? 0xff : 0x7f;
+            bytes[bpos++] = (uint8_t)ioption;
+        }
+        else {
+            bytes[bpos++] = 0x01;
+            bytes[bpos++] = (uint8_t)ioption;
+        }
+    }
+    if (plbytes > 0) {
+        bytes[bpos++] = 0xff;
+        memset(bytes + bpos, 0xff, plbytes);
+        bpos += plbytes;
+    }
+    return bpos;
+}
+
+/**
+ *  Given option buffers with and without payloads, some with 0xff inside option values,
+ *  When we scan them,
+ *  Then the vector and scalar scans agree on the option count and payload position.
+ */
+static void test_scan_valid(CuTest* tc) {
+    uint8_t bytes[512];
+    mc_option_scan_t scan;
+    mc_option_scan_t scalar;
+    uint32_t noptions;
+    uint32_t nbytes;
+
+    for (noptions = 0; noptions < 40; noptions++) {
+        nbytes = mk_options(bytes, noptions, noptions % 3, noptions % 2);
+
+        CuAssert(tc, "scan is valid", mc_option_scan(&scan, bytes, nbytes, 0));
+        CuAssert(tc, "scalar scan is valid", mc_option_scan_scalar(&scalar, bytes, nbytes, 0));
+        CuAssert(tc, "option count", scan.noptions == noptions && scalar.noptions == noptions);
+        CuAssert(tc, "same payload", scan.plpos == scalar.plpos && scan.optend == scalar.optend);
+        CuAssert(tc, "payload length", nbytes - scan.plpos == noptions % 3);
+    }
+}
+
+/**
+ *  Given malformed option buffers,
+ *  When we scan them,
+ *  Then they are rejected.
+ */
+static void test_scan_malformed(CuTest* tc) {
+    mc_option_scan_t scan;
+    uint8_t overrun[] = { 0x01, 0x01, 0x05, 0x01 };
+    uint8_t reserved_len[] = { 0x0f, 0x01, 0x01 };
+    uint8_t reserved_delta[] = { 0xf1, 0x01 };
+    uint8_t empty_payload[] = { 0x01, 0x01, 0xff };
+    uint8_t short_extended[] = { 0x0e, 0x01 };
+
+    CuAssert(tc, "length overrun", !mc_option_scan(&scan, overrun, sizeof(overrun), 0));
+    CuAssert(tc, "reserved length", !mc_option_scan(&scan, reserved_len, sizeof(reserved_len), 0));
+    CuAssert(tc, "reserved delta", !mc_option_scan(&scan, reserved_delta, sizeof(reserved_delta), 0));
+    CuAssert(tc, "marker without payload", !mc_option_scan(&scan, empty_payload, sizeof(empty_payload), 0));
+    CuAssert(tc, "truncated extended length", !mc_option_scan(&scan, short_extended, sizeof(short_extended), 0));
+    CuAssert(tc, "scalar agrees", !mc_option_scan_scalar(&scan, overrun, sizeof(overrun), 0));
+}
+
+/**
+ *  Given an option with a 2 byte extended length,
+ *  When we decode the options,
+ *  Then the value is found after the extended length.
+ */
+static void test_scan_extended_length(CuTest* tc) {
+    uint8_t bytes[300];
+    mc_buffer_t buffer;
+    mc_option_scan_t scan;
+    mc_options_list_t* list;
+    uint32_t bpos = 0;
+
+    memset(bytes, 'a', sizeof(bytes));
+    bytes[0] = 0xbe;            /* Uri-Path, 2 byte extended length. */
+    bytes[1] = 0x00;
+    bytes[2] = 0x10;            /* 269 + 16 = 285 bytes. */
+    mc_buffer_init(&buffer, 3 + 285, bytes);
+
+    CuAssert(tc, "scan is valid", mc_option_scan(&scan, bytes, buffer.nbytes, 0));
+    CuAssert(tc, "one option", scan.noptions == 1 && scan.plpos == buffer.nbytes);
+
+    list = mc_options_list_from_buffer(mc_options_list_alloc(), &buffer, &bpos);
+    CuAssert(tc, "decoded", list != 0 && list->noptions == 1);
+    CuAssert(tc, "value length 285", list->options[0].value.nbytes == 285);
+
+    ms_free(mc_options_list_deinit(list));
+}
+
+/**
+ *  Benchmark the vectorized scan against the scalar scan and the full option decode
+ *  on a message with many small options.
+ */
+static void bench_scan(CuTest* tc) {
+    uint8_t bytes[1024];
+    mc_buffer_t buffer;
+    mc_option_scan_t scan;
+    uint32_t nbytes = mk_options(bytes, BENCH_NOPTIONS, 64, 0);
+    uint32_t round;
+    uint32_t total = 0;
+    double start;
+    double vector_ns;
+    double scalar_ns;
+    double decode_ns;
+
+    mc_buffer_init(&buffer, nbytes, bytes);
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        mc_option_scan(&scan, bytes, nbytes, 0);
+        total += scan.noptions;
+    }
+    vector_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        mc_option_scan_scalar(&scan, bytes, nbytes, 0);
+        total += scan.noptions;
+    }
+    scalar_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS / 10; round++) {
+        uint32_t bpos = 0;
+        mc_options_list_t* list = mc_options_list_from_buffer(mc_options_list_alloc(), &buffer, &bpos);
+        total += list->noptions;
+        ms_free(mc_options_list_deinit(list));
+    }
+    decode_ns = (mn_gettime() - start) * 1.0e9 / (BENCH_ROUNDS / 10);
+
+    printf("option scan (%d options): vector %.1f ns, scalar %.1f ns, full decode %.1f ns (%u scanned)\n",
+           BENCH_NOPTIONS, vector_ns, scalar_ns, decode_ns, total);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_option_scan_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_scan_valid);
+    SUITE_ADD_TEST(suite, test_scan_malformed);
+    SUITE_ADD_TEST(suite, test_scan_extended_length);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_option_scan_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_scan);
+
+    return suite;
+}
@@ -0,0 +1,9 @@
+#ifndef MC_OPTION_SCAN_TEST_H
+#define MC_OPTION_SCAN_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_option_scan_suite();
+CuSuite* mc_option_scan_bench_suite();
+
+#endif
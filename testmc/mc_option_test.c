@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_option.h"
+#include "testmc/mc_option_test.h"
+
+#include "cutest/CuTest.h"
+
+/**
+ *  Given the option registry,
+ *  When we look up registered and unregistered option numbers,
+ *  Then the registered ones have the expected metadata and the others are unknown.
+ */
+static void test_option_info(CuTest* tc) {
+    const mc_option_info_t* info;
+
+    info = mc_option_info(OPTION_URI_PATH);
+    CuAssert(tc, "uri path is known", info != 0);
+    CuAssert(tc, "uri path number", info->option_num == 11);
+    CuAssert(tc, "uri path is a string", info->format == MC_FORMAT_STRING);
+    CuAssert(tc, "uri path is critical, unsafe and repeatable",
+             info->flags == (MC_OPTION_KNOWN | MC_OPTION_CRITICAL | MC_OPTION_UNSAFE | MC_OPTION_REPEATABLE));
+
+    info = mc_option_info(OPTION_SIZE_1);
+    CuAssert(tc, "size1 is elective and no-cache-key",
+             info != 0 && info->flags == (MC_OPTION_KNOWN | MC_OPTION_NOCACHEKEY));
+
+    info = mc_option_info(OPTION_PROXY_URI);
+    CuAssert(tc, "proxy uri length", info != 0 && info->min_length == 1 && info->max_length == 1034);
+
+    CuAssert(tc, "observe is registered", mc_option_info(OPTION_OBSERVE) != 0);
+    CuAssert(tc, "block2 is registered", mc_option_info(OPTION_BLOCK2) != 0);
+    CuAssert(tc, "2 is unknown", mc_option_info(2) == 0);
+    CuAssert(tc, "1000 is unknown", mc_option_info(1000) == 0);
+}
+
+/**
+ *  Given options with values in and out of their registered length range,
+ *  When we check them,
+ *  Then only the in range values of known options are valid.
+ */
+static void test_option_is_valid(CuTest* tc) {
+    mc_option_t option;
+
+    memset(&option, 0, sizeof(option));
+    mc_option_init(&option, OPTION_ETAG, 0, 0);
+    CuAssert(tc, "empty etag is invalid", !mc_option_is_valid(&option));
+
+    mc_option_init(&option, OPTION_ETAG, 4, ms_copy_uint8(4, (uint8_t*)"abcd"));
+    CuAssert(tc, "4 byte etag is valid", mc_option_is_valid(&option));
+
+    mc_option_init(&option, OPTION_URI_PORT, 4, ms_copy_uint8(4, (uint8_t*)"abcd"));
+    CuAssert(tc, "4 byte port is invalid", !mc_option_is_valid(&option));
+
+    mc_option_init(&option, 2, 1, ms_copy_uint8(1, (uint8_t*)"a"));
+    CuAssert(tc, "unknown option is invalid", !mc_option_is_valid(&option));
+
+    mc_option_deinit(&option);
+}
+
+/**
+ *  Given uint option values of 0 to 4 bytes,
+ *  When we decode them,
+ *  Then the network order value is returned.
+ */
+static void test_option_as_uint32(CuTest* tc) {
+    mc_option_t option;
+    uint8_t three[] = { 0x01, 0x02, 0x03 };
+
+    memset(&option, 0, sizeof(option));
+    mc_option_init(&option, OPTION_BLOCK2, 3, ms_copy_uint8(3, three));
+    CuAssert(tc, "3 byte value", mc_option_as_uint32(&option) == 0x010203);
+
+    mc_option_init(&option, OPTION_BLOCK2, 0, 0);
+    CuAssert(tc, "empty value is 0", mc_option_as_uint32(&option) == 0);
+
+    mc_option_init_uint32(&option, OPTION_MAX_AGE, 0x12345678);
+    CuAssert(tc, "4 byte value", mc_option_as_uint32(&option) == 0x12345678);
+
+    mc_option_deinit(&option);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_option_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_option_info);
+    SUITE_ADD_TEST(suite, test_option_is_valid);
+    SUITE_ADD_TEST(suite, test_option_as_uint32);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MC_OPTION_TEST_H
+#define MC_OPTION_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_option_suite();
+
+#endif
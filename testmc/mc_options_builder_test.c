@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mcoap/mc_options_builder.h"
+#include "testmc/mc_options_builder_test.h"
+
+#include "cutest/CuTest.h"
+
+static int option_is(const mc_option_t* option, uint16_t num, const char* value) {
+    if (option->option_num != num) return 0;
+    if (option->value.nbytes != strlen(value)) return 0;
+    return strncmp((const char*)option->value.bytes, value, option->value.nbytes) == 0;
+}
+
+/**
+ *  Given two sorted lists with a repeated option in both,
+ *  When we merge them with a builder,
+ *  Then the result is sorted, repeated options keep their order, and the values were moved.
+ */
+static void test_builder_sorted_merge(CuTest* tc) {
+    mc_options_builder_t builder;
+    uint8_t* moved;
+    mc_options_list_t* uri = mc_options_list_vinit(
+        mc_options_list_alloc(),
+        3,
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_HOST, ms_copy_str("host")),
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("a")),
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("b")));
+    mc_options_list_t* extra = mc_options_list_vinit(
+        mc_options_list_alloc(),
+        3,
+        mc_option_init_str(mc_option_alloc(), OPTION_IF_MATCH, ms_copy_str("x")),
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("c")),
+        mc_option_init_str(mc_option_alloc(), OPTION_ACCEPT, ms_copy_str("y")));
+
+    moved = uri->options[1].value.bytes;
+
+    mc_options_builder_init(&builder, uri->noptions + extra->noptions);
+    mc_options_builder_merge(&builder, uri);
+    mc_options_builder_merge(&builder, extra);
+
+    CuAssert(tc, "builder is sorted", builder.sorted);
+    CuAssert(tc, "builder has 6 options", builder.noptions == 6);
+    CuAssert(tc, "capacity was not grown", builder.capacity == 6);
+    CuAssert(tc, "extra is empty", extra->noptions == 0 && extra->options == 0);
+
+    mc_options_builder_to_list(&builder, uri);
+
+    CuAssert(tc, "list has 6 options", uri->noptions == 6);
+    CuAssert(tc, "0 is if-match", option_is(&uri->options[0], OPTION_IF_MATCH, "x"));
+    CuAssert(tc, "1 is host", option_is(&uri->options[1], OPTION_URI_HOST, "host"));
+    CuAssert(tc, "2 is path a", option_is(&uri->options[2], OPTION_URI_PATH, "a"));
+    CuAssert(tc, "3 is path b", option_is(&uri->options[3], OPTION_URI_PATH, "b"));
+    CuAssert(tc, "4 is path c", option_is(&uri->options[4], OPTION_URI_PATH, "c"));
+    CuAssert(tc, "5 is accept", option_is(&uri->options[5], OPTION_ACCEPT, "y"));
+    CuAssert(tc, "value was moved, not copied", uri->options[2].value.bytes == moved);
+    CuAssert(tc, "list is indexed", mc_options_list_count(uri, OPTION_URI_PATH) == 3);
+
+    mc_options_builder_deinit(&builder);
+    ms_free(mc_options_list_deinit(uri));
+    ms_free(mc_options_list_deinit(extra));
+}
+
+/**
+ *  Given options appended out of order,
+ *  When we build the list,
+ *  Then the list is sorted and repeated options keep the order they were added in.
+ */
+static void test_builder_unsorted_add(CuTest* tc) {
+    mc_options_builder_t builder;
+    mc_options_list_t list;
+
+    memset(&list, 0, sizeof(list));
+    mc_options_builder_init(&builder, 1);
+    mc_options_builder_add(&builder, OPTION_URI_QUERY, 2, (uint8_t*)ms_copy_str("q1"));
+    mc_options_builder_add(&builder, OPTION_URI_PATH, 1, (uint8_t*)ms_copy_str("a"));
+    mc_options_builder_add(&builder, OPTION_URI_QUERY, 2, (uint8_t*)ms_copy_str("q2"));
+    mc_options_builder_add(&builder, OPTION_URI_PATH, 1, (uint8_t*)ms_copy_str("b"));
+
+    CuAssert(tc, "builder is not sorted", !builder.sorted);
+    CuAssert(tc, "builder grew", builder.capacity >= 4);
+
+    mc_options_builder_to_list(&builder, &list);
+
+    CuAssert(tc, "0 is path a", option_is(&list.options[0], OPTION_URI_PATH, "a"));
+    CuAssert(tc, "1 is path b", option_is(&list.options[1], OPTION_URI_PATH, "b"));
+    CuAssert(tc, "2 is query q1", option_is(&list.options[2], OPTION_URI_QUERY, "q1"));
+    CuAssert(tc, "3 is query q2", option_is(&list.options[3], OPTION_URI_QUERY, "q2"));
+    CuAssert(tc, "builder is empty", builder.noptions == 0 && builder.options == 0);
+
+    mc_options_list_deinit(&list);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_options_builder_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_builder_sorted_merge);
+    SUITE_ADD_TEST(suite, test_builder_unsorted_add);
+
+    return suite;
+}
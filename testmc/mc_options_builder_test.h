@@ -0,0 +1,8 @@
+#ifndef MC_OPTIONS_BUILDER_TEST_H
+#define MC_OPTIONS_BUILDER_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_options_builder_suite();
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "msys/ms_copy.h"
 #include "msys/ms_memory.h"
+#include "mcoap/mc_code.h"
 #include "mcoap/mc_options_list.h"
 #include "testmc/mc_options_list_test.h"
 
@@ -24,8 +25,8 @@ static void test_options_list_init(CuTest* tc) {
     CuAssert(tc, "list count is 1", list->noptions == 1);
     CuAssert(tc, "list owns the data buffer", list->options->value.bytes == buffer->bytes);
 
-    free(mc_options_list_deinit(list));
-    free(buffer);
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(mc_buffer_init(buffer, 0, 0));
 }
 
 static FILE* write_bytes(FILE* out, uint32_t count, uint8_t* bytes) {
@@ -73,8 +74,8 @@ static void test_options_list_u8_write_to_buffer(CuTest* tc) {
     /* Value of 1 in 8 bits. */
     CuAssert(tc, "bytes[3] is 0x02", buffer->bytes[3] == 0x02);
 
-    free(mc_options_list_deinit(list));
-    free(mc_buffer_deinit(buffer));
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(buffer);
 }
 
 /**
@@ -111,8 +112,8 @@ static void test_options_list_u16_write_to_buffer(CuTest* tc) {
     CuAssert(tc, "bytes[4] is 0x01", buffer->bytes[4] == 0x01);
     CuAssert(tc, "bytes[4] is 0x01", buffer->bytes[4] == 0x01);
 
-    free(mc_options_list_deinit(list));
-    free(mc_buffer_deinit(buffer));
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(buffer);
 }
 
 /**
@@ -154,8 +155,8 @@ static void test_options_list_u32_write_to_buffer(CuTest* tc) {
     CuAssert(tc, "bytes[8] is 0x01", buffer->bytes[8] == 0x00);
     CuAssert(tc, "bytes[9] is 0x01", buffer->bytes[9] == 0x01);
 
-    free(mc_options_list_deinit(list));
-    free(mc_buffer_deinit(buffer));
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(buffer);
 }
 
 /**
@@ -182,7 +183,7 @@ static void test_options_list_vinit(CuTest* tc) {
     CuAssert(tc, "option[2] num is 3", list->options[2].option_num == 3);
     CuAssert(tc, "option[2] val is 65536", mc_option_as_uint32(&list->options[2]) == 65536);
 
-    free(mc_options_list_deinit(list));
+    ms_free(mc_options_list_deinit(list));
 }
 
 /**
@@ -237,9 +238,118 @@ static void test_options_list_buffer_roundtrip(CuTest* tc) {
     CuAssert(tc, "result->options[4] optlen == 1", result->options[4].value.nbytes == 1);
     CuAssert(tc, "result->options[4] value == 10", *(result->options[4].value.bytes) == 10);
 
-    free(mc_options_list_deinit(list));
-    free(mc_buffer_deinit(buffer));
-    free(mc_options_list_deinit(result));
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(buffer);
+    ms_free(mc_options_list_deinit(result));
+}
+
+/**
+ *  Given a decoded option list with a repeated option and an option outside the index,
+ *  When we look options up,
+ *  Then presence, counts, and first-occurrence lookups match the list contents.
+ */
+static void test_options_list_index(CuTest* tc) {
+	uint32_t bpos = 0;
+	uint32_t count = 0;
+	mc_option_t* options = mc_option_nalloc(5);
+	mc_option_init_str(options    , OPTION_URI_PATH, ms_copy_str("a"));
+	mc_option_init_str(options + 1, OPTION_URI_PATH, ms_copy_str("b"));
+	mc_option_init_str(options + 2, OPTION_URI_PATH, ms_copy_str("c"));
+	mc_option_init_uint32(options + 3, OPTION_CONTENT_FORMAT, CONTENT_JSON);
+	mc_option_init_uint32(options + 4, 100, 1);
+
+    mc_options_list_t* list = mc_options_list_init(mc_options_list_alloc(), 5, options);
+
+    uint32_t nbytes = mc_options_list_buffer_size(list);
+    mc_buffer_t* buffer = mc_buffer_init(mc_buffer_alloc(), nbytes, ms_calloc(nbytes, uint8_t));
+    mc_options_list_to_buffer(list, buffer, &bpos);
+
+    bpos = 0;
+    mc_options_list_t* result = mc_options_list_from_buffer(mc_options_list_alloc(), buffer, &bpos);
+    mc_option_t* paths = mc_options_list_get_all(result, OPTION_URI_PATH, &count);
+
+    CuAssert(tc, "has uri path", mc_options_list_has(result, OPTION_URI_PATH));
+    CuAssert(tc, "has content format", mc_options_list_has(result, OPTION_CONTENT_FORMAT));
+    CuAssert(tc, "has no accept", !mc_options_list_has(result, OPTION_ACCEPT));
+    CuAssert(tc, "has unindexed option", mc_options_list_has(result, 100));
+    CuAssert(tc, "3 uri paths", mc_options_list_count(result, OPTION_URI_PATH) == 3);
+    CuAssert(tc, "uri path starts at 0", mc_options_list_get_index(result, 0, OPTION_URI_PATH) == 0);
+    CuAssert(tc, "second uri path at 1", mc_options_list_get_index(result, 1, OPTION_URI_PATH) == 1);
+    CuAssert(tc, "no uri path after 2", mc_options_list_get_index(result, 3, OPTION_URI_PATH) == -1);
+    CuAssert(tc, "content format at 3", mc_options_list_get_index(result, 0, OPTION_CONTENT_FORMAT) == 3);
+    CuAssert(tc, "unindexed option at 4", mc_options_list_get_index(result, 0, 100) == 4);
+    CuAssert(tc, "get_all count is 3", count == 3);
+    CuAssert(tc, "get_all path[2] is c", paths != 0 && paths[2].value.bytes[0] == 'c');
+    CuAssert(tc, "content format is json", mc_option_as_uint32(mc_options_list_get(result, OPTION_CONTENT_FORMAT)) == CONTENT_JSON);
+    CuAssert(tc, "missing option is null", mc_options_list_get(result, OPTION_ACCEPT) == 0);
+
+    ms_free(mc_options_list_deinit(list));
+    mc_buffer_free(buffer);
+    ms_free(mc_options_list_deinit(result));
+}
+
+/**
+ *  Given option lists with unrecognized elective and critical options,
+ *  When we validate them,
+ *  Then only the critical ones are reported.
+ */
+static void test_options_list_validate(CuTest* tc) {
+	mc_option_t* options = mc_option_nalloc(4);
+	mc_option_init_uint32(options    , OPTION_CONTENT_FORMAT, CONTENT_JSON);
+	mc_option_init_uint32(options + 1, OPTION_CONTENT_FORMAT, CONTENT_JSON);
+	mc_option_init_str(options + 2, OPTION_URI_PATH, ms_copy_str("a"));
+	mc_option_init_uint32(options + 3, 100, 1);
+
+    mc_options_list_t* list = mc_options_list_init(mc_options_list_alloc(), 4, options);
+
+    /* Repeated content format and unknown option 100 are both elective. */
+    CuAssert(tc, "electives are ignored", mc_options_list_validate(list) == -1);
+
+    /* A second Uri-Host (critical, not repeatable) must be rejected. */
+    mc_option_init_str(mc_option_deinit(options), OPTION_URI_HOST, ms_copy_str("a"));
+    mc_option_init_str(mc_option_deinit(options + 1), OPTION_URI_HOST, ms_copy_str("b"));
+    mc_options_list_init(list, 4, options);
+    CuAssert(tc, "repeated uri host at 1", mc_options_list_validate(list) == 1);
+
+    /* So must an unknown critical option and a too long Uri-Port. */
+    mc_option_init_uint32(options + 1, 9, 1);
+    mc_options_list_init(list, 4, options);
+    CuAssert(tc, "unknown critical option at 1", mc_options_list_validate(list) == 1);
+
+    mc_option_init_uint32(options + 1, OPTION_URI_PORT, 70000);
+    mc_options_list_init(list, 4, options);
+    CuAssert(tc, "3 byte uri port at 1", mc_options_list_validate(list) == 1);
+
+    ms_free(mc_options_list_deinit(list));
+}
+
+/**
+ *  Given two requests that differ only in a NoCacheKey option,
+ *  When we compute their cache keys,
+ *  Then the keys match, and differ from a request with another path or method.
+ */
+static void test_options_list_cache_key(CuTest* tc) {
+	uint32_t value = 0;
+    mc_options_list_t* list1 = mc_options_list_vinit(mc_options_list_alloc(), 2,
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("a")),
+        mc_option_init_uint32(mc_option_alloc(), OPTION_SIZE_1, 10));
+    mc_options_list_t* list2 = mc_options_list_vinit(mc_options_list_alloc(), 2,
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("a")),
+        mc_option_init_uint32(mc_option_alloc(), OPTION_SIZE_1, 20));
+    mc_options_list_t* list3 = mc_options_list_vinit(mc_options_list_alloc(), 1,
+        mc_option_init_str(mc_option_alloc(), OPTION_URI_PATH, ms_copy_str("b")));
+
+    CuAssert(tc, "size1 is not in the key", mc_options_list_cache_key(list1, MC_GET) == mc_options_list_cache_key(list2, MC_GET));
+    CuAssert(tc, "path is in the key", mc_options_list_cache_key(list1, MC_GET) != mc_options_list_cache_key(list3, MC_GET));
+    CuAssert(tc, "method is in the key", mc_options_list_cache_key(list1, MC_GET) != mc_options_list_cache_key(list1, MC_PUT));
+
+    CuAssert(tc, "typed size1", mc_options_list_get_uint32(list2, OPTION_SIZE_1, &value) && value == 20);
+    CuAssert(tc, "uri path is not a uint", !mc_options_list_get_uint32(list2, OPTION_URI_PATH, &value));
+    CuAssert(tc, "uri path value", mc_options_list_get_value(list3, OPTION_URI_PATH)->bytes[0] == 'b');
+
+    ms_free(mc_options_list_deinit(list1));
+    ms_free(mc_options_list_deinit(list2));
+    ms_free(mc_options_list_deinit(list3));
 }
 
 /* Run all of the tests in this test suite. */
@@ -252,6 +362,9 @@ CuSuite* mc_options_list_suite() {
     SUITE_ADD_TEST(suite, test_options_list_u32_write_to_buffer);
     SUITE_ADD_TEST(suite, test_options_list_vinit);
     SUITE_ADD_TEST(suite, test_options_list_buffer_roundtrip);
+    SUITE_ADD_TEST(suite, test_options_list_index);
+    SUITE_ADD_TEST(suite, test_options_list_validate);
+    SUITE_ADD_TEST(suite, test_options_list_cache_key);
 
     return suite;
 }
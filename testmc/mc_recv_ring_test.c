@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_endpt_udp.h"
+#include "mcoap/mc_recv_ring.h"
+#include "testmc/mc_recv_ring_test.h"
+
+#include "cutest/CuTest.h"
+
+/**
+ *  Given a ring of four slots,
+ *  When we take every slot and release one,
+ *  Then the slots are cache line aligned, a full ring has none to give, and the released slot comes back.
+ */
+static void test_ring_slots(CuTest* tc) {
+    mc_recv_ring_t ring;
+    mc_shared_buffer_t* slots[4];
+    mc_shared_buffer_t* again;
+    int islot;
+
+    CuAssert(tc, "initialized", mc_recv_ring_init(&ring, 4, 100, 0) != 0);
+    CuAssert(tc, "slot size rounded", ring.slotsize == 128 && ring.nfree == 4);
+
+    for (islot = 0; islot < 4; islot++) {
+        slots[islot] = mc_recv_ring_acquire(&ring);
+        CuAssert(tc, "acquired", slots[islot] != 0 && slots[islot]->view.nbytes == 128);
+        CuAssert(tc, "aligned", ((size_t)slots[islot]->view.bytes % MC_RECV_SLOT_ALIGN) == 0);
+    }
+    CuAssert(tc, "exhausted", mc_recv_ring_acquire(&ring) == 0 && ring.nfree == 0);
+
+    slots[2]->view.nbytes = 10;
+    mc_shared_buffer_release(slots[2]);
+    again = mc_recv_ring_acquire(&ring);
+    CuAssert(tc, "reused with full view", again == slots[2] && again->view.nbytes == 128);
+
+    for (islot = 0; islot < 4; islot++) mc_shared_buffer_release(slots[islot]);
+    CuAssert(tc, "all free", ring.nfree == 4);
+    mc_recv_ring_deinit(&ring);
+}
+
+/**
+ *  Given a ring that asks for huge pages,
+ *  When the system has none reserved,
+ *  Then it still maps the slots with normal pages.
+ */
+static void test_ring_huge(CuTest* tc) {
+    mc_recv_ring_t ring;
+    mc_shared_buffer_t* slot;
+
+    CuAssert(tc, "initialized", mc_recv_ring_init(&ring, 1024, 1500, 1) != 0);
+    printf("receive ring: %u slots of %u bytes, %s pages\n", ring.nslots, ring.slotsize, ring.pages.huge ? "huge" : "normal");
+
+    slot = mc_recv_ring_acquire(&ring);
+    memset(slot->view.bytes, 0xff, slot->view.nbytes);
+    mc_shared_buffer_release(slot);
+    mc_recv_ring_deinit(&ring);
+}
+
+/**
+ *  Given two endpoints,
+ *  When one receives a message with a payload,
+ *  Then the payload is read in place from a receive slot, which is reused once the message is freed.
+ */
+static void test_ring_recv(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t* bmsg;
+    uint8_t* base;
+    uint32_t nfree;
+    int received;
+    int inplace = 0;
+    int held = 0;
+    int reused;
+    const char* text = "in place";
+
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+    base = (uint8_t*)bob.ring.pages.base;
+    nfree = bob.ring.nfree;
+
+    mc_endpt_udp_post(&alice, 0, 0, "coap://127.0.0.1:5679/ring", 0,
+                      mc_buffer_init(mc_buffer_alloc(), (uint32_t)strlen(text), (uint8_t*)ms_copy_str(text)));
+    bmsg = mc_endpt_udp_recv(&bob);
+    received = bmsg != 0 && bmsg->payload != 0 && bmsg->payload->nbytes == strlen(text)
+               && memcmp(bmsg->payload->bytes, text, strlen(text)) == 0;
+    if (received) {
+        inplace = bmsg->payload->bytes > base && bmsg->payload->bytes < base + bob.ring.pages.size;
+        held = bob.ring.nfree == nfree - 1;
+    }
+    mc_message_free(bmsg);
+    reused = bob.ring.nfree == nfree;
+
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+
+    CuAssert(tc, "received", received);
+    CuAssert(tc, "payload is in a slot", inplace);
+    CuAssert(tc, "message holds the slot", held);
+    CuAssert(tc, "slot free after the message", reused);
+}
+
+/**
+ *  Given an endpoint,
+ *  When replacing its receive slots fails and then succeeds,
+ *  Then the failure keeps the old slots and the new slots receive and come back when released.
+ */
+static void test_ring_replace(CuTest* tc) {
+    mc_endpt_udp_t alice;
+    mc_endpt_udp_t bob;
+    mc_message_t* bmsg;
+    uint32_t nslots;
+    uint32_t slotsize;
+    int kept;
+    int replaced;
+    int received;
+    int released;
+
+    mc_endpt_udp_init(&alice, 512, 512, "127.0.0.1", 5678);
+    mc_endpt_udp_init(&bob, 512, 512, "127.0.0.1", 5679);
+    nslots = bob.ring.nslots;
+    slotsize = bob.ring.slotsize;
+
+    kept = !mc_endpt_udp_set_recv_slots(&bob, 0, 0) && bob.ring.nslots == nslots && bob.ring.slotsize == slotsize;
+    replaced = mc_endpt_udp_set_recv_slots(&bob, 64, 0) && bob.ring.nslots == 64 && bob.ring.slotsize == slotsize;
+
+    mc_endpt_udp_post(&alice, 0, 0, "coap://127.0.0.1:5679/ring", 0,
+                      mc_buffer_init(mc_buffer_alloc(), 4, (uint8_t*)ms_copy_str("ring")));
+    bmsg = mc_endpt_udp_recv(&bob);
+    received = bmsg != 0 && bmsg->payload != 0 && bmsg->payload->nbytes == 4 && bob.ring.nfree == 63;
+    mc_message_free(bmsg);
+    released = bob.ring.nfree == 64;
+
+    mc_endpt_udp_deinit(&alice);
+    mc_endpt_udp_deinit(&bob);
+
+    CuAssert(tc, "failure keeps the slots", kept);
+    CuAssert(tc, "replaced", replaced);
+    CuAssert(tc, "received in a new slot", received);
+    CuAssert(tc, "released to the new ring", released);
+}
+
+CuSuite* mc_recv_ring_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_ring_slots);
+    SUITE_ADD_TEST(suite, test_ring_huge);
+    SUITE_ADD_TEST(suite, test_ring_recv);
+    SUITE_ADD_TEST(suite, test_ring_replace);
+
+    return suite;
+}
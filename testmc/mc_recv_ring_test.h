@@ -0,0 +1,8 @@
+#ifndef MC_RECV_RING_TEST_H
+#define MC_RECV_RING_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_recv_ring_suite();
+
+#endif
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcoap/mc_request_table.h"
+#include "testmc/mc_request_table_test.h"
+
+#include "cutest/CuTest.h"
+
+/* A token view of the bytes of a number. */
+static mc_buffer_t* mk_token(mc_buffer_t* token, uint32_t* value) {
+    return mc_buffer_init(token, sizeof(uint32_t), (uint8_t*)value);
+}
+
+/**
+ *  Given a request table,
+ *  When we add requests,
+ *  Then they are found by (peer, token) only, and removed ones are not found.
+ */
+static void test_request_table_find(CuTest* tc) {
+    mc_request_table_t table;
+    mc_buffer_t token;
+    mc_buffer_t empty;
+    mc_request_t* request;
+    uint32_t value = 7;
+
+    mc_request_table_init(&table, 4);
+    mk_token(&token, &value);
+    mc_buffer_init(&empty, 0, 0);
+
+    request = mc_request_table_add(&table, 1, &token, 100, 10.0);
+    CuAssert(tc, "added", request != 0 && request->msgid == 100);
+    CuAssert(tc, "empty token added", mc_request_table_add(&table, 1, &empty, 101, 10.0) != 0);
+    CuAssert(tc, "duplicate rejected", mc_request_table_add(&table, 1, &token, 102, 10.0) == 0);
+
+    CuAssert(tc, "found", mc_request_table_find(&table, 1, &token) == request);
+    CuAssert(tc, "other peer misses", mc_request_table_find(&table, 2, &token) == 0);
+    CuAssert(tc, "empty token found", mc_request_table_find(&table, 1, &empty)->msgid == 101);
+
+    mc_request_table_remove(&table, request);
+    CuAssert(tc, "removed", mc_request_table_find(&table, 1, &token) == 0);
+    CuAssert(tc, "one left", table.count == 1);
+
+    mc_request_table_deinit(&table);
+}
+
+/**
+ *  Given a small request table,
+ *  When we add more requests than its capacity,
+ *  Then it grows and every request is still found.
+ */
+static void test_request_table_grow(CuTest* tc) {
+    mc_request_table_t table;
+    mc_buffer_t token;
+    uint32_t value;
+    int found = 1;
+
+    mc_request_table_init(&table, 2);
+    for (value = 0; value < 1000; value++) {
+        mc_request_table_add(&table, value % 7, mk_token(&token, &value), (uint16_t)value, (double)value);
+    }
+    for (value = 0; value < 1000; value++) {
+        mc_request_t* request = mc_request_table_find(&table, value % 7, mk_token(&token, &value));
+        found = found && request != 0 && request->msgid == value;
+    }
+
+    CuAssert(tc, "all found", found);
+    CuAssert(tc, "count", table.count == 1000);
+    CuAssert(tc, "grew", table.capacity >= 1000);
+
+    mc_request_table_deinit(&table);
+}
+
+/**
+ *  Given requests with different deadlines,
+ *  When we drain the expired ones,
+ *  Then they come out in deadline order, and moving a deadline reorders them.
+ */
+static void test_request_table_expired(CuTest* tc) {
+    mc_request_table_t table;
+    mc_buffer_t token;
+    mc_request_t* request;
+    uint32_t values[5] = { 0, 1, 2, 3, 4 };
+    double deadlines[5] = { 5.0, 1.0, 4.0, 2.0, 3.0 };
+    uint16_t order[5];
+    int iorder = 0;
+    int ivalue;
+
+    mc_request_table_init(&table, 2);
+    for (ivalue = 0; ivalue < 5; ivalue++) {
+        mc_request_table_add(&table, 1, mk_token(&token, &values[ivalue]), (uint16_t)ivalue, deadlines[ivalue]);
+    }
+
+    /* Push msgid 1 from first to last. */
+    mc_request_table_set_deadline(&table, mc_request_table_find(&table, 1, mk_token(&token, &values[1])), 6.0);
+
+    CuAssert(tc, "nothing expired yet", mc_request_table_expired(&table, 1.5) == 0);
+    while ((request = mc_request_table_expired(&table, 10.0)) != 0) {
+        order[iorder++] = request->msgid;
+        mc_request_table_remove(&table, request);
+    }
+
+    CuAssert(tc, "all expired", iorder == 5 && table.count == 0);
+    CuAssert(tc, "deadline order", order[0] == 3 && order[1] == 4 && order[2] == 2 && order[3] == 0 && order[4] == 1);
+
+    mc_request_table_deinit(&table);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_request_table_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_request_table_find);
+    SUITE_ADD_TEST(suite, test_request_table_grow);
+    SUITE_ADD_TEST(suite, test_request_table_expired);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MC_REQUEST_TABLE_TEST_H
+#define MC_REQUEST_TABLE_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_request_table_suite();
+
+#endif
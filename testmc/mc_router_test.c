@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_uri.h"
+#include "mcoap/mc_router.h"
+#include "testmc/mc_router_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_RESOURCES 50000
+#define BENCH_LOOKUPS   1000000
+
+static int handler_a(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg) {
+    return 1;
+}
+
+static int handler_b(mc_endpt_udp_t* const endpt, mc_message_t* const request, const mc_router_match_t* match, void* arg) {
+    return 2;
+}
+
+/* A request for the path of a coap URI. */
+static mc_message_t* mk_request(mc_message_t* msg, uint8_t method, char* uri) {
+    return mc_message_con_init(msg, method, 1, mc_buffer_init(mc_buffer_alloc(), 0, 0), mc_uri_to_options(mc_options_list_alloc(), 0, uri), 0);
+}
+
+/* Match a request for uri, returning the match result. */
+static uint8_t route(mc_router_t* router, uint8_t method, char* uri, mc_router_handler_fn_t* handler, void** arg, mc_router_match_t* match) {
+    mc_message_t msg;
+    uint8_t code;
+
+    *handler = 0;
+    code = mc_router_match(router, mk_request(&msg, method, uri), handler, arg, match);
+    mc_message_deinit(&msg);
+    return code;
+}
+
+/**
+ *  Given a router with literal resources,
+ *  When we match requests,
+ *  Then each path finds its own handler and argument, and other paths and methods are rejected.
+ */
+static void test_router_literal(CuTest* tc) {
+    mc_router_t router;
+    mc_router_handler_fn_t handler;
+    mc_router_match_t match;
+    void* arg;
+    int a = 1;
+    int b = 2;
+
+    mc_router_init(&router);
+    CuAssert(tc, "added", mc_router_add(&router, MC_GET, "/sensors/temp", handler_a, &a));
+    CuAssert(tc, "shared prefix added", mc_router_add(&router, MC_GET, "/sensors/tempmax", handler_b, &b));
+    CuAssert(tc, "other method added", mc_router_add(&router, MC_PUT, "/sensors/temp", handler_b, &b));
+    CuAssert(tc, "root added", mc_router_add(&router, MC_GET, "/", handler_b, 0));
+    CuAssert(tc, "duplicate rejected", !mc_router_add(&router, MC_GET, "/sensors/temp", handler_b, 0));
+    CuAssert(tc, "bad method rejected", !mc_router_add(&router, MC_CONTENT, "/x", handler_b, 0));
+    CuAssert(tc, "three resources", router.nresources == 3);
+
+    CuAssert(tc, "get found", route(&router, MC_GET, "coap://127.0.0.1/sensors/temp", &handler, &arg, &match) == 0);
+    CuAssert(tc, "get handler", handler == handler_a && arg == &a && match.nwildcards == 0);
+    CuAssert(tc, "put found", route(&router, MC_PUT, "coap://127.0.0.1/sensors/temp", &handler, &arg, &match) == 0);
+    CuAssert(tc, "put handler", handler == handler_b && arg == &b);
+    CuAssert(tc, "longer found", route(&router, MC_GET, "coap://127.0.0.1/sensors/tempmax", &handler, &arg, &match) == 0);
+    CuAssert(tc, "longer handler", handler == handler_b);
+    CuAssert(tc, "root found", route(&router, MC_GET, "coap://127.0.0.1", &handler, &arg, &match) == 0);
+
+    CuAssert(tc, "prefix not found", route(&router, MC_GET, "coap://127.0.0.1/sensors", &handler, &arg, &match) == MC_NOT_FOUND);
+    CuAssert(tc, "partial segment not found", route(&router, MC_GET, "coap://127.0.0.1/sensors/tem", &handler, &arg, &match) == MC_NOT_FOUND);
+    CuAssert(tc, "unknown not found", route(&router, MC_GET, "coap://127.0.0.1/actuators", &handler, &arg, &match) == MC_NOT_FOUND);
+    CuAssert(tc, "delete not allowed", route(&router, MC_DELETE, "coap://127.0.0.1/sensors/temp", &handler, &arg, &match) == MC_METHOD_NOT_ALLOWED);
+
+    mc_router_deinit(&router);
+}
+
+/**
+ *  Given a router with wildcard and percent encoded templates,
+ *  When we match requests,
+ *  Then wildcard segments are captured and a literal segment wins over a wildcard at the same position.
+ */
+static void test_router_wildcard(CuTest* tc) {
+    mc_router_t router;
+    mc_message_t msg;
+    mc_router_handler_fn_t handler;
+    mc_router_match_t match;
+    void* arg;
+
+    mc_router_init(&router);
+    CuAssert(tc, "wildcard added", mc_router_add(&router, MC_GET, "/devices/*/temp", handler_a, 0));
+    CuAssert(tc, "literal added", mc_router_add(&router, MC_GET, "/devices/hub/temp", handler_b, 0));
+    CuAssert(tc, "two wildcards added", mc_router_add(&router, MC_GET, "/devices/*/log/*", handler_a, 0));
+    CuAssert(tc, "encoded added", mc_router_add(&router, MC_GET, "/a%20b", handler_b, 0));
+
+    /* The captures point into the request's options, so keep it until they are checked. */
+    mk_request(&msg, MC_GET, "coap://127.0.0.1/devices/dev42/temp");
+    CuAssert(tc, "wildcard found", mc_router_match(&router, &msg, &handler, &arg, &match) == 0);
+    CuAssert(tc, "wildcard handler", handler == handler_a && match.nwildcards == 1);
+    CuAssert(tc, "captured", match.wildcards[0]->nbytes == 5 && memcmp(match.wildcards[0]->bytes, "dev42", 5) == 0);
+    mc_message_deinit(&msg);
+
+    CuAssert(tc, "literal found", route(&router, MC_GET, "coap://127.0.0.1/devices/hub/temp", &handler, &arg, &match) == 0);
+    CuAssert(tc, "literal wins", handler == handler_b && match.nwildcards == 0);
+
+    CuAssert(tc, "two wildcards found", route(&router, MC_GET, "coap://127.0.0.1/devices/dev1/log/today", &handler, &arg, &match) == 0);
+    CuAssert(tc, "both captured", handler == handler_a && match.nwildcards == 2);
+    CuAssert(tc, "wildcard behind literal found", route(&router, MC_GET, "coap://127.0.0.1/devices/hub/log/today", &handler, &arg, &match) == 0);
+    CuAssert(tc, "hub captured", handler == handler_a && match.nwildcards == 2);
+
+    CuAssert(tc, "decoded found", route(&router, MC_GET, "coap://127.0.0.1/a%20b", &handler, &arg, &match) == 0);
+    CuAssert(tc, "wildcard is one segment", route(&router, MC_GET, "coap://127.0.0.1/devices/a/b/temp", &handler, &arg, &match) == MC_NOT_FOUND);
+    CuAssert(tc, "wildcard needs a segment", route(&router, MC_GET, "coap://127.0.0.1/devices", &handler, &arg, &match) == MC_NOT_FOUND);
+
+    mc_router_deinit(&router);
+}
+
+/**
+ *  Benchmark matching with 50k registered device resources.
+ */
+static void bench_router(CuTest* tc) {
+    mc_router_t router;
+    mc_router_handler_fn_t handler;
+    mc_router_match_t match;
+    mc_message_t msgs[16];
+    char path[64];
+    void* arg;
+    uint32_t iresource;
+    uint32_t ilookup;
+    uint32_t misses = 0;
+    double start;
+    double add_ns;
+    double match_ns;
+
+    mc_router_init(&router);
+    start = mn_gettime();
+    for (iresource = 0; iresource < BENCH_RESOURCES; iresource++) {
+        sprintf(path, "/site/%u/devices/%u/temp", iresource % 100, iresource);
+        mc_router_add(&router, MC_GET, path, handler_a, 0);
+    }
+    add_ns = (mn_gettime() - start) * 1.0e9 / BENCH_RESOURCES;
+    mc_router_add(&router, MC_GET, "/gateway/*/status", handler_b, 0);
+
+    for (iresource = 0; iresource < 16; iresource++) {
+        uint32_t id = iresource * (BENCH_RESOURCES / 16);
+        sprintf(path, "coap://127.0.0.1/site/%u/devices/%u/temp", id % 100, id);
+        mk_request(&msgs[iresource], MC_GET, path);
+    }
+
+    start = mn_gettime();
+    for (ilookup = 0; ilookup < BENCH_LOOKUPS; ilookup++) {
+        misses += mc_router_match(&router, &msgs[ilookup % 16], &handler, &arg, &match) != 0;
+    }
+    match_ns = (mn_gettime() - start) * 1.0e9 / BENCH_LOOKUPS;
+
+    printf("router: add %.1f ns, match %.1f ns, %u resources\n", add_ns, match_ns, router.nresources);
+    CuAssert(tc, "all matched", misses == 0);
+    CuAssert(tc, "wildcard matched", route(&router, MC_GET, "coap://127.0.0.1/gateway/7/status", &handler, &arg, &match) == 0 && handler == handler_b);
+
+    for (iresource = 0; iresource < 16; iresource++) mc_message_deinit(&msgs[iresource]);
+    mc_router_deinit(&router);
+}
+
+/**
+ *  Given a wildcard template and a literal sibling that shares a prefix with the request,
+ *  When the literal path leads to no resource, or to one without the request's method,
+ *  Then matching backtracks to the wildcard, and only reports 4.05 when no template has the method.
+ */
+static void test_router_backtrack(CuTest* tc) {
+    mc_router_t router;
+    mc_message_t msg;
+    mc_router_handler_fn_t handler;
+    mc_router_match_t match;
+    void* arg;
+
+    mc_router_init(&router);
+    CuAssert(tc, "wildcard added", mc_router_add(&router, MC_GET, "/devices/*/temp", handler_a, 0));
+    CuAssert(tc, "wildcard put added", mc_router_add(&router, MC_PUT, "/devices/*/config", handler_a, 0));
+    CuAssert(tc, "literal added", mc_router_add(&router, MC_GET, "/devices/hub/config", handler_b, 0));
+    CuAssert(tc, "nested added", mc_router_add(&router, MC_GET, "/devices/hub/*/name", handler_b, 0));
+
+    mk_request(&msg, MC_GET, "coap://127.0.0.1/devices/hub/temp");
+    CuAssert(tc, "wildcard found", mc_router_match(&router, &msg, &handler, &arg, &match) == 0);
+    CuAssert(tc, "wildcard handler", handler == handler_a && match.nwildcards == 1);
+    CuAssert(tc, "hub captured", match.wildcards[0]->nbytes == 3 && memcmp(match.wildcards[0]->bytes, "hub", 3) == 0);
+    mc_message_deinit(&msg);
+
+    CuAssert(tc, "literal found", route(&router, MC_GET, "coap://127.0.0.1/devices/hub/config", &handler, &arg, &match) == 0);
+    CuAssert(tc, "literal wins", handler == handler_b && match.nwildcards == 0);
+    CuAssert(tc, "put falls back", route(&router, MC_PUT, "coap://127.0.0.1/devices/hub/config", &handler, &arg, &match) == 0);
+    CuAssert(tc, "put handler", handler == handler_a && match.nwildcards == 1);
+    CuAssert(tc, "delete not allowed", route(&router, MC_DELETE, "coap://127.0.0.1/devices/hub/config", &handler, &arg, &match) == MC_METHOD_NOT_ALLOWED);
+
+    CuAssert(tc, "deeper wildcard found", route(&router, MC_GET, "coap://127.0.0.1/devices/hub/x/name", &handler, &arg, &match) == 0);
+    CuAssert(tc, "deeper handler", handler == handler_b && match.nwildcards == 1);
+    CuAssert(tc, "no match", route(&router, MC_GET, "coap://127.0.0.1/devices/hub/x/temp", &handler, &arg, &match) == MC_NOT_FOUND);
+
+    mc_router_deinit(&router);
+}
+
+CuSuite* mc_router_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_router_literal);
+    SUITE_ADD_TEST(suite, test_router_wildcard);
+    SUITE_ADD_TEST(suite, test_router_backtrack);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_router_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_router);
+
+    return suite;
+}
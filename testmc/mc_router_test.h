@@ -0,0 +1,9 @@
+#ifndef MC_ROUTER_TEST_H
+#define MC_ROUTER_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_router_suite();
+CuSuite* mc_router_bench_suite();
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_thread.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_shared_buffer.h"
+#include "testmc/mc_shared_buffer_test.h"
+
+#include "cutest/CuTest.h"
+
+#define NTHREADS 4
+#define THREAD_ROUNDS 100000
+
+/**
+ *  Given a payload shared by three messages,
+ *  When we serialize each message and deinitialize them,
+ *  Then each carries the same bytes without a copy, and only our reference is left.
+ */
+static void test_shared_payload(CuTest* tc) {
+    const char* text = "22.5 C";
+    mc_shared_buffer_t* shared = mc_shared_buffer_create((uint32_t)strlen(text), (const uint8_t*)text);
+    mc_message_t msgs[3];
+    uint8_t bytes[64];
+    mc_buffer_t buffer;
+    uint32_t imsg;
+
+    CuAssert(tc, "created", shared != 0 && shared->refs == 1);
+    CuAssert(tc, "copied", shared->view.nbytes == strlen(text) && memcmp(shared->view.bytes, text, strlen(text)) == 0);
+
+    for (imsg = 0; imsg < 3; imsg++) {
+        uint32_t nbytes;
+
+        mc_message_non_init(&msgs[imsg], MC_CONTENT, (uint16_t)imsg, mc_buffer_init(mc_buffer_alloc(), 0, 0), 0,
+                            mc_buffer_init(mc_buffer_alloc(), 0, 0));
+        mc_message_share_payload(&msgs[imsg], shared);
+        CuAssert(tc, "not copied", msgs[imsg].payload->bytes == shared->view.bytes);
+
+        nbytes = mc_message_to_buffer(&msgs[imsg], mc_buffer_init(&buffer, sizeof(bytes), bytes));
+        CuAssert(tc, "serialized payload", nbytes == 4 + 1 + strlen(text) && memcmp(&bytes[5], text, strlen(text)) == 0);
+    }
+    CuAssert(tc, "one reference each", shared->refs == 4);
+
+    for (imsg = 0; imsg < 3; imsg++) mc_message_deinit(&msgs[imsg]);
+    CuAssert(tc, "released", shared->refs == 1);
+    mc_shared_buffer_release(shared);
+    mc_shared_buffer_release(0);
+}
+
+static void retain_release(void* arg) {
+    mc_shared_buffer_t* shared = (mc_shared_buffer_t*)arg;
+    int round;
+
+    for (round = 0; round < THREAD_ROUNDS; round++) {
+        mc_shared_buffer_release(mc_shared_buffer_retain(shared));
+    }
+}
+
+/**
+ *  Given a shared buffer,
+ *  When several threads retain and release it at once,
+ *  Then no update is lost.
+ */
+static void test_shared_threads(CuTest* tc) {
+    mc_shared_buffer_t* shared = mc_shared_buffer_create(16, 0);
+    ms_thread_t* threads[NTHREADS];
+    int ithread;
+
+    CuAssert(tc, "zeroed", shared->view.bytes[0] == 0 && shared->view.bytes[15] == 0);
+    for (ithread = 0; ithread < NTHREADS; ithread++) {
+        threads[ithread] = ms_thread_init(ms_thread_alloc(), retain_release, mc_shared_buffer_retain(shared));
+    }
+    for (ithread = 0; ithread < NTHREADS; ithread++) {
+        ms_free(ms_thread_deinit(threads[ithread]));
+        mc_shared_buffer_release(shared);
+    }
+    CuAssert(tc, "balanced", shared->refs == 1);
+    mc_shared_buffer_release(shared);
+}
+
+CuSuite* mc_shared_buffer_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_shared_payload);
+    SUITE_ADD_TEST(suite, test_shared_threads);
+
+    return suite;
+}
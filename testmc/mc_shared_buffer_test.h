@@ -0,0 +1,8 @@
+#ifndef MC_SHARED_BUFFER_TEST_H
+#define MC_SHARED_BUFFER_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_shared_buffer_suite();
+
+#endif
@@ -7,10 +7,26 @@
 
 #include "testmc/mc_code_test.h"
 #include "testmc/mc_header_test.h"
+#include "testmc/mc_header_batch_test.h"
+#include "testmc/mc_option_test.h"
+#include "testmc/mc_option_scan_test.h"
 #include "testmc/mc_options_list_test.h"
+#include "testmc/mc_options_builder_test.h"
 #include "testmc/mc_message_test.h"
 #include "testmc/mc_uri_test.h"
+#include "testmc/mc_uri_cache_test.h"
+#include "testmc/mc_request_table_test.h"
+#include "testmc/mc_router_test.h"
+#include "testmc/mc_discovery_test.h"
+#include "testmc/mc_shared_buffer_test.h"
+#include "testmc/mc_buffer_queue_test.h"
+#include "testmc/mc_mem_resource_test.h"
+#include "testmc/mc_recv_ring_test.h"
+#include "testmc/mn_peer_table_test.h"
+#include "testmc/mn_resolver_test.h"
 #include "testmc/mc_endpt_udp_test.h"
+#include "testmc/mc_event_log_test.h"
+#include "testmc/mc_alloc_budget_test.h"
 
 #if defined(WIN32) && defined(_DEBUG)
 void dumpMemLeaks() {
@@ -32,7 +48,8 @@ static void add_tmp_suite(CuSuite* primary, CuSuite* secondary) {
     free(secondary);
 }
 
-void run_all_tests() {
+/** Run the unit tests, or with bench only the benchmarks, which print their timings. */
+void run_all_tests(int bench) {
     CuString *summary = CuStringNew();
     CuSuite* suite = CuSuiteNew();
 
@@ -41,12 +58,40 @@ void run_all_tests() {
 
     ms_log_debug("starting testing");
 
-    add_tmp_suite(suite, mc_code_suite());
-    add_tmp_suite(suite, mc_header_suite());
-    add_tmp_suite(suite, mc_options_list_suite());
-    add_tmp_suite(suite, mc_message_suite());
-    add_tmp_suite(suite, mc_uri_suite());
-    add_tmp_suite(suite, mc_endpt_udp_suite());
+    if (bench) {
+        add_tmp_suite(suite, mc_header_batch_bench_suite());
+        add_tmp_suite(suite, mc_option_scan_bench_suite());
+        add_tmp_suite(suite, mc_uri_cache_bench_suite());
+        add_tmp_suite(suite, mn_peer_table_bench_suite());
+        add_tmp_suite(suite, mc_router_bench_suite());
+        add_tmp_suite(suite, mc_uri_bench_suite());
+        add_tmp_suite(suite, mc_buffer_queue_bench_suite());
+        add_tmp_suite(suite, mc_event_log_bench_suite());
+    }
+    else {
+        add_tmp_suite(suite, mc_code_suite());
+        add_tmp_suite(suite, mc_header_suite());
+        add_tmp_suite(suite, mc_header_batch_suite());
+        add_tmp_suite(suite, mc_option_suite());
+        add_tmp_suite(suite, mc_option_scan_suite());
+        add_tmp_suite(suite, mc_options_list_suite());
+        add_tmp_suite(suite, mc_options_builder_suite());
+        add_tmp_suite(suite, mc_message_suite());
+        add_tmp_suite(suite, mc_uri_suite());
+        add_tmp_suite(suite, mc_uri_cache_suite());
+        add_tmp_suite(suite, mc_request_table_suite());
+        add_tmp_suite(suite, mc_router_suite());
+        add_tmp_suite(suite, mc_discovery_suite());
+        add_tmp_suite(suite, mc_shared_buffer_suite());
+        add_tmp_suite(suite, mc_buffer_queue_suite());
+        add_tmp_suite(suite, mc_mem_resource_suite());
+        add_tmp_suite(suite, mc_recv_ring_suite());
+        add_tmp_suite(suite, mn_resolver_suite());
+        add_tmp_suite(suite, mn_peer_table_suite());
+        add_tmp_suite(suite, mc_endpt_udp_suite());
+        add_tmp_suite(suite, mc_event_log_suite());
+        add_tmp_suite(suite, mc_alloc_budget_suite());
+    }
 
     CuSuiteRun(suite);
     
@@ -59,9 +104,18 @@ void run_all_tests() {
 }
 
 int main(int argc, char** argv) {
-    run_all_tests();
+    int bench = 0;
+    int leaks = 0;
+    int iarg;
+
+    for (iarg = 1; iarg < argc; iarg++) {
+        if (strcmp("-bench", argv[iarg]) == 0) bench = 1;
+        if (strcmp("-leaks", argv[iarg]) == 0) leaks = 1;
+    }
+
+    run_all_tests(bench);
 
-    if (argc > 1 && strcmp("-leaks", argv[1]) == 0) {
+    if (leaks) {
         dumpMemLeaks();
     }
 
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "mnet/mn_timeout.h"
+#include "mcoap/mc_code.h"
+#include "mcoap/mc_message.h"
+#include "mcoap/mc_uri.h"
+#include "mcoap/mc_uri_cache.h"
+#include "testmc/mc_uri_cache_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_ROUNDS 100000
+
+/**
+ *  Given a cache with two entries,
+ *  When we look up three URIs and then the first again,
+ *  Then the repeated lookup of a recent URI hits and the least recently used one was evicted.
+ */
+static void test_uri_cache_lru(CuTest* tc) {
+    mc_uri_cache_t cache;
+    const mc_uri_cache_entry_t* entry;
+
+    mc_uri_cache_init(&cache, 2);
+
+    entry = mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/a");
+    CuAssert(tc, "a is converted", entry != 0 && entry->resolved);
+    mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/b");
+    mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/a");
+    CuAssert(tc, "a hits", cache.hits == 1 && cache.misses == 2);
+
+    /* c evicts b, the least recently used. */
+    mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/c");
+    mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/a");
+    CuAssert(tc, "a still hits", cache.hits == 2);
+    mc_uri_cache_get(&cache, 0, "coap://127.0.0.1/b");
+    CuAssert(tc, "b was evicted", cache.misses == 4);
+
+    CuAssert(tc, "bad uri is not cached", mc_uri_cache_get(&cache, 0, "http://127.0.0.1/a") == 0);
+
+    mc_uri_cache_deinit(&cache);
+}
+
+/**
+ *  Given a cached URI and extra options that sort after the URI options,
+ *  When we serialize a request with the cached encoded options,
+ *  Then the bytes are the same as serializing the merged option list.
+ */
+static void test_uri_cache_encoded(CuTest* tc) {
+    char* uri = "coap://127.0.0.1:1000/path/to?q";
+    mc_uri_cache_t cache;
+    sockaddr_t dest;
+    const mc_uri_cache_entry_t* entry;
+    mc_message_t msg;
+    mc_buffer_t expected;
+    mc_buffer_t actual;
+    mc_options_list_t* list;
+    mc_options_list_t* path;
+    mc_options_list_t* accept;
+    uint32_t nexpected;
+    uint32_t nactual;
+
+    mc_uri_cache_init(&cache, 4);
+    mc_uri_to_address(&dest, "coap://127.0.0.1:2000");
+    entry = mc_uri_cache_get(&cache, &dest, uri);
+    CuAssert(tc, "uri is converted", entry != 0);
+    CuAssert(tc, "last option is the query", entry->lastnum == OPTION_URI_QUERY);
+
+    /* Reference: the full options list plus an Accept option. */
+    path = mc_uri_to_options(mc_options_list_alloc(), &dest, uri);
+    accept = mc_options_list_vinit(mc_options_list_alloc(), 1, mc_option_init_uint32(mc_option_alloc(), OPTION_ACCEPT, CONTENT_JSON));
+    list = mc_options_list_merge(path, accept);
+    ms_free(mc_options_list_deinit(path));
+    ms_free(mc_options_list_deinit(accept));
+    mc_message_con_init(&msg, MC_GET, 1, mc_buffer_init(mc_buffer_alloc(), 1, ms_copy_uint8(1, (const uint8_t*)"t")), list, 0);
+    mc_buffer_init(&expected, 128, ms_calloc(128, uint8_t));
+    nexpected = mc_message_to_buffer(&msg, &expected);
+    mc_message_deinit(&msg);
+
+    list = mc_options_list_vinit(mc_options_list_alloc(), 1, mc_option_init_uint32(mc_option_alloc(), OPTION_ACCEPT, CONTENT_JSON));
+    mc_message_con_init(&msg, MC_GET, 1, mc_buffer_init(mc_buffer_alloc(), 1, ms_copy_uint8(1, (const uint8_t*)"t")), list, 0);
+    mc_buffer_init(&actual, 128, ms_calloc(128, uint8_t));
+    nactual = mc_message_to_buffer_encoded(&msg, &entry->options, entry->lastnum, &actual);
+
+    CuAssert(tc, "same size", nexpected > 0 && nexpected == nactual);
+    CuAssert(tc, "same bytes", memcmp(expected.bytes, actual.bytes, nactual) == 0);
+
+    mc_message_deinit(&msg);
+    mc_buffer_deinit(&expected);
+    mc_buffer_deinit(&actual);
+    mc_uri_cache_deinit(&cache);
+}
+
+/**
+ *  Benchmark serializing a request from the cache against converting and encoding the URI each time.
+ */
+static void bench_uri_cache(CuTest* tc) {
+    char* uri = "coap://127.0.0.1:5683/sensors/temp/room1?units=c";
+    mc_uri_cache_t cache;
+    mc_buffer_t buffer;
+    mc_message_t msg;
+    uint32_t round;
+    uint32_t total = 0;
+    double start;
+    double cached_ns;
+    double uncached_ns;
+
+    mc_uri_cache_init(&cache, MC_URI_CACHE_SIZE);
+    mc_buffer_init(&buffer, 256, ms_calloc(256, uint8_t));
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        const mc_uri_cache_entry_t* entry = mc_uri_cache_get(&cache, 0, uri);
+        mc_message_con_init(&msg, MC_GET, 1, mc_buffer_init(mc_buffer_alloc(), 0, 0), 0, 0);
+        total += mc_message_to_buffer_encoded(&msg, &entry->options, entry->lastnum, &buffer);
+        mc_message_deinit(&msg);
+    }
+    cached_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+    start = mn_gettime();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        sockaddr_t addr;
+        mc_uri_to_address(&addr, uri);
+        mc_message_con_init(&msg, MC_GET, 1, mc_buffer_init(mc_buffer_alloc(), 0, 0),
+                            mc_uri_to_options(mc_options_list_alloc(), &addr, uri), 0);
+        total -= mc_message_to_buffer(&msg, &buffer);
+        mc_message_deinit(&msg);
+    }
+    uncached_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+    printf("request options: cached %.1f ns, uncached %.1f ns\n", cached_ns, uncached_ns);
+    CuAssert(tc, "same sizes", total == 0);
+
+    mc_buffer_deinit(&buffer);
+    mc_uri_cache_deinit(&cache);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mc_uri_cache_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_uri_cache_lru);
+    SUITE_ADD_TEST(suite, test_uri_cache_encoded);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_uri_cache_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_uri_cache);
+
+    return suite;
+}
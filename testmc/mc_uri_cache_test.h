@@ -0,0 +1,9 @@
+#ifndef MC_URI_CACHE_TEST_H
+#define MC_URI_CACHE_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mc_uri_cache_suite();
+CuSuite* mc_uri_cache_bench_suite();
+
+#endif
@@ -2,6 +2,8 @@
 #include "mcoap/mc_option.h"
 #include "mcoap/mc_uri.h"
 #include "msys/ms_memory.h"
+#include "mnet/mn_timeout.h"
+#include <stdio.h>
 #include <string.h>
 
 #include "testmc/mc_uri_test.h"
@@ -185,6 +187,193 @@ static void test_address_with_path_and_query(CuTest* tc) {
 	ms_free(mc_options_list_deinit(options));
 }
 
+/**
+ *  Given a URI with percent-encoded path and query characters
+ *  when we create an option list
+ *  then the option values are decoded.
+ */
+static void test_address_percent_decoding(CuTest* tc) {
+
+	mc_options_list_t* options = mc_uri_to_options(mc_options_list_alloc(), 0, "coap://127.0.0.1/a%2Fb/%7euser?x%3D1");
+
+	mc_option_t* ropt = mc_options_list_get(options, OPTION_URI_PATH);
+	mc_option_t* qopt = mc_options_list_get(options, OPTION_URI_QUERY);
+
+	CuAssert(tc, "is parseable", options != 0);
+	CuAssert(tc, "2 paths", mc_options_list_count(options, OPTION_URI_PATH) == 2);
+	CuAssert(tc, "path1 is a/b", ropt->value.nbytes == 3 && strncmp("a/b", (char*)ropt->value.bytes, 3) == 0);
+	ropt++;
+	CuAssert(tc, "path2 is ~user", ropt->value.nbytes == 5 && strncmp("~user", (char*)ropt->value.bytes, 5) == 0);
+	CuAssert(tc, "query is x=1", qopt->value.nbytes == 3 && strncmp("x=1", (char*)qopt->value.bytes, 3) == 0);
+
+	ms_free(mc_options_list_deinit(options));
+
+	options = mc_uri_to_options(mc_options_list_alloc(), 0, "coap://127.0.0.1/a%2");
+	CuAssert(tc, "truncated escape is not parseable", options == 0);
+}
+
+/**
+ *  Given URIs with a fragment, a bare / path, and the coaps scheme
+ *  when we parse them
+ *  then the fragment is rejected, / has no path segments and coaps uses port 5684.
+ */
+static void test_uri_parse(CuTest* tc) {
+	mc_uri_parts_t parts;
+	const char* uri = "coaps://[::1]/?a&b";
+
+	CuAssert(tc, "fragment is rejected", !mc_uri_parse(&parts, "coap://host/path#frag"));
+	CuAssert(tc, "bad port is rejected", !mc_uri_parse(&parts, "coap://host:12x/path"));
+
+	CuAssert(tc, "coaps is parseable", mc_uri_parse(&parts, uri));
+	CuAssert(tc, "secure", parts.secure && parts.portnum == MC_DEFAULT_SECURE_PORT);
+	CuAssert(tc, "ipv6 host", parts.ipv6 && parts.host.length == 3 && strncmp("::1", uri + parts.host.offset, 3) == 0);
+	CuAssert(tc, "no path segments", parts.npaths == 0);
+	CuAssert(tc, "2 query arguments", parts.nqueries == 2);
+}
+
+/**
+ *  Given every byte value at every offset of values up to 48 bytes long,
+ *  when we percent-encode and decode them with the vectorized and scalar functions,
+ *  then both agree and decoding the encoding gives back the value.
+ */
+static void test_percent_encode_decode(CuTest* tc) {
+	uint8_t value[48];
+	uint8_t decoded[3 * 48];
+	char encoded[3 * 48];
+	char scalar[3 * 48];
+	uint32_t length;
+	uint32_t offset;
+	uint32_t byte;
+	int same = 1;
+	int roundtrip = 1;
+
+	for (length = 1; length <= sizeof(value); length++) {
+		for (offset = 0; offset < length; offset++) {
+			for (byte = 0; byte < 256; byte++) {
+				uint32_t nchars;
+
+				memset(value, 'a' + length % 26, sizeof(value));
+				value[offset] = (uint8_t)byte;
+				nchars = mc_uri_percent_encode(encoded, value, length);
+				same &= nchars == mc_uri_percent_encode_scalar(scalar, value, length) && memcmp(encoded, scalar, nchars) == 0;
+				roundtrip &= mc_uri_percent_decode(decoded, encoded, nchars) == (int32_t)length && memcmp(decoded, value, length) == 0;
+				same &= mc_uri_percent_decode_scalar(decoded, encoded, nchars) == (int32_t)length;
+			}
+		}
+	}
+	CuAssert(tc, "vectorized matches scalar", same);
+	CuAssert(tc, "decode inverts encode", roundtrip);
+
+	CuAssert(tc, "reserved encoded", mc_uri_percent_encode(encoded, (uint8_t*)"a/b?c&d e", 9) == 17
+	         && memcmp(encoded, "a%2Fb%3Fc%26d%20e", 17) == 0);
+	CuAssert(tc, "sub-delims plain", mc_uri_percent_encode(encoded, (uint8_t*)"k=v;x:@", 7) == 7);
+	CuAssert(tc, "escape split at the chunk end", mc_uri_percent_decode(decoded, "0123456789abcde%4", 17) == -1);
+	CuAssert(tc, "bad hex after a chunk", mc_uri_percent_decode(decoded, "0123456789abcdef%zz", 19) == -1);
+	CuAssert(tc, "escape across a chunk", mc_uri_percent_decode(decoded, "0123456789abcde%41", 18) == 16 && decoded[15] == 'A');
+}
+
+/**
+ *  Given options decoded from a URI with escapes
+ *  when we format the path
+ *  then the path and query are re-encoded.
+ */
+static void test_format_path(CuTest* tc) {
+	mc_options_list_t* options = mc_uri_to_options(mc_options_list_alloc(), 0, "coap://127.0.0.1/a%2Fb/room%20a?x%3D1&y=2");
+	char path[64];
+
+	CuAssert(tc, "formatted", mc_uri_format_path(path, sizeof(path), options) == 23);
+	CuAssert(tc, "encoded", strcmp(path, "/a%2Fb/room%20a?x=1&y=2") == 0);
+	CuAssert(tc, "too small", mc_uri_format_path(path, 10, options) == -1);
+	ms_free(mc_options_list_deinit(options));
+
+	CuAssert(tc, "root", mc_uri_format_path(path, sizeof(path), 0) == 1 && strcmp(path, "/") == 0);
+}
+
+#define CODEC_ROUNDS 200000
+
+/**
+ *  Benchmark the vectorized percent codec against the scalar loops on typical path segments.
+ */
+static void bench_percent(CuTest* tc) {
+	const char* segments[] = { "sensors", "temperature", "building-42", "room%20a", "0f9c3e2a-7d41-4b8e-9a1c-5e6d7f809a1b",
+	                           "firmware_v2.3.1-release-candidate%2Bbuild.20240611" };
+	const uint32_t nsegments = sizeof(segments) / sizeof(segments[0]);
+	uint8_t decoded[128];
+	char encoded[384];
+	uint32_t round;
+	uint32_t total = 0;
+	uint32_t nchars = 0;
+	double start;
+	double times[4];
+
+	for (round = 0; round < nsegments; round++) nchars += (uint32_t)strlen(segments[round]);
+
+	start = mn_gettime();
+	for (round = 0; round < CODEC_ROUNDS; round++) {
+		const char* segment = segments[round % nsegments];
+		total += mc_uri_percent_decode(decoded, segment, (uint32_t)strlen(segment));
+	}
+	times[0] = mn_gettime() - start;
+
+	start = mn_gettime();
+	for (round = 0; round < CODEC_ROUNDS; round++) {
+		const char* segment = segments[round % nsegments];
+		total -= mc_uri_percent_decode_scalar(decoded, segment, (uint32_t)strlen(segment));
+	}
+	times[1] = mn_gettime() - start;
+
+	start = mn_gettime();
+	for (round = 0; round < CODEC_ROUNDS; round++) {
+		const char* segment = segments[round % nsegments];
+		total += mc_uri_percent_encode(encoded, (const uint8_t*)segment, (uint32_t)strlen(segment));
+	}
+	times[2] = mn_gettime() - start;
+
+	start = mn_gettime();
+	for (round = 0; round < CODEC_ROUNDS; round++) {
+		const char* segment = segments[round % nsegments];
+		total -= mc_uri_percent_encode_scalar(encoded, (const uint8_t*)segment, (uint32_t)strlen(segment));
+	}
+	times[3] = mn_gettime() - start;
+
+	printf("percent codec (%u chars avg): decode %.1f ns, scalar %.1f ns, encode %.1f ns, scalar %.1f ns\n",
+	       nchars / nsegments, times[0] * 1.0e9 / CODEC_ROUNDS, times[1] * 1.0e9 / CODEC_ROUNDS,
+	       times[2] * 1.0e9 / CODEC_ROUNDS, times[3] * 1.0e9 / CODEC_ROUNDS);
+	CuAssert(tc, "same lengths", total == 0);
+}
+
+#define BENCH_ROUNDS 100000
+
+/**
+ *  Benchmark parsing a typical request URI, with and without building the options list.
+ */
+static void bench_uri(CuTest* tc) {
+	char* uri = "coap://127.0.0.1:5683/sensors/temp/room%20a?units=c&precision=2";
+	mc_uri_parts_t parts;
+	uint32_t round;
+	uint32_t total = 0;
+	double start;
+	double parse_ns;
+	double options_ns;
+
+	start = mn_gettime();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		total += mc_uri_parse(&parts, uri);
+	}
+	parse_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+	start = mn_gettime();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		mc_options_list_t* options = mc_uri_to_options(mc_options_list_alloc(), 0, uri);
+		total += options->noptions;
+		ms_free(mc_options_list_deinit(options));
+	}
+	options_ns = (mn_gettime() - start) * 1.0e9 / BENCH_ROUNDS;
+
+	printf("uri parse: %.1f ns, uri to options: %.1f ns\n", parse_ns, options_ns);
+	CuAssert(tc, "parsed", total == BENCH_ROUNDS * 8);
+}
+
 /* Run all of the tests in this test suite. */
 CuSuite* mc_uri_suite() {
     CuSuite* suite = CuSuiteNew();
@@ -197,7 +386,21 @@ CuSuite* mc_uri_suite() {
     SUITE_ADD_TEST(suite, test_address_with_invalid_scheme);
     SUITE_ADD_TEST(suite, test_address_with_path);
     SUITE_ADD_TEST(suite, test_address_with_path_and_query);
+    SUITE_ADD_TEST(suite, test_address_percent_decoding);
+    SUITE_ADD_TEST(suite, test_uri_parse);
+    SUITE_ADD_TEST(suite, test_percent_encode_decode);
+    SUITE_ADD_TEST(suite, test_format_path);
 
         
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mc_uri_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_uri);
+    SUITE_ADD_TEST(suite, bench_percent);
+
     return suite;
 }
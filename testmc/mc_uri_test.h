@@ -4,5 +4,6 @@
 #include "cutest/CuTest.h"
 
 CuSuite* mc_uri_suite();
+CuSuite* mc_uri_bench_suite();
 
 #endif
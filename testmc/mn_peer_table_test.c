@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mnet/mn_peer_table.h"
+#include "mnet/mn_sockaddr.h"
+#include "mnet/mn_timeout.h"
+#include "testmc/mn_peer_table_test.h"
+
+#include "cutest/CuTest.h"
+
+#define BENCH_PEERS  (1u << 20)
+
+/* An IPv4 address built from a number, so tests can make many distinct peers. */
+static sockaddr_t* mk_addr(sockaddr_t* addr, uint32_t n, unsigned short port) {
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)addr;
+
+    memset(addr, 0, sizeof(sockaddr_t));
+    inaddr->sin_family = AF_INET;
+    inaddr->sin_addr.s_addr = htonl(0x0a000000 | n);
+    inaddr->sin_port = htons(port);
+
+    return addr;
+}
+
+/**
+ *  Given a peer table,
+ *  When we intern addresses,
+ *  Then each distinct address gets the next dense id and repeats get the same id.
+ */
+static void test_peer_table_intern(CuTest* tc) {
+    mn_peer_table_t table;
+    sockaddr_t a;
+    sockaddr_t b;
+    sockaddr_t c;
+    sockaddr_t out;
+    mn_peer_id_t aid;
+    mn_peer_id_t bid;
+    mn_peer_id_t cid;
+
+    mn_peer_table_init(&table, 8);
+    mk_addr(&a, 1, 5683);
+    mk_addr(&b, 1, 5684);
+    mn_sockaddr_inet_init(&c, "::1", 5683);
+
+    aid = mn_peer_table_intern(&table, &a);
+    bid = mn_peer_table_intern(&table, &b);
+    cid = mn_peer_table_intern(&table, &c);
+
+    CuAssert(tc, "ids are valid", aid != MN_PEER_NONE && bid != MN_PEER_NONE && cid != MN_PEER_NONE);
+    CuAssert(tc, "ids are dense", MN_PEER_INDEX(aid) == 0 && MN_PEER_INDEX(bid) == 1 && MN_PEER_INDEX(cid) == 2);
+    CuAssert(tc, "repeat gets the same id", mn_peer_table_intern(&table, &a) == aid);
+    CuAssert(tc, "find does not add", mn_peer_table_find(&table, mk_addr(&out, 2, 5683)) == MN_PEER_NONE);
+    CuAssert(tc, "find returns the id", mn_peer_table_find(&table, &c) == cid);
+    CuAssert(tc, "three peers", table.count == 3);
+
+    CuAssert(tc, "IPv6 address round trips", mn_peer_table_address(&table, cid, &out) != 0 && mn_sockaddr_equal(&out, &c));
+    CuAssert(tc, "IPv4 address round trips", mn_peer_table_address(&table, bid, &out) != 0 && mn_sockaddr_equal(&out, &b));
+
+    mn_peer_table_deinit(&table);
+}
+
+/**
+ *  Given a link-local IPv6 address on two interfaces,
+ *  When we intern both,
+ *  Then they are two peers and each address comes back with its scope id and flow info.
+ */
+static void test_peer_table_scope(CuTest* tc) {
+    mn_peer_table_t table;
+    sockaddr_t a;
+    sockaddr_t b;
+    sockaddr_t out;
+    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&out;
+    mn_peer_id_t aid;
+    mn_peer_id_t bid;
+
+    mn_peer_table_init(&table, 8);
+    mn_sockaddr_inet_init(&a, "fe80::1", 5683);
+    mn_sockaddr_inet_init(&b, "fe80::1", 5683);
+    ((struct sockaddr_in6*)&a)->sin6_scope_id = 1;
+    ((struct sockaddr_in6*)&a)->sin6_flowinfo = htonl(0x12345);
+    ((struct sockaddr_in6*)&b)->sin6_scope_id = 2;
+
+    aid = mn_peer_table_intern(&table, &a);
+    bid = mn_peer_table_intern(&table, &b);
+    CuAssert(tc, "two peers", aid != MN_PEER_NONE && bid != MN_PEER_NONE && aid != bid);
+
+    CuAssert(tc, "first rebuilt", mn_peer_table_address(&table, aid, &out) != 0 && mn_sockaddr_equal(&out, &a));
+    CuAssert(tc, "first scope and flow", in6->sin6_scope_id == 1 && in6->sin6_flowinfo == htonl(0x12345));
+    CuAssert(tc, "second rebuilt", mn_peer_table_address(&table, bid, &out) != 0 && mn_sockaddr_equal(&out, &b));
+    CuAssert(tc, "second scope and flow", in6->sin6_scope_id == 2 && in6->sin6_flowinfo == 0);
+
+    mn_peer_table_deinit(&table);
+}
+
+/**
+ *  Given a full peer table,
+ *  When we intern a new address,
+ *  Then the least recently interned peer's slot is reused and its old id is no longer live.
+ */
+static void test_peer_table_evict(CuTest* tc) {
+    mn_peer_table_t table;
+    sockaddr_t a;
+    sockaddr_t b;
+    sockaddr_t c;
+    mn_peer_id_t aid;
+    mn_peer_id_t bid;
+    mn_peer_id_t cid;
+
+    mn_peer_table_init(&table, 2);
+    aid = mn_peer_table_intern(&table, mk_addr(&a, 1, 5683));
+    bid = mn_peer_table_intern(&table, mk_addr(&b, 2, 5683));
+
+    /* Touch a so b is the oldest. */
+    mn_peer_table_intern(&table, &a);
+    cid = mn_peer_table_intern(&table, mk_addr(&c, 3, 5683));
+
+    CuAssert(tc, "c reuses b's slot", MN_PEER_INDEX(cid) == MN_PEER_INDEX(bid));
+    CuAssert(tc, "generation changes", cid != bid);
+    CuAssert(tc, "b's id is stale", !mn_peer_table_is_live(&table, bid));
+    CuAssert(tc, "a is live", mn_peer_table_is_live(&table, aid));
+    CuAssert(tc, "b is gone", mn_peer_table_find(&table, &b) == MN_PEER_NONE);
+    CuAssert(tc, "one eviction", table.evictions == 1);
+    CuAssert(tc, "none is never live", !mn_peer_table_is_live(&table, MN_PEER_NONE));
+
+    mn_peer_table_deinit(&table);
+}
+
+/**
+ *  Given a peer table of two with a pinned peer,
+ *  When the other slot is reclaimed more times than the generation can count,
+ *  Then the pinned id stays live and resolves to its own address, and interning fails once both are pinned.
+ */
+static void test_peer_table_pin(CuTest* tc) {
+    mn_peer_table_t table;
+    sockaddr_t a;
+    sockaddr_t other;
+    sockaddr_t out;
+    mn_peer_id_t aid;
+    mn_peer_id_t lastid = MN_PEER_NONE;
+    uint32_t n;
+
+    mn_peer_table_init(&table, 2);
+    aid = mn_peer_table_intern(&table, mk_addr(&a, 1, 5683));
+    CuAssert(tc, "a is pinned", mn_peer_table_pin(&table, aid));
+
+    for (n = 2; n < 2 + 600; n++) lastid = mn_peer_table_intern(&table, mk_addr(&other, n, 5683));
+
+    CuAssert(tc, "other slot reclaimed 599 times", table.evictions == 599 && MN_PEER_INDEX(lastid) != MN_PEER_INDEX(aid));
+    CuAssert(tc, "a is live", mn_peer_table_is_live(&table, aid) && mn_peer_table_find(&table, &a) == aid);
+    CuAssert(tc, "a resolves to a", mn_peer_table_address(&table, aid, &out) != 0 && mn_sockaddr_equal(&out, &a));
+
+    CuAssert(tc, "last is pinned", mn_peer_table_pin(&table, lastid));
+    CuAssert(tc, "all pinned fails", mn_peer_table_intern(&table, mk_addr(&other, 1000, 5683)) == MN_PEER_NONE);
+
+    mn_peer_table_unpin(&table, aid);
+    CuAssert(tc, "unpinned a is reclaimed", MN_PEER_INDEX(mn_peer_table_intern(&table, &other)) == MN_PEER_INDEX(aid));
+    CuAssert(tc, "a is stale", !mn_peer_table_is_live(&table, aid));
+    CuAssert(tc, "last stays live", mn_peer_table_is_live(&table, lastid));
+
+    mn_peer_table_deinit(&table);
+}
+
+/**
+ *  Benchmark interning a million distinct peers, then looking them up again.
+ */
+static void bench_peer_table(CuTest* tc) {
+    mn_peer_table_t table;
+    sockaddr_t addr;
+    uint32_t ipeer;
+    uint32_t mismatches = 0;
+    double start;
+    double insert_ns;
+    double hit_ns;
+
+    mn_peer_table_init(&table, BENCH_PEERS);
+
+    start = mn_gettime();
+    for (ipeer = 0; ipeer < BENCH_PEERS; ipeer++) {
+        mn_peer_table_intern(&table, mk_addr(&addr, ipeer, 5683));
+    }
+    insert_ns = (mn_gettime() - start) * 1.0e9 / BENCH_PEERS;
+
+    start = mn_gettime();
+    for (ipeer = 0; ipeer < BENCH_PEERS; ipeer++) {
+        mismatches += MN_PEER_INDEX(mn_peer_table_intern(&table, mk_addr(&addr, ipeer, 5683))) != ipeer;
+    }
+    hit_ns = (mn_gettime() - start) * 1.0e9 / BENCH_PEERS;
+
+    printf("peer table: insert %.1f ns, hit %.1f ns, %u peers\n", insert_ns, hit_ns, table.count);
+    CuAssert(tc, "ids are stable", mismatches == 0);
+    CuAssert(tc, "no evictions", table.evictions == 0);
+
+    mn_peer_table_deinit(&table);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mn_peer_table_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_peer_table_intern);
+    SUITE_ADD_TEST(suite, test_peer_table_scope);
+    SUITE_ADD_TEST(suite, test_peer_table_evict);
+    SUITE_ADD_TEST(suite, test_peer_table_pin);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* mn_peer_table_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_peer_table);
+
+    return suite;
+}
@@ -0,0 +1,9 @@
+#ifndef MN_PEER_TABLE_TEST_H
+#define MN_PEER_TABLE_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mn_peer_table_suite();
+CuSuite* mn_peer_table_bench_suite();
+
+#endif
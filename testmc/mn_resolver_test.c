@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mnet/mn_resolver.h"
+#include "mnet/mn_sockaddr.h"
+#include "mnet/mn_timeout.h"
+#include "testmc/mn_resolver_test.h"
+
+#include "cutest/CuTest.h"
+
+/* Poll until the name resolves or fails. */
+static int wait_lookup(mn_resolver_t* resolver, const char* host, unsigned short port, int family, sockaddr_t* addr) {
+    double start = mn_gettime();
+    int err;
+
+    do {
+        err = mn_resolver_lookup(resolver, host, port, family, addr);
+    } while (err == MN_PENDING && mn_gettime() - start < 5.0);
+
+    return err;
+}
+
+/**
+ *  Given a resolver,
+ *  When we look up an IP literal and a host name,
+ *  Then the literal is done immediately, the name is pending and then cached.
+ */
+static void test_resolver_lookup(CuTest* tc) {
+    mn_resolver_t resolver;
+    sockaddr_t addr;
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)&addr;
+
+    mn_resolver_init(&resolver, 4, MN_RESOLVER_TTL);
+
+    CuAssert(tc, "literal is done", mn_resolver_lookup(&resolver, "127.0.0.1", 1000, AF_INET, &addr) == MN_DONE);
+    CuAssert(tc, "literal port", ntohs(inaddr->sin_port) == 1000);
+
+    CuAssert(tc, "name is pending", mn_resolver_lookup(&resolver, "localhost", 2000, AF_INET, &addr) == MN_PENDING);
+    CuAssert(tc, "name resolves", wait_lookup(&resolver, "localhost", 2000, AF_INET, &addr) == MN_DONE);
+    CuAssert(tc, "name is loopback", ntohl(inaddr->sin_addr.s_addr) >> 24 == 127);
+
+    /* Cached, with the port of this lookup. */
+    CuAssert(tc, "name is cached", mn_resolver_lookup(&resolver, "localhost", 3000, AF_INET, &addr) == MN_DONE);
+    CuAssert(tc, "cached port", ntohs(inaddr->sin_port) == 3000);
+
+    CuAssert(tc, "empty name fails", mn_resolver_lookup(&resolver, "", 1000, AF_INET, &addr) == MN_NOHOST);
+
+    mn_resolver_deinit(&resolver);
+}
+
+/**
+ *  Given a resolver with a zero ttl,
+ *  When we look up a name again after it was resolved,
+ *  Then the stale address is served while it is refreshed.
+ */
+static void test_resolver_refresh(CuTest* tc) {
+    mn_resolver_t resolver;
+    sockaddr_t addr;
+
+    mn_resolver_init(&resolver, 4, 0.0);
+
+    CuAssert(tc, "name resolves", wait_lookup(&resolver, "localhost", 2000, AF_INET, &addr) == MN_DONE);
+    CuAssert(tc, "expired name is served", mn_resolver_lookup(&resolver, "localhost", 2000, AF_INET, &addr) == MN_DONE);
+
+    mn_resolver_deinit(&resolver);
+}
+
+/* @return 1 if addr is an IPv6 loopback, ::1 or IPv4-mapped 127.x.x.x. */
+static int is_loopback6(const sockaddr_t* addr) {
+    static const uint8_t loopback[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    static const uint8_t mapped[13] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127 };
+    const uint8_t* bytes = (const uint8_t*)&((const struct sockaddr_in6*)addr)->sin6_addr;
+
+    if (addr->ss_family != AF_INET6) return 0;
+    return memcmp(bytes, loopback, sizeof(loopback)) == 0 || memcmp(bytes, mapped, sizeof(mapped)) == 0;
+}
+
+/**
+ *  Given a resolver,
+ *  When we look up names and literals for IPv6 and IPv4 sockets,
+ *  Then an IPv6 socket gets IPv6 or IPv4-mapped addresses and an IPv4 socket never gets IPv6.
+ */
+static void test_resolver_family(CuTest* tc) {
+    mn_resolver_t resolver;
+    sockaddr_t addr;
+    struct sockaddr_in6* in6addr = (struct sockaddr_in6*)&addr;
+
+    mn_resolver_init(&resolver, 4, MN_RESOLVER_TTL);
+
+    CuAssert(tc, "name resolves for IPv6", wait_lookup(&resolver, "localhost", 2000, AF_INET6, &addr) == MN_DONE);
+    CuAssert(tc, "name is an IPv6 loopback", is_loopback6(&addr) && ntohs(in6addr->sin6_port) == 2000);
+
+    CuAssert(tc, "IPv4 literal for IPv6", mn_resolver_lookup(&resolver, "127.0.0.1", 1000, AF_INET6, &addr) == MN_DONE);
+    CuAssert(tc, "literal is mapped", is_loopback6(&addr) && ntohs(in6addr->sin6_port) == 1000);
+    CuAssert(tc, "mapped back to IPv4", mn_sockaddr_to_family(&addr, AF_INET) && addr.ss_family == AF_INET
+                                        && ntohl(((struct sockaddr_in*)&addr)->sin_addr.s_addr) == 0x7f000001);
+
+    CuAssert(tc, "IPv6 literal for IPv4", mn_resolver_lookup(&resolver, "::1", 1000, AF_INET, &addr) == MN_NOHOST);
+    CuAssert(tc, "IPv6 literal for either", mn_resolver_lookup(&resolver, "::1", 1000, AF_UNSPEC, &addr) == MN_DONE);
+
+    mn_resolver_deinit(&resolver);
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* mn_resolver_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_resolver_lookup);
+    SUITE_ADD_TEST(suite, test_resolver_refresh);
+    SUITE_ADD_TEST(suite, test_resolver_family);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MN_RESOLVER_TEST_H
+#define MN_RESOLVER_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* mn_resolver_suite();
+
+#endif
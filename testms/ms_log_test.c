@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "msys/ms_log.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_thread.h"
+#include "testms/ms_log_test.h"
+
+#include "cutest/CuTest.h"
+
+#define THREADS         4
+#define THREAD_MESSAGES 500
+#define BENCH_MESSAGES  20000
+#define BENCH_DISABLED  10000000
+
+/* Counts of the kinds of lines written to a log file. */
+typedef struct {
+    uint32_t messages;
+    uint32_t dumps;
+    uint32_t drops;
+    uint32_t suppressed;
+    uint32_t longest;
+} lines_t;
+
+static lines_t* read_lines(FILE* file, lines_t* lines) {
+    char line[1024];
+
+    memset(lines, 0, sizeof(lines_t));
+    rewind(file);
+    while (fgets(line, sizeof(line), file)) {
+        uint32_t length = (uint32_t)strlen(line);
+
+        if (strncmp(line, "WARN@ms_log_test.c:", 19) == 0) lines->messages++;
+        if (strcmp(line, "0x61 0x62 0x63 \n") == 0) lines->dumps++;
+        if (strstr(line, "dropped")) lines->drops++;
+        if (strstr(line, "suppressed")) lines->suppressed++;
+        if (length > lines->longest) lines->longest = length;
+    }
+    return lines;
+}
+
+static void log_messages(void* arg) {
+    uint32_t imessage;
+
+    for (imessage = 0; imessage < THREAD_MESSAGES; imessage++) {
+        ms_log_warn("thread %d message %d", (int)(size_t)arg, imessage);
+    }
+}
+
+/**
+ *  Given the background writer is started,
+ *  When several threads log at once and bytes are dumped,
+ *  Then every message is either written or counted as dropped, and drops are reported.
+ */
+static void test_log_async(CuTest* tc) {
+    FILE* file = tmpfile();
+    ms_thread_t* threads[THREADS];
+    uint32_t dropped = ms_log_dropped();
+    uint32_t ithread;
+    lines_t lines;
+
+    ms_log_setfile(file);
+    CuAssert(tc, "started", ms_log_start());
+
+    for (ithread = 0; ithread < THREADS; ithread++) {
+        threads[ithread] = ms_thread_init(ms_thread_alloc(), log_messages, (void*)(size_t)ithread);
+    }
+    for (ithread = 0; ithread < THREADS; ithread++) ms_free(ms_thread_deinit(threads[ithread]));
+    ms_log_bytes(ms_warn, 3, (uint8_t*)"abc");
+
+    ms_log_flush();
+    ms_log_stop();
+    ms_log_setfile(stderr);
+
+    dropped = ms_log_dropped() - dropped;
+    read_lines(file, &lines);
+    fclose(file);
+
+    CuAssert(tc, "written or dropped", lines.messages + dropped == THREADS * THREAD_MESSAGES);
+    CuAssert(tc, "drops reported", dropped == 0 || lines.drops > 0);
+    CuAssert(tc, "dumped", lines.dumps == 1);
+}
+
+/**
+ *  Given the background writer is started,
+ *  When a message longer than a record is logged,
+ *  Then it is cut to the record's text.
+ */
+static void test_log_truncate(CuTest* tc) {
+    FILE* file = tmpfile();
+    char text[2 * MS_LOG_TEXT];
+    lines_t lines;
+
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = 0;
+
+    ms_log_setfile(file);
+    ms_log_start();
+    ms_log_warn("%s", text);
+    ms_log_stop();
+    ms_log_setfile(stderr);
+
+    read_lines(file, &lines);
+    fclose(file);
+
+    CuAssert(tc, "written", lines.messages == 1);
+    CuAssert(tc, "cut", lines.longest < MS_LOG_TEXT + 64);
+}
+
+/* Wall clock seconds, the writer's time must not be counted. */
+static double wall_seconds() {
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+/* Time logging in bursts of half a ring, letting the writer catch up in between. */
+static double log_seconds() {
+    double seconds = 0.0;
+    uint32_t imessage = 0;
+
+    while (imessage < BENCH_MESSAGES) {
+        double start = wall_seconds();
+        uint32_t iburst;
+
+        for (iburst = 0; iburst < MS_LOG_RING_RECORDS / 2; iburst++, imessage++) ms_log_warn("message %d to %s", imessage, "peer");
+        seconds += wall_seconds() - start;
+        ms_log_flush();
+    }
+    return seconds / imessage;
+}
+
+/**
+ *  Benchmark the time a logging call takes on the calling thread.
+ */
+static void bench_log(CuTest* tc) {
+    FILE* file = tmpfile();
+    uint32_t dropped = ms_log_dropped();
+    double sync;
+    double async;
+
+    ms_log_setfile(file);
+    sync = log_seconds();
+    ms_log_start();
+    async = log_seconds();
+    ms_log_stop();
+    ms_log_setfile(stderr);
+    fclose(file);
+
+    printf("log call: sync %.0f ns, async %.0f ns\n", sync * 1.0e9, async * 1.0e9);
+    CuAssert(tc, "none dropped", ms_log_dropped() == dropped);
+}
+
+static int evaluated;
+
+static int evaluate() {
+    return ++evaluated;
+}
+
+/**
+ *  Given the global level is fatal and the mcoap categories are set to warn,
+ *  When messages are logged under several categories,
+ *  Then only the enabled categories write, and a disabled call does not evaluate its arguments.
+ */
+static void test_log_categories(CuTest* tc) {
+    FILE* file = tmpfile();
+    ms_log_level_t saved = ms_log_getlevel();
+    ms_log_level_t endpt;
+    ms_log_level_t mnet;
+    int nmcoap;
+    int npartial;
+    lines_t lines;
+
+    evaluated = 0;
+    ms_log_setfile(file);
+    ms_log_setlevel(ms_fatal);
+    nmcoap = ms_log_set_named_level("mcoap", ms_warn);
+    npartial = ms_log_set_named_level("mcoap.end", ms_debug);
+    endpt = ms_log_get_category_level(MS_LOG_ENDPT);
+    mnet = ms_log_get_category_level(MS_LOG_MNET);
+
+    ms_log_category(MS_LOG_ENDPT, ms_warn, __FILE__, __LINE__, "endpoint");
+    ms_log_category(MS_LOG_MNET, ms_warn, __FILE__, __LINE__, "network");
+    ms_log_warn("app %d", evaluate());
+    ms_log_set_category_level(MS_LOG_APP, ms_warn);
+    ms_log_warn("app %d", evaluate());
+
+    ms_log_setlevel(saved);
+    ms_log_setfile(stderr);
+    read_lines(file, &lines);
+    fclose(file);
+
+    CuAssert(tc, "mcoap and below set", nmcoap == 3 && npartial == 0);
+    CuAssert(tc, "levels", endpt == ms_warn && mnet == ms_fatal);
+    CuAssert(tc, "named", strcmp(ms_log_category_name(MS_LOG_ENDPT), "mcoap.endpt") == 0);
+    CuAssert(tc, "enabled categories written", lines.messages == 2);
+    CuAssert(tc, "disabled call not evaluated", evaluated == 1);
+}
+
+/**
+ *  Given a rate limited call site,
+ *  When it fires many times in a row,
+ *  Then about a burst a second is written, and the next second reports how many were suppressed.
+ */
+static void test_log_limited(CuTest* tc) {
+    FILE* file = tmpfile();
+    ms_log_limit_t limit;
+    uint32_t allowed = 0;
+    int again;
+    int imessage;
+    lines_t lines;
+
+    memset(&limit, 0, sizeof(limit));
+    ms_log_setfile(file);
+
+    for (imessage = 0; imessage < 100; imessage++) allowed += ms_log_limit(&limit, MS_LOG_APP, ms_warn, __FILE__, __LINE__);
+
+    /* Move the site back a second, as if it had gone quiet. */
+    limit.second--;
+    again = ms_log_limit(&limit, MS_LOG_APP, ms_warn, __FILE__, __LINE__);
+
+    for (imessage = 0; imessage < 100; imessage++) ms_log_warn_limited("limited %d", imessage);
+
+    ms_log_setfile(stderr);
+    read_lines(file, &lines);
+    fclose(file);
+
+    /* A loop may straddle a second, which lets a second burst through. */
+    CuAssert(tc, "burst allowed", allowed >= MS_LOG_LIMIT_BURST && allowed <= 2 * MS_LOG_LIMIT_BURST);
+    CuAssert(tc, "allowed after a quiet second", again);
+    CuAssert(tc, "suppressed reported", lines.suppressed >= 1);
+    CuAssert(tc, "macro limited", lines.messages >= MS_LOG_LIMIT_BURST + 1 && lines.messages <= 2 * MS_LOG_LIMIT_BURST + 4);
+}
+
+/**
+ *  Benchmark a call site whose category is disabled, against calling ms_log to check the level.
+ */
+static void bench_log_disabled(CuTest* tc) {
+    ms_log_level_t saved = ms_log_getlevel();
+    double start;
+    double inline_ns;
+    double call_ns;
+    int imessage;
+
+    ms_log_setlevel(ms_fatal);
+
+    start = wall_seconds();
+    for (imessage = 0; imessage < BENCH_DISABLED; imessage++) ms_log_warn("message %d", imessage);
+    inline_ns = (wall_seconds() - start) * 1.0e9 / BENCH_DISABLED;
+
+    start = wall_seconds();
+    for (imessage = 0; imessage < BENCH_DISABLED; imessage++) ms_log(ms_warn, __FILE__, __LINE__, "message %d", imessage);
+    call_ns = (wall_seconds() - start) * 1.0e9 / BENCH_DISABLED;
+
+    ms_log_setlevel(saved);
+    printf("disabled log call: category check %.2f ns, ms_log %.2f ns\n", inline_ns, call_ns);
+}
+
+CuSuite* ms_log_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_log_async);
+    SUITE_ADD_TEST(suite, test_log_truncate);
+    SUITE_ADD_TEST(suite, test_log_categories);
+    SUITE_ADD_TEST(suite, test_log_limited);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* ms_log_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_log);
+    SUITE_ADD_TEST(suite, bench_log_disabled);
+
+    return suite;
+}
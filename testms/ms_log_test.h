@@ -0,0 +1,9 @@
+#ifndef MS_LOG_TEST_H
+#define MS_LOG_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* ms_log_suite();
+CuSuite* ms_log_bench_suite();
+
+#endif
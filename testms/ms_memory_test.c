@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "msys/ms_copy.h"
+#include "msys/ms_memory.h"
+#include "msys/ms_thread.h"
+#include "testms/ms_memory_test.h"
+
+#include "cutest/CuTest.h"
+
+/* Counts the calls and live blocks, delegating to the default allocator. */
+typedef struct {
+    uint32_t calls;
+    int32_t live;
+} counts_t;
+
+static void* count_malloc(void* ctx, size_t size) {
+    ((counts_t*)ctx)->calls++;
+    ((counts_t*)ctx)->live++;
+    return ms_allocator_default()->malloc_fn(0, size);
+}
+
+static void* count_calloc(void* ctx, size_t count, size_t size) {
+    ((counts_t*)ctx)->calls++;
+    ((counts_t*)ctx)->live++;
+    return ms_allocator_default()->calloc_fn(0, count, size);
+}
+
+static void* count_realloc(void* ctx, void* ptr, size_t size) {
+    ((counts_t*)ctx)->calls++;
+    if (ptr == 0) ((counts_t*)ctx)->live++;
+    return ms_allocator_default()->realloc_fn(0, ptr, size);
+}
+
+static void count_free(void* ctx, void* ptr) {
+    ((counts_t*)ctx)->calls++;
+    ((counts_t*)ctx)->live--;
+    ms_allocator_default()->free_fn(0, ptr);
+}
+
+/**
+ *  Given a counting allocator is installed,
+ *  When the library allocates, reallocates and frees,
+ *  Then every call goes through it with its context, and restoring gives back the default.
+ */
+static void test_memory_allocator(CuTest* tc) {
+    counts_t counts = { 0, 0 };
+    ms_allocator_t counting = { count_malloc, count_calloc, count_realloc, count_free, &counts };
+    const ms_allocator_t* previous = ms_allocator_set(&counting);
+    uint32_t* values;
+    char* copy;
+
+    CuAssert(tc, "default was installed", previous == ms_allocator_default());
+    CuAssert(tc, "installed", ms_allocator_get() == &counting);
+
+    values = ms_malloc(4, uint32_t);
+    values = ms_realloc(values, 1 + 7, uint32_t);
+    values[7] = 7;
+    copy = ms_copy_str("counted");
+    CuAssert(tc, "three calls", counts.calls == 3 && counts.live == 2);
+
+    ms_free(values);
+    ms_free(copy);
+    ms_free(0);
+    CuAssert(tc, "all freed", counts.calls == 5 && counts.live == 0);
+
+    ms_allocator_set(0);
+    CuAssert(tc, "default restored", ms_allocator_get() == ms_allocator_default());
+
+    values = ms_calloc(2, uint32_t);
+    ms_free(values);
+    CuAssert(tc, "not counted after restore", counts.calls == 5);
+}
+
+/* The change in a tag's usage since base. */
+static ms_mem_usage_t* usage_since(uint32_t tag, const ms_mem_usage_t* base, ms_mem_usage_t* usage) {
+    ms_mem_usage(tag, usage);
+    usage->bytes -= base->bytes;
+    usage->objects -= base->objects;
+    return usage;
+}
+
+/**
+ *  Given tagged allocations,
+ *  When blocks are allocated, resized, retagged and freed,
+ *  Then each tag counts its live bytes and blocks.
+ */
+static void test_memory_tags(CuTest* tc) {
+    ms_mem_usage_t uri;
+    ms_mem_usage_t option;
+    ms_mem_usage_t usage;
+    uint32_t* values;
+    char* copy;
+
+    ms_mem_usage(MS_MEM_URI, &uri);
+    ms_mem_usage(MS_MEM_OPTION, &option);
+
+    values = ms_malloc_tag(MS_MEM_URI, 4, uint32_t);
+    CuAssert(tc, "counted", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 16 && usage.objects == 1);
+
+    values = ms_realloc(values, 8, uint32_t);
+    CuAssert(tc, "resize keeps the tag", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 32 && usage.objects == 1);
+
+    values = ms_realloc_tag(MS_MEM_OPTION, values, 2, uint32_t);
+    CuAssert(tc, "moved off", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 0 && usage.objects == 0);
+    CuAssert(tc, "moved to", usage_since(MS_MEM_OPTION, &option, &usage)->bytes == 8 && usage.objects == 1);
+
+    copy = ms_mem_retag(ms_copy_str("coap://host"), MS_MEM_URI);
+    CuAssert(tc, "retagged", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 12 && usage.objects == 1);
+
+    ms_free(values);
+    ms_free(copy);
+    CuAssert(tc, "uri freed", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 0 && usage.objects == 0);
+    CuAssert(tc, "option freed", usage_since(MS_MEM_OPTION, &option, &usage)->bytes == 0 && usage.objects == 0);
+
+    ms_mem_account(MS_MEM_URI, 4096, 1);
+    CuAssert(tc, "accounted", usage_since(MS_MEM_URI, &uri, &usage)->bytes == 4096);
+    ms_mem_account(MS_MEM_URI, -4096, -1);
+
+    CuAssert(tc, "names", strcmp(ms_mem_tag_name(MS_MEM_SOCKADDR), "sockaddr") == 0 && ms_mem_tag_name(MS_MEM_NTAGS) == 0);
+}
+
+static char* thread_blocks[100];
+
+static void allocate_blocks(void* arg) {
+    uint32_t iblock;
+
+    for (iblock = 0; iblock < 100; iblock++) thread_blocks[iblock] = ms_malloc_tag(MS_MEM_QUEUE, 10, char);
+}
+
+/**
+ *  Given blocks allocated on another thread,
+ *  When they are freed on this one,
+ *  Then the counts summed over threads come back to where they were.
+ */
+static void test_memory_threads(CuTest* tc) {
+    ms_mem_usage_t queue;
+    ms_mem_usage_t usage;
+    uint32_t iblock;
+
+    ms_mem_usage(MS_MEM_QUEUE, &queue);
+    ms_free(ms_thread_deinit(ms_thread_init(ms_thread_alloc(), allocate_blocks, 0)));
+    CuAssert(tc, "other thread counted", usage_since(MS_MEM_QUEUE, &queue, &usage)->bytes == 1000 && usage.objects == 100);
+
+    for (iblock = 0; iblock < 100; iblock++) ms_free(thread_blocks[iblock]);
+    CuAssert(tc, "freed here", usage_since(MS_MEM_QUEUE, &queue, &usage)->bytes == 0 && usage.objects == 0);
+}
+
+CuSuite* ms_memory_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_memory_allocator);
+    SUITE_ADD_TEST(suite, test_memory_tags);
+    SUITE_ADD_TEST(suite, test_memory_threads);
+
+    return suite;
+}
@@ -0,0 +1,8 @@
+#ifndef MS_MEMORY_TEST_H
+#define MS_MEMORY_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* ms_memory_suite();
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_pool.h"
+#include "msys/ms_thread.h"
+
+#include "testms/ms_pool_test.h"
+
+#define OBJECT_BYTES 40
+#define THREAD_ROUNDS 10000
+#define BENCH_ROUNDS 10000000
+
+/**
+ *  Given a pool,
+ *  When we take objects, put one back and take another,
+ *  Then the objects are distinct and aligned, and the one put back is reused.
+ */
+static void test_pool_reuse(CuTest* tc) {
+    ms_pool_t pool;
+    void* first;
+    void* second;
+    void* again;
+
+    ms_pool_init(&pool, "test", OBJECT_BYTES);
+    first = ms_pool_get(&pool);
+    second = ms_pool_get(&pool);
+    CuAssert(tc, "got objects", first != 0 && second != 0 && first != second);
+    CuAssert(tc, "aligned", ((size_t)first % (2 * sizeof(void*))) == 0);
+    CuAssert(tc, "no overlap", (char*)second - (char*)first >= OBJECT_BYTES || (char*)first - (char*)second >= OBJECT_BYTES);
+    memset(first, 0xa5, OBJECT_BYTES);
+    memset(second, 0x5a, OBJECT_BYTES);
+
+    ms_pool_put(&pool, first);
+    again = ms_pool_get(&pool);
+    CuAssert(tc, "reused", again == first);
+
+    ms_pool_put(&pool, again);
+    ms_pool_put(&pool, second);
+    ms_pool_put(&pool, 0);
+    ms_pool_deinit(&pool);
+}
+
+/**
+ *  Given a pool with a reserved working set,
+ *  When we take and return more objects than a thread keeps,
+ *  Then no slab is added, and the stats track the high-water mark.
+ */
+static void test_pool_reserve(CuTest* tc) {
+    ms_pool_t pool;
+    ms_pool_stats_t stats;
+    void* objects[200];
+    uint32_t iobject;
+    uint32_t nslabs;
+
+    ms_pool_init(&pool, "test", OBJECT_BYTES);
+    CuAssert(tc, "reserved", ms_pool_reserve(&pool, 1000));
+    ms_pool_stats(&pool, &stats);
+    CuAssert(tc, "capacity", stats.capacity >= 1000 && stats.outstanding == 0 && stats.highwater == 0);
+    nslabs = stats.nslabs;
+
+    objects[0] = ms_pool_get(&pool);
+    ms_pool_stats(&pool, &stats);
+    CuAssert(tc, "one out", stats.outstanding == 1 && stats.highwater == 1);
+
+    for (iobject = 1; iobject < 200; iobject++) objects[iobject] = ms_pool_get(&pool);
+    ms_pool_stats(&pool, &stats);
+    CuAssert(tc, "outstanding counts gets", stats.outstanding == 200 && stats.highwater == 200);
+
+    for (iobject = 0; iobject < 200; iobject++) ms_pool_put(&pool, objects[iobject]);
+    ms_pool_flush(&pool);
+    ms_pool_stats(&pool, &stats);
+    CuAssert(tc, "all returned", stats.outstanding == 0);
+    CuAssert(tc, "high-water kept", stats.highwater == 200);
+    CuAssert(tc, "no new slab", stats.nslabs == nslabs);
+
+    ms_pool_deinit(&pool);
+    ms_pool_stats(&pool, &stats);
+    CuAssert(tc, "deinit clears", stats.nslabs == 0 && stats.capacity == 0);
+}
+
+static ms_pool_t shared = MS_POOL_STATIC("shared", OBJECT_BYTES);
+static volatile int overwritten;
+
+/* Take and return objects in bursts, checking no other thread holds them. */
+static void churn(void* arg) {
+    void* objects[100];
+    uint32_t round;
+    uint32_t iobject;
+
+    for (round = 0; round < THREAD_ROUNDS / 100; round++) {
+        for (iobject = 0; iobject < 100; iobject++) {
+            objects[iobject] = ms_pool_get(&shared);
+            memset(objects[iobject], (int)(size_t)arg, OBJECT_BYTES);
+        }
+        for (iobject = 0; iobject < 100; iobject++) {
+            if (((uint8_t*)objects[iobject])[OBJECT_BYTES - 1] != (uint8_t)(size_t)arg) overwritten = 1;
+            ms_pool_put(&shared, objects[iobject]);
+        }
+    }
+    ms_pool_flush(&shared);
+}
+
+/**
+ *  Given a statically defined pool,
+ *  When several threads take and return objects and flush,
+ *  Then every object comes back to the shared list.
+ */
+static void test_pool_threads(CuTest* tc) {
+    ms_thread_t* threads[4];
+    ms_pool_stats_t stats;
+    uint32_t ithread;
+
+    for (ithread = 0; ithread < 4; ithread++) {
+        threads[ithread] = ms_thread_init(ms_thread_alloc(), churn, (void*)(size_t)(ithread + 1));
+    }
+    for (ithread = 0; ithread < 4; ithread++) ms_free(ms_thread_deinit(threads[ithread]));
+
+    ms_pool_stats(&shared, &stats);
+    CuAssert(tc, "no object shared between threads", !overwritten);
+    CuAssert(tc, "all returned", stats.outstanding == 0);
+    CuAssert(tc, "used", stats.highwater >= 100 && stats.capacity >= stats.highwater);
+    ms_pool_deinit(&shared);
+}
+
+/**
+ *  Benchmark the pool against malloc and free.
+ */
+static void bench_pool(CuTest* tc) {
+    ms_pool_t pool;
+    void* objects[16];
+    clock_t start;
+    double pool_ns;
+    double libc_ns;
+    int round;
+    int iobject;
+
+    ms_pool_init(&pool, "bench", OBJECT_BYTES);
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS / 16; round++) {
+        for (iobject = 0; iobject < 16; iobject++) objects[iobject] = ms_pool_get(&pool);
+        for (iobject = 0; iobject < 16; iobject++) ms_pool_put(&pool, objects[iobject]);
+    }
+    pool_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / BENCH_ROUNDS;
+    ms_pool_deinit(&pool);
+
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS / 16; round++) {
+        for (iobject = 0; iobject < 16; iobject++) objects[iobject] = malloc(OBJECT_BYTES);
+        for (iobject = 0; iobject < 16; iobject++) free(objects[iobject]);
+    }
+    libc_ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / BENCH_ROUNDS;
+
+    printf("pool get/put: %.2f ns, malloc/free: %.2f ns\n", pool_ns, libc_ns);
+}
+
+CuSuite* ms_pool_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_pool_reuse);
+    SUITE_ADD_TEST(suite, test_pool_reserve);
+    SUITE_ADD_TEST(suite, test_pool_threads);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* ms_pool_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_pool);
+
+    return suite;
+}
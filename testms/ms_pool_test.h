@@ -0,0 +1,9 @@
+#ifndef MS_POOL_TEST_H
+#define MS_POOL_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* ms_pool_suite();
+CuSuite* ms_pool_bench_suite();
+
+#endif
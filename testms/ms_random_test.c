@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msys/ms_memory.h"
+#include "msys/ms_random.h"
+#include "msys/ms_thread.h"
+
+#include "testms/ms_random_test.h"
+
+#define BENCH_ROUNDS 10000000
+
+static ms_random_t* worker_rng;
+
+static void record_rng(void* arg) {
+    worker_rng = ms_random_thread();
+    *(uint64_t*)arg = ms_random_next(worker_rng);
+}
+
+/**
+ *  Given two generators with the same seed,
+ *  When we draw from both,
+ *  Then they produce the same sequence, and a different seed does not.
+ */
+static void test_random_seed(CuTest* tc) {
+    ms_random_t a;
+    ms_random_t b;
+    ms_random_t c;
+    int same = 1;
+    int round;
+
+    ms_random_init_seed(&a, 42);
+    ms_random_init_seed(&b, 42);
+    ms_random_init_seed(&c, 43);
+
+    for (round = 0; round < 100; round++) {
+        uint64_t value = ms_random_next(&a);
+        same = same && value == ms_random_next(&b);
+        CuAssert(tc, "other seed differs", value != ms_random_next(&c));
+    }
+    CuAssert(tc, "same seed, same sequence", same);
+}
+
+/**
+ *  Given an OS seeded generator,
+ *  When we draw fractions and fill bytes,
+ *  Then fractions are in [0, 1) and partial fills only touch the requested bytes.
+ */
+static void test_random_fill(CuTest* tc) {
+    ms_random_t rng;
+    uint8_t bytes[16];
+    int round;
+    int inrange = 1;
+
+    ms_random_init(&rng);
+    for (round = 0; round < 1000; round++) {
+        double fraction = ms_random_fraction(&rng);
+        inrange = inrange && fraction >= 0.0 && fraction < 1.0;
+    }
+    CuAssert(tc, "fractions in range", inrange);
+
+    memset(bytes, 0xee, sizeof(bytes));
+    ms_random_fill(&rng, bytes, 11);
+    CuAssert(tc, "tail untouched", bytes[11] == 0xee && bytes[15] == 0xee);
+    CuAssert(tc, "os bytes", ms_random_os_bytes(bytes, sizeof(bytes)));
+}
+
+/**
+ *  Given the calling thread's generator,
+ *  When another thread asks for its generator,
+ *  Then it gets its own.
+ */
+static void test_random_thread(CuTest* tc) {
+    ms_thread_t* thread;
+    uint64_t value = 0;
+    ms_random_t* mine = ms_random_thread();
+
+    CuAssert(tc, "same generator on this thread", ms_random_thread() == mine);
+
+    thread = ms_thread_init(ms_thread_alloc(), record_rng, &value);
+    ms_free(ms_thread_deinit(thread));
+
+    CuAssert(tc, "worker ran", worker_rng != 0);
+    CuAssert(tc, "worker has its own generator", worker_rng != mine);
+}
+
+/**
+ *  Benchmark the generator against rand().
+ */
+static void bench_random(CuTest* tc) {
+    ms_random_t* rng = ms_random_thread();
+    uint64_t sum = 0;
+    clock_t start;
+    double fast_ns;
+    double libc_ns;
+    int round;
+
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS; round++) sum += ms_random_next(rng);
+    fast_ns = (double)(clock() - start) * 1.0e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+
+    start = clock();
+    for (round = 0; round < BENCH_ROUNDS; round++) sum += (uint64_t)rand();
+    libc_ns = (double)(clock() - start) * 1.0e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+
+    printf("random: xoshiro256** %.1f ns, rand() %.1f ns (%llu)\n", fast_ns, libc_ns, (unsigned long long)(sum & 1));
+}
+
+/* Run all of the tests in this test suite. */
+CuSuite* ms_random_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, test_random_seed);
+    SUITE_ADD_TEST(suite, test_random_fill);
+    SUITE_ADD_TEST(suite, test_random_thread);
+
+    return suite;
+}
+
+/* The benchmarks, run with -bench. */
+CuSuite* ms_random_bench_suite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, bench_random);
+
+    return suite;
+}
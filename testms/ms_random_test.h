@@ -0,0 +1,9 @@
+#ifndef MS_RANDOM_TEST_H
+#define MS_RANDOM_TEST_H
+
+#include "cutest/CuTest.h"
+
+CuSuite* ms_random_suite();
+CuSuite* ms_random_bench_suite();
+
+#endif
@@ -6,6 +6,10 @@
 #include "msys/ms_log.h"
 
 #include "testms/ms_endian_test.h"
+#include "testms/ms_log_test.h"
+#include "testms/ms_memory_test.h"
+#include "testms/ms_pool_test.h"
+#include "testms/ms_random_test.h"
 
 #if defined(WIN32) && defined(_DEBUG)
 
@@ -30,7 +34,8 @@ static void add_tmp_suite(CuSuite* primary, CuSuite* secondary) {
     free(secondary);
 }
 
-void run_all_tests() {
+/** Run the unit tests, or with bench only the benchmarks, which print their timings. */
+void run_all_tests(int bench) {
     CuString *summary = CuStringNew();
     CuSuite* suite = CuSuiteNew();
 
@@ -39,7 +44,18 @@ void run_all_tests() {
 
     ms_log_debug("starting testing");
 
-    add_tmp_suite(suite, ms_endian_suite());
+    if (bench) {
+        add_tmp_suite(suite, ms_random_bench_suite());
+        add_tmp_suite(suite, ms_pool_bench_suite());
+        add_tmp_suite(suite, ms_log_bench_suite());
+    }
+    else {
+        add_tmp_suite(suite, ms_endian_suite());
+        add_tmp_suite(suite, ms_log_suite());
+        add_tmp_suite(suite, ms_memory_suite());
+        add_tmp_suite(suite, ms_pool_suite());
+        add_tmp_suite(suite, ms_random_suite());
+    }
 
     CuSuiteRun(suite);
     
@@ -52,9 +68,18 @@ void run_all_tests() {
 }
 
 int main(int argc, char** argv) {
-    run_all_tests();
+    int bench = 0;
+    int leaks = 0;
+    int iarg;
+
+    for (iarg = 1; iarg < argc; iarg++) {
+        if (strcmp("-bench", argv[iarg]) == 0) bench = 1;
+        if (strcmp("-leaks", argv[iarg]) == 0) leaks = 1;
+    }
+
+    run_all_tests(bench);
 
-    if (argc > 1 && strcmp("-leaks", argv[1]) == 0) {
+    if (leaks) {
         dumpMemLeaks();
     }
 